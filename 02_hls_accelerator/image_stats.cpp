@@ -15,41 +15,14 @@
 #include "image_stats.h"
 
 /* ======================================================================
- * compute_image_stats – single-pass mean / std / contrast
- *
- * OPTIMIZATION:
- * - All statistics computed in single pass (1 iteration per pixel)
- * - Accumulation uses uint64 for sum_sq to prevent overflow
- * - Min/max tracking is purely combinational (no extra cycles)
+ * finish_stats – mean / std / contrast from the raw sums (shared by the
+ * pixel and histogram versions, so both give identical results)
  * ====================================================================*/
-void compute_image_stats(const uint8_t img[IMG_SIZE],
+static void finish_stats(uint64_t sum, uint64_t sum_sq,
+                         uint8_t v_min, uint8_t v_max,
                          ImageStats *stats)
 {
-#pragma HLS INLINE off
-
-    uint64_t sum = 0;
-    uint64_t sum_sq = 0;
-    uint8_t v_min = 255;
-    uint8_t v_max = 0;
-
-STATS_LOOP:
-    for (int i = 0; i < IMG_SIZE; i++)
-    {
-#pragma HLS PIPELINE II = 1
-#pragma HLS LOOP_TRIPCOUNT min = 16384 max = 16384 avg = 16384
-        uint8_t px = img[i];
-        
-        /* Accumulate sum and sum of squares */
-        sum += px;
-        sum_sq += (uint32_t)px * px;
-        
-        /* Track min/max (pure combinational logic) */
-        if (px < v_min)
-            v_min = px;
-        if (px > v_max)
-            v_max = px;
-    }
-
+#pragma HLS INLINE
     uint8_t mean = (uint8_t)(sum / IMG_SIZE);
 
     /* 
@@ -93,6 +66,79 @@ STATS_LOOP:
     stats->max_val = v_max;
 }
 
+/* ======================================================================
+ * compute_image_stats – single-pass mean / std / contrast
+ *
+ * OPTIMIZATION:
+ * - All statistics computed in single pass (1 iteration per pixel)
+ * - Accumulation uses uint64 for sum_sq to prevent overflow
+ * - Min/max tracking is purely combinational (no extra cycles)
+ * ====================================================================*/
+void compute_image_stats(const uint8_t img[IMG_SIZE],
+                         ImageStats *stats)
+{
+#pragma HLS INLINE off
+
+    uint64_t sum = 0;
+    uint64_t sum_sq = 0;
+    uint8_t v_min = 255;
+    uint8_t v_max = 0;
+
+STATS_LOOP:
+    for (int i = 0; i < IMG_SIZE; i++)
+    {
+#pragma HLS PIPELINE II = 1
+#pragma HLS LOOP_TRIPCOUNT min = 16384 max = 16384 avg = 16384
+        uint8_t px = img[i];
+        
+        /* Accumulate sum and sum of squares */
+        sum += px;
+        sum_sq += (uint32_t)px * px;
+        
+        /* Track min/max (pure combinational logic) */
+        if (px < v_min)
+            v_min = px;
+        if (px > v_max)
+            v_max = px;
+    }
+
+    finish_stats(sum, sum_sq, v_min, v_max, stats);
+}
+
+/* ======================================================================
+ * compute_hist_stats – the same statistics from a histogram
+ *
+ * One bin per cycle: the sums are weighted by the bin counts, and the
+ * range is that of the non-empty bins.
+ * ====================================================================*/
+void compute_hist_stats(const uint32_t hist[NUM_BINS],
+                        ImageStats *stats)
+{
+#pragma HLS INLINE off
+
+    uint64_t sum = 0;
+    uint64_t sum_sq = 0;
+    uint8_t v_min = 255;
+    uint8_t v_max = 0;
+
+HIST_STATS_LOOP:
+    for (int v = 0; v < NUM_BINS; v++)
+    {
+#pragma HLS PIPELINE II = 1
+        uint32_t n = hist[v];
+        sum += (uint64_t)n * v;
+        sum_sq += (uint64_t)n * (uint32_t)(v * v);
+        if (n != 0)
+        {
+            if (v < v_min)
+                v_min = (uint8_t)v;
+            v_max = (uint8_t)v;
+        }
+    }
+
+    finish_stats(sum, sum_sq, v_min, v_max, stats);
+}
+
 /* ======================================================================
  * select_mode – rule-based adaptive mode selector
  *
@@ -32,6 +32,13 @@ typedef struct
 void compute_image_stats(const uint8_t img[IMG_SIZE],
                          ImageStats *stats);
 
+/*--------------------------------------------------------------------------
+ * The same statistics from a 256-bin histogram of the image (NUM_BINS
+ * cycles instead of a pass over the pixels)
+ *------------------------------------------------------------------------*/
+void compute_hist_stats(const uint32_t hist[NUM_BINS],
+                        ImageStats *stats);
+
 /*--------------------------------------------------------------------------
  * Select processing mode from statistics
  *   High contrast, clear separation  → MODE_FAST
@@ -0,0 +1,185 @@
+/*******************************************************************************
+ * otsu_multichannel.cpp
+ * ----------------------
+ * HLS implementation of the multi-channel Otsu kernel (see
+ * otsu_multichannel.h).
+ *
+ * Pipeline overview
+ * -----------------
+ *   1. READ_IN        – one 32-bit beat per pixel tuple, unpacked into one
+ *                       BRAM plane per channel
+ *   2. histograms     – compute_histogram() per channel, side by side
+ *   3. thresholds     – otsu_compute() per channel, side by side
+ *   4. COMBINE        – per-channel compare, LUT fusion, channel counts
+ *   5. morphology     – morph_open_3x3 / morph_close_3x3 on the fused mask
+ *   6. COUNT_AND_WRITE
+ *
+ * The per-channel loops are fully unrolled over independent planes and
+ * histograms, so the scheduler gives each channel its own histogram and
+ * Otsu instance and the stage latency does not grow with the channel count.
+ ******************************************************************************/
+#include "otsu_multichannel.h"
+
+/* Nominal latency of one line-buffer erode/dilate pass */
+#define MC_MORPH_PASS_CYCLES ((IMG_HEIGHT + 1) * (IMG_WIDTH + 1))
+
+/* ======================================================================
+ * Top-level accelerator function
+ * ====================================================================*/
+void otsu_multichannel_top(
+    const uint32_t img_in[IMG_SIZE],
+    uint8_t img_out[IMG_SIZE],
+    uint8_t mode,
+    uint8_t channels,
+    uint16_t combine,
+    McResult *result,
+    volatile const uint32_t *cycle_counter)
+{
+/* ============== AXI Interface Configuration ============== */
+/*
+ * img_in is 32 bits wide: a whole pixel tuple per beat, so the read
+ * bandwidth is that of the single-channel kernel.
+ */
+#pragma HLS INTERFACE m_axi port=img_in offset=slave bundle=gmem0 depth=IMG_SIZE \
+    max_read_burst_length=64 latency=64 num_read_outstanding=4
+#pragma HLS INTERFACE m_axi port=img_out offset=slave bundle=gmem1 depth=IMG_SIZE \
+    max_write_burst_length=64 latency=64 num_write_outstanding=4
+
+#pragma HLS INTERFACE s_axilite port=mode bundle=control
+#pragma HLS INTERFACE s_axilite port=channels bundle=control
+#pragma HLS INTERFACE s_axilite port=combine bundle=control
+#pragma HLS INTERFACE s_axilite port=result bundle=control
+#pragma HLS INTERFACE s_axilite port=return bundle=control
+
+#pragma HLS INTERFACE ap_none port=cycle_counter
+
+    mode &= MODE_MASK;
+    if (mode == MODE_AUTO)
+        mode = MODE_FAST;
+    if (channels < 1)
+        channels = 1;
+    if (channels > MC_MAX_CHANNELS)
+        channels = MC_MAX_CHANNELS;
+
+    uint32_t stamp[NUM_STAGES + 1];
+#pragma HLS ARRAY_PARTITION variable=stamp complete dim=1
+
+    /* One BRAM plane and histogram per channel, accessed in parallel */
+    uint8_t planes[MC_MAX_CHANNELS][IMG_SIZE];
+    uint8_t local_out[IMG_SIZE];
+    uint32_t hist[MC_MAX_CHANNELS][NUM_BINS];
+    uint8_t thr[MC_MAX_CHANNELS];
+    uint16_t sep[MC_MAX_CHANNELS];
+    uint32_t ch_fg[MC_MAX_CHANNELS];
+
+#pragma HLS ARRAY_PARTITION variable=planes complete dim=1
+#pragma HLS BIND_STORAGE variable=planes type=ram_2p impl=bram
+#pragma HLS BIND_STORAGE variable=local_out type=ram_2p impl=bram
+#pragma HLS ARRAY_PARTITION variable=hist complete dim=1
+#if HIST_IMPL == HIST_IMPL_BRAM
+#pragma HLS BIND_STORAGE variable=hist type=ram_2p impl=bram
+#endif
+#pragma HLS ARRAY_PARTITION variable=thr complete dim=1
+#pragma HLS ARRAY_PARTITION variable=sep complete dim=1
+#pragma HLS ARRAY_PARTITION variable=ch_fg complete dim=1
+
+    stamp[STAGE_READ_IN] = stage_timestamp(cycle_counter, 0);
+
+    /* ============== Stage 1: Burst Read + Unpack ============== */
+READ_IN:
+    for (int i = 0; i < IMG_SIZE; i++)
+    {
+#pragma HLS PIPELINE II = 1
+        uint32_t tuple = img_in[i];
+        for (int c = 0; c < MC_MAX_CHANNELS; c++)
+        {
+#pragma HLS UNROLL
+            planes[c][i] = (uint8_t)(tuple >> (8 * c));
+        }
+    }
+    stamp[STAGE_HISTOGRAM] = stage_timestamp(cycle_counter, IMG_SIZE);
+
+    /* ============== Stage 2: Per-channel Histograms ============== */
+CH_HIST:
+    for (int c = 0; c < MC_MAX_CHANNELS; c++)
+    {
+#pragma HLS UNROLL
+        if (c < channels)
+            compute_histogram(planes[c], hist[c]);
+    }
+    stamp[STAGE_SWEEP] = stage_timestamp(
+        cycle_counter, IMG_SIZE + (HIST_IMPL == HIST_IMPL_BRAM ? NUM_BINS : 0));
+
+    /* ============== Stage 3: Per-channel Otsu ============== */
+CH_OTSU:
+    for (int c = 0; c < MC_MAX_CHANNELS; c++)
+    {
+#pragma HLS UNROLL
+        sep[c] = 0;
+        thr[c] = c < channels ? otsu_compute(hist[c], &sep[c]) : 0;
+        ch_fg[c] = 0;
+    }
+    stamp[STAGE_ADAPTIVE] = stage_timestamp(
+        cycle_counter, (HIST_IMPL == HIST_IMPL_BRAM ? 3 : 2) * NUM_BINS);
+    stamp[STAGE_THRESHOLD] = stage_timestamp(cycle_counter, 0);
+
+    /* ============== Stage 4: Threshold + Combine ============== */
+COMBINE:
+    for (int i = 0; i < IMG_SIZE; i++)
+    {
+#pragma HLS PIPELINE II = 1
+        uint8_t v = 0;
+        for (int c = 0; c < MC_MAX_CHANNELS; c++)
+        {
+#pragma HLS UNROLL
+            bool above = c < channels && planes[c][i] > thr[c];
+            v |= (uint8_t)above << c;
+            ch_fg[c] += above ? 1 : 0;
+        }
+        local_out[i] = ((combine >> v) & 1U) ? 255 : 0;
+    }
+    stamp[STAGE_OPEN] = stage_timestamp(cycle_counter, IMG_SIZE);
+
+    /* ============== Stage 5: Morphological Post-processing ============== */
+    if (mode >= MODE_NORMAL)
+        morph_open_3x3(local_out);
+    stamp[STAGE_CLOSE] = stage_timestamp(
+        cycle_counter, (mode >= MODE_NORMAL) ? 2 * MC_MORPH_PASS_CYCLES : 0);
+    if (mode == MODE_CAREFUL)
+        morph_close_3x3(local_out);
+    stamp[STAGE_WRITE_OUT] = stage_timestamp(
+        cycle_counter, (mode == MODE_CAREFUL) ? 2 * MC_MORPH_PASS_CYCLES : 0);
+
+    /* ============== Stage 6: Count Foreground & Write Output ============== */
+    uint32_t fg = 0;
+COUNT_AND_WRITE:
+    for (int i = 0; i < IMG_SIZE; i++)
+    {
+#pragma HLS PIPELINE II = 1
+        uint8_t px = local_out[i];
+        img_out[i] = px;
+        fg += px > 0 ? 1 : 0;
+    }
+    stamp[NUM_STAGES] = stage_timestamp(cycle_counter, IMG_SIZE);
+
+    /* ============== Stage 7: Write Result Struct ============== */
+    result->mode_used = mode;
+    result->channels = channels;
+    result->combine = combine;
+    result->foreground_pixels = fg;
+CH_RESULT:
+    for (int c = 0; c < MC_MAX_CHANNELS; c++)
+    {
+#pragma HLS UNROLL
+        result->thresholds[c] = thr[c];
+        result->channel_pixels[c] = ch_fg[c];
+        result->separability[c] = sep[c];
+    }
+
+STAGE_CYCLES:
+    for (int s = 0; s < NUM_STAGES; s++)
+    {
+#pragma HLS UNROLL
+        result->stage_cycles[s] = stamp[s + 1] - stamp[s];
+    }
+}
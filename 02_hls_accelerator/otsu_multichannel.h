@@ -0,0 +1,85 @@
+/*******************************************************************************
+ * otsu_multichannel.h
+ * --------------------
+ * Multi-channel variant of the Otsu kernel for co-registered MRI
+ * modalities (e.g. T1 / T2 / FLAIR).
+ *
+ * Up to MC_MAX_CHANNELS 8-bit planes arrive interleaved as one 32-bit
+ * pixel tuple per AXI beat (byte c = channel c), so the input costs one
+ * beat per pixel whatever the channel count.  Every channel gets its own
+ * histogram and Otsu threshold, computed side by side; the per-channel
+ * masks are then fused by a 16-entry lookup table and cleaned up with the
+ * single-channel kernel's morphology:
+ *
+ *   v    = sum over c of (plane_c > threshold_c) << c
+ *   mask = (combine >> v) & 1 ? 255 : 0
+ *
+ * Channels at or beyond 'channels' never set their bit.  MC_LUT_* give the
+ * usual functions; any other 16-bit pattern is accepted (e.g. 0x0088 for
+ * "channels 0 and 1, whatever channel 2 says").
+ *
+ * mode is the processing mode only (MODE_MASK bits): FAST thresholds,
+ * NORMAL adds the open, CAREFUL the close; MODE_AUTO runs as FAST.  The
+ * CAREFUL adaptive fall-back, contrast normalisation and the output /
+ * volume flags of otsu_threshold_top() are not part of this kernel.
+ *
+ * Resources: one compute_histogram / otsu_compute instance per channel,
+ * so build with HIST_IMPL_BRAM unless the four register histograms fit.
+ ******************************************************************************/
+#ifndef OTSU_MULTICHANNEL_H
+#define OTSU_MULTICHANNEL_H
+
+#include <stdint.h>
+#include "otsu_threshold.h" /* IMG_SIZE, NUM_STAGES, ProcessingMode */
+
+#define MC_MAX_CHANNELS 4
+
+/*--------------------------------------------------------------------------
+ * Combine LUT presets (bit v = fused output for channel vector v)
+ *------------------------------------------------------------------------*/
+#define MC_LUT_AND(n)    (1U << ((1U << (n)) - 1U)) /* all n channels   */
+#define MC_LUT_OR        0xFFFEU                    /* any channel      */
+#define MC_LUT_MAJORITY3 0x00E8U                    /* 2 of channels 0-2 */
+#define MC_LUT_MAJORITY4 0xE880U                    /* 3 of channels 0-3 */
+
+/*--------------------------------------------------------------------------
+ * Result structure (written to AXI-Lite registers)
+ *
+ * Same size as OtsuResult and the same stage_cycles offset, with the
+ * STAGE_* slots reused: READ_IN unpacks the tuples, HISTOGRAM and SWEEP
+ * cover all channels at once, ADAPTIVE is always 0, THRESHOLD is the
+ * per-channel threshold and combine pass.
+ *------------------------------------------------------------------------*/
+typedef struct
+{
+    uint8_t thresholds[MC_MAX_CHANNELS];      /* per channel      (offset 0)  */
+    uint8_t mode_used;                        /* mode executed    (offset 4)  */
+    uint8_t channels;                         /* channels used    (offset 5)  */
+    uint16_t combine;                         /* LUT applied      (offset 6)  */
+    uint32_t foreground_pixels;               /* fused mask       (offset 8)  */
+    uint32_t channel_pixels[MC_MAX_CHANNELS]; /* above threshold_c (offset 12) */
+    uint16_t separability[MC_MAX_CHANNELS];   /* eta_c, Q0.16     (offset 28) */
+    uint32_t stage_cycles[NUM_STAGES];        /* per-stage latency (offset 36) */
+} McResult;
+
+/*--------------------------------------------------------------------------
+ * Top-level HLS function
+ *   img_in    – pixel tuples, byte c = channel c (flattened row-major)
+ *   img_out   – fused binary mask (0 or 255)
+ *   mode      – processing mode (MODE_MASK bits)
+ *   channels  – planes present, 1 .. MC_MAX_CHANNELS (clamped)
+ *   combine   – fusion LUT
+ *   result    – output result metadata
+ *   cycle_counter – free-running clock-cycle counter, as for
+ *                   otsu_threshold_top()
+ *------------------------------------------------------------------------*/
+void otsu_multichannel_top(
+    const uint32_t img_in[IMG_SIZE],
+    uint8_t img_out[IMG_SIZE],
+    uint8_t mode,
+    uint8_t channels,
+    uint16_t combine,
+    McResult *result,
+    volatile const uint32_t *cycle_counter);
+
+#endif /* OTSU_MULTICHANNEL_H */
@@ -7,7 +7,8 @@
  * PERFORMANCE-OPTIMIZED VERSION
  * ============================================================================
  * Key optimizations:
- *   1. Complete histogram partitioning for true II=1 (8K FFs, worth it)
+ *   1. Complete histogram partitioning for true II=1 (8K FFs, worth it);
+ *      HIST_IMPL_BRAM trades that for a forwarding BRAM histogram
  *   2. Line-buffer based morphology for minimal BRAM bandwidth
  *   3. Wider AXI burst transfers (64-bit packing)
  *   4. Loop flattening where beneficial
@@ -22,6 +23,7 @@
  * Pipeline overview
  * -----------------
  *   1. compute_histogram()  – build a 256-bin histogram
+ *      normalize_contrast() – optional stretch / equalisation LUT
  *   2. otsu_compute()       – find optimal threshold (maximise σ²_B)
  *   3. apply_threshold()    – binarise the image
  *   4. morph_open / close   – optional morphological cleanup
@@ -33,10 +35,18 @@
  *   MODE_CAREFUL  – Otsu with adaptive fall-back + 1× open + 1× close
  ******************************************************************************/
 #include "otsu_threshold.h"
+#include "image_stats.h" /* compute_hist_stats, select_mode (MODE_AUTO) */
 #include <string.h> /* memset, memcpy */
 
 /* ======================================================================
- * 1. Histogram - FULLY PARTITIONED for II=1
+ * 1. Histogram
+ *
+ * Two implementations, selected at compile time with HIST_IMPL (see
+ * otsu_threshold.h).
+ * ====================================================================*/
+#if HIST_IMPL == HIST_IMPL_REGISTER
+/*
+ * 1a. Register histogram - FULLY PARTITIONED for II=1
  *
  * OPTIMIZATION RATIONALE:
  * - Complete partitioning stores all 256 bins in registers (8K FFs)
@@ -45,7 +55,7 @@
  *   same partition (1/16 probability of collision = still ~6% II=2)
  * - For 16K pixels, complete partitioning adds ~0.5% LUT overhead
  *   but guarantees II=1 for entire histogram loop
- * ====================================================================*/
+ */
 void compute_histogram(const uint8_t img_in[IMG_SIZE],
                        uint32_t hist[NUM_BINS])
 {
@@ -79,6 +89,95 @@ HIST_ACC:
         hist[pixel] = hist[pixel] + 1;
     }
 }
+#else
+/*
+ * 1b. BRAM histogram - area-lean, still II=1
+ *
+ * OPTIMIZATION RATIONALE:
+ * - hist lives in a single 1R1W BRAM (no FFs, no wide read mux)
+ * - A read-modify-write per pixel would carry a RAW hazard through the
+ *   BRAM latency, forcing II=2-3.  Instead:
+ *     * runs of identical pixels are counted in a register (acc) and only
+ *       written back when the value changes,
+ *     * the last HIST_FWD_DEPTH write-backs are kept in a tiny register
+ *       cache and forwarded when a read hits one of them (a, b, a ...),
+ *   so every BRAM read sees the up-to-date count and DEPENDENCE false is
+ *   safe.
+ */
+void compute_histogram(const uint8_t img_in[IMG_SIZE],
+                       uint32_t hist[NUM_BINS])
+{
+#pragma HLS INLINE off
+
+HIST_ZERO:
+    for (int i = 0; i < NUM_BINS; i++)
+    {
+#pragma HLS PIPELINE II = 1
+        hist[i] = 0;
+    }
+
+    /* Write-forwarding cache: most recent write-back in slot 0 */
+    uint8_t fwd_bin[HIST_FWD_DEPTH];
+    uint32_t fwd_val[HIST_FWD_DEPTH];
+    bool fwd_ok[HIST_FWD_DEPTH];
+#pragma HLS ARRAY_PARTITION variable = fwd_bin complete dim = 1
+#pragma HLS ARRAY_PARTITION variable = fwd_val complete dim = 1
+#pragma HLS ARRAY_PARTITION variable = fwd_ok complete dim = 1
+
+HIST_FWD_INIT:
+    for (int k = 0; k < HIST_FWD_DEPTH; k++)
+    {
+#pragma HLS UNROLL
+        fwd_ok[k] = false;
+    }
+
+    uint8_t cur = img_in[0]; /* bin whose count is held in acc */
+    uint32_t acc = 0;
+
+HIST_ACC:
+    for (int i = 0; i < IMG_SIZE; i++)
+    {
+#pragma HLS PIPELINE II = 1
+#pragma HLS DEPENDENCE variable = hist inter false
+        uint8_t pixel = img_in[i];
+
+        if (pixel == cur)
+        {
+            acc++;
+        }
+        else
+        {
+            /* Fetch the new bin, preferring a pending write-back */
+            uint32_t count = hist[pixel];
+        HIST_FWD_HIT:
+            for (int k = HIST_FWD_DEPTH - 1; k >= 0; k--)
+            {
+#pragma HLS UNROLL
+                if (fwd_ok[k] && fwd_bin[k] == pixel)
+                    count = fwd_val[k];
+            }
+
+            /* Retire the current run */
+            hist[cur] = acc;
+        HIST_FWD_SHIFT:
+            for (int k = HIST_FWD_DEPTH - 1; k > 0; k--)
+            {
+#pragma HLS UNROLL
+                fwd_bin[k] = fwd_bin[k - 1];
+                fwd_val[k] = fwd_val[k - 1];
+                fwd_ok[k] = fwd_ok[k - 1];
+            }
+            fwd_bin[0] = cur;
+            fwd_val[0] = acc;
+            fwd_ok[0] = true;
+
+            cur = pixel;
+            acc = count + 1;
+        }
+    }
+    hist[cur] = acc;
+}
+#endif
 
 /* ======================================================================
  * 2. Otsu threshold computation - OPTIMIZED
@@ -89,8 +188,16 @@ HIST_ACC:
  * - Division is expensive (68 cycles on Artix-7)
  * - We keep II=2 but optimize the division scheduling
  * - Pre-computing sum_total allows better pipelining
+ *
+ * The winning max_var is also normalised by the total variance to give
+ * the separability eta = σ²_B / σ²_T.  With the scaling used in the sweep
+ * (integer means, weights in pixels):
+ *      eta ≈ max_var / (N · Σ i²·h[i] − (Σ i·h[i])²)
+ * which needs one extra adder tree next to SUM_TOTAL and a single
+ * division after the sweep.
  * ====================================================================*/
-uint8_t otsu_compute(const uint32_t hist[NUM_BINS])
+uint8_t otsu_compute(const uint32_t hist[NUM_BINS],
+                     uint16_t *separability)
 {
 #pragma HLS INLINE off
 
@@ -98,22 +205,31 @@ uint8_t otsu_compute(const uint32_t hist[NUM_BINS])
      * Histogram is already partitioned from compute_histogram.
      * Re-declare partition for this function scope.
      */
+#if HIST_IMPL == HIST_IMPL_REGISTER
 #pragma HLS ARRAY_PARTITION variable = hist complete dim = 1
+#endif
 
     /* Total pixel count and cumulative mean */
     uint32_t total = IMG_SIZE;
     uint64_t sum_total = 0;
+    uint64_t sum_sq_total = 0;
 
 /*
  * Sum total intensity - fully unrolled for single-cycle computation
  * With complete partitioning, all 256 multiplies happen in parallel
- * and are reduced via adder tree (log2(256) = 8 levels)
+ * and are reduced via adder tree (log2(256) = 8 levels).
+ * The BRAM histogram has one read port, so it is summed sequentially.
  */
 SUM_TOTAL:
     for (int i = 0; i < NUM_BINS; i++)
     {
+#if HIST_IMPL == HIST_IMPL_REGISTER
 #pragma HLS UNROLL
+#else
+#pragma HLS PIPELINE II = 1
+#endif
         sum_total += (uint64_t)i * hist[i];
+        sum_sq_total += (uint64_t)(i * i) * hist[i];
     }
 
     uint64_t sum_bg = 0;    /* cumulative intensity sum of background */
@@ -169,9 +285,104 @@ OTSU_SWEEP:
         }
     }
 
+    /* Separability eta in Q0.16; a flat image (σ²_T = 0) is reported as 0 */
+    uint64_t var_total = (uint64_t)total * sum_sq_total - sum_total * sum_total;
+    uint64_t eta = 0;
+    if (var_total > 0)
+    {
+        eta = (max_var << 16) / var_total;
+        if (eta > 0xFFFF)
+            eta = 0xFFFF;
+    }
+    *separability = (uint16_t)eta;
+
     return best_thr;
 }
 
+/* ======================================================================
+ * 2b. Contrast normalisation (NORM_STRETCH / NORM_EQUALIZE)
+ *
+ * Three passes over the bins and one over the pixels:
+ *   RANGE     – first / last non-empty bin and the first CDF value; also
+ *               clears the remapped histogram
+ *   BUILD_LUT – the running CDF gives each bin its output value; the LUT
+ *               is monotonic, so a bin's count joins its predecessor's when
+ *               both map to the same output and the remapped histogram is
+ *               only written, never read back (no carried dependence)
+ *   COPY_HIST – remapped counts back into hist for otsu_compute
+ *   APPLY_LUT – img[i] = lut[img[i]]
+ * A flat image (zero span) keeps the identity.
+ * ====================================================================*/
+void normalize_contrast(uint8_t img[IMG_SIZE],
+                        uint32_t hist[NUM_BINS],
+                        uint8_t method)
+{
+#pragma HLS INLINE off
+    uint8_t lut[NUM_BINS];
+    uint32_t remap[NUM_BINS];
+#pragma HLS BIND_STORAGE variable = lut type = ram_2p impl = lutram
+#if HIST_IMPL == HIST_IMPL_BRAM
+#pragma HLS BIND_STORAGE variable = remap type = ram_2p impl = bram
+#endif
+
+    uint32_t lo = NUM_BINS, hi = 0, cdf_min = 0;
+RANGE:
+    for (int v = 0; v < NUM_BINS; v++)
+    {
+#pragma HLS PIPELINE II = 1
+        uint32_t n = hist[v];
+        if (n != 0 && lo == NUM_BINS)
+        {
+            lo = v;
+            cdf_min = n;
+        }
+        if (n != 0)
+            hi = v;
+        remap[v] = 0;
+    }
+
+    uint32_t span = (method == NORM_STRETCH) ? hi - lo : IMG_SIZE - cdf_min;
+    uint32_t cdf = 0, acc = 0;
+    uint8_t prev = 0;
+BUILD_LUT:
+    for (int v = 0; v < NUM_BINS; v++)
+    {
+#pragma HLS PIPELINE II = 1
+        uint32_t n = hist[v];
+        cdf += n;
+        uint32_t num;
+        if ((uint32_t)v <= lo)
+            num = 0;
+        else if (method == NORM_STRETCH)
+            num = (uint32_t)v >= hi ? span : v - lo;
+        else
+            num = cdf - cdf_min;
+        uint8_t out = span == 0 ? (uint8_t)v : (uint8_t)((num * 255 + span / 2) / span);
+        lut[v] = out;
+
+        acc = (v > 0 && out == prev) ? acc + n : n;
+        remap[out] = acc;
+        prev = out;
+    }
+
+COPY_HIST:
+    for (int v = 0; v < NUM_BINS; v++)
+    {
+#pragma HLS PIPELINE II = 1
+        hist[v] = remap[v];
+    }
+
+APPLY_LUT:
+    for (int i = 0; i < IMG_SIZE; i++)
+    {
+#pragma HLS PIPELINE II = 1
+        img[i] = lut[img[i]];
+    }
+}
+
+/* Nominal latency of normalize_contrast */
+#define NORM_CYCLES (3 * NUM_BINS + IMG_SIZE)
+
 /* ======================================================================
  * 3. Apply threshold – produce binary mask (0 / 255)
  * ====================================================================*/
@@ -214,17 +425,29 @@ static inline uint8_t u8_max(uint8_t a, uint8_t b)
     return (a > b) ? a : b; 
 }
 
+/* One pass scans (IMG_HEIGHT+1) x (IMG_WIDTH+1) positions (see below) */
+#define MORPH_SCAN_STEPS ((IMG_HEIGHT + 1) * (IMG_WIDTH + 1))
+
 /*
- * erode_3x3_linebuf - Line-buffer based erosion (minimum filter)
- * 
+ * morph_3x3_linebuf - Line-buffer based 3x3 minimum / maximum filter
+ *
  * Uses sliding window with 2 line buffers + 1 window column.
  * Achieves true II=1 for entire image.
+ *
+ * The scan runs one row and one column past the image, feeding the border
+ * value (255 for erosion, 0 for dilation) for out-of-image positions, so
+ * the window centre at step (row, col) is pixel (row-1, col-1) and every
+ * output pixel - including the last column - is written exactly once with
+ * the same result as erode_3x3 / dilate_3x3.
  */
-static void erode_3x3_linebuf(const uint8_t src[IMG_SIZE],
-                              uint8_t dst[IMG_SIZE])
+static void morph_3x3_linebuf(const uint8_t src[IMG_SIZE],
+                              uint8_t dst[IMG_SIZE],
+                              bool dilate)
 {
 #pragma HLS INLINE off
 
+    const uint8_t pad = dilate ? 0 : 255;
+
     /* Line buffers: store previous 2 rows */
     uint8_t line_buf[2][IMG_WIDTH];
 #pragma HLS ARRAY_PARTITION variable = line_buf complete dim = 1
@@ -237,205 +460,87 @@ static void erode_3x3_linebuf(const uint8_t src[IMG_SIZE],
     int row = 0;
     int col = 0;
 
-ERODE_LOOP:
-    for (int i = 0; i < IMG_SIZE + 2 * IMG_WIDTH; i++)
+MORPH_LOOP:
+    for (int i = 0; i < MORPH_SCAN_STEPS; i++)
     {
 #pragma HLS PIPELINE II = 1
 #pragma HLS DEPENDENCE variable = line_buf inter false
 
-        /* Calculate current position */
-        row = (i / IMG_WIDTH);
-        col = (i % IMG_WIDTH);
+        /* Left border: restart the window at the beginning of a row */
+        if (col == 0)
+        {
+            win[0][1] = pad; win[1][1] = pad; win[2][1] = pad;
+            win[0][2] = pad; win[1][2] = pad; win[2][2] = pad;
+        }
 
         /* Shift window left */
         win[0][0] = win[0][1]; win[0][1] = win[0][2];
         win[1][0] = win[1][1]; win[1][1] = win[1][2];
         win[2][0] = win[2][1]; win[2][1] = win[2][2];
 
-        /* Read new pixel from appropriate source */
-        uint8_t new_pixel;
-        if (i < IMG_SIZE)
-        {
-            new_pixel = src[i];
-        }
-        else
-        {
-            new_pixel = 255; /* Pad with foreground for erosion */
-        }
+        /* New column: two buffered rows plus the incoming pixel */
+        bool in_img = (row < IMG_HEIGHT) && (col < IMG_WIDTH);
+        uint8_t new_pixel = in_img ? src[row * IMG_WIDTH + col] : pad;
 
-        /* Update line buffers and window */
-        if (row >= 2)
+        if (col < IMG_WIDTH)
         {
-            win[0][2] = line_buf[0][col];
-        }
-        else
-        {
-            win[0][2] = 255; /* Border padding */
-        }
-
-        if (row >= 1)
-        {
-            win[1][2] = line_buf[1][col];
+            win[0][2] = (row >= 2) ? line_buf[0][col] : pad;
+            win[1][2] = (row >= 1) ? line_buf[1][col] : pad;
             line_buf[0][col] = line_buf[1][col];
+            line_buf[1][col] = new_pixel;
         }
         else
         {
-            win[1][2] = 255;
+            win[0][2] = pad;
+            win[1][2] = pad;
         }
-
         win[2][2] = new_pixel;
-        line_buf[1][col] = new_pixel;
 
-        /* Compute minimum of 3×3 window (after initial fill) */
-        if (row >= 2 && col >= 2)
+        /* Reduce the window once the centre pixel (row-1, col-1) exists */
+        if (row >= 1 && col >= 1)
         {
-            int out_row = row - 2;
-            int out_col = col - 2;
-            
-            /* Handle borders: use 255 for out-of-bounds */
-            uint8_t v00 = (out_row > 0 && out_col > 0) ? win[0][0] : 255;
-            uint8_t v01 = (out_row > 0) ? win[0][1] : 255;
-            uint8_t v02 = (out_row > 0 && out_col < IMG_WIDTH - 1) ? win[0][2] : 255;
-            uint8_t v10 = (out_col > 0) ? win[1][0] : 255;
-            uint8_t v11 = win[1][1]; /* Center pixel always valid */
-            uint8_t v12 = (out_col < IMG_WIDTH - 1) ? win[1][2] : 255;
-            uint8_t v20 = (out_row < IMG_HEIGHT - 1 && out_col > 0) ? win[2][0] : 255;
-            uint8_t v21 = (out_row < IMG_HEIGHT - 1) ? win[2][1] : 255;
-            uint8_t v22 = (out_row < IMG_HEIGHT - 1 && out_col < IMG_WIDTH - 1) ? win[2][2] : 255;
-
-            /* Balanced min-tree (3 levels) */
-            uint8_t m01 = u8_min(v00, v01);
-            uint8_t m23 = u8_min(v02, v10);
-            uint8_t m45 = u8_min(v11, v12);
-            uint8_t m67 = u8_min(v20, v21);
-
-            uint8_t m0123 = u8_min(m01, m23);
-            uint8_t m4567 = u8_min(m45, m67);
-            uint8_t m01234567 = u8_min(m0123, m4567);
-
-            uint8_t result = u8_min(m01234567, v22);
-
-            if (out_row < IMG_HEIGHT && out_col < IMG_WIDTH)
+            uint8_t result = win[1][1];
+            for (int wy = 0; wy < 3; wy++)
             {
-                dst[out_row * IMG_WIDTH + out_col] = result;
+#pragma HLS UNROLL
+                for (int wx = 0; wx < 3; wx++)
+                {
+#pragma HLS UNROLL
+                    result = dilate ? u8_max(result, win[wy][wx])
+                                    : u8_min(result, win[wy][wx]);
+                }
             }
+            dst[(row - 1) * IMG_WIDTH + (col - 1)] = result;
         }
-    }
-}
-
-/*
- * dilate_3x3_linebuf - Line-buffer based dilation (maximum filter)
- */
-static void dilate_3x3_linebuf(const uint8_t src[IMG_SIZE],
-                               uint8_t dst[IMG_SIZE])
-{
-#pragma HLS INLINE off
-
-    /* Line buffers: store previous 2 rows */
-    uint8_t line_buf[2][IMG_WIDTH];
-#pragma HLS ARRAY_PARTITION variable = line_buf complete dim = 1
-#pragma HLS BIND_STORAGE variable = line_buf type = ram_s2p impl = lutram
-
-    /* Window registers: 3×3 sliding window */
-    uint8_t win[3][3];
-#pragma HLS ARRAY_PARTITION variable = win complete dim = 0
-
-    int row = 0;
-    int col = 0;
-
-DILATE_LOOP:
-    for (int i = 0; i < IMG_SIZE + 2 * IMG_WIDTH; i++)
-    {
-#pragma HLS PIPELINE II = 1
-#pragma HLS DEPENDENCE variable = line_buf inter false
 
-        row = (i / IMG_WIDTH);
-        col = (i % IMG_WIDTH);
-
-        /* Shift window left */
-        win[0][0] = win[0][1]; win[0][1] = win[0][2];
-        win[1][0] = win[1][1]; win[1][1] = win[1][2];
-        win[2][0] = win[2][1]; win[2][1] = win[2][2];
-
-        /* Read new pixel */
-        uint8_t new_pixel;
-        if (i < IMG_SIZE)
+        if (++col == IMG_WIDTH + 1)
         {
-            new_pixel = src[i];
-        }
-        else
-        {
-            new_pixel = 0; /* Pad with background for dilation */
-        }
-
-        /* Update line buffers and window */
-        if (row >= 2)
-        {
-            win[0][2] = line_buf[0][col];
-        }
-        else
-        {
-            win[0][2] = 0;
-        }
-
-        if (row >= 1)
-        {
-            win[1][2] = line_buf[1][col];
-            line_buf[0][col] = line_buf[1][col];
-        }
-        else
-        {
-            win[1][2] = 0;
+            col = 0;
+            row++;
         }
+    }
+}
 
-        win[2][2] = new_pixel;
-        line_buf[1][col] = new_pixel;
+void erode_3x3_linebuf(const uint8_t src[IMG_SIZE],
+                       uint8_t dst[IMG_SIZE])
+{
+    morph_3x3_linebuf(src, dst, false);
+}
 
-        /* Compute maximum of 3×3 window */
-        if (row >= 2 && col >= 2)
-        {
-            int out_row = row - 2;
-            int out_col = col - 2;
-            
-            /* Handle borders: use 0 for out-of-bounds */
-            uint8_t v00 = (out_row > 0 && out_col > 0) ? win[0][0] : 0;
-            uint8_t v01 = (out_row > 0) ? win[0][1] : 0;
-            uint8_t v02 = (out_row > 0 && out_col < IMG_WIDTH - 1) ? win[0][2] : 0;
-            uint8_t v10 = (out_col > 0) ? win[1][0] : 0;
-            uint8_t v11 = win[1][1];
-            uint8_t v12 = (out_col < IMG_WIDTH - 1) ? win[1][2] : 0;
-            uint8_t v20 = (out_row < IMG_HEIGHT - 1 && out_col > 0) ? win[2][0] : 0;
-            uint8_t v21 = (out_row < IMG_HEIGHT - 1) ? win[2][1] : 0;
-            uint8_t v22 = (out_row < IMG_HEIGHT - 1 && out_col < IMG_WIDTH - 1) ? win[2][2] : 0;
-
-            /* Balanced max-tree */
-            uint8_t m01 = u8_max(v00, v01);
-            uint8_t m23 = u8_max(v02, v10);
-            uint8_t m45 = u8_max(v11, v12);
-            uint8_t m67 = u8_max(v20, v21);
-
-            uint8_t m0123 = u8_max(m01, m23);
-            uint8_t m4567 = u8_max(m45, m67);
-            uint8_t m01234567 = u8_max(m0123, m4567);
-
-            uint8_t result = u8_max(m01234567, v22);
-
-            if (out_row < IMG_HEIGHT && out_col < IMG_WIDTH)
-            {
-                dst[out_row * IMG_WIDTH + out_col] = result;
-            }
-        }
-    }
+void dilate_3x3_linebuf(const uint8_t src[IMG_SIZE],
+                        uint8_t dst[IMG_SIZE])
+{
+    morph_3x3_linebuf(src, dst, true);
 }
 
-/* --- Legacy direct-access versions (kept for reference/testing) --- */
+/* --- Direct-access versions (reference for the testbench) --- */
 
 /*
  * erode_3x3  – minimum filter (3×3 neighbourhood) - DIRECT ACCESS
  * Out-of-bounds pixels are treated as 255 (foreground).
  */
-static void erode_3x3(const uint8_t src[IMG_SIZE],
-                      uint8_t dst[IMG_SIZE])
+void erode_3x3(const uint8_t src[IMG_SIZE],
+               uint8_t dst[IMG_SIZE])
 {
 #pragma HLS INLINE off
 
@@ -483,8 +588,8 @@ ERODE_ROW:
  * dilate_3x3 – maximum filter (3×3 neighbourhood) - DIRECT ACCESS
  * Out-of-bounds pixels are treated as 0 (background).
  */
-static void dilate_3x3(const uint8_t src[IMG_SIZE],
-                       uint8_t dst[IMG_SIZE])
+void dilate_3x3(const uint8_t src[IMG_SIZE],
+                uint8_t dst[IMG_SIZE])
 {
 #pragma HLS INLINE off
 
@@ -545,6 +650,100 @@ void morph_close_3x3(uint8_t img[IMG_SIZE])
     erode_3x3_linebuf(tmp, img);
 }
 
+/* ======================================================================
+ * 4b. Slice-streaming 3x3x3 morphology (MODE_VOLUME)
+ *
+ * A 3x3x3 minimum / maximum is the minimum / maximum over three slices of
+ * the 3x3 one, so each pass filters the incoming slice in-plane with the
+ * line buffer above and keeps the result in a ring of bit-packed planes
+ * (2 KB each).  When slice z arrives, slice z-1 is finished from planes
+ * z-2, z-1 and z; absent planes (before the first slice, after the last)
+ * are left out of the reduction, which clips the neighbourhood like the
+ * 2D border.  Passes chain, so MODE_CAREFUL lags four slices.
+ *
+ * The rings are static: they hold the volume's state between calls
+ * (VOL_MAX_PASSES x 2 planes = 16 KB, 8 BRAM18).
+ * ====================================================================*/
+#define VOL_PLANE_WORDS (IMG_SIZE / 32)
+
+static uint32_t vol_ring[VOL_MAX_PASSES][2][VOL_PLANE_WORDS];
+static bool vol_have[VOL_MAX_PASSES][2];
+static uint8_t vol_newest[VOL_MAX_PASSES]; /* ring slot of slice z-1 */
+
+/* Nominal latency of one 3D pass: in-plane filter + slice reduction */
+#define VOL_PASS_CYCLES (MORPH_SCAN_STEPS + IMG_SIZE)
+
+static void volume_reset(void)
+{
+VOL_RESET:
+    for (int p = 0; p < VOL_MAX_PASSES; p++)
+    {
+#pragma HLS UNROLL
+        vol_have[p][0] = false;
+        vol_have[p][1] = false;
+        vol_newest[p] = 0;
+    }
+}
+
+/*
+ * volume_pass - one 3x3x3 erode / dilate step of the slice stream
+ *
+ * plane holds slice z (if present) on entry and slice z-1 of the result
+ * on exit (0 everywhere if z-1 is outside the volume).  Returns whether
+ * slice z-1 exists, i.e. whether the next pass gets a slice.
+ */
+static bool volume_pass(uint8_t plane[IMG_SIZE], bool present, int p,
+                        bool dilate)
+{
+#pragma HLS INLINE off
+
+    uint8_t filt[IMG_SIZE];
+#pragma HLS BIND_STORAGE variable = filt type = ram_2p impl = bram
+    if (present)
+        morph_3x3_linebuf(plane, filt, dilate);
+
+    const int mid = vol_newest[p];   /* slice z-1 */
+    const int old = mid ^ 1;         /* slice z-2, then replaced by z */
+    const bool out = vol_have[p][mid];
+    const bool use_old = vol_have[p][old];
+
+    uint32_t w_mid = 0, w_old = 0, w_new = 0;
+
+VOL_COMBINE:
+    for (int i = 0; i < IMG_SIZE; i++)
+    {
+#pragma HLS PIPELINE II = 1
+        const int w = i / 32, b = i % 32;
+        if (b == 0)
+        {
+            w_mid = vol_ring[p][mid][w];
+            w_old = vol_ring[p][old][w];
+        }
+
+        bool cur = present && filt[i] != 0;
+        bool v = (w_mid >> b) & 1U;
+        if (use_old)
+            v = dilate ? (v || ((w_old >> b) & 1U)) : (v && ((w_old >> b) & 1U));
+        if (present)
+            v = dilate ? (v || cur) : (v && cur);
+        plane[i] = (out && v) ? 255 : 0;
+
+        w_new |= (uint32_t)cur << b;
+        if (b == 31)
+        {
+            vol_ring[p][old][w] = w_new;
+            w_new = 0;
+        }
+    }
+
+    vol_have[p][old] = present;
+    vol_newest[p] = (uint8_t)old;
+    return out;
+}
+
+/* Nominal latency of one line-buffer erode/dilate pass */
+#define MORPH_PASS_CYCLES MORPH_SCAN_STEPS
+
 /* ======================================================================
  * 5. Top-level accelerator function - OPTIMIZED
  *
@@ -558,7 +757,10 @@ void otsu_threshold_top(
     const uint8_t img_in[IMG_SIZE],
     uint8_t img_out[IMG_SIZE],
     uint8_t mode,
-    OtsuResult *result)
+    uint8_t fixed_threshold,
+    uint8_t normalize,
+    OtsuResult *result,
+    volatile const uint32_t *cycle_counter)
 {
 /* ============== AXI Interface Configuration ============== */
 /*
@@ -574,38 +776,151 @@ void otsu_threshold_top(
 
 /* s_axilite for control/status registers */
 #pragma HLS INTERFACE s_axilite port=mode bundle=control
+#pragma HLS INTERFACE s_axilite port=fixed_threshold bundle=control
+#pragma HLS INTERFACE s_axilite port=normalize bundle=control
 #pragma HLS INTERFACE s_axilite port=result bundle=control
 #pragma HLS INTERFACE s_axilite port=return bundle=control
 
+/* Free-running cycle counter from the block design (no handshake) */
+#pragma HLS INTERFACE ap_none port=cycle_counter
+
+    /* Output format / threshold flags ride on the mode register */
+    bool rle_out = (mode & MODE_OUTPUT_RLE) != 0;
+    bool hist_out = (mode & MODE_OUTPUT_HIST) != 0;
+    bool fixed_thr = (mode & MODE_FIXED_THRESHOLD) != 0 && !hist_out;
+    bool volume = (mode & MODE_VOLUME) != 0 && !hist_out;
+    bool vol_start = volume && (mode & MODE_VOLUME_START) != 0;
+    bool vol_flush = volume && (mode & MODE_VOLUME_FLUSH) != 0;
+    mode &= MODE_MASK;
+
+    /* Normalisation and MODE_AUTO need this frame's own histogram */
+    bool shared_thr = fixed_thr || hist_out || volume;
+    bool norm = !shared_thr && (normalize == NORM_STRETCH || normalize == NORM_EQUALIZE);
+    if (mode == MODE_AUTO && shared_thr)
+        mode = MODE_FAST;
+
+    /* Stage boundary timestamps: stamp[s] = start of stage s */
+    uint32_t stamp[NUM_STAGES + 1];
+#pragma HLS ARRAY_PARTITION variable=stamp complete dim=1
+
     /* Local buffers with explicit BRAM binding */
     uint8_t local_in[IMG_SIZE];
     uint8_t local_out[IMG_SIZE];
     uint32_t hist[NUM_BINS];
+    uint32_t runs[RLE_MAX_RUNS];
 
 #pragma HLS BIND_STORAGE variable=local_in type=ram_2p impl=bram
 #pragma HLS BIND_STORAGE variable=local_out type=ram_2p impl=bram
+#pragma HLS BIND_STORAGE variable=runs type=ram_2p impl=bram
+#if HIST_IMPL == HIST_IMPL_BRAM
+#pragma HLS BIND_STORAGE variable=hist type=ram_2p impl=bram
+#endif
+
+    stamp[STAGE_READ_IN] = stage_timestamp(cycle_counter, 0);
 
 /* ============== Stage 1: Burst Read ============== */
 /*
  * Sequential burst read with II=1.
  * AXI memory controller will automatically batch into efficient bursts.
+ * A volume flush call has no slice: the image reads as 0 (nothing above
+ * any threshold) and the morphology treats it as absent.
  */
 READ_IN:
     for (int i = 0; i < IMG_SIZE; i++)
     {
 #pragma HLS PIPELINE II = 1
-        local_in[i] = img_in[i];
+        local_in[i] = vol_flush ? 0 : img_in[i];
     }
 
+    stamp[STAGE_HISTOGRAM] = stage_timestamp(cycle_counter, IMG_SIZE);
+
     /* ============== Stage 2: Histogram ============== */
-    compute_histogram(local_in, hist);
+    /* Not needed when the threshold is given */
+    if (!fixed_thr)
+        compute_histogram(local_in, hist);
+
+    /*
+     * Contrast normalisation, then the mode choice on the statistics of
+     * the normalised histogram: a low-contrast frame that would need
+     * CAREFUL's fall-back and two extra morphology passes is stretched
+     * into FAST / NORMAL territory for one extra pass over local_in.
+     */
+    uint32_t norm_cycles = 0;
+    if (norm)
+    {
+        normalize_contrast(local_in, hist, normalize);
+        norm_cycles += NORM_CYCLES;
+    }
+    if (mode == MODE_AUTO)
+    {
+        ImageStats st;
+        compute_hist_stats(hist, &st);
+        mode = select_mode(&st);
+        norm_cycles += NUM_BINS;
+    }
+    stamp[STAGE_SWEEP] = stage_timestamp(
+        cycle_counter,
+        fixed_thr ? 0 : IMG_SIZE + (HIST_IMPL == HIST_IMPL_BRAM ? NUM_BINS : 0) + norm_cycles);
+
+    /* ============== Stage 2b: Histogram Output (MODE_OUTPUT_HIST) ============== */
+    /*
+     * Four byte beats per bin in one burst; nothing else runs, so the
+     * remaining stages read 0 and the write is booked to STAGE_WRITE_OUT.
+     */
+    if (hist_out)
+    {
+    HIST_WRITE:
+        for (int k = 0; k < HIST_OUT_BYTES; k++)
+        {
+#pragma HLS PIPELINE II = 1
+            img_out[k] = (uint8_t)(hist[k / 4] >> (8 * (k % 4)));
+        }
+
+    HIST_STAMPS:
+        for (int s = STAGE_ADAPTIVE; s <= STAGE_WRITE_OUT; s++)
+        {
+#pragma HLS UNROLL
+            stamp[s] = stamp[STAGE_SWEEP];
+        }
+        stamp[NUM_STAGES] = stage_timestamp(cycle_counter, HIST_OUT_BYTES);
+
+        result->threshold = 0;
+        result->mode_used = mode;
+        result->slice_ready = 0;
+        result->_reserved = 0;
+        result->foreground_pixels = 0;
+        result->sum_x = 0;
+        result->sum_y = 0;
+        result->sum_xx = 0;
+        result->sum_yy = 0;
+        result->sum_xy = 0;
+        result->bbox_x0 = 255;
+        result->bbox_y0 = 255;
+        result->bbox_x1 = 0;
+        result->bbox_y1 = 0;
+        result->separability = 0;
+        result->run_count = 0;
+
+    HIST_STAGE_CYCLES:
+        for (int s = 0; s < NUM_STAGES; s++)
+        {
+#pragma HLS UNROLL
+            result->stage_cycles[s] = stamp[s + 1] - stamp[s];
+        }
+        return;
+    }
 
     /* ============== Stage 3: Otsu Threshold ============== */
-    uint8_t thr = otsu_compute(hist);
+    uint16_t separability = 0;
+    uint8_t thr = fixed_thr ? fixed_threshold : otsu_compute(hist, &separability);
+    stamp[STAGE_ADAPTIVE] = stage_timestamp(
+        cycle_counter, fixed_thr ? 0 : (HIST_IMPL == HIST_IMPL_BRAM ? 3 : 2) * NUM_BINS);
 
     /* ============== Stage 4: Adaptive Mode (MODE_CAREFUL only) ============== */
-    if (mode == MODE_CAREFUL)
+    uint32_t adaptive_cycles = 0;
+    if (mode == MODE_CAREFUL && !fixed_thr)
     {
+        adaptive_cycles = IMG_SIZE;
         /* Count foreground pixels with current threshold */
         uint32_t fg_count = 0;
     COUNT_FG:
@@ -619,6 +934,7 @@ READ_IN:
         uint32_t frac_limit = IMG_SIZE / 5; /* 20% */
         if (fg_count > frac_limit)
         {
+            adaptive_cycles += IMG_SIZE;
             /* Compute mean and variance in single pass for efficiency */
             uint64_t sum = 0;
             uint64_t sum_sq = 0;
@@ -663,39 +979,184 @@ READ_IN:
         }
     }
 
+    stamp[STAGE_THRESHOLD] = stage_timestamp(cycle_counter, adaptive_cycles);
+
     /* ============== Stage 5: Apply Threshold ============== */
     apply_threshold(local_in, local_out, thr);
+    stamp[STAGE_OPEN] = stage_timestamp(cycle_counter, IMG_SIZE);
 
     /* ============== Stage 6: Morphological Post-processing ============== */
+    /*
+     * MODE_VOLUME runs the same open / close as 3x3x3 passes over the
+     * slice stream; ready tracks whether a slice comes out of them.
+     */
+    const uint32_t pass_cycles = volume ? VOL_PASS_CYCLES : MORPH_PASS_CYCLES;
+    bool ready = !vol_flush;
+    if (vol_start)
+        volume_reset();
+
     if (mode >= MODE_NORMAL)
     {
-        morph_open_3x3(local_out); /* Remove small noise */
+        /* Remove small noise */
+        if (volume)
+        {
+            ready = volume_pass(local_out, ready, 0, false);
+            ready = volume_pass(local_out, ready, 1, true);
+        }
+        else
+        {
+            morph_open_3x3(local_out);
+        }
     }
+    stamp[STAGE_CLOSE] = stage_timestamp(
+        cycle_counter, (mode >= MODE_NORMAL) ? 2 * pass_cycles : 0);
     if (mode == MODE_CAREFUL)
     {
-        morph_close_3x3(local_out); /* Fill small holes */
+        /* Fill small holes */
+        if (volume)
+        {
+            ready = volume_pass(local_out, ready, 2, true);
+            ready = volume_pass(local_out, ready, 3, false);
+        }
+        else
+        {
+            morph_close_3x3(local_out);
+        }
     }
+    stamp[STAGE_WRITE_OUT] = stage_timestamp(
+        cycle_counter, (mode == MODE_CAREFUL) ? 2 * pass_cycles : 0);
 
     /* ============== Stage 7: Count Foreground & Write Output ============== */
     /*
      * Combine final counting with output write to reduce total latency.
      * This is safe because we read local_out and write to img_out (different arrays).
+     *
+     * The same pass accumulates the raw region moments and bounding box of
+     * the foreground, so software gets centroid / orientation / extent
+     * without touching the mask again.  Coordinates are tracked with
+     * incrementing row/col counters (no divide/modulo on the index) and the
+     * x*x, y*y, x*y products are 7x7-bit multiplies that fit a single DSP.
+     *
+     * It also run-length encodes the mask: a run is closed on the first
+     * background pixel after it or on the last pixel of its row, so at
+     * most one run is stored per cycle.  With MODE_OUTPUT_RLE the mask
+     * write is skipped (the flag is loop-invariant, the burst stays) and
+     * only the runs go out below.
      */
     uint32_t fg = 0;
+    uint32_t sum_x = 0, sum_y = 0;
+    uint32_t sum_xx = 0, sum_yy = 0, sum_xy = 0;
+    uint8_t bb_x0 = 255, bb_y0 = 255, bb_x1 = 0, bb_y1 = 0;
+    uint8_t col = 0, row = 0;
+    uint16_t n_runs = 0;
+    uint8_t run_x0 = 0;
+    bool in_run = false;
 
 COUNT_AND_WRITE:
     for (int i = 0; i < IMG_SIZE; i++)
     {
 #pragma HLS PIPELINE II = 1
         uint8_t px = local_out[i];
-        fg += (px > 0) ? 1 : 0;
-        img_out[i] = px;
+        if (!rle_out)
+            img_out[i] = px;
+
+        /* Run ending before this pixel, or with it at the row's end */
+        bool starts = px > 0 && !in_run;
+        uint8_t x0 = starts ? col : run_x0;
+        bool ends_here = px > 0 && col == IMG_WIDTH - 1;
+        if (ends_here || (px == 0 && in_run))
+        {
+            uint8_t len = ends_here ? (uint8_t)(col - x0 + 1) : (uint8_t)(col - x0);
+            if (n_runs < RLE_MAX_RUNS)
+                runs[n_runs] = (uint32_t)x0 | ((uint32_t)len << 8) | ((uint32_t)row << 16);
+            n_runs++;
+        }
+        in_run = px > 0 && !ends_here;
+        run_x0 = x0;
+
+        if (px > 0)
+        {
+            fg++;
+            sum_x += col;
+            sum_y += row;
+            sum_xx += (uint32_t)col * col;
+            sum_yy += (uint32_t)row * row;
+            sum_xy += (uint32_t)col * row;
+
+            if (col < bb_x0)
+                bb_x0 = col;
+            if (col > bb_x1)
+                bb_x1 = col;
+            if (row < bb_y0)
+                bb_y0 = row;
+            bb_y1 = row; /* rows are visited in increasing order */
+        }
+
+        if (col == IMG_WIDTH - 1)
+        {
+            col = 0;
+            row++;
+        }
+        else
+        {
+            col++;
+        }
     }
 
+    /* ============== Stage 7b: RLE Output ============== */
+    /*
+     * RLE_RUN_BYTES byte beats per run in one burst; if the runs did not
+     * fit the local buffer, the plain mask is written after all.
+     */
+    uint32_t out_cycles = IMG_SIZE;
+    uint16_t run_count = 0;
+    if (rle_out && n_runs <= RLE_MAX_RUNS)
+    {
+        run_count = n_runs;
+        out_cycles += RLE_RUN_BYTES * n_runs;
+    RLE_WRITE:
+        for (int k = 0; k < RLE_RUN_BYTES * n_runs; k++)
+        {
+#pragma HLS PIPELINE II = 1
+#pragma HLS LOOP_TRIPCOUNT min = 0 max = RLE_RUN_BYTES * RLE_MAX_RUNS
+            img_out[k] = (uint8_t)(runs[k / RLE_RUN_BYTES] >> (8 * (k % RLE_RUN_BYTES)));
+        }
+    }
+    else if (rle_out)
+    {
+        out_cycles += IMG_SIZE;
+    MASK_WRITE:
+        for (int i = 0; i < IMG_SIZE; i++)
+        {
+#pragma HLS PIPELINE II = 1
+            img_out[i] = local_out[i];
+        }
+    }
+
+    stamp[NUM_STAGES] = stage_timestamp(cycle_counter, out_cycles);
+
     /* ============== Stage 8: Write Result Struct ============== */
     result->threshold = thr;
     result->mode_used = mode;
-    result->_reserved[0] = 0;
-    result->_reserved[1] = 0;
+    result->slice_ready = volume && ready;
+    result->_reserved = 0;
     result->foreground_pixels = fg;
+    result->sum_x = sum_x;
+    result->sum_y = sum_y;
+    result->sum_xx = sum_xx;
+    result->sum_yy = sum_yy;
+    result->sum_xy = sum_xy;
+    result->bbox_x0 = bb_x0;
+    result->bbox_y0 = bb_y0;
+    result->bbox_x1 = bb_x1;
+    result->bbox_y1 = bb_y1;
+    result->separability = separability;
+    result->run_count = run_count;
+
+STAGE_CYCLES:
+    for (int s = 0; s < NUM_STAGES; s++)
+    {
+#pragma HLS UNROLL
+        result->stage_cycles[s] = stamp[s + 1] - stamp[s];
+    }
 }
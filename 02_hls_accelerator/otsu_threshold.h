@@ -40,6 +40,72 @@
 #define IMG_SIZE (IMG_WIDTH * IMG_HEIGHT) /* 16384 */
 #define NUM_BINS 256                      /* 8-bit histogram */
 
+/*--------------------------------------------------------------------------
+ * Histogram implementation (compile-time, e.g. -DHIST_IMPL=HIST_IMPL_BRAM)
+ *   HIST_IMPL_REGISTER – 256 bins completely partitioned into FFs (~8K FF
+ *                        plus a 513-input read mux); 1-cycle zero and
+ *                        adder-tree Otsu sum.  Fastest, largest.
+ *   HIST_IMPL_BRAM     – bins in one dual-port BRAM with a run-length
+ *                        accumulator and a HIST_FWD_DEPTH-entry
+ *                        write-forwarding cache so the accumulate loop
+ *                        still reaches II=1 on repeated pixel values.
+ *                        Adds ~2x256 cycles (zero + sequential Otsu sum)
+ *                        but frees the FFs / mux for more kernel instances.
+ *------------------------------------------------------------------------*/
+#define HIST_IMPL_REGISTER 0
+#define HIST_IMPL_BRAM 1
+#ifndef HIST_IMPL
+#define HIST_IMPL HIST_IMPL_REGISTER
+#endif
+#define HIST_FWD_DEPTH 2 /* covers BRAM read + write latency */
+
+/*--------------------------------------------------------------------------
+ * Pipeline stages instrumented with cycle counters (OtsuResult.stage_cycles)
+ *------------------------------------------------------------------------*/
+#define STAGE_READ_IN 0   /* burst read img_in → local_in             */
+#define STAGE_HISTOGRAM 1 /* compute_histogram (+ normalise, MODE_AUTO) */
+#define STAGE_SWEEP 2     /* otsu_compute (sum tree + sweep)          */
+#define STAGE_ADAPTIVE 3  /* MODE_CAREFUL fall-back (COUNT_FG, stats) */
+#define STAGE_THRESHOLD 4 /* apply_threshold                          */
+#define STAGE_OPEN 5      /* morph_open_3x3                           */
+#define STAGE_CLOSE 6     /* morph_close_3x3                          */
+#define STAGE_WRITE_OUT 7 /* COUNT_AND_WRITE (+ RLE_WRITE)            */
+#define NUM_STAGES 8
+
+/*--------------------------------------------------------------------------
+ * Stage timestamps (shared by otsu_threshold.cpp and otsu_multichannel.cpp)
+ *
+ * In hardware, cycle_counter is an ap_none port wired to a free-running
+ * counter; ap_wait() on both sides of the sample pins it between the
+ * neighbouring stages so the scheduler cannot hoist it across a loop.
+ *
+ * In C simulation nothing drives the counter, so a model clock advances by
+ * each stage's nominal latency (trip count x II) instead.  Co-simulation and
+ * the board report the real numbers, including AXI stalls.
+ *------------------------------------------------------------------------*/
+#ifdef __SYNTHESIS__
+#include "ap_utils.h" /* ap_wait */
+
+static inline uint32_t stage_timestamp(volatile const uint32_t *cycle_counter,
+                                       uint32_t nominal_cycles)
+{
+#pragma HLS INLINE
+    ap_wait();
+    uint32_t t = *cycle_counter;
+    ap_wait();
+    return t;
+}
+#else
+static inline uint32_t stage_timestamp(volatile const uint32_t *cycle_counter,
+                                       uint32_t nominal_cycles)
+{
+    static uint32_t csim_clock = 0;
+
+    csim_clock += nominal_cycles;
+    return *cycle_counter + csim_clock;
+}
+#endif
+
 /*--------------------------------------------------------------------------
  * Processing modes
  *------------------------------------------------------------------------*/
@@ -47,9 +113,91 @@ typedef enum
 {
     MODE_FAST = 0,   /* speed-optimised, less accuracy     */
     MODE_NORMAL = 1, /* balanced                           */
-    MODE_CAREFUL = 2 /* accuracy-optimised, slower          */
+    MODE_CAREFUL = 2, /* accuracy-optimised, slower          */
+    MODE_AUTO = 3     /* select_mode() in the kernel (below)  */
 } ProcessingMode;
 
+/*--------------------------------------------------------------------------
+ * Contrast normalisation (normalize argument)
+ *   NORM_NONE     – threshold the image as read
+ *   NORM_STRETCH  – linear stretch of the used range [min, max] to 0..255
+ *   NORM_EQUALIZE – histogram equalisation: the CDF, from the first
+ *                   non-empty bin, scaled to 0..255
+ * The LUT is built from the first histogram and applied to local_in in one
+ * more pass; the histogram is remapped through it instead of being rebuilt.
+ * Otsu, the CAREFUL fall-back and the reported threshold all work on the
+ * normalised scale.  Ignored with MODE_FIXED_THRESHOLD, MODE_OUTPUT_HIST
+ * and MODE_VOLUME, which share one threshold on the raw scale across calls.
+ *
+ * MODE_AUTO picks FAST / NORMAL / CAREFUL with select_mode() from the
+ * statistics of the (normalised) histogram and reports the choice in
+ * mode_used; a stretched or equalised low-contrast frame qualifies for the
+ * cheaper modes.  It runs as MODE_FAST with the three flags above.
+ *------------------------------------------------------------------------*/
+#define NORM_NONE 0
+#define NORM_STRETCH 1
+#define NORM_EQUALIZE 2
+
+/*--------------------------------------------------------------------------
+ * Output format, OR-ed into the mode register (bits [1:0] are the mode)
+ *   0                – img_out receives the IMG_SIZE-byte mask (0 / 255)
+ *   MODE_OUTPUT_RLE  – img_out receives run_count row runs of foreground,
+ *                      RLE_RUN_BYTES each in row order:
+ *                        byte 0 x0 (first pixel), 1 length (1..128),
+ *                        2 y (row), 3 reserved 0
+ *                      i.e. the little-endian word x0 | len << 8 | y << 16.
+ *                      Only 4 x run_count bytes are written.  A mask with
+ *                      more than RLE_MAX_RUNS runs is written as a plain
+ *                      mask instead and reports run_count = 0.
+ *------------------------------------------------------------------------*/
+#define MODE_MASK 0x03
+#define MODE_OUTPUT_RLE 0x80
+#define RLE_RUN_BYTES 4
+#ifndef RLE_MAX_RUNS
+#define RLE_MAX_RUNS 1024 /* local run buffer: 1024 x 32 bit = 2 BRAM18 */
+#endif
+
+/*--------------------------------------------------------------------------
+ * Further mode register flags, for images larger than one frame that are
+ * processed in tiles with one global threshold (firmware tiler.c)
+ *   MODE_OUTPUT_HIST      – only the histogram is computed: img_out
+ *                           receives NUM_BINS little-endian uint32 counts
+ *                           (HIST_OUT_BYTES), the result holds no mask
+ *                           statistics and every later stage is skipped.
+ *                           Takes precedence over the other flags.
+ *   MODE_FIXED_THRESHOLD  – the fixed_threshold argument replaces the
+ *                           histogram, the Otsu sweep and the MODE_CAREFUL
+ *                           fall-back; the mode still selects the
+ *                           morphology.  separability reads 0.
+ *------------------------------------------------------------------------*/
+#define MODE_FIXED_THRESHOLD 0x40
+#define MODE_OUTPUT_HIST 0x20
+#define HIST_OUT_BYTES (NUM_BINS * 4)
+
+/*--------------------------------------------------------------------------
+ * Volume (slice-streaming) flags, for MRI stacks sent one slice per call
+ *   MODE_VOLUME        – the morphology is 3x3x3: each erode / dilate pass
+ *                        keeps the previous two slices' in-plane results in
+ *                        a ring (bit-packed, persistent across calls) and
+ *                        combines them with the current one, so it can only
+ *                        finish slice z-1 when slice z arrives.  img_out and
+ *                        the result describe the slice entered VOL_LAG(mode)
+ *                        calls earlier; slice_ready is 0 while the ring
+ *                        fills.  Usually with MODE_FIXED_THRESHOLD and the
+ *                        volume's threshold from the summed MODE_OUTPUT_HIST
+ *                        histograms.
+ *   MODE_VOLUME_START  – first slice of a volume: the rings are cleared.
+ *   MODE_VOLUME_FLUSH  – no input slice (img_in is not read) past the last
+ *                        one; VOL_LAG(mode) flush calls drain the rings.
+ * Slices before the first and after the last are outside the volume: the
+ * 3x3x3 neighbourhood is clipped there as at the slice borders.
+ *------------------------------------------------------------------------*/
+#define MODE_VOLUME 0x10
+#define MODE_VOLUME_START 0x08
+#define MODE_VOLUME_FLUSH 0x04
+#define VOL_MAX_PASSES 4 /* MODE_CAREFUL: erode, dilate, dilate, erode */
+#define VOL_LAG(mode) ((mode) == MODE_CAREFUL ? 4 : (mode) == MODE_NORMAL ? 2 : 0)
+
 /*--------------------------------------------------------------------------
  * Result structure returned by the accelerator
  *
@@ -57,36 +205,98 @@ typedef enum
  * consecutive 32-bit registers. To avoid alignment issues and ensure
  * deterministic register layout, we explicitly order and pad fields.
  *
- * Memory Layout (8 bytes total):
+ * Memory Layout (68 bytes total):
  *   Offset 0: threshold (1 byte)
  *   Offset 1: mode_used (1 byte)
- *   Offset 2-3: _reserved[2] (2 bytes padding)
+ *   Offset 2: slice_ready (1 byte)
+ *   Offset 3: _reserved (1 byte padding)
  *   Offset 4-7: foreground_pixels (4 bytes)
+ *   Offset 8-27: region moments sum_x .. sum_xy (5 x 4 bytes)
+ *   Offset 28-31: foreground bounding box (4 x 1 byte)
+ *   Offset 32-33: separability (uint16, Q0.16)
+ *   Offset 34-35: run_count (uint16)
+ *   Offset 36-67: stage_cycles[NUM_STAGES] (8 x 4 bytes)
  *
- * AXI-Lite Register Map:
- *   Register 0 (offset 0x00): bits[7:0]=threshold, bits[15:8]=mode_used
+ * AXI-Lite Register Map (relative to the result; the mode and
+ * fixed_threshold arguments sit at control offsets 0x10 and 0x18):
+ *   Register 0 (offset 0x00): bits[7:0]=threshold, bits[15:8]=mode_used,
+ *                             bits[23:16]=slice_ready
  *   Register 1 (offset 0x04): foreground_pixels
+ *   Register 2 (offset 0x08): sum_x   = sum of x over foreground
+ *   Register 3 (offset 0x0C): sum_y   = sum of y over foreground
+ *   Register 4 (offset 0x10): sum_xx  = sum of x*x over foreground
+ *   Register 5 (offset 0x14): sum_yy  = sum of y*y over foreground
+ *   Register 6 (offset 0x18): sum_xy  = sum of x*y over foreground
+ *   Register 7 (offset 0x1C): bits[7:0]=bbox_x0, [15:8]=bbox_y0,
+ *                             [23:16]=bbox_x1, [31:24]=bbox_y1
+ *   Register 8 (offset 0x20): bits[15:0]=separability,
+ *                             bits[31:16]=run_count
+ *   Register 9..16 (offset 0x24..0x40): stage_cycles[0..7]
+ *
+ * The moments are raw (non-central) sums; with a 128x128 image the largest
+ * (127^2 * 16384) still fits in 32 bits.  If the mask is empty the bounding
+ * box is reported as x0=y0=255, x1=y1=0.
+ *
+ * separability is the normalised Otsu separability eta = sigma2_B / sigma2_T
+ * of the chosen histogram split, in unsigned Q0.16 (65535 ~ 1.0).  Values
+ * near 1 mean a clearly bimodal histogram; low values flag ambiguous frames.
+ * It always describes the Otsu split, even if MODE_CAREFUL later replaced
+ * the threshold with its adaptive fall-back.
+ *
+ * run_count is the number of runs written with MODE_OUTPUT_RLE, 0 if the
+ * plain mask was written (no MODE_OUTPUT_RLE, or too many runs).  With
+ * MODE_OUTPUT_RLE an empty mask writes nothing to img_out.
+ *
+ * slice_ready is 1 if a MODE_VOLUME call produced a slice (img_out holds
+ * its mask, the result its statistics), 0 while the rings fill, on the
+ * extra flush calls of a short volume, and without MODE_VOLUME.
+ *
+ * stage_cycles[s] is the number of clock cycles spent in stage s (see
+ * STAGE_* above), taken as the difference of the free-running cycle_counter
+ * input latched at consecutive stage boundaries.  Skipped stages read ~0.
  *------------------------------------------------------------------------*/
 typedef struct
 {
     uint8_t threshold;          /* computed Otsu threshold (offset 0)     */
     uint8_t mode_used;          /* actual mode that was executed (offset 1) */
-    uint8_t _reserved[2];       /* padding to align foreground_pixels     */
+    uint8_t slice_ready;        /* MODE_VOLUME slice out    (offset 2)    */
+    uint8_t _reserved;          /* padding to align foreground_pixels     */
     uint32_t foreground_pixels; /* # pixels above threshold (offset 4)    */
+    uint32_t sum_x;             /* first-order moment in X  (offset 8)    */
+    uint32_t sum_y;             /* first-order moment in Y  (offset 12)   */
+    uint32_t sum_xx;            /* second-order moment XX   (offset 16)   */
+    uint32_t sum_yy;            /* second-order moment YY   (offset 20)   */
+    uint32_t sum_xy;            /* second-order moment XY   (offset 24)   */
+    uint8_t bbox_x0;            /* foreground bbox left     (offset 28)   */
+    uint8_t bbox_y0;            /* foreground bbox top      (offset 29)   */
+    uint8_t bbox_x1;            /* foreground bbox right    (offset 30)   */
+    uint8_t bbox_y1;            /* foreground bbox bottom   (offset 31)   */
+    uint16_t separability;      /* Otsu eta, Q0.16          (offset 32)   */
+    uint16_t run_count;         /* RLE runs written, 0=mask (offset 34)   */
+    uint32_t stage_cycles[NUM_STAGES]; /* per-stage latency (offset 36)   */
 } OtsuResult;
 
 /*--------------------------------------------------------------------------
  * Top-level HLS function  (AXI-Lite control, BRAM / AXI-Stream data)
  *   img_in    – input  grayscale image  (flattened row-major)
- *   img_out   – output binary mask      (flattened row-major, 0 or 255)
- *   mode      – processing mode selector
+ *   img_out   – output binary mask      (flattened row-major, 0 or 255),
+ *               or its row runs with MODE_OUTPUT_RLE
+ *   mode      – processing mode selector | output format
+ *   fixed_threshold – threshold applied with MODE_FIXED_THRESHOLD
+ *   normalize – NORM_* contrast normalisation before the Otsu sweep
  *   result    – output result metadata
+ *   cycle_counter – free-running 32-bit clock-cycle counter (ap_none input,
+ *                   driven by cycle_counter.v in the block design); sampled
+ *                   at every stage boundary to fill result->stage_cycles
  *------------------------------------------------------------------------*/
 void otsu_threshold_top(
     const uint8_t img_in[IMG_SIZE],
     uint8_t img_out[IMG_SIZE],
     uint8_t mode,
-    OtsuResult *result);
+    uint8_t fixed_threshold,
+    uint8_t normalize,
+    OtsuResult *result,
+    volatile const uint32_t *cycle_counter);
 
 /*--------------------------------------------------------------------------
  * Internal helpers (exposed for unit-testing)
@@ -96,14 +306,29 @@ void otsu_threshold_top(
 void compute_histogram(const uint8_t img_in[IMG_SIZE],
                        uint32_t hist[NUM_BINS]);
 
-/* Classical Otsu: find threshold that maximises inter-class variance */
-uint8_t otsu_compute(const uint32_t hist[NUM_BINS]);
+/* Classical Otsu: find threshold that maximises inter-class variance.
+ * Also reports the normalised separability sigma2_B / sigma2_T (Q0.16). */
+uint8_t otsu_compute(const uint32_t hist[NUM_BINS],
+                     uint16_t *separability);
+
+/* Build the NORM_STRETCH / NORM_EQUALIZE LUT from hist, apply it to img
+ * and remap hist to the histogram of the result */
+void normalize_contrast(uint8_t img[IMG_SIZE],
+                        uint32_t hist[NUM_BINS],
+                        uint8_t method);
 
 /* Apply threshold to image and write binary mask */
 void apply_threshold(const uint8_t img_in[IMG_SIZE],
                      uint8_t img_out[IMG_SIZE],
                      uint8_t thr);
 
+/* Single 3x3 minimum / maximum passes, out-of-image pixels neutral: the
+ * line-buffer versions the kernel uses and the direct-access references */
+void erode_3x3_linebuf(const uint8_t src[IMG_SIZE], uint8_t dst[IMG_SIZE]);
+void dilate_3x3_linebuf(const uint8_t src[IMG_SIZE], uint8_t dst[IMG_SIZE]);
+void erode_3x3(const uint8_t src[IMG_SIZE], uint8_t dst[IMG_SIZE]);
+void dilate_3x3(const uint8_t src[IMG_SIZE], uint8_t dst[IMG_SIZE]);
+
 /* 3x3 morphological open (erosion then dilation) on binary mask */
 void morph_open_3x3(uint8_t img[IMG_SIZE]);
 
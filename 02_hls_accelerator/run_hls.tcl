@@ -4,19 +4,39 @@ cd $SCRIPT_DIR
 set PROJECT_NAME "otsu_hls"
 set SOLUTION_NAME "solution1"
 set TOP_FUNCTION "otsu_threshold_top"
+set IP_NAME "otsu_threshold_v2"
+set IP_DESCRIPTION "Otsu Threshold Accelerator"
 set PART "xc7a100tcsg324-1"
 set CLOCK_PERIOD 10
 
 set IP_REPO_DIR "../03_vivado_hardware/ip_repo"
 
+# Histogram implementation: 0 = register (HIST_IMPL_REGISTER, fastest),
+# 1 = BRAM with write forwarding (HIST_IMPL_BRAM, area-lean, lets 3-4
+# kernel instances fit on the xc7a100t)
+set HIST_IMPL 0
+
+# Kernel: 0 = single-channel otsu_threshold_top, 1 = multi-channel
+# otsu_multichannel_top (up to four co-registered planes per pixel tuple,
+# LUT-fused masks; use with HIST_IMPL 1)
+set MULTICHANNEL 0
+if {$MULTICHANNEL} {
+    set PROJECT_NAME "otsu_mc_hls"
+    set TOP_FUNCTION "otsu_multichannel_top"
+    set IP_NAME "otsu_multichannel_v1"
+    set IP_DESCRIPTION "Multi-channel Otsu Threshold Accelerator"
+}
+
 puts "INFO: Creating HLS project: ${PROJECT_NAME}"
 open_project -reset ${PROJECT_NAME}
 
-add_files otsu_threshold.cpp
+add_files otsu_threshold.cpp -cflags "-DHIST_IMPL=${HIST_IMPL}"
 add_files otsu_threshold.h
+add_files otsu_multichannel.cpp -cflags "-DHIST_IMPL=${HIST_IMPL}"
+add_files otsu_multichannel.h
 add_files image_stats.cpp
 add_files image_stats.h
-add_files -tb test_otsu.cpp
+add_files -tb test_otsu.cpp -cflags "-DHIST_IMPL=${HIST_IMPL}"
 
 set_top ${TOP_FUNCTION}
 open_solution -reset ${SOLUTION_NAME}
@@ -39,7 +59,7 @@ puts "===> Exporting IP..."
 # File copy approach requires ensuring dir exists
 file mkdir $IP_REPO_DIR
 
-export_design -format ip_catalog -display_name "otsu_threshold_v2" -description "Otsu Threshold Accelerator" -vendor "custom" -version "2.0" -output $IP_REPO_DIR
+export_design -format ip_catalog -display_name $IP_NAME -description $IP_DESCRIPTION -vendor "custom" -version "2.0" -output $IP_REPO_DIR
 
 if {![file exists "$IP_REPO_DIR/component.xml"]} {
     puts "ERROR: IP Export failed! component.xml not found in $IP_REPO_DIR"
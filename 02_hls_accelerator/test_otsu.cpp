@@ -5,10 +5,16 @@
  *
  * Generates three synthetic 128×128 grayscale test images, runs all three
  * processing modes on each, and prints threshold / foreground-pixel / mode
- * results.  Also exercises the adaptive mode selector.
+ * results.  Also exercises the adaptive mode selector (and MODE_AUTO with
+ * contrast stretch / equalisation) and checks the RLE
+ * output format against the plain mask, the line-buffer erode / dilate
+ * against the direct-access filters, the histogram / fixed-threshold
+ * tile modes, the slice-streaming volume mode and the multi-channel kernel
+ * (otsu_multichannel_top).
  *
  * Compile (desktop):
- *   g++ -std=c++11 -o test_otsu test_otsu.cpp otsu_threshold.cpp image_stats.cpp
+ *   g++ -std=c++11 -o test_otsu test_otsu.cpp otsu_threshold.cpp \
+ *       otsu_multichannel.cpp image_stats.cpp
  *   ./test_otsu
  *
  * For HLS co-simulation the same file is used as the testbench source.
@@ -18,6 +24,7 @@
 #include <cstring>
 #include <cmath>
 #include "otsu_threshold.h"
+#include "otsu_multichannel.h"
 #include "image_stats.h"
 
 /* -----------------------------------------------------------------------
@@ -33,6 +40,9 @@ static uint8_t rand8(void)
 }
 static void seed_rng(uint32_t s) { rng_state = s; }
 
+/* Stand-in for the block design's free-running cycle counter */
+static volatile uint32_t cycle_counter = 0;
+
 /* Dice coefficient between two binary masks */
 static float dice(const uint8_t *pred, const uint8_t *gt, int n)
 {
@@ -50,6 +60,37 @@ static float dice(const uint8_t *pred, const uint8_t *gt, int n)
     return 2.0f * tp / (pred_sum + gt_sum);
 }
 
+/* Verify the region moments / bbox reported by the accelerator against a
+ * straightforward recomputation from the output mask */
+static int check_moments(const uint8_t *mask, const OtsuResult *res)
+{
+    uint32_t n = 0, sx = 0, sy = 0, sxx = 0, syy = 0, sxy = 0;
+    int x0 = 255, y0 = 255, x1 = 0, y1 = 0;
+    for (int r = 0; r < IMG_HEIGHT; r++)
+    {
+        for (int c = 0; c < IMG_WIDTH; c++)
+        {
+            if (mask[r * IMG_WIDTH + c] == 0)
+                continue;
+            n++;
+            sx += c;
+            sy += r;
+            sxx += c * c;
+            syy += r * r;
+            sxy += c * r;
+            if (c < x0) x0 = c;
+            if (c > x1) x1 = c;
+            if (r < y0) y0 = r;
+            if (r > y1) y1 = r;
+        }
+    }
+    return n == res->foreground_pixels &&
+           sx == res->sum_x && sy == res->sum_y &&
+           sxx == res->sum_xx && syy == res->sum_yy && sxy == res->sum_xy &&
+           x0 == res->bbox_x0 && y0 == res->bbox_y0 &&
+           x1 == res->bbox_x1 && y1 == res->bbox_y1;
+}
+
 /* -----------------------------------------------------------------------
  * Synthetic image generators
  * ---------------------------------------------------------------------*/
@@ -177,11 +218,30 @@ static int test_image(const char *name,
         memset(out, 0, sizeof(out));
         memset(&res, 0, sizeof(res));
 
-        otsu_threshold_top(img, out, (uint8_t)m, &res);
+        otsu_threshold_top(img, out, (uint8_t)m, 0, NORM_NONE, &res, &cycle_counter);
 
         float d = dice(out, gt, IMG_SIZE);
-        printf("  Mode %-8s → thr=%3u  fg_px=%5u  dice=%.4f",
-               mode_names[m], res.threshold, res.foreground_pixels, d);
+        printf("  Mode %-8s → thr=%3u  fg_px=%5u  eta=%.3f  dice=%.4f",
+               mode_names[m], res.threshold, res.foreground_pixels,
+               res.separability / 65536.0f, d);
+
+        if (!check_moments(out, &res))
+        {
+            printf("  [FAIL: moments/bbox mismatch]\n");
+            pass = 0;
+            continue;
+        }
+
+        /* Skipped stages must not be charged any cycles */
+        if ((m < MODE_NORMAL && res.stage_cycles[STAGE_OPEN] != 0) ||
+            (m < MODE_CAREFUL && res.stage_cycles[STAGE_CLOSE] != 0) ||
+            res.stage_cycles[STAGE_READ_IN] == 0 ||
+            res.stage_cycles[STAGE_WRITE_OUT] == 0)
+        {
+            printf("  [FAIL: stage cycle counters]\n");
+            pass = 0;
+            continue;
+        }
 
         if (d < 0.10f)
         {
@@ -196,15 +256,19 @@ static int test_image(const char *name,
         }
     }
 
-    /* --- 3. Verify adaptive path matches explicit mode --- */
+    /* --- 3. Verify the in-kernel MODE_AUTO matches the explicit mode --- */
     {
         uint8_t out_auto[IMG_SIZE], out_explicit[IMG_SIZE];
         OtsuResult ra, re;
-        otsu_threshold_top(img, out_auto, (uint8_t)auto_mode, &ra);
-        otsu_threshold_top(img, out_explicit, (uint8_t)auto_mode, &re);
+        otsu_threshold_top(img, out_auto, MODE_AUTO, 0, NORM_NONE, &ra, &cycle_counter);
+        otsu_threshold_top(img, out_explicit, (uint8_t)auto_mode, 0, NORM_NONE, &re,
+                           &cycle_counter);
 
-        int match = (ra.threshold == re.threshold) &&
-                    (ra.foreground_pixels == re.foreground_pixels);
+        int match = (ra.mode_used == auto_mode) &&
+                    (ra.threshold == re.threshold) &&
+                    (ra.foreground_pixels == re.foreground_pixels) &&
+                    (ra.separability == re.separability) &&
+                    memcmp(out_auto, out_explicit, IMG_SIZE) == 0;
         printf("  Adaptive consistency check: %s\n",
                match ? "PASS" : "FAIL");
         if (!match)
@@ -214,6 +278,456 @@ static int test_image(const char *name,
     return pass;
 }
 
+/* -----------------------------------------------------------------------
+ * Contrast normalisation – NORM_STRETCH / NORM_EQUALIZE with MODE_AUTO must
+ * behave like the explicit mode that select_mode() picks for the
+ * normalised image, run on that image.  The tile modes ignore the
+ * normalisation.
+ * ---------------------------------------------------------------------*/
+static const char *const mode_label[] = {"FAST", "NORMAL", "CAREFUL", "AUTO"};
+
+static void reference_normalize(const uint8_t img[IMG_SIZE], uint8_t out[IMG_SIZE],
+                                uint8_t method)
+{
+    uint32_t hist[NUM_BINS] = {0}, cdf[NUM_BINS];
+    for (int i = 0; i < IMG_SIZE; i++)
+        hist[img[i]]++;
+    int lo = 0, hi = NUM_BINS - 1;
+    while (hist[lo] == 0)
+        lo++;
+    while (hist[hi] == 0)
+        hi--;
+    uint32_t run = 0;
+    for (int v = 0; v < NUM_BINS; v++)
+        cdf[v] = run += hist[v];
+
+    uint8_t lut[NUM_BINS];
+    for (int v = 0; v < NUM_BINS; v++)
+    {
+        double span = method == NORM_STRETCH ? hi - lo : IMG_SIZE - hist[lo];
+        double x = v <= lo ? 0.0 : method == NORM_STRETCH ? (v >= hi ? span : v - lo)
+                                                          : cdf[v] - hist[lo];
+        lut[v] = span == 0.0 ? (uint8_t)v : (uint8_t)floor(x * 255.0 / span + 0.5);
+    }
+    for (int i = 0; i < IMG_SIZE; i++)
+        out[i] = lut[img[i]];
+}
+
+static int test_normalize(const char *name, const uint8_t img[IMG_SIZE], uint8_t method)
+{
+    static uint8_t norm_img[IMG_SIZE], out[IMG_SIZE], ref[IMG_SIZE];
+    uint32_t hist[NUM_BINS];
+    ImageStats st_raw, st_norm, st_hist;
+    OtsuResult r, rr;
+
+    compute_image_stats(img, &st_raw);
+    reference_normalize(img, norm_img, method);
+    compute_image_stats(norm_img, &st_norm);
+    compute_histogram(norm_img, hist);
+    compute_hist_stats(hist, &st_hist);
+    ProcessingMode expect = select_mode(&st_norm);
+
+    otsu_threshold_top(img, out, MODE_AUTO, 0, method, &r, &cycle_counter);
+    otsu_threshold_top(norm_img, ref, (uint8_t)expect, 0, NORM_NONE, &rr, &cycle_counter);
+    int pass = memcmp(&st_hist, &st_norm, sizeof(st_norm)) == 0 &&
+               r.mode_used == expect && r.threshold == rr.threshold &&
+               r.separability == rr.separability &&
+               r.foreground_pixels == rr.foreground_pixels &&
+               memcmp(out, ref, IMG_SIZE) == 0 &&
+               r.stage_cycles[STAGE_HISTOGRAM] > rr.stage_cycles[STAGE_HISTOGRAM];
+
+    /* Tile modes keep the raw scale; AUTO runs as FAST there */
+    otsu_threshold_top(img, ref, MODE_FAST | MODE_FIXED_THRESHOLD, 100, NORM_NONE, &rr,
+                       &cycle_counter);
+    otsu_threshold_top(img, out, MODE_AUTO | MODE_FIXED_THRESHOLD, 100, method, &r,
+                       &cycle_counter);
+    pass = pass && r.mode_used == MODE_FAST && r.threshold == 100 &&
+           r.foreground_pixels == rr.foreground_pixels && memcmp(out, ref, IMG_SIZE) == 0;
+
+    printf("Normalise %-13s (%s): contrast %3u -> %3u, std %2u -> %2u, mode %s -> %s %s\n",
+           name, method == NORM_STRETCH ? "stretch" : "equalise", st_raw.contrast,
+           st_norm.contrast, st_raw.std_dev, st_norm.std_dev,
+           mode_label[select_mode(&st_raw)], mode_label[expect], pass ? "PASS" : "FAIL");
+    return pass;
+}
+
+/* -----------------------------------------------------------------------
+ * Histogram check – small alphabet with long runs and a, b, a patterns,
+ * which exercise the BRAM variant's run accumulator and forwarding cache.
+ * ---------------------------------------------------------------------*/
+static int test_histogram(void)
+{
+    static uint8_t img[IMG_SIZE];
+    uint32_t hist[NUM_BINS], ref[NUM_BINS];
+
+    seed_rng(2024);
+    memset(ref, 0, sizeof(ref));
+    for (int i = 0; i < IMG_SIZE; i++)
+    {
+        uint8_t r = rand8();
+        img[i] = (r & 0x80) ? (uint8_t)(r & 0x03) : (i > 0 ? img[i - 1] : 0);
+        ref[img[i]]++;
+    }
+
+    compute_histogram(img, hist);
+    int ok = memcmp(hist, ref, sizeof(ref)) == 0;
+    printf("Histogram check (HIST_IMPL=%d): %s\n", HIST_IMPL, ok ? "PASS" : "FAIL");
+    return ok;
+}
+
+/* -----------------------------------------------------------------------
+ * Line-buffer erode / dilate – same output as the direct-access filters on
+ * random masks of several densities, including the first / last rows and
+ * columns, and on random grey levels (both are plain min / max filters).
+ * ---------------------------------------------------------------------*/
+static int test_morph_linebuf(void)
+{
+    static uint8_t src[IMG_SIZE], out[IMG_SIZE], ref[IMG_SIZE];
+    static const uint8_t density[] = {8, 64, 128, 192, 248, 0};
+    int pass = 1;
+
+    seed_rng(31337);
+    for (unsigned d = 0; d < sizeof(density); d++)
+    {
+        for (int i = 0; i < IMG_SIZE; i++)
+            src[i] = density[d] ? (rand8() < density[d] ? 255 : 0) : rand8();
+
+        erode_3x3_linebuf(src, out);
+        erode_3x3(src, ref);
+        int ok = memcmp(out, ref, IMG_SIZE) == 0;
+        dilate_3x3_linebuf(src, out);
+        dilate_3x3(src, ref);
+        ok &= memcmp(out, ref, IMG_SIZE) == 0;
+
+        if (density[d])
+            printf("Line-buffer morphology (density %3u/256): %s\n", density[d], ok ? "PASS" : "FAIL");
+        else
+            printf("Line-buffer morphology (grey levels):    %s\n", ok ? "PASS" : "FAIL");
+        pass &= ok;
+    }
+    return pass;
+}
+
+/* -----------------------------------------------------------------------
+ * RLE output – the runs written with MODE_OUTPUT_RLE decode to the plain
+ * mask, nothing past them is written, and a mask with more than
+ * RLE_MAX_RUNS runs falls back to the plain mask.
+ * ---------------------------------------------------------------------*/
+static uint32_t count_runs(const uint8_t *mask)
+{
+    uint32_t n = 0;
+    for (int i = 0; i < IMG_SIZE; i++)
+        n += mask[i] && (i % IMG_WIDTH == 0 || !mask[i - 1]);
+    return n;
+}
+
+static int test_rle(const char *name, const uint8_t img[IMG_SIZE], uint8_t mode)
+{
+    static uint8_t plain[IMG_SIZE], rle[IMG_SIZE], decoded[IMG_SIZE];
+    OtsuResult rp, rr;
+
+    otsu_threshold_top(img, plain, mode, 0, NORM_NONE, &rp, &cycle_counter);
+    memset(rle, 0xA5, sizeof(rle));
+    otsu_threshold_top(img, rle, mode | MODE_OUTPUT_RLE, 0, NORM_NONE, &rr, &cycle_counter);
+
+    uint32_t runs = count_runs(plain);
+    int same = rr.threshold == rp.threshold && rr.mode_used == rp.mode_used &&
+               rr.foreground_pixels == rp.foreground_pixels &&
+               rr.sum_xy == rp.sum_xy && rr.bbox_y1 == rp.bbox_y1 &&
+               rp.run_count == 0;
+    int ok;
+    if (runs > RLE_MAX_RUNS)
+    {
+        /* Fallback: plain mask, no runs reported */
+        ok = same && rr.run_count == 0 && memcmp(rle, plain, IMG_SIZE) == 0;
+    }
+    else
+    {
+        memset(decoded, 0, sizeof(decoded));
+        ok = same && rr.run_count == runs;
+        int prev = -1;
+        for (uint32_t k = 0; ok && k < rr.run_count; k++)
+        {
+            const uint8_t *r = rle + RLE_RUN_BYTES * k;
+            int x0 = r[0], len = r[1], y = r[2];
+            int key = y * IMG_WIDTH + x0;
+            ok = len > 0 && x0 + len <= IMG_WIDTH && y < IMG_HEIGHT &&
+                 r[3] == 0 && key >= prev;   /* row order */
+            memset(decoded + key, 255, ok ? len : 0);
+            prev = key + len;
+        }
+        ok = ok && memcmp(decoded, plain, IMG_SIZE) == 0;
+        for (uint32_t i = RLE_RUN_BYTES * rr.run_count; ok && i < IMG_SIZE; i++)
+            ok = rle[i] == 0xA5;
+    }
+
+    printf("RLE output (%s): %u runs, %u of %d bytes written: %s\n", name,
+           (unsigned)runs, (unsigned)(rr.run_count ? RLE_RUN_BYTES * rr.run_count : IMG_SIZE),
+           IMG_SIZE, ok ? "PASS" : "FAIL");
+    return ok;
+}
+
+/* -----------------------------------------------------------------------
+ * Tile modes – MODE_OUTPUT_HIST writes exactly the histogram and nothing
+ * else; MODE_FIXED_THRESHOLD with the threshold a normal run applied gives
+ * the same mask and moments without the histogram / sweep stages.
+ * ---------------------------------------------------------------------*/
+static int test_tile_modes(const char *name, const uint8_t img[IMG_SIZE], uint8_t mode)
+{
+    static uint8_t plain[IMG_SIZE], out[IMG_SIZE];
+    uint32_t ref[NUM_BINS];
+    OtsuResult rp, rh, rf;
+
+    compute_histogram(img, ref);
+    memset(out, 0xA5, sizeof(out));
+    otsu_threshold_top(img, out, mode | MODE_OUTPUT_HIST, 0, NORM_NONE, &rh, &cycle_counter);
+    int hist_ok = rh.foreground_pixels == 0 && rh.bbox_x0 == 255 &&
+                  rh.run_count == 0 &&
+                  rh.stage_cycles[STAGE_WRITE_OUT] == HIST_OUT_BYTES &&
+                  rh.stage_cycles[STAGE_OPEN] == 0;
+    for (int b = 0; hist_ok && b < NUM_BINS; b++)
+        hist_ok = (uint32_t)(out[4 * b] | out[4 * b + 1] << 8 | out[4 * b + 2] << 16 |
+                             out[4 * b + 3] << 24) == ref[b];
+    for (int i = HIST_OUT_BYTES; hist_ok && i < IMG_SIZE; i++)
+        hist_ok = out[i] == 0xA5;
+
+    otsu_threshold_top(img, plain, mode, 0, NORM_NONE, &rp, &cycle_counter);
+    otsu_threshold_top(img, out, mode | MODE_FIXED_THRESHOLD, rp.threshold, NORM_NONE, &rf,
+                       &cycle_counter);
+    int fixed_ok = rf.threshold == rp.threshold && rf.mode_used == rp.mode_used &&
+                   rf.foreground_pixels == rp.foreground_pixels &&
+                   rf.sum_xy == rp.sum_xy && rf.separability == 0 &&
+                   rf.stage_cycles[STAGE_HISTOGRAM] == 0 &&
+                   rf.stage_cycles[STAGE_SWEEP] == 0 &&
+                   rf.stage_cycles[STAGE_ADAPTIVE] == 0 &&
+                   memcmp(out, plain, IMG_SIZE) == 0;
+
+    printf("Tile modes (%s, mode %d): histogram only %s, fixed threshold %u %s\n",
+           name, mode, hist_ok ? "PASS" : "FAIL", rp.threshold,
+           fixed_ok ? "PASS" : "FAIL");
+    return hist_ok && fixed_ok;
+}
+
+/* -----------------------------------------------------------------------
+ * Volume mode – slices streamed with MODE_VOLUME must come out VOL_LAG
+ * calls later with the 3x3x3 open / close of the whole thresholded
+ * volume, clipped at its borders.  An abandoned volume before it checks
+ * that MODE_VOLUME_START clears the rings.
+ * ---------------------------------------------------------------------*/
+#define VOL_TEST_DEPTH 10
+static uint8_t vol_img[VOL_TEST_DEPTH][IMG_SIZE];
+static uint8_t vol_ref[VOL_TEST_DEPTH][IMG_SIZE];
+static uint8_t vol_tmp[VOL_TEST_DEPTH][IMG_SIZE];
+
+/* Ellipsoid across the slices, a small blob on the first slice, a
+ * one-slice bright sheet (removed by a 3D open, not a 2D one) and salt */
+static void generate_volume(int depth)
+{
+    seed_rng(4242);
+    for (int z = 0; z < depth; z++)
+    {
+        for (int i = 0; i < IMG_SIZE; i++)
+        {
+            int x = i % IMG_WIDTH, y = i / IMG_WIDTH;
+            float dx = (x - 64) / 30.0f, dy = (y - 60) / 24.0f;
+            float dz = (z - depth / 2.0f) / (depth / 2.0f);
+            int v = 30 + rand8() % 50;
+            if (dx * dx + dy * dy + dz * dz <= 1.0f)
+                v = 170 + rand8() % 40;
+            if (z == 0 && (x - 20) * (x - 20) + (y - 20) * (y - 20) <= 16)
+                v = 200;
+            if (z == depth / 2 && x >= 100 && x < 120 && y >= 100 && y < 120)
+                v = 220;
+            if (rand8() < 2)
+                v = 255;
+            vol_img[z][i] = (uint8_t)v;
+        }
+    }
+}
+
+/* 3x3x3 min / max, neighbourhood clipped at the volume's borders */
+static void morph_3d(uint8_t dst[][IMG_SIZE], uint8_t src[][IMG_SIZE],
+                     int depth, bool dilate)
+{
+    for (int z = 0; z < depth; z++)
+        for (int y = 0; y < IMG_HEIGHT; y++)
+            for (int x = 0; x < IMG_WIDTH; x++)
+            {
+                uint8_t v = dilate ? 0 : 255;
+                for (int dz = -1; dz <= 1; dz++)
+                    for (int dy = -1; dy <= 1; dy++)
+                        for (int dx = -1; dx <= 1; dx++)
+                        {
+                            int zz = z + dz, yy = y + dy, xx = x + dx;
+                            if (zz < 0 || zz >= depth || yy < 0 || yy >= IMG_HEIGHT ||
+                                xx < 0 || xx >= IMG_WIDTH)
+                                continue;
+                            uint8_t s = src[zz][yy * IMG_WIDTH + xx];
+                            v = dilate ? (s > v ? s : v) : (s < v ? s : v);
+                        }
+                dst[z][y * IMG_WIDTH + x] = v;
+            }
+}
+
+static int test_volume(int depth, uint8_t mode, uint8_t thr)
+{
+    static uint8_t out[IMG_SIZE];
+    const int lag = VOL_LAG(mode);
+    const uint8_t vmode = mode | MODE_FIXED_THRESHOLD | MODE_VOLUME;
+    OtsuResult r;
+    int pass = 1, slices = 0;
+
+    /* Abandoned volume: leaves the rings full */
+    generate_volume(VOL_TEST_DEPTH);
+    for (int z = 0; z < 3; z++)
+        otsu_threshold_top(vol_img[VOL_TEST_DEPTH - 1 - z], out,
+                           vmode | (z == 0 ? MODE_VOLUME_START : 0), thr, NORM_NONE, &r,
+                           &cycle_counter);
+
+    generate_volume(depth);
+    for (int z = 0; z < depth; z++)
+        for (int i = 0; i < IMG_SIZE; i++)
+            vol_ref[z][i] = vol_img[z][i] > thr ? 255 : 0;
+    if (mode >= MODE_NORMAL)
+    {
+        morph_3d(vol_tmp, vol_ref, depth, false);
+        morph_3d(vol_ref, vol_tmp, depth, true);
+    }
+    if (mode == MODE_CAREFUL)
+    {
+        morph_3d(vol_tmp, vol_ref, depth, true);
+        morph_3d(vol_ref, vol_tmp, depth, false);
+    }
+
+    for (int k = 0; k < depth + lag; k++)
+    {
+        uint8_t m = vmode;
+        if (k == 0)
+            m |= MODE_VOLUME_START;
+        if (k >= depth)
+            m |= MODE_VOLUME_FLUSH;
+        otsu_threshold_top(vol_img[k < depth ? k : 0], out, m, thr, NORM_NONE, &r, &cycle_counter);
+
+        int z = k - lag;
+        if (r.slice_ready != (z >= 0))
+            pass = 0;
+        if (!r.slice_ready)
+            continue;
+        slices++;
+        if (memcmp(out, vol_ref[z], IMG_SIZE) != 0 || !check_moments(out, &r))
+            pass = 0;
+    }
+
+    /* Plain frames report no slice */
+    otsu_threshold_top(vol_img[0], out, mode, 0, NORM_NONE, &r, &cycle_counter);
+    pass = pass && r.slice_ready == 0 && slices == depth;
+
+    printf("Volume (%d slices, mode %d, lag %d): %d slices out %s\n",
+           depth, mode, lag, slices, pass ? "PASS" : "FAIL");
+    return pass;
+}
+
+/* -----------------------------------------------------------------------
+ * Multi-channel kernel – every channel must get the threshold of its own
+ * plane, and the mask must be the LUT fusion of the channel masks cleaned
+ * up like the single-channel kernel's.  One channel with the identity LUT
+ * is the single-channel kernel, whatever the unused tuple bytes hold.
+ * ---------------------------------------------------------------------*/
+static uint8_t mc_planes[MC_MAX_CHANNELS][IMG_SIZE];
+static uint32_t mc_tuples[IMG_SIZE];
+
+/* Tumour core bright in channel 0 (T1-like), core and edema in channel 1
+ * (T2-like), edema only in channel 2 (FLAIR-like), noise in channel 3 */
+static void generate_multichannel(void)
+{
+    seed_rng(777);
+    for (int i = 0; i < IMG_SIZE; i++)
+    {
+        int x = i % IMG_WIDTH, y = i / IMG_WIDTH;
+        int d2 = (x - 60) * (x - 60) + (y - 68) * (y - 68);
+        bool core = d2 <= 14 * 14, edema = !core && d2 <= 26 * 26;
+        mc_planes[0][i] = (uint8_t)(core ? 190 + rand8() % 40 : 40 + rand8() % 50);
+        mc_planes[1][i] = (uint8_t)(core || edema ? 160 + rand8() % 50 : 50 + rand8() % 40);
+        mc_planes[2][i] = (uint8_t)(edema ? 180 + rand8() % 50 : 30 + rand8() % 60);
+        if (x > 100 && y < 20)
+            mc_planes[2][i] = 240; /* FLAIR-only artefact */
+        mc_planes[3][i] = rand8();
+    }
+    for (int i = 0; i < IMG_SIZE; i++)
+        mc_tuples[i] = (uint32_t)mc_planes[0][i] | (uint32_t)mc_planes[1][i] << 8 |
+                       (uint32_t)mc_planes[2][i] << 16 | (uint32_t)mc_planes[3][i] << 24;
+}
+
+static int test_multichannel(const char *name, uint8_t channels, uint16_t lut,
+                             uint8_t mode)
+{
+    static uint8_t out[IMG_SIZE], ref[IMG_SIZE];
+    uint32_t hist[NUM_BINS];
+    uint8_t thr[MC_MAX_CHANNELS] = {0};
+    uint32_t ch_fg[MC_MAX_CHANNELS] = {0};
+    McResult r;
+    int pass = 1;
+
+    for (int c = 0; c < channels; c++)
+    {
+        uint16_t sep;
+        compute_histogram(mc_planes[c], hist);
+        thr[c] = otsu_compute(hist, &sep);
+    }
+    uint32_t fg = 0;
+    for (int i = 0; i < IMG_SIZE; i++)
+    {
+        unsigned v = 0;
+        for (int c = 0; c < channels; c++)
+            if (mc_planes[c][i] > thr[c])
+            {
+                v |= 1U << c;
+                ch_fg[c]++;
+            }
+        ref[i] = (lut >> v) & 1U ? 255 : 0;
+    }
+    if (mode >= MODE_NORMAL)
+        morph_open_3x3(ref);
+    if (mode == MODE_CAREFUL)
+        morph_close_3x3(ref);
+    for (int i = 0; i < IMG_SIZE; i++)
+        fg += ref[i] > 0;
+
+    otsu_multichannel_top(mc_tuples, out, mode, channels, lut, &r, &cycle_counter);
+    pass = memcmp(out, ref, IMG_SIZE) == 0 && r.foreground_pixels == fg &&
+           r.channels == channels && r.combine == lut && r.mode_used == mode &&
+           r.stage_cycles[STAGE_ADAPTIVE] == 0 && r.stage_cycles[STAGE_READ_IN] == IMG_SIZE;
+    for (int c = 0; c < MC_MAX_CHANNELS; c++)
+        pass = pass && r.thresholds[c] == thr[c] && r.channel_pixels[c] == ch_fg[c] &&
+               (c < channels || r.separability[c] == 0);
+
+    printf("Multi-channel %-9s (%d ch, LUT 0x%04X, mode %d): thr %3u/%3u/%3u/%3u, "
+           "%5u px %s\n",
+           name, channels, lut, mode, r.thresholds[0], r.thresholds[1],
+           r.thresholds[2], r.thresholds[3], r.foreground_pixels, pass ? "PASS" : "FAIL");
+    return pass;
+}
+
+static int test_multichannel_single(uint8_t mode)
+{
+    static uint8_t out[IMG_SIZE], ref[IMG_SIZE];
+    McResult r;
+    OtsuResult rs;
+
+    otsu_threshold_top(mc_planes[1], ref, mode, 0, NORM_NONE, &rs, &cycle_counter);
+    for (int i = 0; i < IMG_SIZE; i++)
+        mc_tuples[i] = (uint32_t)mc_planes[1][i] | (uint32_t)rand8() << 8 |
+                       (uint32_t)rand8() << 16 | (uint32_t)rand8() << 24;
+    otsu_multichannel_top(mc_tuples, out, mode, 1, MC_LUT_AND(1), &r, &cycle_counter);
+
+    int pass = memcmp(out, ref, IMG_SIZE) == 0 && r.thresholds[0] == rs.threshold &&
+               r.separability[0] == rs.separability &&
+               r.foreground_pixels == rs.foreground_pixels && r.thresholds[1] == 0;
+    printf("Multi-channel single plane (mode %d): thr %u (kernel %u) %s\n",
+           mode, r.thresholds[0], rs.threshold, pass ? "PASS" : "FAIL");
+    return pass;
+}
+
 /* -----------------------------------------------------------------------
  * main
  * ---------------------------------------------------------------------*/
@@ -227,6 +741,10 @@ int main(void)
     uint8_t gt[IMG_SIZE];
     int total_pass = 1;
 
+    if (!test_histogram())
+        total_pass = 0;
+    total_pass &= test_morph_linebuf();
+
     /* Test 1 – bright circle */
     generate_bright_circle(img, gt);
     if (!test_image("bright_circle", img, gt))
@@ -242,6 +760,66 @@ int main(void)
     if (!test_image("low_contrast", img, gt))
         total_pass = 0;
 
+    /* RLE output on each image, and on noise (too many runs) */
+    printf("\n");
+    generate_bright_circle(img, gt);
+    total_pass &= test_rle("bright_circle", img, MODE_NORMAL);
+    generate_two_blobs(img, gt);
+    total_pass &= test_rle("two_blobs", img, MODE_CAREFUL);
+    generate_low_contrast(img, gt);
+    total_pass &= test_rle("low_contrast", img, MODE_FAST);
+    /* Runs at both ends of every row, a full row and single pixels */
+    for (int i = 0; i < IMG_SIZE; i++)
+    {
+        int x = i % IMG_WIDTH, y = i / IMG_WIDTH;
+        img[i] = (x == 0 || x == IMG_WIDTH - 1 || y == 64 || (y == 10 && x % 8 == 4)) ? 220 : 20;
+    }
+    total_pass &= test_rle("edges", img, MODE_FAST);
+    seed_rng(99);
+    for (int i = 0; i < IMG_SIZE; i++)
+        img[i] = rand8();
+    total_pass &= test_rle("noise", img, MODE_FAST);
+
+    /* Contrast normalisation before the mode choice */
+    printf("\n");
+    generate_low_contrast(img, gt);
+    total_pass &= test_normalize("low_contrast", img, NORM_STRETCH);
+    total_pass &= test_normalize("low_contrast", img, NORM_EQUALIZE);
+    generate_two_blobs(img, gt);
+    total_pass &= test_normalize("two_blobs", img, NORM_STRETCH);
+    total_pass &= test_normalize("two_blobs", img, NORM_EQUALIZE);
+    generate_bright_circle(img, gt);
+    total_pass &= test_normalize("bright_circle", img, NORM_EQUALIZE);
+    memset(img, 77, IMG_SIZE);
+    total_pass &= test_normalize("flat", img, NORM_STRETCH);
+    total_pass &= test_normalize("flat", img, NORM_EQUALIZE);
+
+    /* Histogram-only and fixed-threshold runs (tiled images) */
+    printf("\n");
+    generate_bright_circle(img, gt);
+    total_pass &= test_tile_modes("bright_circle", img, MODE_NORMAL);
+    generate_low_contrast(img, gt);
+    total_pass &= test_tile_modes("low_contrast", img, MODE_CAREFUL);
+    generate_two_blobs(img, gt);
+    total_pass &= test_tile_modes("two_blobs", img, MODE_FAST);
+
+    /* Slice-streaming 3D morphology */
+    printf("\n");
+    total_pass &= test_volume(VOL_TEST_DEPTH, MODE_NORMAL, 120);
+    total_pass &= test_volume(VOL_TEST_DEPTH, MODE_CAREFUL, 120);
+    total_pass &= test_volume(2, MODE_CAREFUL, 120);
+    total_pass &= test_volume(6, MODE_FAST, 120);
+
+    /* Multi-channel fusion */
+    printf("\n");
+    generate_multichannel();
+    total_pass &= test_multichannel("AND", 2, MC_LUT_AND(2), MODE_NORMAL);
+    total_pass &= test_multichannel("OR", 3, MC_LUT_OR, MODE_CAREFUL);
+    total_pass &= test_multichannel("majority", 3, MC_LUT_MAJORITY3, MODE_NORMAL);
+    total_pass &= test_multichannel("majority", 4, MC_LUT_MAJORITY4, MODE_FAST);
+    total_pass &= test_multichannel("edema", 3, 0x0044, MODE_CAREFUL); /* ch 1, not ch 0 */
+    total_pass &= test_multichannel_single(MODE_NORMAL);
+
     printf("\n==============================================\n");
     if (total_pass)
     {
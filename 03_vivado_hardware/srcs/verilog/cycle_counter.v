@@ -0,0 +1,28 @@
+////////////////////////////////////////////////////////////////////////////////
+// cycle_counter.v
+// ----------------
+// Free-running 32-bit clock-cycle counter for the Otsu accelerator's
+// per-stage latency instrumentation.
+//
+// Connect `count` to the HLS IP's `cycle_counter` ap_none input port in the
+// block design (same clock as ap_clk).  The kernel latches it at every stage
+// boundary and reports the differences in OtsuResult.stage_cycles, so the
+// value wrapping every ~43 s at 100 MHz is harmless.
+//
+// Target: Artix-7, 100 MHz
+////////////////////////////////////////////////////////////////////////////////
+
+module cycle_counter (
+    input  wire        clk,
+    input  wire        rst,      // active-high synchronous reset
+    output reg  [31:0] count
+);
+
+    always @(posedge clk) begin
+        if (rst)
+            count <= 32'd0;
+        else
+            count <= count + 32'd1;
+    end
+
+endmodule
@@ -0,0 +1,274 @@
+/******************************************************************************
+ * telemetry_decode.cpp
+ * ---------------------
+ * Host-side decoder for the firmware's binary telemetry stream
+ * (TELEMETRY_BINARY=1, record layout in ../src/telemetry.h).
+ *
+ * Reads the raw UART byte stream, prints every record with a valid CRC as
+ * text and passes any other bytes (banner, summaries) through unchanged.
+ * Gaps in the sequence numbers (records the firmware dropped because its
+ * TX ring was full) are reported.
+ *
+ * Build / run (from 04_vitis_software):
+ *   make host
+ *   build/telemetry_decode [capture.bin]     (stdin if no file)
+ *   e.g.  build/telemetry_decode < /dev/ttyUSB1
+ ******************************************************************************/
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <vector>
+
+/* ---- Must match src/telemetry.h ---- */
+static const uint32_t TLM_SYNC          = 0x314D4C54U;   /* "TLM1" */
+static const size_t   TLM_HEADER_BYTES  = 12;
+static const size_t   TLM_CRC_BYTES     = 4;
+static const size_t   TLM_MAX_PAYLOAD   = 12 + 24 * 16;   /* MAX_REGIONS */
+static const int      TLM_NUM_STAGES    = 8;
+
+enum { TLM_ACCEL_RESULT = 1, TLM_WATERSHED = 2, TLM_ENERGY = 3, TLM_CONTOUR = 4 };
+
+/* -----------------------------------------------------------------------
+ * Helpers
+ * ---------------------------------------------------------------------*/
+static uint32_t crc32(const uint8_t *buf, size_t len)
+{
+    uint32_t crc = 0xFFFFFFFFU;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= buf[i];
+        for (int b = 0; b < 8; b++)
+            crc = (crc >> 1) ^ (0xEDB88320U & (0U - (crc & 1U)));
+    }
+    return ~crc;
+}
+
+static uint16_t get_u16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static float get_f32(const uint8_t *p)
+{
+    uint32_t bits = get_u32(p);
+    float v;
+    std::memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+/* Expected payload length of a record type, or 0 if unknown */
+static size_t payload_bytes(uint8_t type, const uint8_t *payload)
+{
+    switch (type) {
+    case TLM_ACCEL_RESULT: return 40 + 4 * TLM_NUM_STAGES;
+    case TLM_WATERSHED:    return 12 + 24 * (size_t)payload[8];
+    case TLM_ENERGY:       return 48;
+    case TLM_CONTOUR:      return 12 + (3 * (size_t)get_u16(payload + 10) + 7) / 8;
+    default:               return 0;
+    }
+}
+
+/* -----------------------------------------------------------------------
+ * Record printers
+ * ---------------------------------------------------------------------*/
+static void print_result(const uint8_t *p)
+{
+    static const char * const stage_names[TLM_NUM_STAGES] = {
+        "read-in", "histogram", "sweep", "adaptive",
+        "threshold", "open", "close", "write-out"
+    };
+
+    uint32_t count = get_u32(p + 12);
+    std::printf("[frame %u] accel: mode %u (used %u) threshold %u "
+                "separability %u fg %u bbox (%u,%u)-(%u,%u)",
+                get_u32(p), p[4], p[6], p[5], get_u16(p + 8), count,
+                p[36], p[37], p[38], p[39]);
+    if (get_u16(p + 10))
+        std::printf(" runs %u", get_u16(p + 10));
+    std::printf("\n");
+
+    /* Orientation from the moments, as watershed_moments_orientation() */
+    if (count) {
+        double n    = count;
+        double mx   = get_u32(p + 16) / n;
+        double my   = get_u32(p + 20) / n;
+        double mu20 = get_u32(p + 24) / n - mx * mx;
+        double mu02 = get_u32(p + 28) / n - my * my;
+        double mu11 = get_u32(p + 32) / n - mx * my;
+        double theta = 0.5 * std::atan2(2.0 * mu11, mu20 - mu02);
+        std::printf("           centroid (%.1f, %.1f) orientation %ld deg\n",
+                    mx, my, std::lround(theta * 180.0 / 3.14159265358979));
+    }
+
+    std::printf("           stage cycles:");
+    uint32_t total = 0;
+    for (int s = 0; s < TLM_NUM_STAGES; s++) {
+        uint32_t c = get_u32(p + 40 + 4 * s);
+        std::printf(" %s %u", stage_names[s], c);
+        total += c;
+    }
+    std::printf(" (total %u)\n", total);
+}
+
+static void print_regions(const uint8_t *p)
+{
+    uint8_t n = p[8];
+    std::printf("[frame %u] watershed: %u regions (%u listed), %u fg pixels\n",
+                get_u32(p), get_u16(p + 10), n, get_u32(p + 4));
+    for (uint8_t i = 0; i < n; i++) {
+        const uint8_t *r = p + 12 + 24 * i;
+        std::printf("           region %u: area %u centroid (%u,%u) "
+                    "bbox (%u,%u)-(%u,%u)%s\n",
+                    get_u16(r + 16), get_u32(r), get_u16(r + 4), get_u16(r + 6),
+                    get_u16(r + 8), get_u16(r + 10), get_u16(r + 12),
+                    get_u16(r + 14), r[18] ? " selected" : "");
+        if (get_u16(r + 20))
+            std::printf("           perimeter %.1f compactness %u%%\n",
+                        get_u16(r + 20) / 10.0, get_u16(r + 22));
+    }
+}
+
+static void print_contour(const uint8_t *p)
+{
+    static const int dx[8] = { 1, 1, 0, -1, -1, -1, 0, 1 };
+    static const int dy[8] = { 0, -1, -1, -1, 0, 1, 1, 1 };
+
+    unsigned steps = get_u16(p + 8), stored = get_u16(p + 10);
+    std::printf("[frame %u] contour of region %u: start (%u,%u), %u steps%s\n",
+                get_u32(p), get_u16(p + 4), p[6], p[7], steps,
+                stored < steps ? " (truncated)" : "");
+
+    /* Unpack the chain code; walk it to check that the outline closes */
+    std::printf("           chain ");
+    int x = p[6], y = p[7];
+    for (unsigned n = 0; n < stored; n++) {
+        unsigned bit = 3 * n;
+        unsigned v = p[12 + bit / 8] | (bit % 8 > 5 ? p[12 + bit / 8 + 1] << 8 : 0);
+        unsigned d = (v >> (bit % 8)) & 7;
+        std::putchar('0' + d);
+        x += dx[d];
+        y += dy[d];
+    }
+    std::printf("%s\n", stored == steps && (x != p[6] || y != p[7]) ? " (not closed)" : "");
+}
+
+static void print_energy(const uint8_t *p)
+{
+    std::printf("[frame %u] energy: hw %u cyc (%.3f ms, %.1f mW, %.2f uJ), "
+                "sw %u cyc (%.3f ms, %.1f mW, %.2f uJ)\n",
+                get_u32(p), get_u32(p + 4), get_f32(p + 16), get_f32(p + 28),
+                get_f32(p + 36), get_u32(p + 8), get_f32(p + 20),
+                get_f32(p + 32), get_f32(p + 40));
+    std::printf("           speedup %.1fx, energy savings %.1f%%\n",
+                get_f32(p + 24), get_f32(p + 44));
+}
+
+/* -----------------------------------------------------------------------
+ * Stream decoder
+ * ---------------------------------------------------------------------*/
+struct Decoder
+{
+    std::vector<uint8_t> buf;   /* bytes not yet consumed        */
+    bool have_seq = false;
+    uint32_t next_seq = 0;
+    unsigned long records = 0, lost = 0, crc_errors = 0;
+
+    void feed(const uint8_t *data, size_t len)
+    {
+        buf.insert(buf.end(), data, data + len);
+        size_t pos = 0;
+        while (pos < buf.size()) {
+            size_t used = parse(&buf[pos], buf.size() - pos);
+            if (used == 0)
+                break;             /* incomplete record: need more bytes */
+            pos += used;
+        }
+        buf.erase(buf.begin(), buf.begin() + pos);
+    }
+
+    /* Consume a record or a text byte at @p p; 0 if more input is needed */
+    size_t parse(const uint8_t *p, size_t avail)
+    {
+        if (avail < 4)
+            return avail == 0 || p[0] == (TLM_SYNC & 0xFF) ? 0 : text(p);
+        if (get_u32(p) != TLM_SYNC)
+            return text(p);
+        if (avail < TLM_HEADER_BYTES)
+            return 0;
+
+        size_t len = get_u16(p + 6);
+        if (len > TLM_MAX_PAYLOAD)
+            return text(p);
+        size_t total = TLM_HEADER_BYTES + len + TLM_CRC_BYTES;
+        if (avail < total)
+            return 0;
+
+        const uint8_t *payload = p + TLM_HEADER_BYTES;
+        if (crc32(p, TLM_HEADER_BYTES + len) != get_u32(payload + len) ||
+            len < 12 || payload_bytes(p[4], payload) != len) {
+            crc_errors++;
+            return text(p);        /* resynchronise on the next byte */
+        }
+
+        uint32_t seq = get_u32(p + 8);
+        if (have_seq && seq != next_seq) {
+            std::printf("[telemetry] %u record(s) lost\n", seq - next_seq);
+            lost += seq - next_seq;
+        }
+        have_seq = true;
+        next_seq = seq + 1;
+        records++;
+
+        switch (p[4]) {
+        case TLM_ACCEL_RESULT: print_result(payload);  break;
+        case TLM_WATERSHED:    print_regions(payload); break;
+        case TLM_ENERGY:       print_energy(payload);  break;
+        case TLM_CONTOUR:      print_contour(payload); break;
+        }
+        return total;
+    }
+
+    /* End of input: whatever is left was not a record */
+    void finish()
+    {
+        for (size_t i = 0; i < buf.size(); i++)
+            text(&buf[i]);
+        buf.clear();
+    }
+
+    size_t text(const uint8_t *p)
+    {
+        if (p[0] != '\r')
+            std::putchar(p[0]);
+        return 1;
+    }
+};
+
+/* ==================================================================== */
+int main(int argc, char **argv)
+{
+    FILE *in = stdin;
+    if (argc > 1 && !(in = std::fopen(argv[1], "rb"))) {
+        std::perror(argv[1]);
+        return 1;
+    }
+
+    Decoder dec;
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = std::fread(chunk, 1, sizeof(chunk), in)) > 0) {
+        dec.feed(chunk, n);
+        std::fflush(stdout);
+    }
+    dec.finish();
+
+    std::printf("[telemetry] %lu records, %lu lost, %lu bad\n",
+                dec.records, dec.lost, dec.crc_errors);
+    return 0;
+}
@@ -0,0 +1,89 @@
+/******************************************************************************
+ * sim_otsu_kernel.cpp
+ * --------------------
+ * Adapter between the desktop register model and the HLS C model.
+ *
+ * Packs OtsuResult / McResult into the s_axilite word layouts documented
+ * in otsu_threshold.h, otsu_multichannel.h and platform_config.h.
+ *
+ * The C model keeps the MODE_VOLUME slice rings in file-scope statics, so
+ * all simulated instances share them: stream one volume at a time.
+ *****************************************************************************/
+#include "otsu_threshold.h"
+#include "otsu_multichannel.h"
+#include "sim_platform.h"
+
+/* Free-running counter input; the C model adds its own nominal latencies */
+static volatile uint32_t sim_cycle_counter = 0;
+
+uint32_t sim_otsu_kernel_run(const uint8_t *img_in, uint8_t *img_out,
+                             uint8_t mode, uint8_t fixed_threshold,
+                             uint8_t normalize, uint32_t words[SIM_OTSU_RESULT_WORDS],
+                             uint32_t *out_bytes)
+{
+    OtsuResult r;
+    otsu_threshold_top(img_in, img_out, mode, fixed_threshold, normalize, &r,
+                       &sim_cycle_counter);
+
+    /* Runs fall back to the mask only when there are too many of them,
+     * so an RLE run with no runs and some foreground wrote the mask */
+    if (mode & MODE_OUTPUT_HIST)
+        *out_bytes = HIST_OUT_BYTES;
+    else if ((mode & MODE_OUTPUT_RLE) && (r.run_count || r.foreground_pixels == 0))
+        *out_bytes = (uint32_t)RLE_RUN_BYTES * r.run_count;
+    else
+        *out_bytes = IMG_SIZE;
+
+    words[0] = (uint32_t)r.threshold | ((uint32_t)r.mode_used << 8) |
+               ((uint32_t)r.slice_ready << 16);
+    words[1] = r.foreground_pixels;
+    words[2] = r.sum_x;
+    words[3] = r.sum_y;
+    words[4] = r.sum_xx;
+    words[5] = r.sum_yy;
+    words[6] = r.sum_xy;
+    words[7] = (uint32_t)r.bbox_x0 | ((uint32_t)r.bbox_y0 << 8) |
+               ((uint32_t)r.bbox_x1 << 16) | ((uint32_t)r.bbox_y1 << 24);
+    words[8] = (uint32_t)r.separability | ((uint32_t)r.run_count << 16);
+
+    uint32_t latency = 0;
+    for (int s = 0; s < NUM_STAGES; s++)
+    {
+        words[9 + s] = r.stage_cycles[s];
+        latency += r.stage_cycles[s];
+    }
+    return latency;
+}
+
+uint32_t sim_otsu_mc_kernel_run(const uint8_t *tuples, uint8_t *img_out,
+                                uint8_t mode, uint8_t channels, uint16_t combine,
+                                uint32_t words[SIM_OTSU_RESULT_WORDS],
+                                uint32_t *out_bytes)
+{
+    static uint32_t img_in[IMG_SIZE];
+    for (int i = 0; i < IMG_SIZE; i++)
+        img_in[i] = (uint32_t)tuples[4 * i] | ((uint32_t)tuples[4 * i + 1] << 8) |
+                    ((uint32_t)tuples[4 * i + 2] << 16) | ((uint32_t)tuples[4 * i + 3] << 24);
+
+    McResult r;
+    otsu_multichannel_top(img_in, img_out, mode, channels, combine, &r, &sim_cycle_counter);
+    *out_bytes = IMG_SIZE;
+
+    words[0] = (uint32_t)r.thresholds[0] | ((uint32_t)r.thresholds[1] << 8) |
+               ((uint32_t)r.thresholds[2] << 16) | ((uint32_t)r.thresholds[3] << 24);
+    words[1] = (uint32_t)r.mode_used | ((uint32_t)r.channels << 8) |
+               ((uint32_t)r.combine << 16);
+    words[2] = r.foreground_pixels;
+    for (int c = 0; c < MC_MAX_CHANNELS; c++)
+        words[3 + c] = r.channel_pixels[c];
+    words[7] = (uint32_t)r.separability[0] | ((uint32_t)r.separability[1] << 16);
+    words[8] = (uint32_t)r.separability[2] | ((uint32_t)r.separability[3] << 16);
+
+    uint32_t latency = 0;
+    for (int s = 0; s < NUM_STAGES; s++)
+    {
+        words[9 + s] = r.stage_cycles[s];
+        latency += r.stage_cycles[s];
+    }
+    return latency;
+}
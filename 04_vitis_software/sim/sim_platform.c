@@ -0,0 +1,673 @@
+/******************************************************************************
+ * sim_platform.c
+ * ---------------
+ * Desktop stand-in for the MicroBlaze SoC (DESKTOP_SIM builds only).
+ *
+ * Address decoding mirrors the Vivado address map in platform_config.h.
+ * Accelerator instances run the HLS C model at ap_start, but the output
+ * mask and result registers only become visible (and ap_done only rises)
+ * once the simulated clock has advanced by the kernel latency, so drivers
+ * observe the same start / poll / done sequence as on hardware.  The CDMA
+ * model works the same way: the copy lands when its transfer time is up.
+ *****************************************************************************/
+#include "sim_platform.h"
+#include "platform_config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/* ---- Image BRAM: bank 0, accelerator buffer pool, frame slots ---- */
+#define SIM_MEM_BASE  IMG_INPUT_BASE
+#define SIM_MEM_SIZE  0x60000U               /* 3 x 128 KB */
+
+/* ---- Accelerator windows: 128 KB per instance ---- */
+#define SIM_ACCEL_BASE    XPAR_HLS_OTSU_0_BASEADDR
+#define SIM_ACCEL_STRIDE  0x20000U
+#define SIM_ACCEL_R_OFF   0x10000U
+
+/* The multi-channel IP is modelled as one more entry of sim_accel[] */
+#define SIM_MC            HLS_OTSU_MAX_INSTANCES
+#define SIM_NUM_ACCELS    (HLS_OTSU_MAX_INSTANCES + 1)
+
+/* ap_ctrl bits */
+#define AP_START        (1U << 0)
+#define AP_DONE         (1U << 1)
+#define AP_IDLE         (1U << 2)
+#define AP_READY        (1U << 3)
+#define AP_AUTO_RESTART (1U << 7)
+
+/* AXI Timer / UART Lite offsets (see energy_analyzer.c, uart_debug.c) */
+#define TIMER_TCSR   0x00   /* + 0x10 per counter */
+#define TIMER_TLR    0x04
+#define TIMER_TCR    0x08
+#define TCSR_LOAD    (1U << 5)
+#define TCSR_ENT     (1U << 7)
+#define UART_RX_FIFO 0x00
+#define UART_TX_FIFO 0x04
+#define UART_STATUS  0x08
+#define UART_CONTROL 0x0C
+#define UART_SR_RX_VALID (1U << 0)
+#define UART_SR_RX_FULL  (1U << 1)
+#define UART_SR_TX_EMPTY (1U << 2)
+#define UART_SR_TX_FULL  (1U << 3)
+#define UART_SR_INTR_EN  (1U << 4)
+#define UART_SR_OVERRUN  (1U << 5)
+#define UART_CR_RST_TX   (1U << 0)
+#define UART_CR_RST_RX   (1U << 1)
+#define UART_CR_INTR_EN  (1U << 4)
+#define UART_FIFO_DEPTH  16U
+
+/* 10 bits per character (start, 8 data, stop) */
+#define UART_CYCLES_PER_BYTE (SYS_CLK_FREQ_HZ / (UART_BAUD_RATE / 10U))
+
+/* AXI CDMA offsets (simple mode, see cdma.c) */
+#define CDMA_CR      0x00
+#define CDMA_SR      0x04
+#define CDMA_SA      0x18
+#define CDMA_DA      0x20
+#define CDMA_BTT     0x28
+#define CDMA_CR_RESET       (1U << 2)
+#define CDMA_CR_IRQ_EN      ((1U << 12) | (1U << 14))
+#define CDMA_SR_IDLE        (1U << 1)
+#define CDMA_SR_DECERR      (1U << 6)
+#define CDMA_SR_IRQ         ((1U << 12) | (1U << 14))
+#define CDMA_SR_IOC_IRQ     (1U << 12)
+#define CDMA_SR_ERR_IRQ     (1U << 14)
+
+/* AXI INTC offsets (see intc.c) */
+#define INTC_ISR 0x00
+#define INTC_IPR 0x04
+#define INTC_IER 0x08
+#define INTC_IAR 0x0C
+#define INTC_SIE 0x10
+#define INTC_CIE 0x14
+#define INTC_MER 0x1C
+#define INTC_MER_ENABLED 0x3U
+
+typedef struct
+{
+    uint32_t ctrl;                   /* auto_restart bit only    */
+    uint32_t mode;
+    uint32_t threshold;
+    uint32_t normalize;
+    uint32_t channels, combine;      /* multi-channel IP only    */
+    uint32_t img_in;
+    uint32_t img_out;
+    uint32_t run_out;                /* img_out sampled at start */
+    uint32_t gie, ier, isr;
+    int running;
+    int done;                        /* ap_done, clear-on-read   */
+    int ready;                       /* ap_ready, clear-on-read  */
+    uint64_t done_at;
+    uint32_t result[SIM_OTSU_RESULT_WORDS];
+    uint32_t staged[SIM_OTSU_RESULT_WORDS];
+    uint8_t staged_mask[IMG_SIZE];
+    uint32_t staged_bytes;           /* of staged_mask the run writes */
+    uint32_t starts;
+    uint32_t kicks;                  /* ap_start writes          */
+    uint32_t ctrl_reads;
+} SimAccel;
+
+static uint8_t  sim_mem[SIM_MEM_SIZE];
+static SimAccel sim_accel[SIM_NUM_ACCELS];
+static uint64_t sim_clock;
+static uint32_t sim_peak_busy;
+
+static uint32_t intc_isr, intc_ier, intc_mer;
+static void (*cpu_irq_handler)(void *);
+static void *cpu_irq_ctx;
+static int cpu_ie;
+static int cpu_in_irq;
+
+static struct
+{
+    uint32_t cr, sr, sa, da, btt;
+    int running;
+    uint64_t done_at;
+    uint32_t transfers;
+} sim_cdma = { 0, CDMA_SR_IDLE, 0, 0, 0, 0, 0, 0 };
+
+static struct
+{
+    int fd;                          /* host end of the serial line */
+    uint64_t next_at;                /* earliest next character     */
+    uint8_t fifo[UART_FIFO_DEPTH];
+    uint32_t head, count;
+    int intr_en;
+    int overrun;
+    uint32_t tx_count;               /* characters in the TX FIFO   */
+    uint64_t tx_next_at;             /* next TX character sent      */
+    uint32_t tx_sent;
+} sim_uart = { -1, 0, { 0 }, 0, 0, 0, 0, 0, 0, 0 };
+
+static uint32_t sim_gpio;
+static uint32_t timer_tcsr[2], timer_tlr[2], timer_frozen[2];
+static uint64_t timer_started_at[2];
+
+/* ------------------------------------------------------------------ */
+void *sim_phys_ptr(uint32_t addr)
+{
+    if (addr < SIM_MEM_BASE || addr - SIM_MEM_BASE >= SIM_MEM_SIZE) {
+        fprintf(stderr, "sim: no memory at 0x%08X\n", (unsigned)addr);
+        abort();
+    }
+    return &sim_mem[addr - SIM_MEM_BASE];
+}
+
+uint32_t sim_bus_addr(const void *ptr)
+{
+    const uint8_t *p = (const uint8_t *)ptr;
+    if (p < sim_mem || p >= sim_mem + SIM_MEM_SIZE)
+        return 0;
+    return SIM_MEM_BASE + (uint32_t)(p - sim_mem);
+}
+
+/* ------------------------------------------------------------------ */
+static void accel_start(SimAccel *a)
+{
+    uint32_t latency;
+    if (a == &sim_accel[SIM_MC]) {
+        (void)sim_phys_ptr(a->img_in + 4U * IMG_SIZE - 1U);
+        latency = sim_otsu_mc_kernel_run(
+            (const uint8_t *)sim_phys_ptr(a->img_in), a->staged_mask,
+            (uint8_t)a->mode, (uint8_t)a->channels, (uint16_t)a->combine, a->staged,
+            &a->staged_bytes);
+    } else {
+        latency = sim_otsu_kernel_run(
+            (const uint8_t *)sim_phys_ptr(a->img_in), a->staged_mask,
+            (uint8_t)a->mode, (uint8_t)a->threshold, (uint8_t)a->normalize,
+            a->staged, &a->staged_bytes);
+    }
+
+    /* Arguments are sampled at start; the registers may change mid-run */
+    a->run_out = a->img_out;
+    if (a->staged_bytes)
+        (void)sim_phys_ptr(a->run_out + a->staged_bytes - 1U);
+
+    a->running = 1;
+    a->done    = 0;
+    a->ready   = 1;          /* inputs consumed: ap_ready */
+    a->done_at = sim_clock + latency;
+    a->starts++;
+
+    uint32_t busy = 0;
+    for (int i = 0; i < SIM_NUM_ACCELS; i++)
+        busy += (uint32_t)sim_accel[i].running;
+    if (busy > sim_peak_busy)
+        sim_peak_busy = busy;
+}
+
+/* Level of each peripheral interrupt output, as INTC input bits */
+static uint32_t irq_lines(void)
+{
+    uint32_t lines = 0;
+    for (int i = 0; i < HLS_OTSU_MAX_INSTANCES; i++) {
+        const SimAccel *a = &sim_accel[i];
+        if (a->gie && (a->isr & a->ier))
+            lines |= 1U << INTC_IRQ_HLS_OTSU(i);
+    }
+    if (sim_cdma.sr & sim_cdma.cr & CDMA_SR_IRQ)
+        lines |= 1U << INTC_IRQ_CDMA;
+    if (sim_uart.intr_en && sim_uart.count)
+        lines |= 1U << INTC_IRQ_UART;
+    return lines;
+}
+
+/* Take the CPU interrupt while one is pending and not masked */
+static void deliver_irqs(void)
+{
+    intc_isr |= irq_lines();
+    while (cpu_ie && !cpu_in_irq && cpu_irq_handler &&
+           (intc_mer & INTC_MER_ENABLED) == INTC_MER_ENABLED &&
+           (intc_isr & intc_ier)) {
+        cpu_in_irq = 1;              /* MSR[IE] cleared on entry */
+        cpu_irq_handler(cpu_irq_ctx);
+        cpu_in_irq = 0;
+        intc_isr |= irq_lines();
+    }
+}
+
+/* Move characters from the host line into the RX FIFO at the baud rate */
+static void uart_receive(void)
+{
+    while (sim_uart.fd >= 0 && sim_clock >= sim_uart.next_at) {
+        uint8_t c;
+        ssize_t n = read(sim_uart.fd, &c, 1);
+        if (n == 0) {                 /* line closed */
+            sim_uart.fd = -1;
+            break;
+        }
+        if (n < 0) {                  /* nothing on the line yet */
+            sim_uart.next_at = sim_clock + UART_CYCLES_PER_BYTE;
+            break;
+        }
+        if (sim_uart.count == UART_FIFO_DEPTH) {
+            sim_uart.overrun = 1;     /* character lost */
+        } else {
+            sim_uart.fifo[(sim_uart.head + sim_uart.count) % UART_FIFO_DEPTH] = c;
+            sim_uart.count++;
+        }
+        sim_uart.next_at += UART_CYCLES_PER_BYTE;
+    }
+}
+
+/* Shift TX characters out at the baud rate.  The UART Lite interrupt is a
+ * pulse when the TX FIFO runs empty, latched by the (edge) INTC input. */
+static void uart_transmit(void)
+{
+    while (sim_uart.tx_count && sim_clock >= sim_uart.tx_next_at) {
+        sim_uart.tx_count--;
+        sim_uart.tx_sent++;
+        sim_uart.tx_next_at += UART_CYCLES_PER_BYTE;
+        if (sim_uart.tx_count == 0 && sim_uart.intr_en)
+            intc_isr |= 1U << INTC_IRQ_UART;
+    }
+}
+
+/* Retire every accelerator whose latency has elapsed */
+static void sim_update(void)
+{
+    for (int i = 0; i < SIM_NUM_ACCELS; i++) {
+        SimAccel *a = &sim_accel[i];
+        if (!a->running || sim_clock < a->done_at)
+            continue;
+
+        /* Only the bytes the kernel writes: runs and histograms leave the
+         * rest of the buffer as it was */
+        memcpy(sim_phys_ptr(a->run_out), a->staged_mask, a->staged_bytes);
+        memcpy(a->result, a->staged, sizeof(a->result));
+        a->running = 0;
+        a->done    = 1;
+        a->isr    |= 0x1U;   /* ap_done interrupt status */
+
+        /* auto_restart: next run samples the argument registers now */
+        if (a->ctrl & AP_AUTO_RESTART)
+            accel_start(a);
+    }
+
+    if (sim_cdma.running && sim_clock >= sim_cdma.done_at) {
+        uint32_t n = sim_cdma.btt;
+        if (sim_cdma.sa < SIM_MEM_BASE || sim_cdma.da < SIM_MEM_BASE ||
+            sim_cdma.sa - SIM_MEM_BASE > SIM_MEM_SIZE - n ||
+            sim_cdma.da - SIM_MEM_BASE > SIM_MEM_SIZE - n) {
+            sim_cdma.sr |= CDMA_SR_DECERR | CDMA_SR_ERR_IRQ;
+        } else {
+            memmove(&sim_mem[sim_cdma.da - SIM_MEM_BASE],
+                    &sim_mem[sim_cdma.sa - SIM_MEM_BASE], n);
+            sim_cdma.sr |= CDMA_SR_IOC_IRQ;
+        }
+        sim_cdma.sr |= CDMA_SR_IDLE;
+        sim_cdma.running = 0;
+        sim_cdma.transfers++;
+    }
+
+    uart_receive();
+    uart_transmit();
+    deliver_irqs();
+}
+
+/* ------------------------------------------------------------------ */
+static SimAccel *decode_accel(uint32_t addr, uint32_t *off, int *is_r)
+{
+    if (addr >= XPAR_HLS_OTSU_MC_0_BASEADDR &&
+        addr - XPAR_HLS_OTSU_MC_0_BASEADDR < SIM_ACCEL_STRIDE) {
+        *off  = addr - XPAR_HLS_OTSU_MC_0_BASEADDR;
+        *is_r = *off >= SIM_ACCEL_R_OFF;
+        if (*is_r)
+            *off -= SIM_ACCEL_R_OFF;
+        return &sim_accel[SIM_MC];
+    }
+
+    if (addr < SIM_ACCEL_BASE ||
+        addr - SIM_ACCEL_BASE >= SIM_ACCEL_STRIDE * HLS_OTSU_MAX_INSTANCES)
+        return NULL;
+
+    uint32_t rel = addr - SIM_ACCEL_BASE;
+    *off  = rel % SIM_ACCEL_STRIDE;
+    *is_r = *off >= SIM_ACCEL_R_OFF;
+    if (*is_r)
+        *off -= SIM_ACCEL_R_OFF;
+    return &sim_accel[rel / SIM_ACCEL_STRIDE];
+}
+
+static uint32_t accel_read(SimAccel *a, uint32_t off, int is_r)
+{
+    if (is_r) {
+        if (off == HLS_OTSU_IMG_IN_LO)  return a->img_in;
+        if (off == HLS_OTSU_IMG_OUT_LO) return a->img_out;
+        return 0;
+    }
+
+    if (a == &sim_accel[SIM_MC]) {
+        if (off == HLS_MC_CHANNELS) return a->channels;
+        if (off == HLS_MC_COMBINE)  return a->combine;
+    }
+
+    switch (off) {
+    case HLS_OTSU_CONTROL: {
+        uint32_t v = a->ctrl & AP_AUTO_RESTART;
+        if (a->running) v |= AP_START;
+        else            v |= AP_IDLE;
+        if (a->done)    v |= AP_DONE;
+        if (a->ready)   v |= AP_READY;
+        a->done  = 0;            /* clear-on-read */
+        a->ready = 0;
+        a->ctrl_reads++;
+        return v;
+    }
+    case HLS_OTSU_GIE:       return a->gie;
+    case HLS_OTSU_IER:       return a->ier;
+    case HLS_OTSU_ISR:       return a->isr;
+    case HLS_OTSU_MODE:      return a->mode;
+    case HLS_OTSU_THRESHOLD: return a->threshold;
+    case HLS_OTSU_NORMALIZE: return a->normalize;
+    case HLS_OTSU_RESULT_VLD:
+        return a->starts > 0 && !a->running;
+    default:
+        break;
+    }
+
+    if (off >= HLS_OTSU_RESULT_WORD0 &&
+        off < HLS_OTSU_RESULT_WORD0 + 4U * SIM_OTSU_RESULT_WORDS)
+        return a->result[(off - HLS_OTSU_RESULT_WORD0) / 4U];
+    return 0;
+}
+
+static void accel_write(SimAccel *a, uint32_t off, int is_r, uint32_t val)
+{
+    if (is_r) {
+        if (off == HLS_OTSU_IMG_IN_LO)  a->img_in  = val;
+        if (off == HLS_OTSU_IMG_OUT_LO) a->img_out = val;
+        return;
+    }
+
+    if (a == &sim_accel[SIM_MC]) {
+        if (off == HLS_MC_CHANNELS) { a->channels = val & 0xFFU;   return; }
+        if (off == HLS_MC_COMBINE)  { a->combine  = val & 0xFFFFU; return; }
+    }
+
+    switch (off) {
+    case HLS_OTSU_CONTROL:
+        a->ctrl = val & AP_AUTO_RESTART;
+        if (val & AP_START)
+            a->kicks++;
+        if ((val & AP_START) && !a->running)
+            accel_start(a);
+        break;
+    case HLS_OTSU_GIE:       a->gie = val & 0x1U;  break;
+    case HLS_OTSU_IER:       a->ier = val & 0x3U;  break;
+    case HLS_OTSU_ISR:       a->isr ^= val & 0x3U; break;   /* toggle-on-write */
+    case HLS_OTSU_MODE:      a->mode = val & 0xFFU; break;
+    case HLS_OTSU_THRESHOLD: a->threshold = val & 0xFFU; break;
+    case HLS_OTSU_NORMALIZE: a->normalize = val & 0xFFU; break;
+    default: break;
+    }
+}
+
+/* ------------------------------------------------------------------ */
+static uint32_t cdma_read(uint32_t off)
+{
+    switch (off) {
+    case CDMA_CR:  return sim_cdma.cr;
+    case CDMA_SR:  return sim_cdma.sr;
+    case CDMA_SA:  return sim_cdma.sa;
+    case CDMA_DA:  return sim_cdma.da;
+    case CDMA_BTT: return sim_cdma.btt;
+    default:       return 0;
+    }
+}
+
+static void cdma_write(uint32_t off, uint32_t val)
+{
+    switch (off) {
+    case CDMA_CR:
+        if (val & CDMA_CR_RESET) {   /* reset completes immediately */
+            sim_cdma.cr = 0;
+            sim_cdma.sr = CDMA_SR_IDLE;
+            sim_cdma.running = 0;
+        } else {
+            sim_cdma.cr = val & CDMA_CR_IRQ_EN;
+        }
+        break;
+    case CDMA_SR: sim_cdma.sr &= ~(val & CDMA_SR_IRQ); break;   /* W1C */
+    case CDMA_SA: sim_cdma.sa = val; break;
+    case CDMA_DA: sim_cdma.da = val; break;
+    case CDMA_BTT:
+        /* 32-bit data path: one word per cycle after the address phase */
+        sim_cdma.btt     = val & 0x7FFFFFU;
+        sim_cdma.sr     &= ~CDMA_SR_IDLE;
+        sim_cdma.running = 1;
+        sim_cdma.done_at = sim_clock + SIM_CDMA_SETUP_CYCLES +
+                           (sim_cdma.btt + 3U) / 4U;
+        break;
+    default:
+        break;
+    }
+}
+
+/* ------------------------------------------------------------------ */
+static uint32_t uart_read(uint32_t off)
+{
+    switch (off) {
+    case UART_RX_FIFO: {
+        if (sim_uart.count == 0)
+            return 0;
+        uint8_t c = sim_uart.fifo[sim_uart.head];
+        sim_uart.head = (sim_uart.head + 1U) % UART_FIFO_DEPTH;
+        sim_uart.count--;
+        return c;
+    }
+    case UART_STATUS: {
+        uint32_t sr = 0;
+        if (sim_uart.tx_count == 0)
+            sr |= UART_SR_TX_EMPTY;
+        if (sim_uart.tx_count == UART_FIFO_DEPTH)
+            sr |= UART_SR_TX_FULL;
+        if (sim_uart.count)
+            sr |= UART_SR_RX_VALID;
+        if (sim_uart.count == UART_FIFO_DEPTH)
+            sr |= UART_SR_RX_FULL;
+        if (sim_uart.intr_en)
+            sr |= UART_SR_INTR_EN;
+        if (sim_uart.overrun)
+            sr |= UART_SR_OVERRUN;
+        sim_uart.overrun = 0;         /* cleared by the status read */
+        return sr;
+    }
+    default:
+        return 0;
+    }
+}
+
+static void uart_write(uint32_t off, uint32_t val)
+{
+    if (off == UART_TX_FIFO) {
+        /* Shown on stdout when queued; a full FIFO drops the character */
+        if (sim_uart.tx_count == UART_FIFO_DEPTH)
+            return;
+        if (sim_uart.tx_count++ == 0)
+            sim_uart.tx_next_at = sim_clock + UART_CYCLES_PER_BYTE;
+        putchar((int)(val & 0xFFU));
+    } else if (off == UART_CONTROL) {
+        if (val & UART_CR_RST_RX)
+            sim_uart.head = sim_uart.count = 0;
+        if (val & UART_CR_RST_TX)
+            sim_uart.tx_count = 0;
+        sim_uart.intr_en = (val & UART_CR_INTR_EN) != 0;
+    }
+}
+
+/* ------------------------------------------------------------------ */
+static uint32_t intc_read(uint32_t off)
+{
+    intc_isr |= irq_lines();
+    switch (off) {
+    case INTC_ISR: return intc_isr;
+    case INTC_IPR: return intc_isr & intc_ier;
+    case INTC_IER: return intc_ier;
+    case INTC_MER: return intc_mer;
+    default:       return 0;
+    }
+}
+
+static void intc_write(uint32_t off, uint32_t val)
+{
+    switch (off) {
+    case INTC_IER: intc_ier = val;   break;
+    case INTC_IAR: intc_isr &= ~val; break;
+    case INTC_SIE: intc_ier |= val;  break;
+    case INTC_CIE: intc_ier &= ~val; break;
+    case INTC_MER: intc_mer = val & INTC_MER_ENABLED; break;
+    default: break;
+    }
+}
+
+/* ------------------------------------------------------------------ */
+static uint32_t timer_read(uint32_t off)
+{
+    uint32_t t = (off >> 4) & 1U;
+    off &= 0x0FU;
+    if (off == TIMER_TCSR) return timer_tcsr[t];
+    if (off == TIMER_TLR)  return timer_tlr[t];
+    if (off == TIMER_TCR) {
+        if (timer_tcsr[t] & TCSR_ENT)
+            return timer_frozen[t] + (uint32_t)(sim_clock - timer_started_at[t]);
+        return timer_frozen[t];
+    }
+    return 0;
+}
+
+static void timer_write(uint32_t off, uint32_t val)
+{
+    uint32_t t = (off >> 4) & 1U;
+    if ((off & 0x0FU) == TIMER_TLR) {
+        timer_tlr[t] = val;
+    } else if ((off & 0x0FU) == TIMER_TCSR) {
+        timer_frozen[t] = timer_read(off - TIMER_TCSR + TIMER_TCR);
+        if (val & TCSR_LOAD)
+            timer_frozen[t] = timer_tlr[t];
+        timer_tcsr[t] = val;
+        timer_started_at[t] = sim_clock;
+    }
+}
+
+/* ------------------------------------------------------------------ */
+uint32_t sim_reg_read(uint32_t addr)
+{
+    uint32_t off;
+    int is_r;
+    SimAccel *a;
+
+    sim_advance(SIM_AXI_LITE_CYCLES);
+
+    if ((a = decode_accel(addr, &off, &is_r)) != NULL)
+        return accel_read(a, off, is_r);
+    if (addr - XPAR_AXI_CDMA_0_BASEADDR < 0x100U)
+        return cdma_read(addr - XPAR_AXI_CDMA_0_BASEADDR);
+    if (addr - XPAR_AXI_TIMER_0_BASEADDR < 0x100U)
+        return timer_read(addr - XPAR_AXI_TIMER_0_BASEADDR);
+    if (addr - XPAR_AXI_INTC_0_BASEADDR < 0x100U)
+        return intc_read(addr - XPAR_AXI_INTC_0_BASEADDR);
+    if (addr == XPAR_AXI_GPIO_0_BASEADDR)
+        return sim_gpio;
+    if (addr - XPAR_AXI_UARTLITE_0_BASEADDR < 0x10U)
+        return uart_read(addr - XPAR_AXI_UARTLITE_0_BASEADDR);
+    return 0;
+}
+
+void sim_reg_write(uint32_t addr, uint32_t val)
+{
+    uint32_t off;
+    int is_r;
+    SimAccel *a;
+
+    sim_advance(SIM_AXI_LITE_CYCLES);
+
+    if ((a = decode_accel(addr, &off, &is_r)) != NULL)
+        accel_write(a, off, is_r, val);
+    else if (addr - XPAR_AXI_CDMA_0_BASEADDR < 0x100U)
+        cdma_write(addr - XPAR_AXI_CDMA_0_BASEADDR, val);
+    else if (addr - XPAR_AXI_TIMER_0_BASEADDR < 0x100U)
+        timer_write(addr - XPAR_AXI_TIMER_0_BASEADDR, val);
+    else if (addr - XPAR_AXI_INTC_0_BASEADDR < 0x100U)
+        intc_write(addr - XPAR_AXI_INTC_0_BASEADDR, val);
+    else if (addr == XPAR_AXI_GPIO_0_BASEADDR)
+        sim_gpio = val;
+    else if (addr - XPAR_AXI_UARTLITE_0_BASEADDR < 0x10U)
+        uart_write(addr - XPAR_AXI_UARTLITE_0_BASEADDR, val);
+}
+
+/* ------------------------------------------------------------------ */
+uint64_t sim_now(void)
+{
+    return sim_clock;
+}
+
+void sim_advance(uint32_t cycles)
+{
+    /* Step a character time at a time so UART events and the interrupts
+     * they raise interleave as they would on the line */
+    while (cycles) {
+        uint32_t step = cycles < UART_CYCLES_PER_BYTE ? cycles : UART_CYCLES_PER_BYTE;
+        sim_clock += step;
+        cycles    -= step;
+        sim_update();
+    }
+}
+
+void sim_cpu_set_irq_handler(void (*handler)(void *), void *ctx)
+{
+    cpu_irq_handler = handler;
+    cpu_irq_ctx     = ctx;
+}
+
+void sim_cpu_irq_enable(int enable)
+{
+    cpu_ie = enable;
+    deliver_irqs();
+}
+
+void sim_uart_attach_rx(int fd)
+{
+    if (fd >= 0)
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    sim_uart.fd      = fd;
+    sim_uart.next_at = sim_clock + UART_CYCLES_PER_BYTE;
+}
+
+uint32_t sim_uart_tx_sent(void)
+{
+    return sim_uart.tx_sent;
+}
+
+int sim_cpu_irq_enabled(void)
+{
+    return cpu_ie && !cpu_in_irq;
+}
+
+uint32_t sim_accel_starts(uint32_t instance)
+{
+    return instance < SIM_NUM_ACCELS ? sim_accel[instance].starts : 0;
+}
+
+uint32_t sim_accel_peak_busy(void)
+{
+    return sim_peak_busy;
+}
+
+uint32_t sim_accel_ctrl_reads(uint32_t instance)
+{
+    return instance < SIM_NUM_ACCELS ? sim_accel[instance].ctrl_reads : 0;
+}
+
+uint32_t sim_accel_kicks(uint32_t instance)
+{
+    return instance < SIM_NUM_ACCELS ? sim_accel[instance].kicks : 0;
+}
+
+uint32_t sim_cdma_transfers(void)
+{
+    return sim_cdma.transfers;
+}
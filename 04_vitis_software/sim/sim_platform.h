@@ -0,0 +1,95 @@
+/******************************************************************************
+ * sim_platform.h
+ * ---------------
+ * Desktop stand-in for the MicroBlaze SoC (DESKTOP_SIM builds only).
+ *
+ * platform_config.h routes REG_READ / REG_WRITE / PHYS_PTR here, so the
+ * unmodified firmware runs on a PC against:
+ *   - image BRAM (+ the accelerator buffer pool) as a host array,
+ *   - a register model of every HLS Otsu instance, whose kernel is the HLS
+ *     C model itself (02_hls_accelerator/otsu_threshold.cpp) and whose
+ *     completion is delayed by the kernel's own stage-cycle counts, and
+ *     the same for the multi-channel IP (otsu_multichannel.cpp),
+ *   - an AXI CDMA (simple mode) that copies after its transfer time,
+ *   - the AXI Timer, GPIO and UART Lite (16-deep FIFOs at UART_BAUD_RATE;
+ *     TX goes to stdout, RX reads a host file descriptor such as a pipe
+ *     or pty),
+ *   - the AXI INTC, delivering interrupts to a handler installed with
+ *     sim_cpu_set_irq_handler() whenever the clock advances with CPU
+ *     interrupts enabled (handlers run nested inside a bus access, as a
+ *     real interrupt would preempt the main program).
+ *
+ * Time is a simulated cycle counter: every register access costs
+ * SIM_AXI_LITE_CYCLES, and sim_advance() lets tests model CPU work.
+ *****************************************************************************/
+#ifndef SIM_PLATFORM_H
+#define SIM_PLATFORM_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Cost of one AXI-Lite register access, in simulated cycles */
+#define SIM_AXI_LITE_CYCLES 8U
+
+/* Cost of one iteration of an idle wait loop (CPU_IDLE) */
+#define SIM_IDLE_CYCLES 4U
+
+/* AXI CDMA address phase / setup, before one 32-bit word per cycle */
+#define SIM_CDMA_SETUP_CYCLES 24U
+
+/* Result words exported by the kernel (HLS_OTSU_RESULT_WORD0 onwards) */
+#define SIM_OTSU_RESULT_WORDS 17
+
+/* ---- Bus access (used by platform_config.h) ---- */
+uint32_t sim_reg_read(uint32_t addr);
+void sim_reg_write(uint32_t addr, uint32_t val);
+void *sim_phys_ptr(uint32_t addr);
+uint32_t sim_bus_addr(const void *ptr);   /* 0 if not image BRAM */
+
+/* ---- Simulated time ---- */
+uint64_t sim_now(void);
+void sim_advance(uint32_t cycles);
+
+/* ---- CPU interrupt model (used by intc.c) ---- */
+void sim_cpu_set_irq_handler(void (*handler)(void *), void *ctx);
+void sim_cpu_irq_enable(int enable);
+int sim_cpu_irq_enabled(void);   /* MSR[IE]: 0 inside a handler */
+
+/* ---- Serial line: feed the UART Lite RX FIFO from @p fd (-1 = none) ---- */
+void sim_uart_attach_rx(int fd);
+
+/* ---- Introspection for tests (instance HLS_OTSU_MAX_INSTANCES is the
+ *      multi-channel IP) ---- */
+uint32_t sim_accel_starts(uint32_t instance);     /* kernel runs         */
+uint32_t sim_accel_kicks(uint32_t instance);      /* ap_start writes     */
+uint32_t sim_accel_peak_busy(void);               /* max concurrent runs */
+uint32_t sim_accel_ctrl_reads(uint32_t instance); /* ap_ctrl reads       */
+uint32_t sim_cdma_transfers(void);                /* completed CDMA ops  */
+uint32_t sim_uart_tx_sent(void);                  /* characters sent     */
+
+/* ---- HLS kernel adapter (sim_otsu_kernel.cpp) ----
+ * Runs otsu_threshold_top() and packs OtsuResult into register words;
+ * *out_bytes is how much of img_out the kernel wrote (the histogram, the
+ * row runs or the mask).  Returns the kernel latency in cycles (sum of
+ * its stage counters). */
+uint32_t sim_otsu_kernel_run(const uint8_t *img_in, uint8_t *img_out,
+                             uint8_t mode, uint8_t fixed_threshold,
+                             uint8_t normalize, uint32_t words[SIM_OTSU_RESULT_WORDS],
+                             uint32_t *out_bytes);
+
+/* Runs otsu_multichannel_top() on IMG_SIZE little-endian pixel tuples and
+ * packs McResult the same way (the mask is always written); returns the
+ * kernel latency. */
+uint32_t sim_otsu_mc_kernel_run(const uint8_t *tuples, uint8_t *img_out,
+                                uint8_t mode, uint8_t channels, uint16_t combine,
+                                uint32_t words[SIM_OTSU_RESULT_WORDS],
+                                uint32_t *out_bytes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIM_PLATFORM_H */
@@ -6,6 +6,9 @@
 #include "adaptive_controller.h"
 #include "uart_debug.h"
 
+static void finish_stats(uint8_t mean, uint64_t var_sum, uint8_t min_v,
+                         uint8_t max_v, SwImageStats *stats);
+
 /* ------------------------------------------------------------------ */
 void adaptive_compute_stats(const uint8_t *img, SwImageStats *stats)
 {
@@ -28,6 +31,28 @@ void adaptive_compute_stats(const uint8_t *img, SwImageStats *stats)
         int16_t diff = (int16_t)img[i] - (int16_t)mean;
         var_sum += (uint32_t)(diff * diff);
     }
+
+    finish_stats(mean, var_sum, min_v, max_v, stats);
+}
+
+/* ------------------------------------------------------------------ */
+void adaptive_stats_from_sums(uint32_t sum, uint32_t sum_sq,
+                              uint8_t min_v, uint8_t max_v, SwImageStats *stats)
+{
+    uint8_t mean = (uint8_t)(sum / IMG_SIZE);
+
+    /* sum((p - mean)^2) = sum_sq - 2*mean*sum + N*mean^2, exactly what
+     * the second pass of adaptive_compute_stats() accumulates */
+    uint64_t var_sum = (uint64_t)sum_sq + (uint64_t)IMG_SIZE * mean * mean -
+                       2ULL * mean * sum;
+
+    finish_stats(mean, var_sum, min_v, max_v, stats);
+}
+
+/* ------------------------------------------------------------------ */
+static void finish_stats(uint8_t mean, uint64_t var_sum, uint8_t min_v,
+                         uint8_t max_v, SwImageStats *stats)
+{
     uint32_t variance = (uint32_t)(var_sum / IMG_SIZE);
 
     /* Integer square root (Newton's method) */
@@ -57,6 +82,19 @@ uint8_t adaptive_select_mode(const SwImageStats *stats)
     return PROCESSING_MODE_CAREFUL;
 }
 
+/* ------------------------------------------------------------------ */
+int adaptive_is_ambiguous(uint16_t separability)
+{
+    return separability < SEPARABILITY_CONFIDENT_Q16;
+}
+
+/* ------------------------------------------------------------------ */
+uint8_t adaptive_probe_mode(uint16_t separability)
+{
+    return adaptive_is_ambiguous(separability) ? PROCESSING_MODE_CAREFUL
+                                               : PROCESSING_MODE_NORMAL;
+}
+
 /* ------------------------------------------------------------------ */
 void adaptive_print_decision(const SwImageStats *stats, uint8_t mode)
 {
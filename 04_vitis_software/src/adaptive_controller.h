@@ -17,6 +17,14 @@
 #define PROCESSING_MODE_FAST 0
 #define PROCESSING_MODE_NORMAL 1
 #define PROCESSING_MODE_CAREFUL 2
+#define PROCESSING_MODE_AUTO 3     /* kernel selects, after HLS_OTSU_NORMALIZE */
+
+/*
+ * Otsu separability (eta = sigma2_B / sigma2_T, Q0.16) at or above which a
+ * frame is considered clearly bimodal and CAREFUL's adaptive fall-back and
+ * closing passes are not worth their cost.  0.80 * 65536.
+ */
+#define SEPARABILITY_CONFIDENT_Q16 52429U
 
 /**
  * Image statistics computed on the software side.
@@ -38,6 +46,16 @@ typedef struct
  */
 void adaptive_compute_stats(const uint8_t *img, SwImageStats *stats);
 
+/**
+ * Same statistics from running sums gathered while the image streamed in
+ * (no pass over the buffer); identical to adaptive_compute_stats().
+ *
+ * @param sum     Sum of the IMG_SIZE pixels
+ * @param sum_sq  Sum of their squares (fits 32 bits for 128x128)
+ */
+void adaptive_stats_from_sums(uint32_t sum, uint32_t sum_sq,
+                              uint8_t min_v, uint8_t max_v, SwImageStats *stats);
+
 /**
  * Select the optimal processing mode based on image statistics.
  * Uses the same thresholds as the HLS module for consistency:
@@ -50,6 +68,29 @@ void adaptive_compute_stats(const uint8_t *img, SwImageStats *stats);
  */
 uint8_t adaptive_select_mode(const SwImageStats *stats);
 
+/**
+ * Decide whether a CAREFUL-class frame needs the full CAREFUL run.
+ *
+ * Statistics-based selection is conservative: low contrast alone sends a
+ * frame to CAREFUL.  The caller first runs such frames in NORMAL mode and
+ * checks the accelerator's separability here; only genuinely ambiguous
+ * frames (low eta) are re-run in CAREFUL.
+ *
+ * @param separability  Otsu separability reported by the accelerator (Q0.16)
+ * @return              1 if the frame should be escalated to CAREFUL
+ */
+int adaptive_is_ambiguous(uint16_t separability);
+
+/**
+ * Mode a CAREFUL-class frame ends up in after its NORMAL probe: the mode
+ * to report for the probe's result, or the mode to re-run the frame in.
+ *
+ * @param separability  Separability of the NORMAL probe (Q0.16)
+ * @return              PROCESSING_MODE_NORMAL if the probe is kept,
+ *                      PROCESSING_MODE_CAREFUL if the frame must be re-run
+ */
+uint8_t adaptive_probe_mode(uint16_t separability);
+
 /**
  * Print mode-selection rationale to UART.
  *
@@ -0,0 +1,163 @@
+/******************************************************************************
+ * cdma.c
+ * -------
+ * AXI Central DMA (simple mode) driver with a software descriptor queue.
+ *
+ * The queue is a ring indexed by free-running head / tail counters; the
+ * head descriptor is the one the CDMA is executing.  Queue state shared
+ * with the ISR is only changed with CPU interrupts disabled.
+ *****************************************************************************/
+#include "cdma.h"
+#include "intc.h"
+#include "uart_debug.h"
+
+/* ---- AXI CDMA register offsets (simple mode) ---- */
+#define CDMA_CR      0x00   /* control                      */
+#define CDMA_SR      0x04   /* status                       */
+#define CDMA_SA      0x18   /* source address               */
+#define CDMA_SA_MSB  0x1C
+#define CDMA_DA      0x20   /* destination address          */
+#define CDMA_DA_MSB  0x24
+#define CDMA_BTT     0x28   /* bytes to transfer (starts)   */
+
+#define CDMA_CR_RESET       (1U << 2)
+#define CDMA_CR_IOC_IRQ_EN  (1U << 12)
+#define CDMA_CR_ERR_IRQ_EN  (1U << 14)
+
+#define CDMA_SR_IDLE        (1U << 1)
+#define CDMA_SR_ERR_MASK    (0x7U << 4)   /* internal / slave / decode */
+#define CDMA_SR_IOC_IRQ     (1U << 12)
+#define CDMA_SR_ERR_IRQ     (1U << 14)
+
+#define CDMA_BASE  XPAR_AXI_CDMA_0_BASEADDR
+#define CDMA_MASK  (CDMA_QUEUE_DEPTH - 1U)
+
+typedef struct
+{
+    uint32_t src;
+    uint32_t dst;
+    uint32_t len;
+    CdmaCallback cb;
+    void *ctx;
+} CdmaDesc;
+
+static CdmaDesc          queue[CDMA_QUEUE_DEPTH];
+static volatile uint32_t q_head;   /* descriptor in flight  */
+static volatile uint32_t q_tail;   /* next free entry       */
+static volatile uint8_t  q_error;  /* sticky, cleared by cdma_wait_idle */
+
+/* ------------------------------------------------------------------ */
+static void start_head(void)
+{
+    const CdmaDesc *d = &queue[q_head & CDMA_MASK];
+    REG_WRITE(CDMA_BASE, CDMA_SA, d->src);
+    REG_WRITE(CDMA_BASE, CDMA_SA_MSB, 0);
+    REG_WRITE(CDMA_BASE, CDMA_DA, d->dst);
+    REG_WRITE(CDMA_BASE, CDMA_DA_MSB, 0);
+    REG_WRITE(CDMA_BASE, CDMA_BTT, d->len);   /* starts the transfer */
+}
+
+/* ------------------------------------------------------------------ */
+/* Completion / error ISR: retire the head, start the next descriptor */
+static void cdma_isr(void *unused)
+{
+    (void)unused;
+    uint32_t sr = REG_READ(CDMA_BASE, CDMA_SR);
+    REG_WRITE(CDMA_BASE, CDMA_SR, sr & (CDMA_SR_IOC_IRQ | CDMA_SR_ERR_IRQ));
+
+    if (q_head == q_tail)
+        return;
+
+    int status = 0;
+    if (sr & (CDMA_SR_ERR_IRQ | CDMA_SR_ERR_MASK)) {
+        /* Errors halt the CDMA until it is reset */
+        REG_WRITE(CDMA_BASE, CDMA_CR, CDMA_CR_RESET);
+        REG_WRITE(CDMA_BASE, CDMA_CR, CDMA_CR_IOC_IRQ_EN | CDMA_CR_ERR_IRQ_EN);
+        q_error = 1;
+        status  = -1;
+    }
+
+    CdmaDesc d = queue[q_head & CDMA_MASK];
+    q_head++;
+    if (q_head != q_tail)
+        start_head();
+
+    if (d.cb)
+        d.cb(d.ctx, status);
+}
+
+/* ------------------------------------------------------------------ */
+void cdma_init(void)
+{
+    REG_WRITE(CDMA_BASE, CDMA_CR, CDMA_CR_RESET);
+    uint32_t timeout = 1000;
+    while ((REG_READ(CDMA_BASE, CDMA_CR) & CDMA_CR_RESET) && --timeout)
+        ;
+
+    q_head  = 0;
+    q_tail  = 0;
+    q_error = 0;
+
+    REG_WRITE(CDMA_BASE, CDMA_CR, CDMA_CR_IOC_IRQ_EN | CDMA_CR_ERR_IRQ_EN);
+    intc_connect(INTC_IRQ_CDMA, cdma_isr, 0);
+}
+
+/* ------------------------------------------------------------------ */
+int cdma_submit(uint32_t src, uint32_t dst, uint32_t len,
+                CdmaCallback cb, void *ctx)
+{
+    int rc = -1;
+
+    uint32_t irq = cpu_irq_save();
+    if (q_tail - q_head < CDMA_QUEUE_DEPTH) {
+        CdmaDesc *d = &queue[q_tail & CDMA_MASK];
+        d->src = src;
+        d->dst = dst;
+        d->len = len;
+        d->cb  = cb;
+        d->ctx = ctx;
+        if (q_tail++ == q_head)
+            start_head();   /* CDMA was idle */
+        rc = 0;
+    }
+    cpu_irq_restore(irq);
+
+    return rc;
+}
+
+/* ------------------------------------------------------------------ */
+uint32_t cdma_free_slots(void)
+{
+    return CDMA_QUEUE_DEPTH - (q_tail - q_head);
+}
+
+/* ------------------------------------------------------------------ */
+int cdma_busy(void)
+{
+    return q_head != q_tail;
+}
+
+/* ------------------------------------------------------------------ */
+int cdma_wait_idle(void)
+{
+    uint32_t timeout = CDMA_TIMEOUT_CYCLES;
+    while (cdma_busy()) {
+        CPU_IDLE();
+        if (--timeout == 0) {
+            uart_print("ERROR: CDMA timeout!\r\n");
+            return -1;
+        }
+    }
+
+    int rc = q_error ? -1 : 0;
+    q_error = 0;
+    return rc;
+}
+
+/* ------------------------------------------------------------------ */
+int cdma_reachable(uint32_t addr, uint32_t len)
+{
+    return addr >= CDMA_REGION_BASE &&
+           len <= CDMA_REGION_SIZE &&
+           addr - CDMA_REGION_BASE <= CDMA_REGION_SIZE - len;
+}
@@ -0,0 +1,72 @@
+/******************************************************************************
+ * cdma.h
+ * -------
+ * AXI Central DMA (simple mode) driver with a software descriptor queue.
+ *
+ * Transfers are described by (source, destination, length) descriptors
+ * and queued with cdma_submit().  The CDMA runs them back to back: each
+ * completion interrupt retires the head descriptor, calls its callback
+ * and programs the next one, so the CPU only touches the CDMA once per
+ * transfer.  Source and destination must both be reachable from the CDMA
+ * master port (the image BRAM banks, see cdma_reachable()).
+ *
+ * Requires intc_init() and CPU interrupts enabled.
+ *****************************************************************************/
+#ifndef CDMA_H
+#define CDMA_H
+
+#include <stdint.h>
+#include "platform_config.h"
+
+/* Descriptors that can be queued at once (power of 2) */
+#define CDMA_QUEUE_DEPTH 16
+
+/* cdma_wait_idle() bound, in wait-loop iterations */
+#define CDMA_TIMEOUT_CYCLES 1000000
+
+/**
+ * Completion callback, run in interrupt context.
+ *
+ * @param ctx     Value given to cdma_submit()
+ * @param status  0 = transfer complete, -1 = CDMA reported an error
+ */
+typedef void (*CdmaCallback)(void *ctx, int status);
+
+/**
+ * Reset the CDMA, enable its completion / error interrupts and attach the
+ * ISR to INTC_IRQ_CDMA.
+ */
+void cdma_init(void);
+
+/**
+ * Queue a transfer of @p len bytes from bus address @p src to @p dst.
+ *
+ * @param cb   Optional callback on completion (may be 0)
+ * @return     0 if queued, -1 if the descriptor queue is full
+ */
+int cdma_submit(uint32_t src, uint32_t dst, uint32_t len,
+                CdmaCallback cb, void *ctx);
+
+/**
+ * @return  Free descriptor entries
+ */
+uint32_t cdma_free_slots(void);
+
+/**
+ * @return  1 while any queued transfer has not completed
+ */
+int cdma_busy(void);
+
+/**
+ * Wait until every queued transfer has completed.
+ *
+ * @return  0 on success, -1 on timeout or if any transfer failed
+ */
+int cdma_wait_idle(void);
+
+/**
+ * @return  1 if bus address range [addr, addr+len) is CDMA-accessible
+ */
+int cdma_reachable(uint32_t addr, uint32_t len);
+
+#endif /* CDMA_H */
@@ -0,0 +1,264 @@
+/******************************************************************************
+ * dispatcher.c
+ * -------------
+ * Frame dispatcher for multiple HLS Otsu accelerator instances.
+ *
+ * Jobs live in a ring of DISPATCH_QUEUE_DEPTH entries indexed by sequence
+ * number.  Three cursors walk it in order:
+ *   collect_seq <= start_seq <= submit_seq
+ * [collect_seq, start_seq) have been started (running or done) and
+ * [start_seq, submit_seq) are still queued.
+ *
+ * Instances and zero-copy buffers are held for two reasons, one bit each:
+ * RESERVED_FRAME until the result after the frame's has been collected,
+ * RESERVED_LATE while a timed-out kernel may still be reading the input
+ * and writing the mask.  A late instance is released only once ap_idle is
+ * seen again, so no frame is started on a kernel that is still running.
+ *****************************************************************************/
+#include "dispatcher.h"
+#include "image_loader.h"
+#include "energy_analyzer.h"
+#include <string.h>
+
+#define DISPATCH_MASK  (DISPATCH_QUEUE_DEPTH - 1U)  /* depth is a power of 2 */
+#define NO_INSTANCE    0xFFU
+
+#define RESERVED_FRAME 0x01U
+#define RESERVED_LATE  0x02U
+
+typedef enum
+{
+    JOB_QUEUED = 0,
+    JOB_RUNNING,
+    JOB_DONE
+} JobState;
+
+typedef struct
+{
+    const uint8_t *frame;
+    uint8_t mode;
+    uint8_t state;
+    uint8_t instance;
+    int8_t status;
+    int8_t buf;              /* zero-copy frame buffer, -1 = copy frame */
+    uint32_t tag;
+    uint32_t started;        /* energy_clock_now() at start (timeout)   */
+    OtsuAccelResult result;
+} DispatchJob;
+
+static OtsuAccel   accel[HLS_OTSU_NUM_INSTANCES];
+static uint8_t     inst_reserved[HLS_OTSU_NUM_INSTANCES];
+static uint8_t     buf_in_use[DISPATCH_FRAME_COUNT];
+static int8_t      late_buf[HLS_OTSU_NUM_INSTANCES];   /* buffer a late kernel reads */
+static DispatchJob jobs[DISPATCH_QUEUE_DEPTH];
+static uint32_t    timeout_cycles = HLS_TIMEOUT_CYCLES;
+
+static uint32_t submit_seq;
+static uint32_t start_seq;
+static uint32_t collect_seq;
+static uint8_t  held_instance = NO_INSTANCE;
+static int8_t   held_buf = -1;
+
+/* ------------------------------------------------------------------ */
+void dispatcher_init(void)
+{
+    for (uint32_t i = 0; i < HLS_OTSU_NUM_INSTANCES; i++) {
+        otsu_accel_init(&accel[i], i);
+#if OTSU_ACCEL_USE_IRQ
+        otsu_accel_enable_interrupt(&accel[i]);
+#endif
+        inst_reserved[i] = 0;
+        late_buf[i]      = -1;
+    }
+    memset(buf_in_use, 0, sizeof(buf_in_use));
+    memset(jobs, 0, sizeof(jobs));
+    submit_seq    = 0;
+    start_seq     = 0;
+    collect_seq   = 0;
+    held_instance = NO_INSTANCE;
+    held_buf      = -1;
+    timeout_cycles = HLS_TIMEOUT_CYCLES;
+}
+
+/* ------------------------------------------------------------------ */
+static int32_t enqueue(const uint8_t *frame, int buf, uint8_t mode, uint32_t tag)
+{
+    if (submit_seq - collect_seq >= DISPATCH_QUEUE_DEPTH)
+        return -1;
+
+    DispatchJob *job = &jobs[submit_seq & DISPATCH_MASK];
+    job->frame    = frame;
+    job->mode     = mode;
+    job->state    = JOB_QUEUED;
+    job->instance = NO_INSTANCE;
+    job->status   = 0;
+    job->buf      = (int8_t)buf;
+    job->tag      = tag;
+    job->started  = 0;
+
+    return (int32_t)submit_seq++;
+}
+
+/* ------------------------------------------------------------------ */
+int32_t dispatcher_submit(const uint8_t *frame, uint8_t mode, uint32_t tag)
+{
+    return enqueue(frame, -1, mode, tag);
+}
+
+/* ------------------------------------------------------------------ */
+int dispatcher_acquire(void)
+{
+    for (int b = 0; b < DISPATCH_FRAME_COUNT; b++) {
+        if (!buf_in_use[b]) {
+            buf_in_use[b] = RESERVED_FRAME;
+            return b;
+        }
+    }
+    return -1;
+}
+
+/* ------------------------------------------------------------------ */
+uint8_t *dispatcher_input(int buf)
+{
+    return (uint8_t *)PHYS_PTR(DISPATCH_FRAME_BASE(buf));
+}
+
+/* ------------------------------------------------------------------ */
+int32_t dispatcher_submit_buffer(int buf, uint8_t mode, uint32_t tag)
+{
+    return enqueue(dispatcher_input(buf), buf, mode, tag);
+}
+
+/* ------------------------------------------------------------------ */
+void dispatcher_set_threshold(uint8_t threshold)
+{
+    for (uint32_t i = 0; i < HLS_OTSU_NUM_INSTANCES; i++)
+        otsu_accel_set_threshold(&accel[i], threshold);
+}
+
+/* ------------------------------------------------------------------ */
+void dispatcher_set_normalize(uint8_t normalize)
+{
+    for (uint32_t i = 0; i < HLS_OTSU_NUM_INSTANCES; i++)
+        otsu_accel_set_normalize(&accel[i], normalize);
+}
+
+/* ------------------------------------------------------------------ */
+void dispatcher_set_timeout(uint32_t cycles)
+{
+    timeout_cycles = cycles;
+}
+
+/* ------------------------------------------------------------------ */
+void dispatcher_poll(void)
+{
+    /* Release timed-out instances (and their input buffers) once idle */
+    for (uint32_t i = 0; i < HLS_OTSU_NUM_INSTANCES; i++) {
+        if (!(inst_reserved[i] & RESERVED_LATE) || !otsu_accel_is_idle(&accel[i]))
+            continue;
+        inst_reserved[i] &= (uint8_t)~RESERVED_LATE;
+        if (late_buf[i] >= 0)
+            buf_in_use[late_buf[i]] &= (uint8_t)~RESERVED_LATE;
+        late_buf[i] = -1;
+    }
+
+    /* Retire finished instances */
+    for (uint32_t seq = collect_seq; seq != start_seq; seq++) {
+        DispatchJob *job = &jobs[seq & DISPATCH_MASK];
+        if (job->state != JOB_RUNNING)
+            continue;
+
+        const OtsuAccel *acc = &accel[job->instance];
+        if (otsu_accel_is_done(acc)) {
+            otsu_accel_read_result(acc, &job->result);
+            job->state = JOB_DONE;
+        } else if (energy_clock_now() - job->started >= timeout_cycles) {
+            job->status = -1;
+            job->state  = JOB_DONE;
+            inst_reserved[job->instance] |= RESERVED_LATE;
+            late_buf[job->instance] = job->buf;
+            if (job->buf >= 0)
+                buf_in_use[job->buf] |= RESERVED_LATE;
+        }
+    }
+
+    /* Start queued frames, in order, on idle instances */
+    for (uint32_t i = 0; i < HLS_OTSU_NUM_INSTANCES && start_seq != submit_seq; i++) {
+        if (inst_reserved[i])
+            continue;
+
+        DispatchJob *job = &jobs[start_seq & DISPATCH_MASK];
+        if (job->buf >= 0) {
+            otsu_accel_set_buffers(&accel[i], DISPATCH_FRAME_BASE(job->buf),
+                                   HLS_OTSU_OUTPUT_BASE(i));
+        } else {
+            otsu_accel_set_buffers(&accel[i], HLS_OTSU_INPUT_BASE(i),
+                                   HLS_OTSU_OUTPUT_BASE(i));
+            image_load_to_buffer(accel[i].in_addr, job->frame);
+        }
+        otsu_accel_start(&accel[i], job->mode);
+
+        inst_reserved[i] = RESERVED_FRAME;
+        job->started     = energy_clock_now();
+        job->instance    = (uint8_t)i;
+        job->state       = JOB_RUNNING;
+        start_seq++;
+    }
+}
+
+/* ------------------------------------------------------------------ */
+int dispatcher_collect(DispatchResult *out)
+{
+    /* The previously collected input / mask are no longer needed */
+    if (held_instance != NO_INSTANCE) {
+        inst_reserved[held_instance] &= (uint8_t)~RESERVED_FRAME;
+        held_instance = NO_INSTANCE;
+    }
+    if (held_buf >= 0) {
+        buf_in_use[held_buf] &= (uint8_t)~RESERVED_FRAME;
+        held_buf = -1;
+    }
+
+    if (collect_seq == start_seq)
+        return 0;
+
+    DispatchJob *job = &jobs[collect_seq & DISPATCH_MASK];
+    if (job->state != JOB_DONE)
+        return 0;
+
+    out->seq      = collect_seq;
+    out->tag      = job->tag;
+    out->instance = job->instance;
+    out->status   = job->status;
+    out->input    = (const uint8_t *)PHYS_PTR(accel[job->instance].in_addr);
+    out->mask     = (const uint8_t *)PHYS_PTR(accel[job->instance].out_addr);
+    out->result   = job->result;
+
+    held_instance = job->instance;
+    held_buf      = job->buf;
+    collect_seq++;
+    return 1;
+}
+
+/* ------------------------------------------------------------------ */
+uint32_t dispatcher_queued(void)
+{
+    return submit_seq - start_seq;
+}
+
+/* ------------------------------------------------------------------ */
+uint32_t dispatcher_in_flight(void)
+{
+    return submit_seq - collect_seq;
+}
+
+/* ------------------------------------------------------------------ */
+uint32_t dispatcher_busy_instances(void)
+{
+    uint32_t busy = 0;
+    for (uint32_t seq = collect_seq; seq != start_seq; seq++) {
+        if (jobs[seq & DISPATCH_MASK].state == JOB_RUNNING)
+            busy++;
+    }
+    return busy;
+}
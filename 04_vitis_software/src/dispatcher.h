@@ -0,0 +1,149 @@
+/******************************************************************************
+ * dispatcher.h
+ * -------------
+ * Frame dispatcher for multiple HLS Otsu accelerator instances.
+ *
+ * Frames are submitted to a FIFO queue; dispatcher_poll() starts queued
+ * frames on whichever instances are idle, so all HLS_OTSU_NUM_INSTANCES
+ * kernels stay busy, and records results as instances finish.  Results are
+ * handed back strictly in submission order by dispatcher_collect(), even
+ * when a later frame finishes first.
+ *
+ * An instance stays reserved until its frame has been collected, because
+ * the output mask lives in that instance's output buffer.  A frame that
+ * has not finished after the timeout (dispatcher_set_timeout(), measured
+ * on energy_clock_now()) is returned with status -1, but its instance,
+ * and its zero-copy buffer, stay reserved until the kernel reports
+ * ap_idle, so no frame is started on a kernel that is still running.
+ *
+ * Frames come in two ways:
+ *   - dispatcher_submit() copies a frame from anywhere into the input
+ *     buffer of the instance that runs it;
+ *   - zero-copy: dispatcher_acquire() hands out one of DISPATCH_FRAME_COUNT
+ *     image BRAM buffers, the producer builds the frame there
+ *     (dispatcher_input()) and dispatcher_submit_buffer() queues it; the
+ *     instance is pointed at the buffer through HLS_OTSU_IMG_IN_LO.
+  *****************************************************************************/
+#ifndef DISPATCHER_H
+#define DISPATCHER_H
+
+#include <stdint.h>
+#include "platform_config.h"
+#include "otsu_accel.h"
+
+/* Frames that may be in flight (submitted, not yet collected) */
+#define DISPATCH_QUEUE_DEPTH 8
+
+/**
+ * Result of one dispatched frame.
+ */
+typedef struct
+{
+    uint32_t seq;           /* submission sequence number (0, 1, ...)   */
+    uint32_t tag;           /* caller tag passed to dispatcher_submit() */
+    uint8_t instance;       /* accelerator instance that ran the frame  */
+    int8_t status;          /* 0 = ok, -1 = accelerator timeout (mask
+                             * and result are not valid)               */
+    const uint8_t *input;   /* input frame, valid until next collect    */
+    const uint8_t *mask;    /* output mask, valid until next collect    */
+    OtsuAccelResult result; /* decoded result registers                 */
+} DispatchResult;
+
+/**
+ * Initialise the dispatcher and all HLS_OTSU_NUM_INSTANCES instances
+ * (interrupt-driven when OTSU_ACCEL_USE_IRQ; call intc_init() first).
+ * Timeouts run on the free-running clock: call energy_clock_start() first.
+ * Resets the timeout to HLS_TIMEOUT_CYCLES.
+ */
+void dispatcher_init(void);
+
+/**
+ * Queue a frame for processing.
+ *
+ * The frame is copied into an instance's input buffer when it is started,
+ * so @p frame must stay valid until dispatcher_queued() no longer counts
+ * it (i.e. until a later dispatcher_poll() has started it).
+ *
+ * @param frame  Grayscale image (IMG_SIZE bytes)
+ * @param mode   Processing mode for this frame
+ * @param tag    Opaque caller value returned with the result
+ * @return       Sequence number, or -1 if DISPATCH_QUEUE_DEPTH frames
+ *               are already in flight
+ */
+int32_t dispatcher_submit(const uint8_t *frame, uint8_t mode, uint32_t tag);
+
+/**
+ * Take a free zero-copy frame buffer.
+ *
+ * @return  Buffer index, or -1 if all DISPATCH_FRAME_COUNT are in use
+ */
+int dispatcher_acquire(void);
+
+/**
+ * @return  CPU pointer to frame buffer @p buf (IMG_SIZE bytes)
+ */
+uint8_t *dispatcher_input(int buf);
+
+/**
+ * Queue the frame built in buffer @p buf (from dispatcher_acquire()).
+ * The kernel reads the buffer in place; it returns to the free pool when
+ * the result after this frame's is collected.
+ *
+ * @return  Sequence number, or -1 if the queue is full (the buffer stays
+ *          acquired, so the call may be retried).  Zero-copy frames alone
+ *          never fill the queue: DISPATCH_FRAME_COUNT <= DISPATCH_QUEUE_DEPTH.
+ */
+int32_t dispatcher_submit_buffer(int buf, uint8_t mode, uint32_t tag);
+
+/**
+ * Set the threshold of HLS_OTSU_MODE_FIXED_THR frames on every instance.
+ * Applies to frames started from now on.
+ */
+void dispatcher_set_threshold(uint8_t threshold);
+
+/**
+ * Set the contrast normalisation (HLS_OTSU_NORM_*) on every instance.
+ * Applies to frames started from now on; the tile modes ignore it.
+ */
+void dispatcher_set_normalize(uint8_t normalize);
+
+/**
+ * Set the per-frame timeout, in energy_clock_now() cycles from the start
+ * of the frame.  Applies to running frames from the next dispatcher_poll().
+ */
+void dispatcher_set_timeout(uint32_t cycles);
+
+/**
+ * Advance the dispatcher: retire finished instances, then start queued
+ * frames on idle instances.  Non-blocking.
+ */
+void dispatcher_poll(void);
+
+/**
+ * Fetch the next result in submission order.
+ *
+ * Releases the instance held by the previously collected result, so its
+ * mask pointer becomes invalid.
+ *
+ * @param out    Output: result of the oldest in-flight frame
+ * @return       1 if that frame has finished, 0 if it is still pending
+ *               (or nothing is in flight)
+ */
+int dispatcher_collect(DispatchResult *out);
+
+/**
+ * @return  Frames submitted but not yet started on an instance
+ */
+uint32_t dispatcher_queued(void);
+
+/**
+ * @return  Frames submitted but not yet collected
+ */
+uint32_t dispatcher_in_flight(void);
+
+/**
+ * @return  Instances currently running a frame
+ */
+uint32_t dispatcher_busy_instances(void);
+
+#endif /* DISPATCHER_H */
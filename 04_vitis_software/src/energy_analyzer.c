@@ -17,6 +17,9 @@
 #define TCSR0   0x00   /* Timer Control/Status Register 0 */
 #define TLR0    0x04   /* Timer Load Register 0           */
 #define TCR0    0x08   /* Timer Counter Register 0        */
+#define TCSR1   0x10   /* Timer Control/Status Register 1 */
+#define TLR1    0x14   /* Timer Load Register 1           */
+#define TCR1    0x18   /* Timer Counter Register 1        */
 
 /* TCSR0 bits */
 #define TCSR_MDT    (1 << 0)   /* Timer mode (0=generate, 1=capture) */
@@ -53,6 +56,22 @@ uint32_t energy_timer_stop(void)
     return cycles;
 }
 
+/* ------------------------------------------------------------------ */
+void energy_clock_start(void)
+{
+    /* Timer 1: free-running up-counter, never stopped */
+    REG_WRITE(XPAR_AXI_TIMER_0_BASEADDR, TCSR1, 0);
+    REG_WRITE(XPAR_AXI_TIMER_0_BASEADDR, TLR1, 0);
+    REG_WRITE(XPAR_AXI_TIMER_0_BASEADDR, TCSR1, TCSR_LOAD);
+    REG_WRITE(XPAR_AXI_TIMER_0_BASEADDR, TCSR1, TCSR_ENT);
+}
+
+/* ------------------------------------------------------------------ */
+uint32_t energy_clock_now(void)
+{
+    return REG_READ(XPAR_AXI_TIMER_0_BASEADDR, TCR1);
+}
+
 /* ------------------------------------------------------------------ */
 /*
  * SW baseline: simple Otsu on MicroBlaze (no HLS).
@@ -145,6 +164,30 @@ void energy_compute_report(uint32_t hw_cycles, uint32_t sw_cycles,
         : 0.0f;
 }
 
+/* ------------------------------------------------------------------ */
+void energy_print_stage_cycles(const uint32_t stage_cycles[HLS_NUM_STAGES])
+{
+    static const char * const stage_names[HLS_NUM_STAGES] = {
+        "  Read-in:        ",
+        "  Histogram:      ",
+        "  Otsu sweep:     ",
+        "  Adaptive:       ",
+        "  Threshold:      ",
+        "  Morph open:     ",
+        "  Morph close:    ",
+        "  Write-out:      ",
+    };
+
+    uint32_t total = 0;
+    uart_print("\r\n=== HLS Stage Cycles ===\r\n");
+    for (int s = 0; s < HLS_NUM_STAGES; s++) {
+        uart_print_uint(stage_names[s], stage_cycles[s]);
+        total += stage_cycles[s];
+    }
+    uart_print_uint("  Kernel total:   ", total);
+    uart_print("========================\r\n");
+}
+
 /* ------------------------------------------------------------------ */
 void energy_print_report(const EnergyReport *report)
 {
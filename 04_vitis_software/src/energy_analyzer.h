@@ -42,6 +42,17 @@ void energy_timer_start(void);
  */
 uint32_t energy_timer_stop(void);
 
+/**
+ * Start the free-running cycle clock (AXI Timer counter 1).  Independent
+ * of energy_timer_start/stop, so it can timestamp overlapping stages.
+ */
+void energy_clock_start(void);
+
+/**
+ * @return  Current value of the free-running cycle clock (wraps at 2^32)
+ */
+uint32_t energy_clock_now(void);
+
 /**
  * Run the software-only baseline (Otsu on MicroBlaze) and measure time.
  *
@@ -61,6 +72,14 @@ uint32_t energy_sw_baseline(const uint8_t *img, uint8_t *mask_out);
 void energy_compute_report(uint32_t hw_cycles, uint32_t sw_cycles,
                            EnergyReport *report);
 
+/**
+ * Print the accelerator's per-stage latency table via UART.
+ *
+ * @param stage_cycles  HLS_NUM_STAGES cycle counts read from the
+ *                      accelerator's stage counters
+ */
+void energy_print_stage_cycles(const uint32_t stage_cycles[HLS_NUM_STAGES]);
+
 /**
  * Print the energy report via UART.
  *
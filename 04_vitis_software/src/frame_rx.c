@@ -0,0 +1,212 @@
+/******************************************************************************
+ * frame_rx.c
+ * -----------
+ * Binary image ingestion over the UART Lite RX line.
+ *
+ * The receiver is a byte-at-a-time state machine run from the UART ISR:
+ *   HUNT    – shift bytes through a 32-bit window until it holds the sync
+ *   HEADER  – collect the rest of the header, validate, claim a slot
+ *   PAYLOAD – store pixels into the slot, fold them into the statistics
+ *   CRC     – compare the trailer, then submit or drop the slot
+ * The CRC runs over every byte as it arrives with a 16-entry nibble table,
+ * so nothing is re-read at the end of the frame.
+ *****************************************************************************/
+#include "frame_rx.h"
+#include "otsu_stream.h"
+#include "uart_debug.h"
+#include "intc.h"
+#include <string.h>
+
+typedef enum
+{
+    RX_HUNT = 0,
+    RX_HEADER,
+    RX_PAYLOAD,
+    RX_CRC
+} RxState;
+
+static const uint32_t crc_nibble[16] = {
+    0x00000000U, 0x1DB71064U, 0x3B6E20C8U, 0x26D930ACU,
+    0x76DC4190U, 0x6B6B51F4U, 0x4DB26158U, 0x5005713CU,
+    0xEDB88320U, 0xF00F9344U, 0xD6D6A3E8U, 0xCB61B38CU,
+    0x9B64C2B0U, 0x86D3D2D4U, 0xA00AE278U, 0xBDBDF21CU
+};
+
+static struct
+{
+    RxState state;
+    uint32_t window;               /* last four bytes while hunting   */
+    uint8_t header[FRAME_RX_HEADER_SIZE];
+    uint32_t pos;                  /* bytes into the current section  */
+    uint32_t crc;                  /* running CRC, pre-inverted       */
+    uint32_t crc_rx;
+    int slot;                      /* -1: payload is being discarded  */
+    uint8_t *dst;
+    uint32_t sum, sum_sq;
+    uint8_t min_v, max_v;
+} rx;
+
+static FrameRxInfo  slot_info[FRAME_SLOT_COUNT];
+static FrameRxStats rx_stats;
+
+/* ------------------------------------------------------------------ */
+static inline uint32_t crc_step(uint32_t crc, uint8_t byte)
+{
+    crc ^= byte;
+    crc = (crc >> 4) ^ crc_nibble[crc & 0xFU];
+    crc = (crc >> 4) ^ crc_nibble[crc & 0xFU];
+    return crc;
+}
+
+uint32_t frame_rx_crc32(uint32_t crc, const uint8_t *buf, uint32_t len)
+{
+    crc = ~crc;
+    for (uint32_t i = 0; i < len; i++)
+        crc = crc_step(crc, buf[i]);
+    return ~crc;
+}
+
+/* ------------------------------------------------------------------ */
+static void hunt(void)
+{
+    rx.state  = RX_HUNT;
+    rx.window = 0;
+}
+
+/* Header complete: validate it and claim a slot for the payload */
+static void begin_payload(void)
+{
+    uint16_t width  = (uint16_t)(rx.header[4] | (rx.header[5] << 8));
+    uint16_t height = (uint16_t)(rx.header[6] | (rx.header[7] << 8));
+    uint8_t  mode   = rx.header[8];
+
+    if (width != IMG_WIDTH || height != IMG_HEIGHT || rx.header[9] != 0 ||
+        (mode > PROCESSING_MODE_CAREFUL && mode != FRAME_RX_MODE_AUTO)) {
+        rx_stats.header_errors++;
+        hunt();
+        return;
+    }
+
+    rx.slot = otsu_stream_acquire();
+    rx.dst  = rx.slot >= 0 ? otsu_stream_input(rx.slot) : 0;
+    rx.sum    = 0;
+    rx.sum_sq = 0;
+    rx.min_v  = 255;
+    rx.max_v  = 0;
+    rx.pos    = 0;
+    rx.state  = RX_PAYLOAD;
+}
+
+/* Trailer complete: hand the slot to the accelerator or drop it */
+static void end_frame(void)
+{
+    int slot = rx.slot;
+    hunt();
+
+    if (~rx.crc != rx.crc_rx) {
+        rx_stats.crc_errors++;
+        if (slot >= 0)
+            otsu_stream_release(slot);
+        return;
+    }
+    if (slot < 0) {
+        rx_stats.no_slot++;
+        return;
+    }
+
+    FrameRxInfo *info = &slot_info[slot];
+    info->frame_id = (uint16_t)(rx.header[10] | (rx.header[11] << 8));
+    adaptive_stats_from_sums(rx.sum, rx.sum_sq, rx.min_v, rx.max_v, &info->stats);
+    info->mode = rx.header[8] == FRAME_RX_MODE_AUTO
+                     ? adaptive_select_mode(&info->stats) : rx.header[8];
+
+    otsu_stream_submit(slot, info->mode);
+    rx_stats.frames++;
+}
+
+/* ------------------------------------------------------------------ */
+/* UART RX handler (interrupt context) */
+static void frame_rx_byte(uint8_t byte, void *ctx)
+{
+    (void)ctx;
+
+    switch (rx.state) {
+    case RX_HUNT:
+        rx.window = (rx.window >> 8) | ((uint32_t)byte << 24);
+        if (rx.window == FRAME_RX_SYNC) {
+            rx.header[0] = (uint8_t)rx.window;
+            rx.header[1] = (uint8_t)(rx.window >> 8);
+            rx.header[2] = (uint8_t)(rx.window >> 16);
+            rx.header[3] = (uint8_t)(rx.window >> 24);
+            rx.crc   = ~frame_rx_crc32(0, rx.header, 4);
+            rx.pos   = 4;
+            rx.state = RX_HEADER;
+        }
+        break;
+
+    case RX_HEADER:
+        rx.header[rx.pos++] = byte;
+        rx.crc = crc_step(rx.crc, byte);
+        if (rx.pos == FRAME_RX_HEADER_SIZE)
+            begin_payload();
+        break;
+
+    case RX_PAYLOAD:
+        rx.crc = crc_step(rx.crc, byte);
+        if (rx.dst) {
+            rx.dst[rx.pos] = byte;
+            rx.sum    += byte;
+            rx.sum_sq += (uint32_t)byte * byte;
+            if (byte < rx.min_v) rx.min_v = byte;
+            if (byte > rx.max_v) rx.max_v = byte;
+        }
+        if (++rx.pos == IMG_SIZE) {
+            rx.pos    = 0;
+            rx.crc_rx = 0;
+            rx.state  = RX_CRC;
+        }
+        break;
+
+    case RX_CRC:
+        rx.crc_rx |= (uint32_t)byte << (8U * rx.pos);
+        if (++rx.pos == 4)
+            end_frame();
+        break;
+    }
+}
+
+/* ------------------------------------------------------------------ */
+void frame_rx_start(void)
+{
+    memset(&rx_stats, 0, sizeof(rx_stats));
+    rx.slot = -1;
+    hunt();
+    uart_rx_attach(frame_rx_byte, 0);
+}
+
+/* ------------------------------------------------------------------ */
+void frame_rx_stop(void)
+{
+    uart_rx_detach();
+    if (rx.state == RX_PAYLOAD || rx.state == RX_CRC) {
+        if (rx.slot >= 0)
+            otsu_stream_release(rx.slot);
+    }
+    rx.slot = -1;
+    hunt();
+}
+
+/* ------------------------------------------------------------------ */
+void frame_rx_info(int slot, FrameRxInfo *info)
+{
+    *info = slot_info[slot];
+}
+
+/* ------------------------------------------------------------------ */
+void frame_rx_get_stats(FrameRxStats *stats)
+{
+    uint32_t irq = cpu_irq_save();
+    *stats = rx_stats;
+    stats->overruns = uart_rx_overruns();
+    cpu_irq_restore(irq);
+}
@@ -0,0 +1,88 @@
+/******************************************************************************
+ * frame_rx.h
+ * -----------
+ * Binary image ingestion over the UART Lite RX line.
+ *
+ * Frames are received in the UART interrupt and streamed byte by byte
+ * into a free otsu_stream slot; when the CRC checks out the slot is
+ * submitted at once, so the accelerator starts while the ISR returns.
+ * Results come back through otsu_stream_collect() as for any other
+ * producer, and frame_rx_info() tells which received frame a slot holds.
+ *
+ * Wire format (little-endian):
+ *
+ *   offset  size
+ *   0       4     sync word FRAME_RX_SYNC (1D FC CF 1A on the wire)
+ *   4       2     width   (must be IMG_WIDTH)
+ *   6       2     height  (must be IMG_HEIGHT)
+ *   8       1     mode    (PROCESSING_MODE_*, or FRAME_RX_MODE_AUTO)
+ *   9       1     flags   (reserved, 0)
+ *   10      2     frame id, echoed back through frame_rx_info()
+ *   12      w*h   pixels, row-major, 8-bit
+ *   12+w*h  4     CRC-32 (IEEE 802.3) of bytes 0 .. 11+w*h
+ *
+ * A bad header resumes the sync search after it; a frame that
+ * fails its CRC (or arrives while every slot is busy) is dropped.
+ *****************************************************************************/
+#ifndef FRAME_RX_H
+#define FRAME_RX_H
+
+#include <stdint.h>
+#include "platform_config.h"
+#include "adaptive_controller.h"
+
+#define FRAME_RX_SYNC        0x1ACFFC1DU
+#define FRAME_RX_HEADER_SIZE 12U
+#define FRAME_RX_MODE_AUTO   0xFFU   /* pick the mode from streamed stats */
+
+/**
+ * Receiver counters.
+ */
+typedef struct
+{
+    uint32_t frames;        /* frames received and submitted           */
+    uint32_t crc_errors;    /* frames dropped on CRC mismatch          */
+    uint32_t header_errors; /* sync words followed by a bad header     */
+    uint32_t no_slot;       /* frames dropped, no free stream slot     */
+    uint32_t overruns;      /* UART RX FIFO overruns                   */
+} FrameRxStats;
+
+/**
+ * Description of a received frame, valid until its slot is released.
+ */
+typedef struct
+{
+    uint16_t frame_id;      /* id from the frame header                */
+    uint8_t mode;           /* mode submitted to the accelerator       */
+    SwImageStats stats;     /* statistics gathered while receiving     */
+} FrameRxInfo;
+
+/**
+ * Start receiving.  The stream (otsu_stream_init()) must be running;
+ * requires intc_init() and CPU interrupts enabled.
+ */
+void frame_rx_start(void);
+
+/**
+ * Stop receiving; a frame in progress is discarded.
+ */
+void frame_rx_stop(void);
+
+/**
+ * @param slot  Slot of a collected StreamResult
+ * @param info  Output: frame that was received into @p slot
+ */
+void frame_rx_info(int slot, FrameRxInfo *info);
+
+/**
+ * Copy the receiver counters.
+ */
+void frame_rx_get_stats(FrameRxStats *stats);
+
+/**
+ * Continue a CRC-32 (IEEE 802.3, reflected, as zlib's crc32()) over
+ * @p len bytes.  Start with crc = 0.
+ */
+uint32_t frame_rx_crc32(uint32_t crc, const uint8_t *buf, uint32_t len);
+
+#endif /* FRAME_RX_H */
@@ -2,35 +2,149 @@
  * image_loader.c
  * ---------------
  * Memory-mapped image transfer to/from BRAM buffers.
+ *
+ * Every AXI access costs the same handful of cycles whether it carries a
+ * byte or a word, so the word path moves an image in a quarter of the
+ * bus transactions of the byte path.
  *****************************************************************************/
 #include "image_loader.h"
 #include <string.h>
+#if IMAGE_USE_CDMA
+#include "cdma.h"
+#endif
 
 /* ------------------------------------------------------------------ */
-void image_load_to_bram(const uint8_t *src)
+void image_copy(void *dst, const void *src, uint32_t len)
 {
-    volatile uint8_t *dst = (volatile uint8_t *)IMG_INPUT_BASE;
-    for (uint32_t i = 0; i < IMG_SIZE; i++) {
-        dst[i] = src[i];
+    volatile uint8_t *d = (volatile uint8_t *)dst;
+    const volatile uint8_t *s = (const volatile uint8_t *)src;
+
+#if IMAGE_XFER == IMAGE_XFER_WORD
+    /* Head: bytes until the destination is word aligned */
+    while (len && ((uintptr_t)d & 3U)) {
+        *d++ = *s++;
+        len--;
     }
+
+    volatile uint32_t *dw = (volatile uint32_t *)d;
+    if (((uintptr_t)s & 3U) == 0) {
+        const volatile uint32_t *sw = (const volatile uint32_t *)s;
+        for (; len >= 4U; len -= 4U)
+            *dw++ = *sw++;
+        s = (const volatile uint8_t *)sw;
+    } else {
+        /* Source misaligned: re-pack bytes into destination words */
+        for (; len >= 4U; len -= 4U, s += 4)
+            *dw++ = (uint32_t)s[0]         | ((uint32_t)s[1] << 8) |
+                    ((uint32_t)s[2] << 16) | ((uint32_t)s[3] << 24);
+    }
+    d = (volatile uint8_t *)dw;
+#endif
+
+    /* Tail (or the whole copy on the byte path) */
+    while (len--)
+        *d++ = *s++;
 }
 
 /* ------------------------------------------------------------------ */
-void image_read_from_bram(uint8_t *dst)
+void image_fill(void *dst, uint8_t value, uint32_t len)
 {
-    volatile const uint8_t *src = (volatile const uint8_t *)IMG_OUTPUT_BASE;
-    for (uint32_t i = 0; i < IMG_SIZE; i++) {
-        dst[i] = src[i];
+    volatile uint8_t *d = (volatile uint8_t *)dst;
+
+#if IMAGE_XFER == IMAGE_XFER_WORD
+    while (len && ((uintptr_t)d & 3U)) {
+        *d++ = value;
+        len--;
     }
+
+    volatile uint32_t *dw = (volatile uint32_t *)d;
+    uint32_t word = (uint32_t)value * 0x01010101U;
+    for (; len >= 4U; len -= 4U)
+        *dw++ = word;
+    d = (volatile uint8_t *)dw;
+#endif
+
+    while (len--)
+        *d++ = value;
 }
 
 /* ------------------------------------------------------------------ */
-void image_clear_buffers(void)
+int image_load_async(uint32_t base, const uint8_t *src,
+                     ImageXferDone cb, void *ctx)
 {
-    volatile uint8_t *inp = (volatile uint8_t *)IMG_INPUT_BASE;
-    volatile uint8_t *out = (volatile uint8_t *)IMG_OUTPUT_BASE;
-    for (uint32_t i = 0; i < IMG_SIZE; i++) {
-        inp[i] = 0;
-        out[i] = 0;
+#if IMAGE_USE_CDMA
+    uint32_t src_addr = BUS_ADDR(src);
+    if (src_addr && cdma_reachable(src_addr, IMG_SIZE))
+        return cdma_submit(src_addr, base, IMG_SIZE, cb, ctx);
+#endif
+
+    /* Local memory source (or no CDMA): CPU copy */
+    image_copy(PHYS_PTR(base), src, IMG_SIZE);
+    if (cb)
+        cb(ctx, 0);
+    return 0;
+}
+
+/* ------------------------------------------------------------------ */
+int image_clear_async(uint32_t base, uint32_t len,
+                      ImageXferDone cb, void *ctx)
+{
+#if IMAGE_USE_CDMA
+    if (len > IMAGE_CLEAR_SEED) {
+        uint32_t steps = 0;
+        for (uint32_t n = IMAGE_CLEAR_SEED; n < len; n *= 2U)
+            steps++;
+
+        if (cdma_free_slots() >= steps) {
+            image_fill(PHYS_PTR(base), 0, IMAGE_CLEAR_SEED);
+            for (uint32_t n = IMAGE_CLEAR_SEED; n < len; n *= 2U) {
+                uint32_t chunk = (len - n < n) ? len - n : n;
+                int last = (n + chunk == len);
+                if (cdma_submit(base, base + n, chunk,
+                                last ? cb : 0, last ? ctx : 0) != 0)
+                    return -1;
+            }
+            return 0;
+        }
     }
+#endif
+
+    image_fill(PHYS_PTR(base), 0, len);
+    if (cb)
+        cb(ctx, 0);
+    return 0;
+}
+
+/* ------------------------------------------------------------------ */
+void image_load_to_buffer(uint32_t base, const uint8_t *src)
+{
+#if IMAGE_USE_CDMA
+    if (image_load_async(base, src, 0, 0) == 0 && cdma_wait_idle() == 0)
+        return;
+#endif
+    image_copy(PHYS_PTR(base), src, IMG_SIZE);
+}
+
+/* ------------------------------------------------------------------ */
+void image_load_to_bram(const uint8_t *src)
+{
+    image_load_to_buffer(IMG_INPUT_BASE, src);
+}
+
+/* ------------------------------------------------------------------ */
+void image_read_from_bram(uint8_t *dst)
+{
+    image_copy(dst, PHYS_PTR(IMG_OUTPUT_BASE), IMG_SIZE);
+}
+
+/* ------------------------------------------------------------------ */
+void image_clear_buffers(void)
+{
+    /* Input and output buffers are adjacent */
+#if IMAGE_USE_CDMA
+    if (image_clear_async(IMG_INPUT_BASE, 2U * IMG_SIZE, 0, 0) == 0 &&
+        cdma_wait_idle() == 0)
+        return;
+#endif
+    image_fill(PHYS_PTR(IMG_INPUT_BASE), 0, 2U * IMG_SIZE);
 }
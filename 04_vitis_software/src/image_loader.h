@@ -2,6 +2,11 @@
  * image_loader.h
  * ---------------
  * Functions to load test images into BRAM and retrieve output masks.
+ *
+ * CPU copies move 32-bit words (IMAGE_XFER_WORD); the byte-at-a-time path
+ * is kept as IMAGE_XFER_BYTE.  With IMAGE_USE_CDMA, BRAM-to-BRAM copies
+ * and buffer clears are offloaded to the AXI CDMA (see cdma.h), and the
+ * _async variants return as soon as the transfer is queued.
  *****************************************************************************/
 #ifndef IMAGE_LOADER_H
 #define IMAGE_LOADER_H
@@ -9,6 +14,67 @@
 #include <stdint.h>
 #include "platform_config.h"
 
+/* CPU copy implementation */
+#define IMAGE_XFER_BYTE 0   /* one volatile byte per access (reference)   */
+#define IMAGE_XFER_WORD 1   /* 32-bit words, byte head / tail for alignment */
+
+#ifndef IMAGE_XFER
+#define IMAGE_XFER IMAGE_XFER_WORD
+#endif
+
+/* Bytes the CPU zeroes before the CDMA doubles them over a buffer */
+#define IMAGE_CLEAR_SEED 256U
+
+/**
+ * Transfer completion callback (interrupt context when the CDMA is used).
+ *
+ * @param status  0 = data in place, -1 = transfer failed
+ */
+typedef void (*ImageXferDone)(void *ctx, int status);
+
+/**
+ * Copy @p len bytes between CPU pointers, any alignment.  The destination
+ * is written in aligned words; a source that is misaligned relative to it
+ * is re-packed on the fly (little-endian, as MicroBlaze on AXI).
+ */
+void image_copy(void *dst, const void *src, uint32_t len);
+
+/**
+ * Fill @p len bytes at @p dst with @p value, any alignment.
+ */
+void image_fill(void *dst, uint8_t value, uint32_t len);
+
+/**
+ * Copy a grayscale image (row-major, 8-bit) into an arbitrary image buffer,
+ * e.g. the input buffer of another accelerator instance.  Returns once the
+ * data is in place.
+ *
+ * @param base  Bus address of the destination buffer (IMG_SIZE bytes)
+ * @param src   Pointer to image data (IMG_SIZE bytes)
+ */
+void image_load_to_buffer(uint32_t base, const uint8_t *src);
+
+/**
+ * Start copying a grayscale image into the buffer at bus address @p base.
+ * Uses the CDMA when enabled and @p src is in image BRAM; otherwise the
+ * copy is done by the CPU before returning and @p cb runs immediately.
+ *
+ * @param cb    Optional completion callback (may be 0)
+ * @return      0 if the copy was queued or done, -1 on failure
+ */
+int image_load_async(uint32_t base, const uint8_t *src,
+                     ImageXferDone cb, void *ctx);
+
+/**
+ * Start zeroing @p len bytes at bus address @p base (word aligned).  With
+ * the CDMA, the CPU clears IMAGE_CLEAR_SEED bytes and the CDMA copies the
+ * zeroed prefix onto itself in doubling steps; @p cb reports the last step.
+ *
+ * @return  0 if the clear was queued or done, -1 on failure
+ */
+int image_clear_async(uint32_t base, uint32_t len,
+                      ImageXferDone cb, void *ctx);
+
 /**
  * Copy a grayscale image (row-major, 8-bit) into the input BRAM buffer.
  *
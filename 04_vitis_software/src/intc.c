@@ -0,0 +1,123 @@
+/******************************************************************************
+ * intc.c
+ * -------
+ * Minimal AXI Interrupt Controller driver for MicroBlaze.
+ *****************************************************************************/
+#include "intc.h"
+
+#ifndef DESKTOP_SIM
+#include "mb_interface.h"   /* standalone BSP: MSR access, vector hook */
+#endif
+
+/* ---- AXI INTC register offsets ---- */
+#define INTC_ISR  0x00   /* interrupt status          */
+#define INTC_IPR  0x04   /* interrupt pending (ISR&IER) */
+#define INTC_IER  0x08   /* interrupt enable          */
+#define INTC_IAR  0x0C   /* interrupt acknowledge (W) */
+#define INTC_SIE  0x10   /* set interrupt enables (W) */
+#define INTC_CIE  0x14   /* clear interrupt enables (W) */
+#define INTC_MER  0x1C   /* master enable             */
+
+#define INTC_MER_ME   (1U << 0)   /* master IRQ output enable  */
+#define INTC_MER_HIE  (1U << 1)   /* hardware interrupt enable */
+
+#define INTC_BASE  XPAR_AXI_INTC_0_BASEADDR
+
+#define MSR_IE  0x2U   /* MicroBlaze MSR interrupt enable */
+
+static IntcHandler handlers[INTC_NUM_IRQS];
+static void       *handler_ctx[INTC_NUM_IRQS];
+
+/* ------------------------------------------------------------------ */
+/* MicroBlaze interrupt entry: serve every pending, enabled line */
+static void intc_dispatch(void *unused)
+{
+    (void)unused;
+    uint32_t pending;
+
+    while ((pending = REG_READ(INTC_BASE, INTC_IPR)) != 0) {
+        for (uint32_t irq = 0; irq < INTC_NUM_IRQS; irq++) {
+            uint32_t bit = 1U << irq;
+            if (!(pending & bit))
+                continue;
+            if (handlers[irq])
+                handlers[irq](handler_ctx[irq]);
+            REG_WRITE(INTC_BASE, INTC_IAR, bit);
+        }
+    }
+}
+
+/* ------------------------------------------------------------------ */
+void intc_init(void)
+{
+    REG_WRITE(INTC_BASE, INTC_MER, 0);
+    REG_WRITE(INTC_BASE, INTC_IER, 0);
+    REG_WRITE(INTC_BASE, INTC_IAR, 0xFFFFFFFFU);
+
+    for (uint32_t irq = 0; irq < INTC_NUM_IRQS; irq++) {
+        handlers[irq]    = 0;
+        handler_ctx[irq] = 0;
+    }
+
+#ifndef DESKTOP_SIM
+    microblaze_register_handler(intc_dispatch, 0);
+#else
+    sim_cpu_set_irq_handler(intc_dispatch, 0);
+#endif
+
+    REG_WRITE(INTC_BASE, INTC_MER, INTC_MER_ME | INTC_MER_HIE);
+}
+
+/* ------------------------------------------------------------------ */
+void intc_connect(uint32_t irq, IntcHandler handler, void *ctx)
+{
+    handlers[irq]    = handler;
+    handler_ctx[irq] = ctx;
+    REG_WRITE(INTC_BASE, INTC_SIE, 1U << irq);
+}
+
+/* ------------------------------------------------------------------ */
+void intc_disconnect(uint32_t irq)
+{
+    REG_WRITE(INTC_BASE, INTC_CIE, 1U << irq);
+    handlers[irq]    = 0;
+    handler_ctx[irq] = 0;
+}
+
+/* ------------------------------------------------------------------ */
+void cpu_irq_enable(void)
+{
+#ifndef DESKTOP_SIM
+    microblaze_enable_interrupts();
+#else
+    sim_cpu_irq_enable(1);
+#endif
+}
+
+void cpu_irq_disable(void)
+{
+#ifndef DESKTOP_SIM
+    microblaze_disable_interrupts();
+#else
+    sim_cpu_irq_enable(0);
+#endif
+}
+
+/* ------------------------------------------------------------------ */
+uint32_t cpu_irq_save(void)
+{
+#ifndef DESKTOP_SIM
+    uint32_t enabled = (mfmsr() & MSR_IE) != 0;
+#else
+    uint32_t enabled = (uint32_t)sim_cpu_irq_enabled();
+#endif
+    if (enabled)
+        cpu_irq_disable();
+    return enabled;
+}
+
+void cpu_irq_restore(uint32_t state)
+{
+    if (state)
+        cpu_irq_enable();
+}
@@ -0,0 +1,54 @@
+/******************************************************************************
+ * intc.h
+ * -------
+ * Minimal AXI Interrupt Controller driver for MicroBlaze.
+ *
+ * One handler per INTC input line; intc_init() hooks the controller into
+ * the MicroBlaze interrupt vector.  Handlers run in interrupt context and
+ * must clear their peripheral's interrupt source before returning.
+ *****************************************************************************/
+#ifndef INTC_H
+#define INTC_H
+
+#include <stdint.h>
+#include "platform_config.h"
+
+/* Handler for one interrupt line; ctx is the value given to intc_connect() */
+typedef void (*IntcHandler)(void *ctx);
+
+/**
+ * Reset the controller (all lines disabled and acknowledged), install the
+ * dispatch routine as the MicroBlaze interrupt handler and enable the
+ * controller's hardware outputs.  CPU interrupts stay disabled.
+ */
+void intc_init(void);
+
+/**
+ * Attach @p handler to input @p irq and enable that line.
+ *
+ * @param irq      INTC input, 0 .. INTC_NUM_IRQS-1
+ * @param handler  Called with @p ctx whenever the line is pending
+ * @param ctx      Opaque pointer passed to the handler
+ */
+void intc_connect(uint32_t irq, IntcHandler handler, void *ctx);
+
+/**
+ * Disable input @p irq and detach its handler.
+ */
+void intc_disconnect(uint32_t irq);
+
+/**
+ * Enable / disable interrupts in the MicroBlaze MSR.
+ */
+void cpu_irq_enable(void);
+void cpu_irq_disable(void);
+
+/**
+ * Critical section usable from both thread and interrupt context: disable
+ * interrupts and return whether they were enabled; cpu_irq_restore()
+ * re-enables them only in that case (an ISR runs with MSR[IE] clear).
+ */
+uint32_t cpu_irq_save(void);
+void cpu_irq_restore(uint32_t state);
+
+#endif /* INTC_H */
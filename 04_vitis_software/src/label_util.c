@@ -0,0 +1,58 @@
+/******************************************************************************
+ * label_util.c
+ * -------------
+ * Label bookkeeping shared by tiler.c and volume.c (see label_util.h).
+ *****************************************************************************/
+#include "label_util.h"
+#include <string.h>
+
+/* ------------------------------------------------------------------ */
+uint16_t label_uf_find(uint16_t *parent, uint16_t l)
+{
+    while (parent[l] != l) {
+        parent[l] = parent[parent[l]];   /* path halving */
+        l = parent[l];
+    }
+    return l;
+}
+
+/* ------------------------------------------------------------------ */
+void label_uf_union(uint16_t *parent, uint16_t a, uint16_t b)
+{
+    a = label_uf_find(parent, a);
+    b = label_uf_find(parent, b);
+    if (a < b)
+        parent[b] = a;
+    else if (b < a)
+        parent[a] = b;
+}
+
+/* ------------------------------------------------------------------ */
+static uint32_t entry_key(const uint8_t *entry, uint32_t key_offset)
+{
+    uint32_t key;
+    memcpy(&key, entry + key_offset, sizeof(key));
+    return key;
+}
+
+int label_top_insert(void *list, uint32_t entry_size, uint32_t key_offset,
+                     uint8_t *count, uint32_t key)
+{
+    uint8_t *entries = (uint8_t *)list;
+    uint32_t k = *count;
+
+    if (k == MAX_REGIONS &&
+        key <= entry_key(entries + (MAX_REGIONS - 1U) * entry_size, key_offset))
+        return -1;
+    if (k == MAX_REGIONS)
+        k--;
+    else
+        (*count)++;
+
+    uint32_t first = k;
+    while (first > 0 && entry_key(entries + (first - 1U) * entry_size, key_offset) < key)
+        first--;
+    memmove(entries + (first + 1U) * entry_size, entries + first * entry_size,
+            (k - first) * entry_size);
+    return (int)first;
+}
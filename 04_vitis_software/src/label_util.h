@@ -0,0 +1,42 @@
+/******************************************************************************
+ * label_util.h
+ * -------------
+ * Label bookkeeping shared by the tiled (tiler.c) and volume (volume.c)
+ * segmentations: a union-find over global labels held in LMB, and the
+ * largest-first region list both results keep.
+ *****************************************************************************/
+#ifndef LABEL_UTIL_H
+#define LABEL_UTIL_H
+
+#include <stdint.h>
+#include "platform_config.h"
+#include "watershed.h"   /* MAX_REGIONS */
+
+/**
+ * Root of label @p l (the smallest label of its set), halving the path.
+ *
+ * @param parent  Union-find table, parent[l] for 1-based labels
+ */
+uint16_t label_uf_find(uint16_t *parent, uint16_t l);
+
+/**
+ * Merge the sets of labels @p a and @p b under the smaller root.
+ */
+void label_uf_union(uint16_t *parent, uint16_t a, uint16_t b);
+
+/**
+ * Make room for an entry of size @p key in a list of at most MAX_REGIONS
+ * entries kept largest first; ties keep the earlier entry.  Smaller
+ * entries move down one slot (the last drops off a full list).
+ *
+ * @param list        MAX_REGIONS entries of @p entry_size bytes
+ * @param entry_size  Size of one entry
+ * @param key_offset  Offset of the entry's uint32_t size (area, volume)
+ * @param count       In/out: entries in the list
+ * @param key         Size of the new entry
+ * @return            Slot to fill, or -1 if the entry does not make the list
+ */
+int label_top_insert(void *list, uint32_t entry_size, uint32_t key_offset,
+                     uint8_t *count, uint32_t key);
+
+#endif /* LABEL_UTIL_H */
@@ -4,13 +4,16 @@
  * Brain Tumor Segmentation – MicroBlaze application.
  *
  * Flow:
- *   1. Initialise UART, LEDs, timer
- *   2. Load test image into BRAM
- *   3. Compute image statistics → adaptive mode selection
- *   4. Invoke HLS Otsu accelerator
- *   5. Run software watershed on HLS output (in image BRAM)
- *   6. Measure energy & print report
- *   7. Repeat for each test image
+ *   1. Initialise UART, LEDs, timers, interrupt controller
+ *   2. Stream the test images through a three-stage frame pipeline:
+ *        load   – build frame in a slot, statistics → adaptive mode
+ *        accel  – HLS Otsu accelerator (auto-restart over the slots)
+ *        label  – software watershed on the slot's mask, energy report
+ *      Loading frame k+1 and labelling frame k-1 overlap the kernel's
+ *      work on frame k.  Results are reported in ASCII or, with
+ *      TELEMETRY_BINARY, as binary telemetry records (telemetry.h).
+ *   3. Print per-stage and overall cycles per frame
+ *   4. Serve full-size frames received over the UART (frame_rx.h)
  *
  * Target: Nexys A7-100T (Artix-7 xc7a100tcsg324-1) + MicroBlaze
  *****************************************************************************/
@@ -23,6 +26,15 @@
 #include "adaptive_controller.h"
 #include "energy_analyzer.h"
 #include "watershed.h"
+#include "otsu_accel.h"
+#include "dispatcher.h"
+#include "otsu_stream.h"
+#include "frame_rx.h"
+#include "telemetry.h"
+#include "intc.h"
+#if IMAGE_USE_CDMA
+#include "cdma.h"
+#endif
 #include "uart_debug.h"
 #include "test_images.h"
 
@@ -41,132 +53,364 @@ static void led_set_mode(uint8_t mode)
     led_set(current);
 }
 
-/* ---- HLS accelerator control ---- */
-static void hls_start(uint8_t mode)
+/* ---- Pad a 16×16 thumbnail into the centre of a 128×128 frame ---- */
+static void build_test_frame(uint8_t *dst, const uint8_t *thumb, uint8_t bg)
 {
-    /* Set image pointers via s_axi_control_r */
-    REG_WRITE(XPAR_HLS_OTSU_0_R_BASEADDR, HLS_OTSU_IMG_IN_LO, IMG_INPUT_BASE);
-    REG_WRITE(XPAR_HLS_OTSU_0_R_BASEADDR, HLS_OTSU_IMG_IN_HI, 0);
-    REG_WRITE(XPAR_HLS_OTSU_0_R_BASEADDR, HLS_OTSU_IMG_OUT_LO, IMG_OUTPUT_BASE);
-    REG_WRITE(XPAR_HLS_OTSU_0_R_BASEADDR, HLS_OTSU_IMG_OUT_HI, 0);
+    memset(dst, bg, IMG_SIZE);
+    for (int y = 0; y < 16; y++) {
+        for (int x = 0; x < 16; x++) {
+            int fy = 56 + y;
+            int fx = 56 + x;
+            dst[fy * IMG_WIDTH + fx] = thumb[y * 16 + x];
+        }
+    }
+}
+
+#if HLS_OTSU_NUM_INSTANCES > 1
+/* ---- Push a batch of frames through all accelerator instances ---- */
+#define DISPATCH_BATCH_FRAMES 9
+
+static void run_dispatch_batch(void)
+{
+    static const uint8_t * const thumbs[3] = {
+        test_bright_circle_16x16, test_low_contrast_16x16, test_medium_contrast_16x16
+    };
+    static const uint8_t backgrounds[3] = { 10, 120, 50 };
+
+    uart_print_separator();
+    uart_print_uint("Dispatch batch, instances: ", HLS_OTSU_NUM_INSTANCES);
+    dispatcher_init();
 
-    /* Set processing mode via s_axi_control */
-    REG_WRITE(XPAR_HLS_OTSU_0_BASEADDR, HLS_OTSU_MODE, mode);
+    energy_timer_start();
+    uint32_t submitted = 0, collected = 0;
+    while (collected < DISPATCH_BATCH_FRAMES) {
+        /* Producer: build the next frame in a free dispatcher buffer; the
+         * instance that runs it reads it in place (no staging copy) */
+        int b;
+        if (submitted < DISPATCH_BATCH_FRAMES && (b = dispatcher_acquire()) >= 0) {
+            uint32_t k = submitted % 3;
+            uint8_t *frame = dispatcher_input(b);
+            build_test_frame(frame, thumbs[k], backgrounds[k]);
+            SwImageStats stats;
+            adaptive_compute_stats(frame, &stats);
+            if (dispatcher_submit_buffer(b, adaptive_select_mode(&stats), k) >= 0)
+                submitted++;
+        }
+
+        dispatcher_poll();
 
-    /* Start accelerator (ap_start = bit 0) via s_axi_control */
-    REG_WRITE(XPAR_HLS_OTSU_0_BASEADDR, HLS_OTSU_CONTROL, 0x01);
+        DispatchResult r;
+        while (dispatcher_collect(&r)) {
+            uart_print_uint("  Frame ", r.seq);
+            uart_print_uint("    Instance:   ", r.instance);
+            uart_print_uint("    Threshold:  ", r.result.threshold);
+            uart_print_uint("    FG pixels:  ", r.result.moments.count);
+            collected++;
+        }
+    }
+    uart_print_uint("  Batch cycles:   ", energy_timer_stop());
 }
+#endif
+
+/* =====================================================================
+ * Frame pipeline
+ *
+ *   load (CPU)   frame k+1 : build in a free slot, stats, mode decision
+ *   accel (HW)   frame k   : Otsu kernel, auto-restarted over the slots
+ *   label (CPU)  frame k-1 : watershed, SW baseline, report
+ *
+ * The accelerator runs concurrently with both CPU stages, so steady-state
+ * time per frame is max(load + label, kernel) instead of the sum of all
+ * three.  CAREFUL-class frames are probed in NORMAL first; an ambiguous
+ * probe re-submits the same slot in CAREFUL (the input is untouched) and
+ * the frame is labelled when that run returns.
+ * ===================================================================*/
+#define PIPELINE_PASSES     2   /* times the test set is streamed        */
+#define PIPELINE_LOAD_AHEAD 2   /* frames submitted but not yet labelled */
+
+typedef struct
+{
+    const char *name;
+    const uint8_t *thumb;
+    uint8_t bg;
+} TestFrame;
+
+static const TestFrame test_set[] = {
+    { "Bright Circle (High Contrast)", test_bright_circle_16x16, 10 },   /* → FAST    */
+    { "Low Contrast (Noisy)",          test_low_contrast_16x16, 120 },   /* → CAREFUL */
+    { "Medium Contrast",               test_medium_contrast_16x16, 50 }, /* → NORMAL  */
+};
+#define TEST_SET_SIZE (sizeof(test_set) / sizeof(test_set[0]))
+
+/* Per-slot bookkeeping for the frame currently held by that slot */
+typedef struct
+{
+    uint32_t frame;        /* frame number in the sequence            */
+    uint8_t mode;          /* adaptive decision, NORMAL once a probe
+                            * is kept                                 */
+    uint8_t probing;       /* NORMAL probe of a CAREFUL-class frame   */
+    uint32_t hw_cycles;    /* kernel cycles, probe + re-run           */
+    SwImageStats stats;
+} PipeFrame;
 
-static int hls_is_done(void)
+typedef struct
 {
-    uint32_t ctrl = REG_READ(XPAR_HLS_OTSU_0_BASEADDR, HLS_OTSU_CONTROL);
-    return (ctrl >> 1) & 0x01;   /* ap_done = bit 1 */
-}
+    uint32_t load;         /* CPU cycles in the load stage            */
+    uint32_t accel;        /* kernel cycles (stage counters)          */
+    uint32_t label;        /* CPU cycles in the label stage           */
+} PipeTotals;
 
-/* Timeout value: ~10ms at 100 MHz = 1,000,000 cycles */
-#define HLS_TIMEOUT_CYCLES 1000000
+static PipeFrame  pipe_frame[FRAME_SLOT_COUNT];
+static PipeTotals pipe_totals;
 
-static int hls_wait_done(void)
+static uint32_t kernel_cycles(const OtsuAccelResult *res)
 {
-    uint32_t timeout = HLS_TIMEOUT_CYCLES;
-    while (!hls_is_done()) {
-        if (--timeout == 0) {
-            uart_print("ERROR: HLS accelerator timeout!\r\n");
-            uart_print_uint("  ap_ctrl = ", REG_READ(XPAR_HLS_OTSU_0_BASEADDR, HLS_OTSU_CONTROL));
-            return -1;  /* Timeout error */
-        }
-    }
-    return 0;  /* Success */
+    uint32_t total = 0;
+    for (uint32_t s = 0; s < HLS_NUM_STAGES; s++)
+        total += res->stage_cycles[s];
+    return total;
 }
 
-static uint8_t hls_get_threshold(void)
+/* ---- Stage 1: build frame k in a free slot and hand it to the kernel ---- */
+static int pipeline_load(uint32_t k)
 {
-    /* threshold is byte 0 of result word 0 */
-    uint32_t word0 = REG_READ(XPAR_HLS_OTSU_0_BASEADDR, HLS_OTSU_RESULT_WORD0);
-    return (uint8_t)(word0 & 0xFF);
+    int slot = otsu_stream_acquire();
+    if (slot < 0)
+        return -1;
+
+    uint32_t t0 = energy_clock_now();
+    const TestFrame *tf = &test_set[k % TEST_SET_SIZE];
+    uint8_t *in = otsu_stream_input(slot);
+    build_test_frame(in, tf->thumb, tf->bg);
+
+    PipeFrame *pf = &pipe_frame[slot];
+    pf->frame = k;
+    adaptive_compute_stats(in, &pf->stats);
+    pf->mode      = adaptive_select_mode(&pf->stats);
+    pf->probing   = (pf->mode == PROCESSING_MODE_CAREFUL);
+    pf->hw_cycles = 0;
+
+    otsu_stream_submit(slot, pf->probing ? PROCESSING_MODE_NORMAL : pf->mode);
+    pipe_totals.load += energy_clock_now() - t0;
+    return 0;
 }
 
-static uint32_t hls_get_fg_pixels(void)
+/* ---- Regions of a non-empty output buffer: run-based labelling of the
+ *      kernel's row runs (HLS_OTSU_MODE_RLE), else watershed_segment() on
+ *      the mask ---- */
+static void segment_output(const StreamResult *r, const uint8_t *image,
+                           WatershedResult *ws)
 {
-    /* foreground_pixels is result word 1 */
-    return REG_READ(XPAR_HLS_OTSU_0_BASEADDR, HLS_OTSU_RESULT_WORD1);
+    if (r->result.run_count)
+        watershed_label_rle((const uint32_t *)r->mask, r->result.run_count, image,
+                            WATERSHED_CONNECTIVITY, ws);
+    else
+        watershed_segment(r->mask, image, ws);
 }
 
-static uint8_t hls_get_mode_used(void)
+#if TELEMETRY_BINARY
+/* ---- Outlines of the selected regions, traced from the label map left
+ *      by watershed_segment(); none after the moments fast path or
+ *      from the kernel's row runs ---- */
+static void send_contours(uint32_t frame, const WatershedResult *ws, int no_map)
 {
-    /* mode_used is byte 1 of result word 0 */
-    uint32_t word0 = REG_READ(XPAR_HLS_OTSU_0_BASEADDR, HLS_OTSU_RESULT_WORD0);
-    return (uint8_t)((word0 >> 8) & 0xFF);
+    static RegionContour contour;
+
+    if (no_map || !WATERSHED_HAS_LABEL_MAP)
+        return;
+    for (uint8_t k = 0; k < ws->num_regions; k++) {
+        if (!ws->regions[k].selected)
+            continue;
+        watershed_trace_contour(&ws->regions[k], &contour);
+        telemetry_send_contour(frame, &contour);
+    }
 }
+#endif
 
-/* ---- Process one image end-to-end ---- */
-static void process_image(const char *name,
-                          const uint8_t *img_data)
+/* ---- Stage 3: label and report a finished frame ----
+ * Returns 0 if the frame went back to the accelerator instead. */
+static int pipeline_label(const StreamResult *r)
 {
+    PipeFrame *pf = &pipe_frame[r->slot];
+    const OtsuAccelResult *res = &r->result;
+
+    uint32_t kcycles = kernel_cycles(res);
+    pf->hw_cycles     += kcycles;
+    pipe_totals.accel += kcycles;
+
+    if (pf->probing) {
+        pf->probing = 0;
+        pf->mode = adaptive_probe_mode(res->separability);
+        if (pf->mode == PROCESSING_MODE_CAREFUL) {
+            otsu_stream_submit(r->slot, PROCESSING_MODE_CAREFUL);
+            return 0;
+        }
+    }
+
+    uint32_t t0 = energy_clock_now();
+    led_set_mode(pf->mode);
+
+    /* SW watershed directly on the slot's output mask, region intensities
+     * from its input, then the Python model's intensity selection */
+    WatershedResult ws;
+    int from_moments = res->moments.count == 0 || WATERSHED_SINGLE_TUMOR_FASTPATH;
+    if (from_moments) {
+        /* Empty / single-tumor mask: the moments already describe it */
+        watershed_from_moments(&res->moments, &ws);
+    } else {
+        memset(&ws, 0, sizeof(ws));
+        segment_output(r, otsu_stream_input(r->slot), &ws);
+        watershed_select(&ws, pf->stats.mean, pf->stats.std_dev);
+    }
+
+    /* SW baseline for comparison (on the slot's input, still intact) */
+    uint32_t sw_cycles = energy_sw_baseline(otsu_stream_input(r->slot),
+                                            (uint8_t *)PHYS_PTR(SW_MASK_BASE));
+
+    /* Energy report: HW side is the kernel's own cycle count */
+    EnergyReport report;
+    energy_compute_report(pf->hw_cycles, sw_cycles, &report);
+    otsu_stream_release(r->slot);
+
+#if TELEMETRY_BINARY
+    telemetry_send_result(pf->frame, pf->mode, res);
+    telemetry_send_regions(pf->frame, &ws);
+    send_contours(pf->frame, &ws, from_moments || res->run_count);
+    telemetry_send_energy(pf->frame, &report);
+#else
     uart_print_separator();
+    uart_print_uint("Frame ", pf->frame);
     uart_print("Processing: ");
-    uart_print(name);
+    uart_print(test_set[pf->frame % TEST_SET_SIZE].name);
     uart_print("\r\n");
+    adaptive_print_decision(&pf->stats, pf->mode);
+    uart_print_uint("  Slot:           ", (uint32_t)r->slot);
+
+    uart_print_uint("  Threshold:      ", res->threshold);
+    uart_print_uint("  FG pixels:      ", res->moments.count);
+    uart_print_uint("  Mode used:      ", res->mode_used);
+    uart_print_uint("  Separability:   ", res->separability);
+
+    energy_print_stage_cycles(res->stage_cycles);
+
+    int16_t orient = watershed_moments_orientation(&res->moments);
+    uart_print_uint(orient < 0 ? "  Orientation:    -" : "  Orientation:    ",
+                    (uint32_t)(orient < 0 ? -orient : orient));
 
-    /* Turn on processing LED */
+    uart_print(from_moments   ? "  Region from HLS moments (watershed skipped)\r\n"
+               : res->run_count ? "  Regions from HLS row runs (watershed skipped)\r\n"
+                                : "  Regions from watershed segmentation\r\n");
+    watershed_print_summary(&ws);
+    energy_print_report(&report);
+    uart_print("  DONE.\r\n");
+#endif
+
+    pipe_totals.label += energy_clock_now() - t0;
+    return 1;
+}
+
+static void run_pipeline(uint32_t frames)
+{
+    memset(&pipe_totals, 0, sizeof(pipe_totals));
+    otsu_stream_init(0);
     led_set(LED_HEARTBEAT | LED_PROCESSING);
 
-    /* ---- Step 1: Load image ---- */
-    uart_print("  Loading image to BRAM...\r\n");
-    image_load_to_bram(img_data);
+    uint32_t t_start = energy_clock_now();
+    uint32_t loaded = 0, labelled = 0;
+    while (labelled < frames) {
+        /* Keep one frame queued behind the one in the kernel */
+        if (loaded < frames && otsu_stream_pending() < PIPELINE_LOAD_AHEAD &&
+            pipeline_load(loaded) == 0) {
+            loaded++;
+            continue;
+        }
 
-    /* ---- Step 2: Adaptive mode selection ---- */
-    SwImageStats stats;
-    adaptive_compute_stats(img_data, &stats);
-    uint8_t mode = adaptive_select_mode(&stats);
-    adaptive_print_decision(&stats, mode);
-    led_set_mode(mode);
-
-    /* ---- Step 3: Run HLS accelerator (timed) ---- */
-    uart_print("  Starting HLS accelerator...\r\n");
-    uart_print_uint("    Input addr:  0x", IMG_INPUT_BASE);
-    uart_print_uint("    Output addr: 0x", IMG_OUTPUT_BASE);
-    uart_print_uint("    Mode:        ", mode);
-    
-    energy_timer_start();
-    hls_start(mode);
-    int hls_status = hls_wait_done();
-    uint32_t hw_cycles = energy_timer_stop();
-    
-    if (hls_status != 0) {
-        uart_print("  HLS FAILED - skipping rest of processing\r\n");
-        led_set(LED_HEARTBEAT);  /* Clear processing LED */
-        return;
+        StreamResult r;
+        if (otsu_stream_collect(&r))
+            labelled += (uint32_t)pipeline_label(&r);
     }
+    uint32_t elapsed = energy_clock_now() - t_start;
 
-    /* Read HLS results */
-    uint8_t  threshold  = hls_get_threshold();
-    uint32_t fg_pixels  = hls_get_fg_pixels();
-    uint8_t  mode_used  = hls_get_mode_used();
+    StreamStats st;
+    otsu_stream_get_stats(&st);
+    otsu_stream_stop();
 
-    uart_print_uint("  Threshold:      ", threshold);
-    uart_print_uint("  FG pixels:      ", fg_pixels);
-    uart_print_uint("  Mode used:      ", mode_used);
+    /* Per-frame logs were queued; let them out before the summary */
+    uart_flush();
+    uart_print_separator();
+    uart_print("=== Pipeline Summary ===\r\n");
+    uart_print_uint("  Frames:          ", frames);
+    uart_print_uint("  Kernel runs:     ", st.frames);
+    uart_print_uint("  Load  cyc/frame: ", pipe_totals.load / frames);
+    uart_print_uint("  Accel cyc/frame: ", pipe_totals.accel / frames);
+    uart_print_uint("  Label cyc/frame: ", pipe_totals.label / frames);
+    uart_print_uint("  Sum   cyc/frame: ",
+                    (pipe_totals.load + pipe_totals.accel + pipe_totals.label) / frames);
+    uart_print_uint("  Actual cyc/frame:", elapsed / frames);
+    uart_print_uint("  UART TX dropped: ", uart_tx_overflows());
+    uart_print("========================\r\n");
 
-    /* ---- Step 4: SW watershed directly on HLS output in image BRAM ---- */
-    uart_print("  Running watershed segmentation...\r\n");
-    WatershedResult ws;
-    memset(&ws, 0, sizeof(ws));
-    watershed_segment((const uint8_t *)IMG_OUTPUT_BASE, &ws);
-    watershed_print_summary(&ws);
+    led_set(LED_HEARTBEAT | LED_DONE);
+}
 
-    /* ---- Step 5: SW baseline for comparison ---- */
-    uart_print("  Running SW baseline for comparison...\r\n");
-    uint32_t sw_cycles = energy_sw_baseline(img_data, (uint8_t *)SW_MASK_BASE);
+/* =====================================================================
+ * UART frame service
+ *
+ * Each frame is streamed into a slot by the UART ISR and submitted to the
+ * accelerator the moment its CRC checks out; this loop only labels and
+ * reports the results, blinking the heartbeat LED while it waits.
+ * ===================================================================*/
+#define HEARTBEAT_PERIOD_CYCLES (SYS_CLK_FREQ_HZ / 2U)
 
-    /* ---- Step 6: Energy report ---- */
-    EnergyReport report;
-    energy_compute_report(hw_cycles, sw_cycles, &report);
-    energy_print_report(&report);
+static void serve_uart_frames(void)
+{
+    otsu_stream_init(0);
+    frame_rx_start();
+    uart_print("Waiting for frames on UART...\r\n");
 
-    /* Done LED on */
-    led_set(LED_HEARTBEAT | LED_DONE);
-    uart_print("  DONE.\r\n");
+    uint32_t beat = energy_clock_now();
+    while (1) {
+        StreamResult r;
+        if (otsu_stream_collect(&r)) {
+            FrameRxInfo info;
+            frame_rx_info(r.slot, &info);
+
+            led_set_mode(info.mode);
+
+            WatershedResult ws;
+            memset(&ws, 0, sizeof(ws));
+            int from_moments = r.result.moments.count == 0 ||
+                               WATERSHED_SINGLE_TUMOR_FASTPATH;
+            if (from_moments) {
+                watershed_from_moments(&r.result.moments, &ws);
+            } else {
+                const uint8_t *in = otsu_stream_input(r.slot);
+                SwImageStats stats;
+                adaptive_compute_stats(in, &stats);
+                segment_output(&r, in, &ws);
+                watershed_select(&ws, stats.mean, stats.std_dev);
+            }
+            otsu_stream_release(r.slot);
+
+#if TELEMETRY_BINARY
+            telemetry_send_result(info.frame_id, info.mode, &r.result);
+            telemetry_send_regions(info.frame_id, &ws);
+            send_contours(info.frame_id, &ws, from_moments || r.result.run_count);
+#else
+            uart_print_separator();
+            uart_print_uint("UART frame ", info.frame_id);
+            uart_print_uint("  Mode:           ", info.mode);
+            uart_print_uint("  Threshold:      ", r.result.threshold);
+            uart_print_uint("  FG pixels:      ", r.result.moments.count);
+            watershed_print_summary(&ws);
+#endif
+        }
+
+        if (energy_clock_now() - beat >= HEARTBEAT_PERIOD_CYCLES) {
+            beat += HEARTBEAT_PERIOD_CYCLES;
+            led_set(REG_READ(XPAR_AXI_GPIO_0_BASEADDR, 0x00) ^ LED_HEARTBEAT);
+        }
+    }
 }
 
 /* ==================================================================== */
@@ -175,7 +419,14 @@ int main(void)
     /* ---- Initialisation ---- */
     uart_init();
     led_set(LED_HEARTBEAT);
+    intc_init();
+#if IMAGE_USE_CDMA
+    cdma_init();
+#endif
+    cpu_irq_enable();
+    uart_tx_enable_interrupt();
     image_clear_buffers();
+    energy_clock_start();
 
     uart_print("\r\n");
     uart_print("========================================\r\n");
@@ -186,52 +437,24 @@ int main(void)
 
     /*
      * NOTE: The 16×16 test images in test_images.h are for bring-up only.
-     * For full 128×128 images, load via UART or use the C arrays generated
-     * by 05_test_images/convert_to_bin.py.
+     * Full 128×128 images are sent over the UART after the test set (see
+     * frame_rx.h for the frame format), or built in from the C arrays
+     * generated by 05_test_images/convert_to_bin.py.
      *
      * Below we demonstrate the pipeline with the embedded 16×16 thumbnails.
      * In production, replace with full-size images and adjust IMG_SIZE
      * accordingly (it's already 128×128 = 16384 in platform_config.h).
      */
 
-    /* For bring-up: pad 16×16 thumbnails into 128×128 buffers.
-     * full_img lives in the image BRAM build area (CPU_IMG_BUILD_BASE)
-     * to avoid consuming LMB BRAM stack/BSS space. */
-    uint8_t * const full_img = (uint8_t *)CPU_IMG_BUILD_BASE;
-
-    /* --- Test 1: Bright circle (high contrast → FAST) --- */
-    memset(full_img, 10, IMG_SIZE);
-    for (int y = 0; y < 16; y++) {
-        for (int x = 0; x < 16; x++) {
-            /* Place thumbnail in centre of 128×128 image */
-            int fy = 56 + y;
-            int fx = 56 + x;
-            full_img[fy * IMG_WIDTH + fx] = test_bright_circle_16x16[y * 16 + x];
-        }
-    }
-    process_image("Bright Circle (High Contrast)", full_img);
+    /* --- Test set through the load / accelerate / label pipeline --- */
+    run_pipeline(PIPELINE_PASSES * TEST_SET_SIZE);
 
-    /* --- Test 2: Low contrast (→ CAREFUL) --- */
-    memset(full_img, 120, IMG_SIZE);
-    for (int y = 0; y < 16; y++) {
-        for (int x = 0; x < 16; x++) {
-            int fy = 56 + y;
-            int fx = 56 + x;
-            full_img[fy * IMG_WIDTH + fx] = test_low_contrast_16x16[y * 16 + x];
-        }
-    }
-    process_image("Low Contrast (Noisy)", full_img);
-
-    /* --- Test 3: Medium contrast (→ NORMAL) --- */
-    memset(full_img, 50, IMG_SIZE);
-    for (int y = 0; y < 16; y++) {
-        for (int x = 0; x < 16; x++) {
-            int fy = 56 + y;
-            int fx = 56 + x;
-            full_img[fy * IMG_WIDTH + fx] = test_medium_contrast_16x16[y * 16 + x];
-        }
-    }
-    process_image("Medium Contrast", full_img);
+#if HLS_OTSU_NUM_INSTANCES > 1
+    /* --- Throughput: all test frames across all accelerator instances.
+     * Frames are built in the dispatcher's image BRAM buffers, which keeps
+     * them out of LMB BRAM stack/BSS space. */
+    run_dispatch_batch();
+#endif
 
     /* ---- All done ---- */
     uart_print("\r\n");
@@ -239,14 +462,13 @@ int main(void)
     uart_print(" All tests complete.\r\n");
     uart_print("========================================\r\n");
 
-    /* Heartbeat blink loop */
-    volatile uint32_t delay;
-    while (1) {
-        led_set(LED_HEARTBEAT | LED_DONE);
-        for (delay = 0; delay < 5000000; delay++) ;
-        led_set(LED_DONE);
-        for (delay = 0; delay < 5000000; delay++) ;
-    }
+#ifdef DESKTOP_SIM
+    uart_flush();
+    return 0;
+#endif
+
+    /* ---- Frames from the host, processed as they arrive ---- */
+    serve_uart_frames();
 
     return 0;
 }
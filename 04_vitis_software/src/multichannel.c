@@ -0,0 +1,88 @@
+/******************************************************************************
+ * multichannel.c
+ * ---------------
+ * Driver for the multi-channel Otsu IP (see multichannel.h).
+ *****************************************************************************/
+#include "multichannel.h"
+#include "otsu_accel.h"      /* HLS_TIMEOUT_CYCLES */
+#include "image_loader.h"
+#include "uart_debug.h"
+
+#define MC_BASE   XPAR_HLS_OTSU_MC_0_BASEADDR
+#define MC_R_BASE XPAR_HLS_OTSU_MC_0_R_BASEADDR
+
+/* ------------------------------------------------------------------ */
+void multichannel_pack(const uint8_t *const planes[], uint8_t channels)
+{
+    /* Little-endian words: byte c of the tuple is channel c */
+    volatile uint32_t *tuples = (volatile uint32_t *)PHYS_PTR(MC_INPUT_BASE);
+    for (uint32_t i = 0; i < IMG_SIZE; i++) {
+        uint32_t t = 0;
+        for (uint32_t c = 0; c < channels && c < HLS_MC_MAX_CHANNELS; c++)
+            t |= (uint32_t)planes[c][i] << (8U * c);
+        tuples[i] = t;
+    }
+}
+
+/* ------------------------------------------------------------------ */
+static void read_result(MultiChannelResult *res)
+{
+    uint32_t thr = REG_READ(MC_BASE, HLS_MC_RESULT_THRESH);
+    uint32_t cfg = REG_READ(MC_BASE, HLS_MC_RESULT_CONFIG);
+    res->mode_used  = (uint8_t)(cfg & 0xFF);
+    res->channels   = (uint8_t)((cfg >> 8) & 0xFF);
+    res->combine    = (uint16_t)(cfg >> 16);
+    res->foreground = REG_READ(MC_BASE, HLS_MC_RESULT_FG_PIX);
+
+    for (uint32_t c = 0; c < HLS_MC_MAX_CHANNELS; c++) {
+        res->thresholds[c]     = (uint8_t)(thr >> (8U * c));
+        res->channel_pixels[c] = REG_READ(MC_BASE, HLS_MC_RESULT_CH_PIX(c));
+        res->separability[c]   = (uint16_t)(REG_READ(MC_BASE, HLS_MC_RESULT_SEPARAB(c))
+                                            >> (16U * (c % 2U)));
+    }
+    for (uint32_t s = 0; s < HLS_NUM_STAGES; s++)
+        res->stage_cycles[s] = REG_READ(MC_BASE, HLS_OTSU_RESULT_STAGE(s));
+}
+
+/* ------------------------------------------------------------------ */
+int multichannel_run(uint8_t mode, uint8_t channels, uint16_t combine,
+                     MultiChannelResult *res)
+{
+    if (channels == 0 || channels > HLS_MC_MAX_CHANNELS)
+        return -1;
+
+    REG_WRITE(MC_R_BASE, HLS_OTSU_IMG_IN_LO, MC_INPUT_BASE);
+    REG_WRITE(MC_R_BASE, HLS_OTSU_IMG_IN_HI, 0);
+    REG_WRITE(MC_R_BASE, HLS_OTSU_IMG_OUT_LO, MC_OUTPUT_BASE);
+    REG_WRITE(MC_R_BASE, HLS_OTSU_IMG_OUT_HI, 0);
+    REG_WRITE(MC_BASE, HLS_OTSU_MODE, mode);
+    REG_WRITE(MC_BASE, HLS_MC_CHANNELS, channels);
+    REG_WRITE(MC_BASE, HLS_MC_COMBINE, combine);
+    REG_WRITE(MC_BASE, HLS_OTSU_CONTROL, HLS_OTSU_AP_START);
+
+    uint32_t timeout = HLS_TIMEOUT_CYCLES;
+    while (!(REG_READ(MC_BASE, HLS_OTSU_CONTROL) & HLS_OTSU_AP_DONE)) {
+        if (--timeout == 0) {
+            uart_print("ERROR: multi-channel accelerator timeout!\r\n");
+            return -1;
+        }
+    }
+
+    read_result(res);
+    return 0;
+}
+
+/* ------------------------------------------------------------------ */
+int multichannel_segment(const uint8_t *const planes[], uint8_t channels,
+                         uint8_t mode, uint16_t combine, uint8_t *mask,
+                         MultiChannelResult *res)
+{
+    if (channels == 0 || channels > HLS_MC_MAX_CHANNELS)
+        return -1;
+
+    multichannel_pack(planes, channels);
+    if (multichannel_run(mode, channels, combine, res) != 0)
+        return -1;
+    image_copy(mask, PHYS_PTR(MC_OUTPUT_BASE), IMG_SIZE);
+    return 0;
+}
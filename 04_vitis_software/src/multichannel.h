@@ -0,0 +1,64 @@
+/******************************************************************************
+ * multichannel.h
+ * ---------------
+ * Fused thresholding of co-registered modalities (T1 / T2 / FLAIR ...) on
+ * the multi-channel Otsu IP (otsu_multichannel_top).
+ *
+ * The IP reads one 32-bit pixel tuple per beat from MC_INPUT_BASE (byte c
+ * = channel c), thresholds every channel with its own Otsu threshold and
+ * fuses the channel masks through a 16-bit lookup table (HLS_MC_LUT_*, or
+ * any other pattern), then applies the processing mode's morphology.  The
+ * single-channel CAREFUL fall-back does not apply.
+ *
+ * The IP is polled; its buffers share the stream frame slots (see
+ * MC_INPUT_BASE).
+ *****************************************************************************/
+#ifndef MULTICHANNEL_H
+#define MULTICHANNEL_H
+
+#include <stdint.h>
+#include "platform_config.h"
+
+/**
+ * Decoded result registers of the multi-channel IP.
+ */
+typedef struct
+{
+    uint8_t thresholds[HLS_MC_MAX_CHANNELS];      /* per channel, 0 if unused */
+    uint8_t mode_used;
+    uint8_t channels;                             /* channels the IP used     */
+    uint16_t combine;                             /* LUT applied              */
+    uint32_t foreground;                          /* fused mask pixels        */
+    uint32_t channel_pixels[HLS_MC_MAX_CHANNELS]; /* above threshold_c        */
+    uint16_t separability[HLS_MC_MAX_CHANNELS];   /* Otsu eta_c, Q0.16        */
+    uint32_t stage_cycles[HLS_NUM_STAGES];        /* per-stage latency        */
+} MultiChannelResult;
+
+/**
+ * Interleave @p channels planes of IMG_SIZE bytes into the IP's tuple
+ * buffer; the bytes of absent channels are zero.
+ */
+void multichannel_pack(const uint8_t *const planes[], uint8_t channels);
+
+/**
+ * Run the IP on the tuples already in MC_INPUT_BASE (e.g. a frame received
+ * interleaved) and wait for it.  The fused mask is left in MC_OUTPUT_BASE.
+ *
+ * @param mode      PROCESSING_MODE_FAST / NORMAL / CAREFUL
+ * @param channels  1 .. HLS_MC_MAX_CHANNELS
+ * @param combine   fusion LUT
+ * @param res       Output: decoded result
+ * @return          0 on success, -1 for a bad channel count or a timeout
+ */
+int multichannel_run(uint8_t mode, uint8_t channels, uint16_t combine,
+                     MultiChannelResult *res);
+
+/**
+ * multichannel_pack(), multichannel_run(), then copy the fused mask
+ * (0 / 255, IMG_SIZE bytes) to @p mask.
+ */
+int multichannel_segment(const uint8_t *const planes[], uint8_t channels,
+                         uint8_t mode, uint16_t combine, uint8_t *mask,
+                         MultiChannelResult *res);
+
+#endif /* MULTICHANNEL_H */
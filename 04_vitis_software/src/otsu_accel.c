@@ -0,0 +1,214 @@
+/******************************************************************************
+ * otsu_accel.c
+ * -------------
+ * Register-level driver for the HLS Otsu accelerator instances.
+ *****************************************************************************/
+#include "otsu_accel.h"
+#include "intc.h"
+#include "uart_debug.h"
+
+/* ---- Base address table (s_axi_control, s_axi_control_r) ---- */
+static const uint32_t ctrl_base_table[HLS_OTSU_MAX_INSTANCES] = {
+    XPAR_HLS_OTSU_0_BASEADDR,
+    XPAR_HLS_OTSU_1_BASEADDR,
+    XPAR_HLS_OTSU_2_BASEADDR,
+    XPAR_HLS_OTSU_3_BASEADDR,
+};
+
+static const uint32_t ctrl_r_base_table[HLS_OTSU_MAX_INSTANCES] = {
+    XPAR_HLS_OTSU_0_R_BASEADDR,
+    XPAR_HLS_OTSU_1_R_BASEADDR,
+    XPAR_HLS_OTSU_2_R_BASEADDR,
+    XPAR_HLS_OTSU_3_R_BASEADDR,
+};
+
+/* ---- Interrupt-mode state, shared by all handles to an instance ---- */
+static uint8_t           irq_mode[HLS_OTSU_MAX_INSTANCES];
+static volatile uint8_t  irq_done[HLS_OTSU_MAX_INSTANCES];   /* set by ISR */
+static OtsuAccelCallback done_cb[HLS_OTSU_MAX_INSTANCES];
+static void             *done_cb_ctx[HLS_OTSU_MAX_INSTANCES];
+
+/* ------------------------------------------------------------------ */
+void otsu_accel_init(OtsuAccel *acc, uint32_t index)
+{
+    acc->index       = index;
+    acc->ctrl_base   = ctrl_base_table[index];
+    acc->ctrl_r_base = ctrl_r_base_table[index];
+    acc->in_addr     = HLS_OTSU_INPUT_BASE(index);
+    acc->out_addr    = HLS_OTSU_OUTPUT_BASE(index);
+}
+
+/* ------------------------------------------------------------------ */
+void otsu_accel_set_buffers(OtsuAccel *acc, uint32_t in_addr, uint32_t out_addr)
+{
+    acc->in_addr  = in_addr;
+    acc->out_addr = out_addr;
+}
+
+/* ------------------------------------------------------------------ */
+/* ap_done ISR: acknowledge the IP, then flag the instance */
+static void otsu_accel_isr(void *ctx)
+{
+    uint32_t index = (uint32_t)(uintptr_t)ctx;
+    uint32_t base  = ctrl_base_table[index];
+    uint32_t status = REG_READ(base, HLS_OTSU_ISR);
+    REG_WRITE(base, HLS_OTSU_ISR, status);   /* toggle-on-write */
+
+    if (status & HLS_OTSU_INT_AP_DONE) {
+        irq_done[index] = 1;
+        if (done_cb[index])
+            done_cb[index](index, done_cb_ctx[index]);
+    }
+}
+
+/* ------------------------------------------------------------------ */
+void otsu_accel_enable_interrupt(const OtsuAccel *acc)
+{
+    /* The ISR is keyed by instance number, not by handle */
+    intc_connect(INTC_IRQ_HLS_OTSU(acc->index), otsu_accel_isr,
+                 (void *)(uintptr_t)acc->index);
+
+    REG_WRITE(acc->ctrl_base, HLS_OTSU_ISR,
+              REG_READ(acc->ctrl_base, HLS_OTSU_ISR));   /* drop stale status */
+    REG_WRITE(acc->ctrl_base, HLS_OTSU_IER, HLS_OTSU_INT_AP_DONE);
+    REG_WRITE(acc->ctrl_base, HLS_OTSU_GIE, 1);
+    irq_mode[acc->index] = 1;
+}
+
+/* ------------------------------------------------------------------ */
+void otsu_accel_set_callback(const OtsuAccel *acc, OtsuAccelCallback cb, void *ctx)
+{
+    done_cb[acc->index]     = 0;   /* never call a half-updated pair */
+    done_cb_ctx[acc->index] = ctx;
+    done_cb[acc->index]     = cb;
+}
+
+/* ------------------------------------------------------------------ */
+void otsu_accel_program(const OtsuAccel *acc, uint8_t mode)
+{
+    /* Set image pointers via s_axi_control_r */
+    REG_WRITE(acc->ctrl_r_base, HLS_OTSU_IMG_IN_LO, acc->in_addr);
+    REG_WRITE(acc->ctrl_r_base, HLS_OTSU_IMG_IN_HI, 0);
+    REG_WRITE(acc->ctrl_r_base, HLS_OTSU_IMG_OUT_LO, acc->out_addr);
+    REG_WRITE(acc->ctrl_r_base, HLS_OTSU_IMG_OUT_HI, 0);
+
+    /* Set processing mode via s_axi_control */
+    REG_WRITE(acc->ctrl_base, HLS_OTSU_MODE, mode);
+}
+
+/* ------------------------------------------------------------------ */
+void otsu_accel_set_threshold(const OtsuAccel *acc, uint8_t threshold)
+{
+    REG_WRITE(acc->ctrl_base, HLS_OTSU_THRESHOLD, threshold);
+}
+
+/* ------------------------------------------------------------------ */
+void otsu_accel_set_normalize(const OtsuAccel *acc, uint8_t normalize)
+{
+    REG_WRITE(acc->ctrl_base, HLS_OTSU_NORMALIZE, normalize);
+}
+
+/* ------------------------------------------------------------------ */
+void otsu_accel_start(const OtsuAccel *acc, uint8_t mode)
+{
+    otsu_accel_program(acc, mode);
+
+    /* Start accelerator (ap_start = bit 0) via s_axi_control */
+    irq_done[acc->index] = 0;
+    REG_WRITE(acc->ctrl_base, HLS_OTSU_CONTROL, HLS_OTSU_AP_START);
+}
+
+/* ------------------------------------------------------------------ */
+void otsu_accel_start_continuous(const OtsuAccel *acc)
+{
+    irq_done[acc->index] = 0;
+    REG_WRITE(acc->ctrl_base, HLS_OTSU_CONTROL,
+              HLS_OTSU_AP_START | HLS_OTSU_AUTO_RESTART);
+}
+
+/* ------------------------------------------------------------------ */
+void otsu_accel_set_auto_restart(const OtsuAccel *acc, int enable)
+{
+    /* ap_start is not re-asserted: a stopped kernel stays stopped */
+    REG_WRITE(acc->ctrl_base, HLS_OTSU_CONTROL,
+              enable ? HLS_OTSU_AUTO_RESTART : 0);
+}
+
+/* ------------------------------------------------------------------ */
+int otsu_accel_is_idle(const OtsuAccel *acc)
+{
+    return (REG_READ(acc->ctrl_base, HLS_OTSU_CONTROL) & HLS_OTSU_AP_IDLE) != 0;
+}
+
+/* ------------------------------------------------------------------ */
+int otsu_accel_is_done(const OtsuAccel *acc)
+{
+    if (irq_mode[acc->index]) {
+        if (irq_done[acc->index])
+            return 1;
+        CPU_IDLE();
+        return 0;
+    }
+
+    uint32_t ctrl = REG_READ(acc->ctrl_base, HLS_OTSU_CONTROL);
+    return (ctrl >> 1) & 0x01;   /* ap_done = bit 1 */
+}
+
+/* ------------------------------------------------------------------ */
+int otsu_accel_wait_done(const OtsuAccel *acc)
+{
+    uint32_t timeout = HLS_TIMEOUT_CYCLES;
+    while (!otsu_accel_is_done(acc)) {
+        if (--timeout == 0) {
+            uart_print("ERROR: HLS accelerator timeout!\r\n");
+            uart_print_uint("  ap_ctrl = ", REG_READ(acc->ctrl_base, HLS_OTSU_CONTROL));
+            return -1;  /* Timeout error */
+        }
+    }
+    return 0;  /* Success */
+}
+
+/* ------------------------------------------------------------------ */
+void otsu_accel_read_result(const OtsuAccel *acc, OtsuAccelResult *res)
+{
+    /* Word 0: threshold in byte 0, mode_used in byte 1, slice_ready in
+     * byte 2 */
+    uint32_t word0 = REG_READ(acc->ctrl_base, HLS_OTSU_RESULT_WORD0);
+    res->threshold   = (uint8_t)(word0 & 0xFF);
+    res->mode_used   = (uint8_t)((word0 >> 8) & 0xFF);
+    res->slice_ready = (uint8_t)((word0 >> 16) & 0xFF);
+
+    /* Word 8: separability (eta, Q0.16) in the low half, RLE run count
+     * in the high half */
+    uint32_t word8 = REG_READ(acc->ctrl_base, HLS_OTSU_RESULT_SEPARAB);
+    res->separability = (uint16_t)(word8 & 0xFFFF);
+    res->run_count    = (uint16_t)(word8 >> 16);
+
+    /* Foreground count, moments and bbox accumulated in COUNT_AND_WRITE */
+    ForegroundMoments *m = &res->moments;
+    m->count  = REG_READ(acc->ctrl_base, HLS_OTSU_RESULT_WORD1);
+    m->sum_x  = REG_READ(acc->ctrl_base, HLS_OTSU_RESULT_SUM_X);
+    m->sum_y  = REG_READ(acc->ctrl_base, HLS_OTSU_RESULT_SUM_Y);
+    m->sum_xx = REG_READ(acc->ctrl_base, HLS_OTSU_RESULT_SUM_XX);
+    m->sum_yy = REG_READ(acc->ctrl_base, HLS_OTSU_RESULT_SUM_YY);
+    m->sum_xy = REG_READ(acc->ctrl_base, HLS_OTSU_RESULT_SUM_XY);
+
+    uint32_t bbox = REG_READ(acc->ctrl_base, HLS_OTSU_RESULT_BBOX);
+    m->bbox_x0 = (uint8_t)(bbox & 0xFF);
+    m->bbox_y0 = (uint8_t)((bbox >> 8) & 0xFF);
+    m->bbox_x1 = (uint8_t)((bbox >> 16) & 0xFF);
+    m->bbox_y1 = (uint8_t)((bbox >> 24) & 0xFF);
+
+    /* Per-stage counters latched inside the kernel (excludes AXI-Lite
+     * programming and polling overhead seen by the AXI Timer) */
+    for (uint32_t s = 0; s < HLS_NUM_STAGES; s++)
+        res->stage_cycles[s] = REG_READ(acc->ctrl_base, HLS_OTSU_RESULT_STAGE(s));
+}
+
+/* ------------------------------------------------------------------ */
+void otsu_accel_add_histogram(const uint8_t *out, uint32_t hist[256])
+{
+    for (uint32_t b = 0; b < 256; b++, out += 4)
+        hist[b] += (uint32_t)out[0] | (uint32_t)out[1] << 8 |
+                   (uint32_t)out[2] << 16 | (uint32_t)out[3] << 24;
+}
@@ -0,0 +1,193 @@
+/******************************************************************************
+ * otsu_accel.h
+ * -------------
+ * Register-level driver for the HLS Otsu accelerator instances.
+ *
+ * Each instance is described by its two AXI-Lite windows (s_axi_control /
+ * s_axi_control_r) and the image buffers it reads and writes.  Up to
+ * HLS_OTSU_MAX_INSTANCES instances are supported; base addresses come
+ * from the table in otsu_accel.c (see platform_config.h).
+ *
+ * Completion is either polled from ap_ctrl or, after
+ * otsu_accel_enable_interrupt(), signalled by the ap_done interrupt: the
+ * ISR sets a per-instance flag, so waiting costs no AXI-Lite traffic and
+ * the CPU is free to do other work between start and completion.
+ *****************************************************************************/
+#ifndef OTSU_ACCEL_H
+#define OTSU_ACCEL_H
+
+#include <stdint.h>
+#include "platform_config.h"
+
+/**
+ * Raw foreground moments reported by the HLS accelerator (accumulated in
+ * COUNT_AND_WRITE, see HLS_OTSU_RESULT_SUM_X .. HLS_OTSU_RESULT_BBOX).
+ */
+typedef struct
+{
+    uint32_t count;  /* foreground pixels                     */
+    uint32_t sum_x;  /* sum of x                              */
+    uint32_t sum_y;  /* sum of y                              */
+    uint32_t sum_xx; /* sum of x*x                            */
+    uint32_t sum_yy; /* sum of y*y                            */
+    uint32_t sum_xy; /* sum of x*y                            */
+    uint8_t bbox_x0; /* bounding box (x0=y0=255 when empty)   */
+    uint8_t bbox_y0;
+    uint8_t bbox_x1;
+    uint8_t bbox_y1;
+} ForegroundMoments;
+
+/**
+ * Decoded accelerator result registers.
+ */
+typedef struct
+{
+    uint8_t threshold;                      /* threshold actually applied */
+    uint8_t mode_used;                      /* mode the kernel executed   */
+    uint8_t slice_ready;                    /* HLS_OTSU_MODE_VOLUME: the
+                                             * output is a finished slice */
+    uint16_t separability;                  /* Otsu eta, Q0.16            */
+    uint16_t run_count;                     /* runs in the output buffer
+                                             * (HLS_OTSU_MODE_RLE), 0 if
+                                             * it holds the plain mask    */
+    ForegroundMoments moments;              /* count = foreground pixels  */
+    uint32_t stage_cycles[HLS_NUM_STAGES];  /* per-stage latency          */
+} OtsuAccelResult;
+
+/**
+ * One accelerator instance.
+ */
+typedef struct
+{
+    uint32_t index;       /* instance number               */
+    uint32_t ctrl_base;   /* s_axi_control base address   */
+    uint32_t ctrl_r_base; /* s_axi_control_r base address */
+    uint32_t in_addr;     /* input image buffer (bus addr) */
+    uint32_t out_addr;    /* output mask buffer (bus addr) */
+} OtsuAccel;
+
+/**
+ * Completion callback, run from the ap_done ISR (interrupt context) after
+ * the IP's interrupt status has been acknowledged.
+ */
+typedef void (*OtsuAccelCallback)(uint32_t index, void *ctx);
+
+/* Timeout value: ~10ms at 100 MHz = 1,000,000 cycles */
+#define HLS_TIMEOUT_CYCLES 1000000
+
+/**
+ * Bind a handle to accelerator instance @p index with its default buffers
+ * (HLS_OTSU_INPUT_BASE(index) / HLS_OTSU_OUTPUT_BASE(index)).
+ *
+ * @param acc    Handle to initialise
+ * @param index  Instance number, 0 .. HLS_OTSU_NUM_INSTANCES-1
+ */
+void otsu_accel_init(OtsuAccel *acc, uint32_t index);
+
+/**
+ * Point the handle at other buffers: the kernel reads @p in_addr and
+ * writes @p out_addr (bus addresses in image BRAM) from the next
+ * otsu_accel_program() / otsu_accel_start() on, so a frame can be
+ * processed where it was built instead of being copied in first.
+ */
+void otsu_accel_set_buffers(OtsuAccel *acc, uint32_t in_addr, uint32_t out_addr);
+
+/**
+ * Switch instance @p acc to interrupt-driven completion: route its
+ * ap_done interrupt through the AXI INTC to the driver's ISR.
+ * Requires intc_init(); CPU interrupts must be enabled by the caller.
+ */
+void otsu_accel_enable_interrupt(const OtsuAccel *acc);
+
+/**
+ * Install (or, with cb = 0, remove) the completion callback of the
+ * instance.  Only used in interrupt mode.
+ */
+void otsu_accel_set_callback(const OtsuAccel *acc, OtsuAccelCallback cb, void *ctx);
+
+/**
+ * Program the buffer pointers (acc->in_addr / acc->out_addr) and mode
+ * without starting.  The kernel samples these registers when a run
+ * starts, so they may be rewritten while a run is in progress to set up
+ * the next auto-restarted run.
+ */
+void otsu_accel_program(const OtsuAccel *acc, uint8_t mode);
+
+/**
+ * Set the threshold applied by runs whose mode has HLS_OTSU_MODE_FIXED_THR
+ * (sampled at start, like the mode).
+ */
+void otsu_accel_set_threshold(const OtsuAccel *acc, uint8_t threshold);
+
+/**
+ * Set the contrast normalisation (HLS_OTSU_NORM_*) applied before the
+ * Otsu sweep, sampled at start.  With PROCESSING_MODE_AUTO the kernel
+ * picks the mode from the normalised histogram and reports it in
+ * mode_used; the threshold is on the normalised scale.
+ */
+void otsu_accel_set_normalize(const OtsuAccel *acc, uint8_t normalize);
+
+/**
+ * Program the buffer pointers and mode, then assert ap_start.
+ *
+ * @param acc    Accelerator instance
+ * @param mode   PROCESSING_MODE_FAST / NORMAL / CAREFUL, optionally
+ *               | HLS_OTSU_MODE_RLE for row runs instead of the mask,
+ *               | HLS_OTSU_MODE_FIXED_THR to skip the Otsu search,
+ *               | HLS_OTSU_MODE_HIST for the histogram only,
+ *               | HLS_OTSU_MODE_VOLUME (with _VOL_START / _VOL_FLUSH)
+ *               for one slice of a volume
+ */
+void otsu_accel_start(const OtsuAccel *acc, uint8_t mode);
+
+/**
+ * Assert ap_start with auto_restart set: after each run the kernel
+ * immediately starts again on whatever otsu_accel_program() last wrote.
+ */
+void otsu_accel_start_continuous(const OtsuAccel *acc);
+
+/**
+ * Set or clear auto_restart without touching ap_start.  Clearing it lets
+ * the current run finish and then leaves the kernel idle.
+ */
+void otsu_accel_set_auto_restart(const OtsuAccel *acc, int enable);
+
+/**
+ * @return  1 if the kernel is idle (ap_idle)
+ */
+int otsu_accel_is_idle(const OtsuAccel *acc);
+
+/**
+ * Non-blocking completion check: the ISR-set flag in interrupt mode,
+ * otherwise ap_done (which clears on read).
+ *
+ * @return  1 once the run started by otsu_accel_start() has finished
+ */
+int otsu_accel_is_done(const OtsuAccel *acc);
+
+/**
+ * Wait for completion with a HLS_TIMEOUT_CYCLES bound (spins on the
+ * completion flag in interrupt mode, on ap_ctrl otherwise).
+ *
+ * @return  0 on success, -1 on timeout
+ */
+int otsu_accel_wait_done(const OtsuAccel *acc);
+
+/**
+ * Read back the result registers of the last completed run.
+ *
+ * @param acc    Accelerator instance
+ * @param res    Output: decoded result
+ */
+void otsu_accel_read_result(const OtsuAccel *acc, OtsuAccelResult *res);
+
+/**
+ * Add the histogram written by a HLS_OTSU_MODE_HIST run (256 little-endian
+ * uint32_t counts, HLS_OTSU_HIST_BYTES) to @p hist.
+ *
+ * @param out    The run's output buffer (CPU pointer)
+ * @param hist   In/out: 256 bin counts
+ */
+void otsu_accel_add_histogram(const uint8_t *out, uint32_t hist[256]);
+
+#endif /* OTSU_ACCEL_H */
@@ -0,0 +1,244 @@
+/******************************************************************************
+ * otsu_stream.c
+ * --------------
+ * Continuous streaming through one HLS Otsu instance using auto_restart.
+ *
+ * Slots move FREE -> FILLING -> QUEUED -> RUNNING -> DONE -> COLLECTED ->
+ * FREE.  Submitted slots are recorded in `order` by sequence number;
+ * three cursors walk it:
+ *   collect_seq <= handed_seq <= submit_seq
+ * [handed_seq, submit_seq) are queued and not yet programmed into the
+ * kernel.  At most two slots are handed at once: run_slot (in the kernel)
+ * and next_slot (in the argument registers, picked up by auto_restart).
+ *
+ * State shared with the ISR is only changed with CPU interrupts disabled.
+ *****************************************************************************/
+#include "otsu_stream.h"
+#include "intc.h"
+#include "uart_debug.h"
+#include <string.h>
+
+#define NO_SLOT (-1)
+
+typedef enum
+{
+    SLOT_FREE = 0,
+    SLOT_FILLING,
+    SLOT_QUEUED,
+    SLOT_RUNNING,
+    SLOT_DONE,
+    SLOT_COLLECTED
+} SlotState;
+
+typedef struct
+{
+    volatile uint8_t state;
+    uint8_t mode;
+    uint32_t seq;
+    OtsuAccelResult result;   /* written by the ISR before state = DONE */
+} StreamSlot;
+
+static OtsuAccel   acc;       /* in_addr / out_addr follow the programmed slot */
+static StreamSlot  slots[FRAME_SLOT_COUNT];
+static int         order[FRAME_SLOT_COUNT];
+static StreamStats stats;
+
+static uint32_t submit_seq;
+static uint32_t handed_seq;
+static uint32_t collect_seq;
+static volatile int run_slot;
+static volatile int next_slot;
+
+/* ------------------------------------------------------------------ */
+static void program_slot(int s)
+{
+    otsu_accel_set_buffers(&acc, FRAME_SLOT_IN(s), FRAME_SLOT_OUT(s));
+    otsu_accel_program(&acc, slots[s].mode);
+}
+
+/*
+ * Put the oldest queued slot into the argument registers for the next
+ * auto-restarted run, or let the kernel drain if nothing is queued.
+ * Called with interrupts disabled (or from the ISR) while a run is active
+ * and next_slot is empty.
+ */
+static void arm_next(void)
+{
+    if (handed_seq != submit_seq) {
+        int s = order[handed_seq % FRAME_SLOT_COUNT];
+        handed_seq++;
+        program_slot(s);
+        next_slot = s;
+        otsu_accel_set_auto_restart(&acc, 1);
+    } else {
+        otsu_accel_set_auto_restart(&acc, 0);
+    }
+}
+
+/* ------------------------------------------------------------------ */
+/* ap_done callback (interrupt context) */
+static void stream_on_done(uint32_t index, void *ctx)
+{
+    (void)index;
+    (void)ctx;
+
+    int r = run_slot;
+    if (r == NO_SLOT)
+        return;
+
+    /* The auto-restarted run overwrites the result registers when it
+     * finishes, so latch them now */
+    otsu_accel_read_result(&acc, &slots[r].result);
+    slots[r].state = SLOT_DONE;
+    stats.frames++;
+
+    int n = next_slot;
+    next_slot = NO_SLOT;
+    run_slot  = n;
+    if (n == NO_SLOT) {
+        stats.drains++;
+        return;
+    }
+
+    slots[n].state = SLOT_RUNNING;
+    if (otsu_accel_is_idle(&acc)) {
+        /* auto_restart was re-armed after the kernel had already stopped */
+        otsu_accel_start(&acc, slots[n].mode);
+        stats.kicks++;
+    } else {
+        stats.auto_restarts++;
+    }
+    arm_next();
+}
+
+/* ------------------------------------------------------------------ */
+void otsu_stream_init(uint32_t index)
+{
+    memset(slots, 0, sizeof(slots));
+    memset(&stats, 0, sizeof(stats));
+    submit_seq  = 0;
+    handed_seq  = 0;
+    collect_seq = 0;
+    run_slot    = NO_SLOT;
+    next_slot   = NO_SLOT;
+
+    otsu_accel_init(&acc, index);
+    otsu_accel_enable_interrupt(&acc);
+    otsu_accel_set_callback(&acc, stream_on_done, 0);
+}
+
+/* ------------------------------------------------------------------ */
+void otsu_stream_stop(void)
+{
+    uint32_t timeout = HLS_TIMEOUT_CYCLES;
+    while (run_slot != NO_SLOT) {
+        CPU_IDLE();
+        if (--timeout == 0) {
+            uart_print("ERROR: stream drain timeout!\r\n");
+            otsu_accel_set_auto_restart(&acc, 0);
+            break;
+        }
+    }
+    otsu_accel_set_callback(&acc, 0, 0);
+    memset(slots, 0, sizeof(slots));
+    submit_seq = handed_seq = collect_seq = 0;
+    run_slot = next_slot = NO_SLOT;
+}
+
+/* ------------------------------------------------------------------ */
+int otsu_stream_acquire(void)
+{
+    int slot = -1;
+
+    uint32_t irq = cpu_irq_save();
+    for (int s = 0; s < FRAME_SLOT_COUNT; s++) {
+        if (slots[s].state == SLOT_FREE) {
+            slots[s].state = SLOT_FILLING;
+            slot = s;
+            break;
+        }
+    }
+    cpu_irq_restore(irq);
+
+    return slot;
+}
+
+/* ------------------------------------------------------------------ */
+uint8_t *otsu_stream_input(int slot)
+{
+    return (uint8_t *)PHYS_PTR(FRAME_SLOT_IN(slot));
+}
+
+/* ------------------------------------------------------------------ */
+void otsu_stream_submit(int slot, uint8_t mode)
+{
+    uint32_t irq = cpu_irq_save();
+
+    if (OTSU_STREAM_RLE)
+        mode |= HLS_OTSU_MODE_RLE;
+    slots[slot].mode  = mode;
+    slots[slot].seq   = submit_seq;
+    slots[slot].state = SLOT_QUEUED;
+    order[submit_seq % FRAME_SLOT_COUNT] = slot;
+    submit_seq++;
+
+    if (run_slot == NO_SLOT) {
+        /* Kernel idle: one explicit start, auto_restart takes over */
+        handed_seq++;
+        program_slot(slot);
+        slots[slot].state = SLOT_RUNNING;
+        run_slot = slot;
+        otsu_accel_start(&acc, mode);
+        stats.kicks++;
+        arm_next();
+    } else if (next_slot == NO_SLOT) {
+        arm_next();
+    }
+
+    cpu_irq_restore(irq);
+}
+
+/* ------------------------------------------------------------------ */
+int otsu_stream_collect(StreamResult *out)
+{
+    int ready = 0;
+
+    uint32_t irq = cpu_irq_save();
+    if (collect_seq != submit_seq) {
+        int s = order[collect_seq % FRAME_SLOT_COUNT];
+        if (slots[s].state == SLOT_DONE) {
+            out->seq    = slots[s].seq;
+            out->slot   = s;
+            out->mask   = (const uint8_t *)PHYS_PTR(FRAME_SLOT_OUT(s));
+            out->result = slots[s].result;
+            slots[s].state = SLOT_COLLECTED;
+            collect_seq++;
+            ready = 1;
+        }
+    }
+    cpu_irq_restore(irq);
+
+    if (!ready)
+        CPU_IDLE();
+    return ready;
+}
+
+/* ------------------------------------------------------------------ */
+void otsu_stream_release(int slot)
+{
+    slots[slot].state = SLOT_FREE;
+}
+
+/* ------------------------------------------------------------------ */
+uint32_t otsu_stream_pending(void)
+{
+    return submit_seq - collect_seq;
+}
+
+/* ------------------------------------------------------------------ */
+void otsu_stream_get_stats(StreamStats *out)
+{
+    uint32_t irq = cpu_irq_save();
+    *out = stats;
+    cpu_irq_restore(irq);
+}
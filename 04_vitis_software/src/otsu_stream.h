@@ -0,0 +1,116 @@
+/******************************************************************************
+ * otsu_stream.h
+ * --------------
+ * Continuous streaming through one HLS Otsu instance using auto_restart.
+ *
+ * Frames live in FRAME_SLOT_COUNT (input, output) slots.  The producer
+ * fills a free slot in place and submits it; the consumer collects
+ * results in submission order and releases each slot once it has finished
+ * with the mask.
+ *
+ * The kernel is started once with auto_restart set.  While it runs frame
+ * k, the ap_done ISR has already programmed the argument registers with
+ * slot k+1, so each completion rolls straight into the next run without
+ * an ap_start handshake.  If the producer falls behind, auto_restart is
+ * cleared, the kernel drains and idles, and the next submit restarts it.
+ *
+ * Requires interrupt-driven completion (intc_init(), CPU interrupts on).
+ * acquire / submit / release may also be called from interrupt context,
+ * so a receiver ISR can feed the stream directly (see frame_rx.h).
+ *****************************************************************************/
+#ifndef OTSU_STREAM_H
+#define OTSU_STREAM_H
+
+#include <stdint.h>
+#include "platform_config.h"
+#include "otsu_accel.h"
+
+/*
+ * 1 = every frame is submitted with HLS_OTSU_MODE_RLE: the slot's output
+ * buffer receives the kernel's row runs (result.run_count of them) instead
+ * of the mask, unless the mask has too many runs.  Callers may also OR
+ * HLS_OTSU_MODE_RLE into the mode of individual frames.
+ */
+#ifndef OTSU_STREAM_RLE
+#define OTSU_STREAM_RLE 0
+#endif
+
+/**
+ * One collected frame.
+ */
+typedef struct
+{
+    uint32_t seq;           /* submission sequence number              */
+    int slot;               /* slot to pass to otsu_stream_release()   */
+    const uint8_t *mask;    /* output mask in the slot, or its row runs
+                             * if result.run_count is non-zero         */
+    OtsuAccelResult result; /* result registers latched by the ISR     */
+} StreamResult;
+
+/**
+ * Streaming counters.
+ */
+typedef struct
+{
+    uint32_t frames;        /* frames completed                        */
+    uint32_t auto_restarts; /* runs started by auto_restart            */
+    uint32_t kicks;         /* runs started with an explicit ap_start  */
+    uint32_t drains;        /* times the kernel ran out of input       */
+} StreamStats;
+
+/**
+ * Take over accelerator instance @p index for streaming.
+ */
+void otsu_stream_init(uint32_t index);
+
+/**
+ * Stop streaming: wait until every submitted frame has run, then detach
+ * the ISR hook.  Results not yet collected are discarded.
+ */
+void otsu_stream_stop(void);
+
+/**
+ * Claim a free slot for the producer.
+ *
+ * @return  Slot number, or -1 if every slot is queued, running or
+ *          waiting to be released
+ */
+int otsu_stream_acquire(void);
+
+/**
+ * @return  Input buffer of @p slot (IMG_SIZE bytes) for in-place filling
+ */
+uint8_t *otsu_stream_input(int slot);
+
+/**
+ * Queue a filled slot for processing in @p mode.
+ *
+ * A collected slot may also be submitted again instead of released: the
+ * kernel never writes the input buffer, so this re-runs the same frame
+ * (e.g. in a different mode).
+ */
+void otsu_stream_submit(int slot, uint8_t mode);
+
+/**
+ * Fetch the next finished frame in submission order (non-blocking).
+ *
+ * @return  1 if @p out was filled, 0 if the oldest frame is not done yet
+ */
+int otsu_stream_collect(StreamResult *out);
+
+/**
+ * Return a collected slot to the free pool.
+ */
+void otsu_stream_release(int slot);
+
+/**
+ * @return  Frames submitted but not yet collected
+ */
+uint32_t otsu_stream_pending(void);
+
+/**
+ * Copy the streaming counters.
+ */
+void otsu_stream_get_stats(StreamStats *stats);
+
+#endif /* OTSU_STREAM_H */
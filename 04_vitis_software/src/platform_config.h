@@ -18,11 +18,59 @@
 #define XPAR_AXI_UARTLITE_0_BASEADDR 0x40600000U
 #define XPAR_AXI_GPIO_0_BASEADDR 0x40000000U
 #define XPAR_AXI_TIMER_0_BASEADDR 0x41C00000U
+#define XPAR_AXI_INTC_0_BASEADDR 0x41200000U
+
+/* AXI INTC input lines (concat order in the block design) */
+#define INTC_NUM_IRQS 8
+#define INTC_IRQ_HLS_OTSU(n) (n)   /* Otsu instance n 'interrupt' output */
+#define INTC_IRQ_CDMA 4            /* AXI CDMA cdma_introut              */
+#define INTC_IRQ_UART 5            /* AXI UART Lite interrupt            */
 
 /* HLS Otsu IP has TWO AXI-Lite slave interfaces: */
 #define XPAR_HLS_OTSU_0_BASEADDR   0x44A00000U  /* s_axi_control  */
 #define XPAR_HLS_OTSU_0_R_BASEADDR 0x44A10000U  /* s_axi_control_r */
 
+/*
+ * Additional accelerator instances (multi-kernel builds, typically with
+ * HIST_IMPL_BRAM).  Each instance occupies a 128 KB window: control at +0,
+ * control_r at +64 KB.  Only the first HLS_OTSU_NUM_INSTANCES are used.
+ */
+#define XPAR_HLS_OTSU_1_BASEADDR   0x44A20000U
+#define XPAR_HLS_OTSU_1_R_BASEADDR 0x44A30000U
+#define XPAR_HLS_OTSU_2_BASEADDR   0x44A40000U
+#define XPAR_HLS_OTSU_2_R_BASEADDR 0x44A50000U
+#define XPAR_HLS_OTSU_3_BASEADDR   0x44A60000U
+#define XPAR_HLS_OTSU_3_R_BASEADDR 0x44A70000U
+
+#define HLS_OTSU_MAX_INSTANCES 4
+#ifndef HLS_OTSU_NUM_INSTANCES
+#define HLS_OTSU_NUM_INSTANCES 1   /* instances present in the block design */
+#endif
+
+/*
+ * Optional multi-channel Otsu IP (otsu_multichannel_top, run_hls.tcl with
+ * MULTICHANNEL 1): same two-window layout, polled (no interrupt line).
+ */
+#define XPAR_HLS_OTSU_MC_0_BASEADDR   0x44AA0000U  /* s_axi_control  */
+#define XPAR_HLS_OTSU_MC_0_R_BASEADDR 0x44AB0000U  /* s_axi_control_r */
+
+/*
+ * Optional AXI CDMA (simple mode, 32-bit data width) for BRAM-to-BRAM
+ * image moves.  Its master port only reaches the image BRAM banks
+ * (CDMA_REGION_*), not MicroBlaze local memory.
+ */
+#define XPAR_AXI_CDMA_0_BASEADDR   0x44A80000U
+#define CDMA_REGION_BASE           0x80000000U
+#define CDMA_REGION_SIZE           0x00060000U   /* banks 0..2 */
+
+/*
+ * 1 = image_loader routes BRAM-to-BRAM copies and buffer clears through
+ * the CDMA (cdma_init() must have run), 0 = CPU copies only.
+ */
+#ifndef IMAGE_USE_CDMA
+#define IMAGE_USE_CDMA 0
+#endif
+
 /* =====================================================================
  * HLS Otsu accelerator – s_axi_control register offsets
  * (mode, result, ap_ctrl – from xotsu_threshold_top_hw.h)
@@ -37,26 +85,126 @@
 #define HLS_OTSU_ISR              0x0C  /* interrupt status register        */
 #define HLS_OTSU_MODE             0x10  /* mode (bits 7:0, R/W)             */
 
+/* Mode register bit 7: write the mask as row runs (MODE_OUTPUT_RLE) */
+#define HLS_OTSU_MODE_RLE         (1U << 7)
+#define HLS_OTSU_RLE_RUN_BYTES    4U   /* x0, length, y, 0 per run        */
+
+/* Mode register bits 6, 5: apply HLS_OTSU_THRESHOLD instead of Otsu
+ * (MODE_FIXED_THRESHOLD) / write only the histogram (MODE_OUTPUT_HIST) */
+#define HLS_OTSU_MODE_FIXED_THR   (1U << 6)
+#define HLS_OTSU_MODE_HIST        (1U << 5)
+#define HLS_OTSU_HIST_BYTES       1024U  /* 256 x uint32 counts           */
+#define HLS_OTSU_THRESHOLD        0x18  /* fixed_threshold (bits 7:0, R/W) */
+
+/* Contrast normalisation before the Otsu sweep (ignored with the FIXED_THR,
+ * HIST and VOLUME bits); mode 3 lets the kernel pick the mode afterwards */
+#define HLS_OTSU_NORMALIZE        0x20  /* normalize (bits 7:0, R/W)       */
+#define HLS_OTSU_NORM_NONE        0U
+#define HLS_OTSU_NORM_STRETCH     1U   /* min / max stretch               */
+#define HLS_OTSU_NORM_EQUALIZE    2U   /* histogram equalisation          */
+
+/* Mode register bits 4..2: slice-streaming 3x3x3 morphology (MODE_VOLUME),
+ * first slice of a volume, flush call without a slice.  The result is
+ * for the slice HLS_OTSU_VOLUME_LAG(mode) calls back (slice_ready). */
+#define HLS_OTSU_MODE_VOLUME      (1U << 4)
+#define HLS_OTSU_MODE_VOL_START   (1U << 3)
+#define HLS_OTSU_MODE_VOL_FLUSH   (1U << 2)
+#define HLS_OTSU_VOLUME_LAG(mode) ((mode) == 2U ? 4U : (mode) == 1U ? 2U : 0U)
+
+/* ap_ctrl bits */
+#define HLS_OTSU_AP_START         (1U << 0)
+#define HLS_OTSU_AP_DONE          (1U << 1)  /* clear-on-read */
+#define HLS_OTSU_AP_IDLE          (1U << 2)
+#define HLS_OTSU_AP_READY         (1U << 3)
+#define HLS_OTSU_AUTO_RESTART     (1U << 7)
+
+/* IER / ISR bits (ISR is toggle-on-write) */
+#define HLS_OTSU_INT_AP_DONE      (1U << 0)
+#define HLS_OTSU_INT_AP_READY     (1U << 1)
+
+/*
+ * Completion signalling: 1 = ap_done interrupt through the AXI INTC sets a
+ * per-instance flag (no AXI-Lite polling while the kernel runs), 0 = poll
+ * the ap_ctrl register.
+ */
+#ifndef OTSU_ACCEL_USE_IRQ
+#define OTSU_ACCEL_USE_IRQ 1
+#endif
+
 /*
  * Result struct layout (after our fix):
  *   Byte 0: threshold (uint8)
  *   Byte 1: mode_used (uint8)
- *   Byte 2-3: reserved padding
+ *   Byte 2: slice_ready (uint8, HLS_OTSU_MODE_VOLUME)
+ *   Byte 3: reserved padding
  *   Byte 4-7: foreground_pixels (uint32)
+ *   Byte 8-27: foreground moments sum_x, sum_y, sum_xx, sum_yy, sum_xy
+ *   Byte 28-31: foreground bbox x0, y0, x1, y1 (uint8 each)
+ *   Byte 32-33: separability eta (uint16, Q0.16)
+ *   Byte 34-35: run_count (uint16, RLE runs written, 0 = plain mask)
+ *   Byte 36-67: stage_cycles[8] (uint32 each)
  *
- * HLS maps this to s_axilite as two 32-bit registers:
- *   Word 0: [7:0]=threshold, [15:8]=mode_used, [31:16]=reserved
+ * HLS maps this to s_axilite as consecutive 32-bit registers:
+ *   Word 0: [7:0]=threshold, [15:8]=mode_used, [23:16]=slice_ready,
+ *           [31:24]=reserved
  *   Word 1: foreground_pixels
+ *   Word 2..6: sum_x, sum_y, sum_xx, sum_yy, sum_xy
+ *   Word 7: [7:0]=bbox_x0, [15:8]=bbox_y0, [23:16]=bbox_x1, [31:24]=bbox_y1
+ *   Word 8: [15:0]=separability, [31:16]=run_count
+ *   Word 9..16: per-stage cycle counts (read-in, histogram, sweep, adaptive,
+ *               threshold, open, close, write-out)
  */
 #define HLS_OTSU_RESULT_WORD0     0x30  /* result word 0: threshold + mode_used */
 #define HLS_OTSU_RESULT_WORD1     0x34  /* result word 1: foreground_pixels     */
-#define HLS_OTSU_RESULT_VLD       0x3C  /* result valid flag (R/COR)            */
+#define HLS_OTSU_RESULT_SUM_X     0x38  /* result word 2: sum of x              */
+#define HLS_OTSU_RESULT_SUM_Y     0x3C  /* result word 3: sum of y              */
+#define HLS_OTSU_RESULT_SUM_XX    0x40  /* result word 4: sum of x*x            */
+#define HLS_OTSU_RESULT_SUM_YY    0x44  /* result word 5: sum of y*y            */
+#define HLS_OTSU_RESULT_SUM_XY    0x48  /* result word 6: sum of x*y            */
+#define HLS_OTSU_RESULT_BBOX      0x4C  /* result word 7: packed bounding box   */
+#define HLS_OTSU_RESULT_SEPARAB   0x50  /* result word 8: separability (Q0.16) */
+                                        /*   and run_count in bits 31:16        */
+#define HLS_OTSU_RESULT_STAGE0    0x54  /* result word 9..16: stage_cycles[]    */
+#define HLS_OTSU_RESULT_VLD       0x78  /* result valid flag (R/COR)            */
+
+/* Per-stage cycle counters (order matches STAGE_* in otsu_threshold.h) */
+#define HLS_NUM_STAGES            8
+#define HLS_OTSU_RESULT_STAGE(s)  (HLS_OTSU_RESULT_STAGE0 + 4U * (s))
 
 /* Legacy aliases for backwards compatibility */
 #define HLS_OTSU_RESULT_THRESH    HLS_OTSU_RESULT_WORD0
 #define HLS_OTSU_RESULT_FG_PIX    HLS_OTSU_RESULT_WORD1
 #define HLS_OTSU_RESULT_MODE_USED HLS_OTSU_RESULT_WORD0  /* mode_used is in byte 1 */
 
+/* =====================================================================
+ * Multi-channel Otsu IP – s_axi_control register offsets
+ * (from xotsu_multichannel_top_hw.h; ap_ctrl, interrupt registers, mode,
+ * result valid and the s_axi_control_r pointers as for the Otsu IP)
+ *
+ * Result words (McResult in otsu_multichannel.h):
+ *   Word 0: thresholds of channels 0..3, one per byte
+ *   Word 1: [7:0]=mode_used, [15:8]=channels, [31:16]=combine
+ *   Word 2: foreground_pixels of the fused mask
+ *   Word 3..6: channel_pixels[0..3] (above the channel's threshold)
+ *   Word 7..8: separability of channels 0, 1 / 2, 3 (Q0.16, low half first)
+ *   Word 9..16: per-stage cycle counts (as HLS_OTSU_RESULT_STAGE(s))
+ * ===================================================================*/
+#define HLS_MC_MAX_CHANNELS       4
+#define HLS_MC_CHANNELS           0x18  /* channels (bits 7:0, R/W)          */
+#define HLS_MC_COMBINE            0x20  /* combine LUT (bits 15:0, R/W)      */
+#define HLS_MC_RESULT_THRESH      0x30  /* result word 0                     */
+#define HLS_MC_RESULT_CONFIG      0x34  /* result word 1                     */
+#define HLS_MC_RESULT_FG_PIX      0x38  /* result word 2                     */
+#define HLS_MC_RESULT_CH_PIX(c)   (0x3CU + 4U * (c))  /* words 3..6          */
+#define HLS_MC_RESULT_SEPARAB(c)  (0x4CU + 4U * ((c) / 2U)) /* words 7..8    */
+
+/* Combine LUT presets: bit v is the fused output when the channels above
+ * their thresholds are the set bits of v */
+#define HLS_MC_LUT_AND(n)         (1U << ((1U << (n)) - 1U))
+#define HLS_MC_LUT_OR             0xFFFEU
+#define HLS_MC_LUT_MAJORITY3      0x00E8U   /* 2 of 3 */
+#define HLS_MC_LUT_MAJORITY4      0xE880U   /* 3 of 4 */
+
 /* =====================================================================
  * HLS Otsu accelerator – s_axi_control_r register offsets
  * (img_in / img_out pointers – from xotsu_threshold_top_hw.h)
@@ -80,6 +228,14 @@
 #define SYS_CLK_FREQ_HZ 100000000U /* 100 MHz system clock       */
 #define UART_BAUD_RATE 115200U     /* UART baud rate             */
 
+/*
+ * 1 = per-frame results go out as binary telemetry records (telemetry.h,
+ * decoded on the host by host/telemetry_decode.cpp), 0 = ASCII reports.
+ */
+#ifndef TELEMETRY_BINARY
+#define TELEMETRY_BINARY 0
+#endif
+
 /* =====================================================================
  * LED bit positions (active-high via AXI GPIO)
  * ===================================================================*/
@@ -90,30 +246,114 @@
 #define LED_DONE (1U << 4)
 
 /* =====================================================================
- * Memory map – image BRAM (128 KB at 0x80000000, AXI-accessible)
+ * Memory map – image BRAM (AXI-accessible)
  *
- * Layout (total 112 KB used of 128 KB):
+ *   0x80000000  bank 0: working buffers (below)
+ *   0x80020000  bank 1: per-instance buffers (ACCEL_POOL_BASE)
+ *   0x80040000  bank 2: frame pipeline / stream slots (FRAME_SLOT_BASE)
+ *
+ * Bank 0 (128 KB at 0x80000000)
+ *
+ * Layout (total 128 KB):
  *   +0x00000 (16 KB)  input image buffer
  *   +0x04000 (16 KB)  HLS output mask
  *   +0x08000 (16 KB)  SW baseline result
- *   +0x0C000 (32 KB)  watershed BFS queue  – uint16_t[16384]
- *   +0x14000 (16 KB)  watershed label map
- *   +0x18000 (16 KB)  CPU thumbnail build buffer
+ *   +0x0C000 (32 KB)  watershed label map  – uint16_t[16384]
+ *   +0x14000 (16 KB)  watershed union-find table, then region areas
+ *                     – uint16_t[8192]
+ *   +0x18000 (32 KB)  dispatcher frame buffers 0, 1 / volume slice labels
  * ===================================================================*/
 #define IMG_INPUT_BASE       0x80000000U
 #define IMG_OUTPUT_BASE      (IMG_INPUT_BASE       + IMG_SIZE)
 #define SW_MASK_BASE         (IMG_OUTPUT_BASE      + IMG_SIZE)
-#define WATERSHED_QUEUE_BASE (SW_MASK_BASE         + IMG_SIZE)
-#define WATERSHED_LABEL_BASE (WATERSHED_QUEUE_BASE + (IMG_SIZE * 2U))
-#define CPU_IMG_BUILD_BASE   (WATERSHED_LABEL_BASE + IMG_SIZE)
+#define WATERSHED_LABEL_BASE (SW_MASK_BASE         + IMG_SIZE)
+#define WATERSHED_EQUIV_BASE (WATERSHED_LABEL_BASE + (IMG_SIZE * 2U))
+
+/*
+ * Per-instance accelerator buffers.  Instance 0 uses the input / output
+ * buffers above; instances 1..3 use (input, output) pairs in a second
+ * 128 KB image BRAM bank at ACCEL_POOL_BASE, which must be present in the
+ * block design when HLS_OTSU_NUM_INSTANCES > 1.
+ *
+ *   +0x00000 (16 KB)  instance 1 input     +0x04000 (16 KB)  instance 1 output
+ *   +0x08000 (16 KB)  instance 2 input     +0x0C000 (16 KB)  instance 2 output
+ *   +0x10000 (16 KB)  instance 3 input     +0x14000 (16 KB)  instance 3 output
+ *   +0x18000 (32 KB)  dispatcher frame buffers 2, 3
+ */
+#define ACCEL_POOL_BASE      0x80020000U
+#define HLS_OTSU_INPUT_BASE(n)  ((n) == 0 ? IMG_INPUT_BASE : \
+                                 ACCEL_POOL_BASE + ((n) - 1U) * 2U * IMG_SIZE)
+#define HLS_OTSU_OUTPUT_BASE(n) ((n) == 0 ? IMG_OUTPUT_BASE : \
+                                 HLS_OTSU_INPUT_BASE(n) + IMG_SIZE)
+
+/*
+ * Zero-copy dispatcher frame buffers: the producer builds a frame here and
+ * the kernel reads it in place (dispatcher_acquire / dispatcher_submit_buffer).
+ * Buffers 2 and 3 are in the ACCEL_POOL_BASE bank, so single-instance
+ * builds only have 0 and 1.
+ */
+#define DISPATCH_FRAME_COUNT   (HLS_OTSU_NUM_INSTANCES > 1 ? 4 : 2)
+#define DISPATCH_FRAME_BASE(k) ((k) < 2 ? \
+    WATERSHED_EQUIV_BASE + IMG_SIZE + (uint32_t)(k) * IMG_SIZE : \
+    ACCEL_POOL_BASE + 6U * IMG_SIZE + ((uint32_t)(k) - 2U) * IMG_SIZE)
+
+/* Labels of the previous slice (uint16_t[IMG_SIZE]) while volume.c
+ * streams a volume through instance 0; no dispatcher frames are in
+ * flight then, so it takes frame buffers 0 and 1. */
+#define VOLUME_PREV_LABEL_BASE DISPATCH_FRAME_BASE(0)
+
+/*
+ * Frame slots for continuous streaming (otsu_stream.c): (input, output)
+ * pairs in a third 128 KB image BRAM bank.  Each slot is filled by the
+ * producer in place and handed to the accelerator by address.
+ *
+ *   +0x00000 slot 0 input   +0x04000 slot 0 output
+ *   +0x08000 slot 1 input   +0x0C000 slot 1 output   ... up to slot 3
+ */
+#define FRAME_SLOT_BASE      0x80040000U
+#define FRAME_SLOT_COUNT     4
+#define FRAME_SLOT_IN(k)     (FRAME_SLOT_BASE + (uint32_t)(k) * 2U * IMG_SIZE)
+#define FRAME_SLOT_OUT(k)    (FRAME_SLOT_IN(k) + IMG_SIZE)
+
+/* Multi-channel IP buffers: 64 KB of pixel tuples (one uint32 per pixel,
+ * byte c = channel c) over frame slots 0 and 1, the fused mask in slot 2's
+ * input.  Not usable while otsu_stream.c owns the slots. */
+#define MC_INPUT_BASE        FRAME_SLOT_IN(0)
+#define MC_OUTPUT_BASE       FRAME_SLOT_IN(2)
 
 /* =====================================================================
- * Register access helpers
+ * Register / memory access helpers
+ *
+ * PHYS_PTR() turns a bus address from the map above into a CPU pointer;
+ * BUS_ADDR() is its inverse (0 for memory that is not on the AXI bus).
+ * In desktop builds (DESKTOP_SIM) registers and image BRAM are backed by
+ * the simulated platform in sim/sim_platform.c.
  * ===================================================================*/
+#ifndef DESKTOP_SIM
 #define REG_WRITE(base, offset, val) \
     (*(volatile uint32_t *)((base) + (offset)) = (val))
 
 #define REG_READ(base, offset) \
     (*(volatile uint32_t *)((base) + (offset)))
 
+#define PHYS_PTR(addr) ((void *)(uintptr_t)(addr))
+#define BUS_ADDR(ptr)  ((uint32_t)(uintptr_t)(ptr))
+
+/* One iteration of a wait loop that only polls local memory */
+#define CPU_IDLE() do { } while (0)
+#else
+#include "sim_platform.h"
+
+#define REG_WRITE(base, offset, val) \
+    sim_reg_write((uint32_t)(base) + (uint32_t)(offset), (uint32_t)(val))
+
+#define REG_READ(base, offset) \
+    sim_reg_read((uint32_t)(base) + (uint32_t)(offset))
+
+#define PHYS_PTR(addr) sim_phys_ptr((uint32_t)(addr))
+#define BUS_ADDR(ptr)  sim_bus_addr((const void *)(ptr))
+
+#define CPU_IDLE() sim_advance(SIM_IDLE_CYCLES)
+#endif
+
 #endif /* PLATFORM_CONFIG_H */
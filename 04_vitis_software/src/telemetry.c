@@ -0,0 +1,179 @@
+/******************************************************************************
+ * telemetry.c
+ * ------------
+ * Binary telemetry records (layout in telemetry.h).  Fields are packed
+ * byte by byte, so the layout does not depend on struct padding, and a
+ * record is handed to the UART as one unit: with buffered transmit it is
+ * queued whole once it fits, or (uart_tx_set_drop) dropped whole, leaving
+ * a gap in the sequence numbers for the host to report.
+ *****************************************************************************/
+#include <string.h>
+#include "telemetry.h"
+#include "frame_rx.h"
+#include "uart_debug.h"
+
+#define TELEMETRY_MAX_PAYLOAD                                            \
+    (TELEMETRY_WATERSHED_BYTES(MAX_REGIONS) >                            \
+             TELEMETRY_CONTOUR_BYTES(WATERSHED_CHAIN_STEPS)              \
+         ? TELEMETRY_WATERSHED_BYTES(MAX_REGIONS)                        \
+         : TELEMETRY_CONTOUR_BYTES(WATERSHED_CHAIN_STEPS))
+#define TELEMETRY_MAX_RECORD \
+    (TELEMETRY_HEADER_BYTES + TELEMETRY_MAX_PAYLOAD + TELEMETRY_CRC_BYTES)
+
+static uint32_t tlm_seq;
+
+/* ---- Little-endian packing ---- */
+static uint8_t *put_u8(uint8_t *p, uint8_t v)
+{
+    *p = v;
+    return p + 1;
+}
+
+static uint8_t *put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    return p + 2;
+}
+
+static uint8_t *put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+    return p + 4;
+}
+
+static uint8_t *put_f32(uint8_t *p, float v)
+{
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    return put_u32(p, bits);
+}
+
+/* ------------------------------------------------------------------ */
+/* Start a record in @p rec; returns where the payload goes */
+static uint8_t *begin(uint8_t *rec, uint8_t type, uint16_t len)
+{
+    uint8_t *p = put_u32(rec, TELEMETRY_SYNC);
+    p = put_u8(p, type);
+    p = put_u8(p, 0);
+    p = put_u16(p, len);
+    return put_u32(p, tlm_seq);
+}
+
+/* Append the CRC to the record ending at @p end and send it */
+static int finish(uint8_t *rec, uint8_t *end)
+{
+    uint32_t len = (uint32_t)(end - rec);
+    put_u32(end, frame_rx_crc32(0, rec, len));
+    tlm_seq++;
+    return uart_write(rec, len + TELEMETRY_CRC_BYTES);
+}
+
+/* ------------------------------------------------------------------ */
+int telemetry_send_result(uint32_t frame, uint8_t mode, const OtsuAccelResult *res)
+{
+    uint8_t rec[TELEMETRY_MAX_RECORD];
+    uint8_t *p = begin(rec, TELEMETRY_ACCEL_RESULT, TELEMETRY_ACCEL_RESULT_BYTES);
+
+    p = put_u32(p, frame);
+    p = put_u8(p, mode);
+    p = put_u8(p, res->threshold);
+    p = put_u8(p, res->mode_used);
+    p = put_u8(p, 0);
+    p = put_u16(p, res->separability);
+    p = put_u16(p, res->run_count);
+    p = put_u32(p, res->moments.count);
+    p = put_u32(p, res->moments.sum_x);
+    p = put_u32(p, res->moments.sum_y);
+    p = put_u32(p, res->moments.sum_xx);
+    p = put_u32(p, res->moments.sum_yy);
+    p = put_u32(p, res->moments.sum_xy);
+    p = put_u8(p, res->moments.bbox_x0);
+    p = put_u8(p, res->moments.bbox_y0);
+    p = put_u8(p, res->moments.bbox_x1);
+    p = put_u8(p, res->moments.bbox_y1);
+    for (uint32_t s = 0; s < HLS_NUM_STAGES; s++)
+        p = put_u32(p, res->stage_cycles[s]);
+
+    return finish(rec, p);
+}
+
+/* ------------------------------------------------------------------ */
+int telemetry_send_regions(uint32_t frame, const WatershedResult *ws)
+{
+    uint8_t rec[TELEMETRY_MAX_RECORD];
+    uint8_t n = ws->num_regions < MAX_REGIONS ? ws->num_regions : MAX_REGIONS;
+    uint8_t *p = begin(rec, TELEMETRY_WATERSHED, (uint16_t)TELEMETRY_WATERSHED_BYTES(n));
+
+    p = put_u32(p, frame);
+    p = put_u32(p, ws->total_foreground);
+    p = put_u8(p, n);
+    p = put_u8(p, 0);
+    p = put_u16(p, ws->total_regions);
+    for (uint8_t i = 0; i < n; i++) {
+        const RegionInfo *r = &ws->regions[i];
+        p = put_u32(p, r->area);
+        p = put_u16(p, r->centroid_x);
+        p = put_u16(p, r->centroid_y);
+        p = put_u16(p, r->bbox_x0);
+        p = put_u16(p, r->bbox_y0);
+        p = put_u16(p, r->bbox_x1);
+        p = put_u16(p, r->bbox_y1);
+        p = put_u16(p, r->label);
+        p = put_u8(p, r->selected);
+        p = put_u8(p, 0);
+        p = put_u16(p, r->perimeter_x10);
+        p = put_u16(p, r->compactness_pct);
+    }
+
+    return finish(rec, p);
+}
+
+/* ------------------------------------------------------------------ */
+int telemetry_send_energy(uint32_t frame, const EnergyReport *report)
+{
+    uint8_t rec[TELEMETRY_MAX_RECORD];
+    uint8_t *p = begin(rec, TELEMETRY_ENERGY, TELEMETRY_ENERGY_BYTES);
+
+    p = put_u32(p, frame);
+    p = put_u32(p, report->hw_cycles);
+    p = put_u32(p, report->sw_cycles);
+    p = put_u32(p, report->total_cycles);
+    p = put_f32(p, report->hw_time_ms);
+    p = put_f32(p, report->sw_time_ms);
+    p = put_f32(p, report->speedup);
+    p = put_f32(p, report->hw_power_mw);
+    p = put_f32(p, report->sw_power_mw);
+    p = put_f32(p, report->hw_energy_uj);
+    p = put_f32(p, report->sw_energy_uj);
+    p = put_f32(p, report->energy_savings_pct);
+
+    return finish(rec, p);
+}
+
+/* ------------------------------------------------------------------ */
+int telemetry_send_contour(uint32_t frame, const RegionContour *contour)
+{
+    uint8_t rec[TELEMETRY_MAX_RECORD];
+    uint16_t len = (uint16_t)TELEMETRY_CONTOUR_BYTES(contour->stored);
+    uint8_t *p = begin(rec, TELEMETRY_CONTOUR, len);
+
+    p = put_u32(p, frame);
+    p = put_u16(p, contour->label);
+    p = put_u8(p, contour->start_x);
+    p = put_u8(p, contour->start_y);
+    p = put_u16(p, contour->steps);
+    p = put_u16(p, contour->stored);
+    memcpy(p, contour->chain, len - 12U);
+
+    return finish(rec, p + len - 12U);
+}
+
+/* ------------------------------------------------------------------ */
+uint32_t telemetry_sequence(void)
+{
+    return tlm_seq;
+}
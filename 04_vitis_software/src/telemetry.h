@@ -0,0 +1,114 @@
+/******************************************************************************
+ * telemetry.h
+ * ------------
+ * Binary telemetry records on the UART, a compact alternative to the ASCII
+ * per-frame reports (TELEMETRY_BINARY in platform_config.h).
+ *
+ * Every record is little-endian:
+ *
+ *   Offset  Size  Field
+ *   0       4     sync word TELEMETRY_SYNC (wire bytes 'T' 'L' 'M' '1')
+ *   4       1     record type (TELEMETRY_*)
+ *   5       1     reserved, 0
+ *   6       2     payload length in bytes
+ *   8       4     sequence number (counts every record, sent or dropped)
+ *   12      n     payload
+ *   12+n    4     CRC-32 of bytes 0 .. 11+n (as frame_rx_crc32)
+ *
+ * Payloads (offsets within the payload):
+ *
+ *   TELEMETRY_ACCEL_RESULT (72 bytes)
+ *     0 frame u32, 4 mode u8 (adaptive decision), 5 threshold u8,
+ *     6 mode_used u8, 7 reserved u8, 8 separability u16,
+ *     10 run_count u16 (HLS_OTSU_MODE_RLE runs, 0 = plain mask),
+ *     12 count, sum_x, sum_y, sum_xx, sum_yy, sum_xy u32,
+ *     36 bbox_x0, bbox_y0, bbox_x1, bbox_y1 u8,
+ *     40 stage_cycles[HLS_NUM_STAGES] u32
+ *
+ *   TELEMETRY_WATERSHED (12 + 24 × num_regions bytes)
+ *     0 frame u32, 4 total_foreground u32, 8 num_regions u8 (listed),
+ *     9 reserved u8, 10 total_regions u16 (found),
+ *     12 per region: area u32, centroid_x, centroid_y, bbox_x0, bbox_y0,
+ *        bbox_x1, bbox_y1, label u16, selected u8, reserved u8,
+ *        perimeter_x10, compactness_pct u16
+ *
+ *   TELEMETRY_ENERGY (48 bytes)
+ *     0 frame u32, 4 hw_cycles, 8 sw_cycles, 12 total_cycles u32,
+ *     16 hw_time_ms, sw_time_ms, speedup, hw_power_mw, sw_power_mw,
+ *        hw_energy_uj, sw_energy_uj, energy_savings_pct (IEEE-754 float)
+ *
+ *   TELEMETRY_CONTOUR (12 + ceil(3 × stored / 8) bytes)
+ *     0 frame u32, 4 label u16, 6 start_x u8, 7 start_y u8,
+ *     8 steps u16 (contour length), 10 stored u16 (steps in this record),
+ *     12 Freeman chain code, 3 bits per step, LSB first (RegionContour)
+ *
+ * A region's outline is a few hundred bytes as a contour record, against
+ * the 16 KB of the mask it is traced from.
+ *
+ * Derived values (orientation, centroid of the moments) are left to the
+ * host; host/telemetry_decode.cpp decodes the stream and passes any bytes
+ * outside records through as text.
+ *****************************************************************************/
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include "otsu_accel.h"
+#include "watershed.h"
+#include "energy_analyzer.h"
+
+#define TELEMETRY_SYNC         0x314D4C54U   /* "TLM1" */
+#define TELEMETRY_HEADER_BYTES 12U
+#define TELEMETRY_CRC_BYTES    4U
+
+/* Record types */
+#define TELEMETRY_ACCEL_RESULT 1U
+#define TELEMETRY_WATERSHED    2U
+#define TELEMETRY_ENERGY       3U
+#define TELEMETRY_CONTOUR      4U
+
+/* Payload sizes */
+#define TELEMETRY_ACCEL_RESULT_BYTES (40U + 4U * HLS_NUM_STAGES)
+#define TELEMETRY_REGION_BYTES       24U
+#define TELEMETRY_WATERSHED_BYTES(n) (12U + TELEMETRY_REGION_BYTES * (n))
+#define TELEMETRY_ENERGY_BYTES       48U
+#define TELEMETRY_CONTOUR_BYTES(n)   (12U + (3U * (n) + 7U) / 8U)
+
+/**
+ * Send the accelerator result of frame @p frame.
+ *
+ * @param frame  Frame number / id reported with every record of the frame
+ * @param mode   Mode chosen by the adaptive controller
+ * @param res    Result read back from the accelerator
+ * @return       0 if sent, -1 if dropped (UART ring full, uart_tx_set_drop)
+ */
+int telemetry_send_result(uint32_t frame, uint8_t mode, const OtsuAccelResult *res);
+
+/**
+ * Send the regions found in frame @p frame (only ws->num_regions entries).
+ *
+ * @return  0 if sent, -1 if dropped
+ */
+int telemetry_send_regions(uint32_t frame, const WatershedResult *ws);
+
+/**
+ * Send the energy report of frame @p frame.
+ *
+ * @return  0 if sent, -1 if dropped
+ */
+int telemetry_send_energy(uint32_t frame, const EnergyReport *report);
+
+/**
+ * Send the contour of one region of frame @p frame (only its stored
+ * steps).
+ *
+ * @return  0 if sent, -1 if dropped
+ */
+int telemetry_send_contour(uint32_t frame, const RegionContour *contour);
+
+/**
+ * @return  Sequence number the next record will carry
+ */
+uint32_t telemetry_sequence(void);
+
+#endif /* TELEMETRY_H */
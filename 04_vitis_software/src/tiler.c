@@ -0,0 +1,402 @@
+/******************************************************************************
+ * tiler.c
+ * --------
+ * Tiled segmentation of large images (see tiler.h).
+ *
+ * Along each axis of length L, n frames of F pixels (IMG_WIDTH or
+ * IMG_HEIGHT) with halo h step by C = F - 2h; the last one is pulled
+ * back to end on the image border.  Frame k's core starts where core k-1 ends, h pixels
+ * into the frame (0 for the first), and ends h pixels before the frame's
+ * end (at L for the last), so cores tile the axis exactly and every core
+ * pixel is at least h pixels from a frame edge that is not an image edge.
+ *
+ * Tile labels get global numbers in raster order of the tiles.  The seam
+ * buffers hold the global labels of the last core row of the previous
+ * tile row (seam_above; the current row's go to seam_below until the row
+ * is complete, so diagonal neighbours above are still there) and of the
+ * last core column of the tile to the left.
+ *****************************************************************************/
+#include "tiler.h"
+#include "dispatcher.h"
+#include "label_util.h"
+#include <stddef.h>
+#include <string.h>
+
+#define LABELS ((volatile uint16_t *)PHYS_PTR(WATERSHED_LABEL_BASE))
+
+typedef struct
+{
+    uint32_t area;
+    uint32_t isum;
+    uint16_t x0, y0, x1, y1;
+} LabelStats;
+
+/* Global labels are 1-based; entry 0 is unused */
+static uint16_t   parent[TILER_MAX_LABELS + 1];
+static LabelStats stats[TILER_MAX_LABELS + 1];
+
+static uint16_t seam_above[TILER_MAX_DIM];
+static uint16_t seam_below[TILER_MAX_DIM];
+static uint16_t seam_left[IMG_HEIGHT];
+
+static uint32_t image_hist[256];
+
+/* =====================================================================
+ * Tile geometry
+ * ===================================================================*/
+typedef struct
+{
+    uint32_t frame;    /* first pixel of the frame */
+    uint32_t c0, c1;   /* core [c0, c1)            */
+} Span;
+
+/* Frames of @p size pixels along an axis of @p len */
+static uint32_t span_count(uint32_t len, uint32_t size, uint32_t halo)
+{
+    uint32_t step = size - 2U * halo;
+    return 1U + (len - size + step - 1U) / step;
+}
+
+static Span span_of(uint32_t len, uint32_t size, uint32_t halo,
+                    uint32_t k, uint32_t n)
+{
+    uint32_t step = size - 2U * halo;
+    Span s;
+    s.frame = k + 1U == n ? len - size : k * step;
+    s.c0    = k == 0 ? 0 : (k - 1U) * step + size - halo;
+    s.c1    = k + 1U == n ? len : k * step + size - halo;
+    return s;
+}
+
+/* ------------------------------------------------------------------ */
+uint8_t tiler_threshold(const uint32_t hist[256], uint32_t total, uint8_t mode)
+{
+    /* ---- Otsu sweep, integer arithmetic as otsu_compute() ---- */
+    uint64_t sum = 0, sum_sq = 0;
+    for (uint32_t t = 0; t < 256; t++) {
+        sum    += (uint64_t)t * hist[t];
+        sum_sq += (uint64_t)(t * t) * hist[t];
+    }
+
+    uint64_t sum_b = 0, best_var = 0;
+    uint32_t w_b = 0;
+    uint8_t thr = 0;
+    for (uint32_t t = 0; t < 256; t++) {
+        w_b += hist[t];
+        if (w_b == 0)
+            continue;
+        uint32_t w_f = total - w_b;
+        if (w_f == 0)
+            break;
+
+        sum_b += (uint64_t)t * hist[t];
+        uint32_t mean_b = (uint32_t)(sum_b / w_b);
+        uint32_t mean_f = (uint32_t)((sum - sum_b) / w_f);
+        int32_t diff = (int32_t)mean_b - (int32_t)mean_f;
+        uint64_t var = (uint64_t)w_b * w_f * (uint32_t)(diff * diff);
+        if (var > best_var) {
+            best_var = var;
+            thr = (uint8_t)t;
+        }
+    }
+
+    /* ---- MODE_CAREFUL fall-back, as the kernel's adaptive stage ---- */
+    if (mode != PROCESSING_MODE_CAREFUL)
+        return thr;
+
+    uint32_t fg = 0;
+    for (uint32_t t = thr + 1U; t < 256; t++)
+        fg += hist[t];
+    if (fg <= total / 5U)
+        return thr;
+
+    uint32_t mean = (uint32_t)(sum / total);
+    uint32_t e_x2 = (uint32_t)(sum_sq / total);
+    uint32_t variance = e_x2 > mean * mean ? e_x2 - mean * mean : 0;
+    uint32_t s = variance;
+    for (int iter = 0; s && iter < 10; iter++) {
+        uint32_t s_new = (s + variance / s) / 2U;
+        if (s_new >= s)
+            break;
+        s = s_new;
+    }
+
+    uint32_t strict = mean + (3U * s) / 5U;
+    return (uint8_t)(strict > 255U ? 255U : strict < 1U ? 1U : strict);
+}
+
+/* =====================================================================
+ * Pass driver: keeps the dispatcher's frame buffers busy, tiles in
+ * raster order
+ * ===================================================================*/
+typedef struct
+{
+    const uint8_t *image;
+    uint32_t width, height;
+    uint32_t halo;
+    uint32_t nx, ny;
+    uint8_t mode;            /* kernel mode incl. flags */
+    TiledResult *result;
+    uint8_t *mask;
+    uint32_t next_label;     /* global labels handed out */
+} Tiler;
+
+typedef void (*BuildFn)(const Tiler *t, uint32_t tile, uint8_t *frame);
+typedef void (*ConsumeFn)(Tiler *t, const DispatchResult *r);
+
+static int run_pass(Tiler *t, BuildFn build, ConsumeFn consume)
+{
+    uint32_t tiles = t->nx * t->ny, next = 0, done = 0;
+    int ok = 1;
+
+    while (done < tiles) {
+        int buf;
+        if (next < tiles && (buf = dispatcher_acquire()) >= 0) {
+            build(t, next, dispatcher_input(buf));
+            dispatcher_submit_buffer(buf, t->mode, next++);
+        }
+
+        dispatcher_poll();
+        DispatchResult r;
+        while (dispatcher_collect(&r)) {
+            if (r.status != 0)
+                ok = 0;
+            else
+                consume(t, &r);
+            for (uint32_t s = 0; s < HLS_NUM_STAGES; s++)
+                t->result->hw_cycles += r.result.stage_cycles[s];
+            done++;
+        }
+    }
+    return ok ? 0 : -1;
+}
+
+/* =====================================================================
+ * Pass 1: histogram
+ * ===================================================================*/
+static void build_hist_tile(const Tiler *t, uint32_t tile, uint8_t *frame)
+{
+    Span sx = span_of(t->width, IMG_WIDTH, 0, tile % t->nx, t->nx);
+    Span sy = span_of(t->height, IMG_HEIGHT, 0, tile / t->nx, t->ny);
+    uint32_t w = sx.c1 - sx.c0;
+
+    /* Core at the frame's top left, zeros elsewhere */
+    for (uint32_t y = 0; y < IMG_HEIGHT; y++) {
+        uint8_t *row = frame + y * IMG_WIDTH;
+        if (y < sy.c1 - sy.c0) {
+            memcpy(row, t->image + (sy.c0 + y) * t->width + sx.c0, w);
+            memset(row + w, 0, IMG_WIDTH - w);
+        } else {
+            memset(row, 0, IMG_WIDTH);
+        }
+    }
+}
+
+static void add_hist_tile(Tiler *t, const DispatchResult *r)
+{
+    otsu_accel_add_histogram(r->mask, image_hist);
+    (void)t;
+}
+
+/* =====================================================================
+ * Pass 2: mask, labels and seams
+ * ===================================================================*/
+static void build_mask_tile(const Tiler *t, uint32_t tile, uint8_t *frame)
+{
+    Span sx = span_of(t->width, IMG_WIDTH, t->halo, tile % t->nx, t->nx);
+    Span sy = span_of(t->height, IMG_HEIGHT, t->halo, tile / t->nx, t->ny);
+
+    for (uint32_t y = 0; y < IMG_HEIGHT; y++)
+        memcpy(frame + y * IMG_WIDTH,
+               t->image + (sy.frame + y) * t->width + sx.frame, IMG_WIDTH);
+}
+
+/* Global label of frame pixel (x, y), 0 for background and for tile
+ * labels past TILER_MAX_LABELS */
+static uint16_t global_label(const uint8_t *out, uint32_t x, uint32_t y,
+                             uint32_t base, uint32_t last)
+{
+    uint32_t i = y * IMG_WIDTH + x;
+    uint32_t g = out[i] ? base + LABELS[i] : 0;
+    return (uint16_t)(g <= last ? g : 0);
+}
+
+static void consume_mask_tile(Tiler *t, const DispatchResult *r)
+{
+    const uint32_t reach = WATERSHED_CONNECTIVITY == 8 ? 1U : 0U;
+    uint32_t tx = r->tag % t->nx, ty = r->tag / t->nx;
+    Span sx = span_of(t->width, IMG_WIDTH, t->halo, tx, t->nx);
+    Span sy = span_of(t->height, IMG_HEIGHT, t->halo, ty, t->ny);
+    uint32_t cx0 = sx.c0 - sx.frame, cx1 = sx.c1 - sx.frame;   /* in frame */
+    uint32_t cy0 = sy.c0 - sy.frame, cy1 = sy.c1 - sy.frame;
+
+    /* Core to the output mask; the halo is cleared in the kernel's output
+     * buffer (ours until the next collect) so only the core is labelled */
+    uint8_t *out = (uint8_t *)r->mask;
+    for (uint32_t y = 0; y < IMG_HEIGHT; y++) {
+        uint8_t *row = out + y * IMG_WIDTH;
+        if (y < cy0 || y >= cy1) {
+            memset(row, 0, IMG_WIDTH);
+            continue;
+        }
+        memcpy(t->mask + (sy.frame + y) * t->width + sx.c0, row + cx0, cx1 - cx0);
+        memset(row, 0, cx0);
+        memset(row + cx1, 0, IMG_WIDTH - cx1);
+    }
+
+    WatershedResult ws;
+    watershed_label_components(out, 0, WATERSHED_CONNECTIVITY, &ws);
+
+    /* Tile label l becomes global label base + l */
+    uint32_t base = t->next_label;
+    uint32_t last = base + ws.total_regions;
+    if (last > TILER_MAX_LABELS) {
+        t->result->label_overflow = 1;
+        last = TILER_MAX_LABELS;
+    }
+    for (uint32_t g = base + 1U; g <= last; g++) {
+        parent[g] = (uint16_t)g;
+        stats[g].area = 0;
+        stats[g].isum = 0;
+        stats[g].x0 = stats[g].y0 = 0xFFFF;
+        stats[g].x1 = stats[g].y1 = 0;
+    }
+    t->next_label = last;
+
+    /* ---- Seams: first core row against the previous tile row's last,
+     *      first core column against the left tile's last ---- */
+    if (ty > 0) {
+        for (uint32_t x = cx0; x < cx1; x++) {
+            uint16_t a = global_label(out, x, cy0, base, last);
+            for (uint32_t d = 0; a && d <= 2U * reach; d++) {
+                uint32_t ix = sx.frame + x + d - reach;   /* wraps at x = -1 */
+                if (ix < t->width && seam_above[ix])
+                    label_uf_union(parent, a, seam_above[ix]);
+            }
+        }
+    }
+    if (tx > 0) {
+        for (uint32_t y = cy0; y < cy1; y++) {
+            uint16_t a = global_label(out, cx0, y, base, last);
+            for (uint32_t d = 0; a && d <= 2U * reach; d++) {
+                uint32_t yy = y + d - reach;
+                if (yy >= cy0 && yy < cy1 && seam_left[yy - cy0])
+                    label_uf_union(parent, a, seam_left[yy - cy0]);
+            }
+        }
+    }
+
+    /* ---- Label statistics; this core's edges become the seams ---- */
+    for (uint32_t y = cy0; y < cy1; y++) {
+        const uint8_t *in = r->input + y * IMG_WIDTH;
+        uint32_t iy = sy.frame + y;
+        for (uint32_t x = cx0; x < cx1; x++) {
+            uint16_t g = global_label(out, x, y, base, last);
+            uint32_t ix = sx.frame + x;
+
+            if (y == cy1 - 1U)
+                seam_below[ix] = g;
+            if (x == cx1 - 1U)
+                seam_left[y - cy0] = g;
+            if (out[y * IMG_WIDTH + x])
+                t->result->foreground++;
+            if (!g)
+                continue;
+
+            LabelStats *st = &stats[g];
+            st->area++;
+            st->isum += in[x];
+            if (ix < st->x0) st->x0 = (uint16_t)ix;
+            if (ix > st->x1) st->x1 = (uint16_t)ix;
+            if (iy < st->y0) st->y0 = (uint16_t)iy;
+            st->y1 = (uint16_t)iy;
+        }
+    }
+
+    if (tx + 1U == t->nx)
+        memcpy(seam_above, seam_below, t->width * sizeof(seam_above[0]));
+}
+
+/* ---- Fold every label into its root; list the largest components ---- */
+static void finish_regions(const Tiler *t)
+{
+    TiledResult *res = t->result;
+
+    for (uint32_t g = 1; g <= t->next_label; g++) {
+        uint16_t root = label_uf_find(parent, (uint16_t)g);
+        if (root == g)
+            continue;
+        LabelStats *dst = &stats[root], *src = &stats[g];
+        dst->area += src->area;
+        dst->isum += src->isum;
+        if (src->x0 < dst->x0) dst->x0 = src->x0;
+        if (src->y0 < dst->y0) dst->y0 = src->y0;
+        if (src->x1 > dst->x1) dst->x1 = src->x1;
+        if (src->y1 > dst->y1) dst->y1 = src->y1;
+    }
+
+    for (uint32_t g = 1; g <= t->next_label; g++) {
+        const LabelStats *st = &stats[g];
+        if (parent[g] != g || st->area == 0)
+            continue;
+        res->total_regions++;
+
+        /* Insert by area, largest first; the earlier root wins ties */
+        int k = label_top_insert(res->regions, sizeof(res->regions[0]),
+                                 offsetof(TiledRegion, area), &res->num_regions,
+                                 st->area);
+        if (k < 0)
+            continue;
+
+        TiledRegion *reg = &res->regions[k];
+        reg->area           = st->area;
+        reg->intensity_sum  = st->isum;
+        reg->bbox_x0        = st->x0;
+        reg->bbox_y0        = st->y0;
+        reg->bbox_x1        = st->x1;
+        reg->bbox_y1        = st->y1;
+        reg->mean_intensity = (uint8_t)(st->isum / st->area);
+    }
+}
+
+/* ------------------------------------------------------------------ */
+int tiler_segment(const uint8_t *image, uint16_t width, uint16_t height,
+                  uint8_t mode, uint8_t *mask, TiledResult *result)
+{
+    if (width < IMG_WIDTH || height < IMG_HEIGHT ||
+        width > TILER_MAX_DIM || height > TILER_MAX_DIM)
+        return -1;
+
+    memset(result, 0, sizeof(*result));
+    Tiler t;
+    t.image      = image;
+    t.width      = width;
+    t.height     = height;
+    t.result     = result;
+    t.mask       = mask;
+    t.next_label = 0;
+
+    /* ---- Pass 1: image histogram from disjoint, zero-padded tiles ---- */
+    t.halo = 0;
+    t.nx   = span_count(width, IMG_WIDTH, 0);
+    t.ny   = span_count(height, IMG_HEIGHT, 0);
+    t.mode = mode | HLS_OTSU_MODE_HIST;
+    memset(image_hist, 0, sizeof(image_hist));
+    if (run_pass(&t, build_hist_tile, add_hist_tile) != 0)
+        return -1;
+    image_hist[0] -= t.nx * t.ny * IMG_SIZE - (uint32_t)width * height;
+    result->threshold = tiler_threshold(image_hist, (uint32_t)width * height, mode);
+
+    /* ---- Pass 2: mask with the global threshold, labels, seams ---- */
+    dispatcher_set_threshold(result->threshold);
+    t.halo = TILER_HALO(mode);
+    t.nx   = span_count(width, IMG_WIDTH, t.halo);
+    t.ny   = span_count(height, IMG_HEIGHT, t.halo);
+    t.mode = mode | HLS_OTSU_MODE_FIXED_THR;
+    result->tiles = (uint16_t)(t.nx * t.ny);
+    if (run_pass(&t, build_mask_tile, consume_mask_tile) != 0)
+        return -1;
+
+    finish_regions(&t);
+    return 0;
+}
@@ -0,0 +1,105 @@
+/******************************************************************************
+ * tiler.h
+ * --------
+ * Segmentation of images larger than the accelerator frame (IMG_WIDTH x
+ * IMG_HEIGHT), tile by tile through the dispatcher.
+ *
+ * The image and the output mask live in memory the CPU addresses (DDR
+ * behind a memory controller on boards that have one); tiles are copied
+ * into the dispatcher's zero-copy frame buffers.  Two passes:
+ *
+ *   1. histogram – frame-sized tiles without overlap (edge tiles padded
+ *      with zeros, which are taken out of bin 0 again) run with
+ *      HLS_OTSU_MODE_HIST.  Their histograms add up to the image's, and
+ *      the CPU derives one threshold for the whole image from it, as the
+ *      kernel would (Otsu, plus the MODE_CAREFUL fall-back).
+ *   2. mask – overlapping frames with a core and a TILER_HALO(mode)-pixel
+ *      halo run with HLS_OTSU_MODE_FIXED_THR.  The kernel's morphology
+ *      reaches no further than the halo, and frames at the image border
+ *      are shifted inside it, so each core equals the mask the whole image
+ *      would give.  Cores are copied to the output mask.
+ *
+ * Each core is labelled (watershed_label_components()) and its labels are
+ * joined to those of the cores above and to the left in a union-find over
+ * the seam rows and columns, giving the connected components of the whole
+ * mask (WATERSHED_CONNECTIVITY).
+ *****************************************************************************/
+#ifndef TILER_H
+#define TILER_H
+
+#include <stdint.h>
+#include "platform_config.h"
+#include "adaptive_controller.h"
+#include "watershed.h"
+
+/* Largest width / height (seam row buffers, 4 bytes per column) */
+#ifndef TILER_MAX_DIM
+#define TILER_MAX_DIM 1024
+#endif
+
+/* Tile labels across the whole image (union-find and statistics, 18
+ * bytes each); components beyond are dropped from the region list */
+#ifndef TILER_MAX_LABELS
+#define TILER_MAX_LABELS 1024
+#endif
+
+/* Pixels of mask each side of a core that the kernel's morphology needs:
+ * one per 3x3 erode / dilate (open in NORMAL, open + close in CAREFUL) */
+#define TILER_HALO(mode) ((mode) == PROCESSING_MODE_CAREFUL ? 4U : \
+                          (mode) == PROCESSING_MODE_NORMAL  ? 2U : 0U)
+
+/**
+ * One connected component of the whole mask.
+ */
+typedef struct
+{
+    uint32_t area;           /* pixels                              */
+    uint32_t intensity_sum;  /* sum of the image under the region   */
+    uint16_t bbox_x0;        /* bounding box, image coordinates     */
+    uint16_t bbox_y0;
+    uint16_t bbox_x1;
+    uint16_t bbox_y1;
+    uint8_t mean_intensity;  /* intensity_sum / area                */
+} TiledRegion;
+
+/**
+ * Result of tiler_segment().
+ */
+typedef struct
+{
+    uint8_t threshold;       /* global threshold applied            */
+    uint8_t label_overflow;  /* 1 = more than TILER_MAX_LABELS tile
+                              * labels, regions incomplete          */
+    uint16_t tiles;          /* frames in the mask pass             */
+    uint32_t foreground;     /* mask pixels                         */
+    uint32_t hw_cycles;      /* kernel cycles, both passes          */
+    uint16_t total_regions;  /* connected components                */
+    uint8_t num_regions;     /* entries in regions[]                */
+    TiledRegion regions[MAX_REGIONS]; /* largest first              */
+} TiledResult;
+
+/**
+ * Threshold the kernel would pick for an image with histogram @p hist of
+ * @p total pixels: the Otsu split, replaced in MODE_CAREFUL by mean +
+ * 0.6 x std. dev. when it selects more than 20 % of the image.
+ */
+uint8_t tiler_threshold(const uint32_t hist[256], uint32_t total, uint8_t mode);
+
+/**
+ * Segment a @p width x @p height image in tiles.  Uses the dispatcher
+ * (dispatcher_init() first) and the watershed scratch; nothing else may
+ * be in flight on the dispatcher.
+ *
+ * @param image   Grayscale image, row-major
+ * @param width   IMG_WIDTH .. TILER_MAX_DIM
+ * @param height  IMG_HEIGHT .. TILER_MAX_DIM
+ * @param mode    PROCESSING_MODE_FAST / NORMAL / CAREFUL
+ * @param mask    Output: binary mask (0 / 255), width x height bytes
+ * @param result  Output: threshold and connected components
+ * @return        0 on success, -1 for an unsupported size or an
+ *                accelerator timeout
+ */
+int tiler_segment(const uint8_t *image, uint16_t width, uint16_t height,
+                  uint8_t mode, uint8_t *mask, TiledResult *result);
+
+#endif /* TILER_H */
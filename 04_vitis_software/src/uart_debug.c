@@ -1,10 +1,21 @@
 /******************************************************************************
  * uart_debug.c
  * --------------
- * UART print functions using AXI UART Lite in polled mode.
+ * UART print functions using AXI UART Lite, plus an interrupt-driven
+ * receive path.
+ *
+ * Transmit starts polled.  uart_tx_enable_interrupt() switches it to a
+ * ring buffer: uart_putc() only queues the character (straight into the
+ * TX FIFO when nothing is queued ahead of it), and the interrupt that
+ * fires when the TX FIFO runs empty refills it with up to a FIFO's worth.
+ * A print that finds the ring full waits for room, moving characters into
+ * the FIFO itself meanwhile, unless uart_tx_set_drop() asked for drops.
+ * Invariant: while the ring is non-empty, the FIFO is either sending or
+ * its empty interrupt is pending, so queued characters always drain.
  *****************************************************************************/
 #include "uart_debug.h"
 #include "platform_config.h"
+#include "intc.h"
 
 /* ---- AXI UART Lite register offsets ---- */
 #define UART_RX_FIFO    0x00   /* Receive data FIFO  (read-only)  */
@@ -29,6 +40,22 @@
 
 #define UART_BASE  XPAR_AXI_UARTLITE_0_BASEADDR
 
+#define UART_FIFO_DEPTH 16U
+#define UART_TX_MASK    (UART_TX_BUF_SIZE - 1U)
+
+static UartRxHandler     rx_handler;
+static void             *rx_ctx;
+static volatile uint32_t rx_overruns;
+
+static char              tx_buf[UART_TX_BUF_SIZE];
+static volatile uint32_t tx_head;       /* next character to send   */
+static volatile uint32_t tx_tail;       /* next free entry          */
+static volatile uint32_t tx_overflows;
+static uint8_t           tx_irq;        /* ring buffer mode active  */
+static uint8_t           tx_drop;       /* full ring: drop, not wait */
+
+static void uart_isr(void *unused);
+
 /* ------------------------------------------------------------------ */
 void uart_init(void)
 {
@@ -36,9 +63,69 @@ void uart_init(void)
     REG_WRITE(UART_BASE, UART_CONTROL, UART_CR_RST_TX | UART_CR_RST_RX);
 }
 
+/* ------------------------------------------------------------------ */
+/* Route the UART Lite interrupt while either direction needs it */
+static void update_interrupt(void)
+{
+    if (rx_handler || tx_irq) {
+        intc_connect(INTC_IRQ_UART, uart_isr, 0);
+        REG_WRITE(UART_BASE, UART_CONTROL, UART_CR_INTR_EN);
+    } else {
+        REG_WRITE(UART_BASE, UART_CONTROL, 0);
+        intc_disconnect(INTC_IRQ_UART);
+    }
+}
+
+/* Move queued characters into the TX FIFO, which has room for @p room */
+static void tx_fill(uint32_t room)
+{
+    while (room-- && tx_head != tx_tail) {
+        REG_WRITE(UART_BASE, UART_TX_FIFO, (uint32_t)tx_buf[tx_head & UART_TX_MASK]);
+        tx_head++;
+    }
+}
+
+/*
+ * The ring has no room for @p len more (interrupts masked).  Waiting:
+ * move a character into the TX FIFO if it has room (its interrupt may be
+ * masked too) and return 1 so the caller retries.  Returns 0 if the
+ * caller should drop instead.
+ */
+static int tx_make_room(uint32_t len, uint32_t *timeout)
+{
+    if (tx_drop || len > UART_TX_BUF_SIZE || *timeout == 0)
+        return 0;
+    (*timeout)--;
+    if (!(REG_READ(UART_BASE, UART_STATUS) & UART_SR_TX_FULL))
+        tx_fill(1);
+    return 1;
+}
+
 /* ------------------------------------------------------------------ */
 void uart_putc(char c)
 {
+    if (tx_irq) {
+        uint32_t timeout = UART_FLUSH_TIMEOUT;
+        for (;;) {
+            uint32_t irq = cpu_irq_save();
+            if (tx_head == tx_tail &&
+                !(REG_READ(UART_BASE, UART_STATUS) & UART_SR_TX_FULL)) {
+                REG_WRITE(UART_BASE, UART_TX_FIFO, (uint32_t)c);
+            } else if (tx_tail - tx_head < UART_TX_BUF_SIZE) {
+                tx_buf[tx_tail & UART_TX_MASK] = c;
+                tx_tail++;
+            } else if (tx_make_room(1, &timeout)) {
+                cpu_irq_restore(irq);
+                CPU_IDLE();
+                continue;
+            } else {
+                tx_overflows++;
+            }
+            cpu_irq_restore(irq);
+            return;
+        }
+    }
+
     /* Wait until TX FIFO is not full (with timeout protection) */
     uint32_t timeout = 100000;  /* ~1ms at 100 MHz */
     while ((REG_READ(UART_BASE, UART_STATUS) & UART_SR_TX_FULL) && timeout > 0)
@@ -50,6 +137,39 @@ void uart_putc(char c)
     REG_WRITE(UART_BASE, UART_TX_FIFO, (uint32_t)c);
 }
 
+/* ------------------------------------------------------------------ */
+int uart_write(const uint8_t *buf, uint32_t len)
+{
+    if (!tx_irq) {
+        for (uint32_t i = 0; i < len; i++)
+            uart_putc((char)buf[i]);
+        return 0;
+    }
+
+    uint32_t timeout = UART_FLUSH_TIMEOUT;
+    uint32_t irq = cpu_irq_save();
+    while (len > UART_TX_BUF_SIZE - (tx_tail - tx_head)) {
+        if (!tx_make_room(len, &timeout)) {
+            tx_overflows += len;
+            cpu_irq_restore(irq);
+            return -1;
+        }
+        cpu_irq_restore(irq);
+        CPU_IDLE();
+        irq = cpu_irq_save();
+    }
+    int was_empty = tx_head == tx_tail;
+    for (uint32_t i = 0; i < len; i++)
+        tx_buf[(tx_tail + i) & UART_TX_MASK] = (char)buf[i];
+    tx_tail += len;
+
+    /* An idle FIFO raises no TX-empty interrupt: start it here */
+    if (was_empty && (REG_READ(UART_BASE, UART_STATUS) & UART_SR_TX_EMPTY))
+        tx_fill(UART_FIFO_DEPTH);
+    cpu_irq_restore(irq);
+    return 0;
+}
+
 /* ------------------------------------------------------------------ */
 void uart_print(const char *str)
 {
@@ -101,3 +221,95 @@ void uart_print_separator(void)
 {
     uart_print("----------------------------------------\r\n");
 }
+
+/* ------------------------------------------------------------------ */
+/* UART Lite ISR: drain the RX FIFO (16 bytes deep) into the handler and
+ * refill an empty TX FIFO from the ring */
+static void uart_isr(void *unused)
+{
+    (void)unused;
+    uint32_t status;
+
+    while ((status = REG_READ(UART_BASE, UART_STATUS)) & UART_SR_RX_VALID) {
+        uint8_t byte = (uint8_t)REG_READ(UART_BASE, UART_RX_FIFO);
+        if (status & UART_SR_OVERRUN)
+            rx_overruns++;
+        if (rx_handler)
+            rx_handler(byte, rx_ctx);
+    }
+    if (status & UART_SR_OVERRUN)
+        rx_overruns++;
+
+    if (status & UART_SR_TX_EMPTY)
+        tx_fill(UART_FIFO_DEPTH);
+}
+
+/* ------------------------------------------------------------------ */
+void uart_tx_enable_interrupt(void)
+{
+    tx_head      = 0;
+    tx_tail      = 0;
+    tx_overflows = 0;
+    tx_irq       = 1;
+    update_interrupt();
+}
+
+/* ------------------------------------------------------------------ */
+void uart_flush(void)
+{
+    uint32_t timeout = UART_FLUSH_TIMEOUT;
+
+    while (timeout--) {
+        /* Also drains with interrupts masked (e.g. called from an ISR) */
+        uint32_t irq = cpu_irq_save();
+        uint32_t status = REG_READ(UART_BASE, UART_STATUS);
+        if (!(status & UART_SR_TX_FULL))
+            tx_fill(1);
+        int idle = tx_head == tx_tail && (status & UART_SR_TX_EMPTY);
+        cpu_irq_restore(irq);
+
+        if (idle)
+            return;
+        CPU_IDLE();
+    }
+}
+
+/* ------------------------------------------------------------------ */
+void uart_tx_set_drop(int drop)
+{
+    tx_drop = drop != 0;
+}
+
+/* ------------------------------------------------------------------ */
+uint32_t uart_tx_overflows(void)
+{
+    return tx_overflows;
+}
+
+/* ------------------------------------------------------------------ */
+void uart_rx_attach(UartRxHandler handler, void *ctx)
+{
+    /* Keep the interrupt enabled if TX needs it: a missed TX-empty pulse
+     * would strand the ring */
+    REG_WRITE(UART_BASE, UART_CONTROL,
+              UART_CR_RST_RX | (tx_irq ? UART_CR_INTR_EN : 0));
+
+    rx_handler  = handler;
+    rx_ctx      = ctx;
+    rx_overruns = 0;
+    update_interrupt();
+}
+
+/* ------------------------------------------------------------------ */
+void uart_rx_detach(void)
+{
+    rx_handler = 0;
+    rx_ctx     = 0;
+    update_interrupt();
+}
+
+/* ------------------------------------------------------------------ */
+uint32_t uart_rx_overruns(void)
+{
+    return rx_overruns;
+}
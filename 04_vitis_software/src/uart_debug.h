@@ -2,23 +2,46 @@
  * uart_debug.h
  * --------------
  * Lightweight UART print functions for MicroBlaze.
- * Uses AXI UART Lite peripheral (polled mode, no interrupts).
+ * Uses AXI UART Lite peripheral.  Transmit is polled until
+ * uart_tx_enable_interrupt(), then buffered and non-blocking; receive is
+ * interrupt-driven (uart_rx_attach) for binary frame input.
  *****************************************************************************/
 #ifndef UART_DEBUG_H
 #define UART_DEBUG_H
 
 #include <stdint.h>
 
+/* TX ring buffer size in bytes (power of 2) */
+#ifndef UART_TX_BUF_SIZE
+#define UART_TX_BUF_SIZE 4096U
+#endif
+
+/* uart_flush() bound, in wait-loop iterations (> a full ring at 115200) */
+#define UART_FLUSH_TIMEOUT 50000000U
+
 /**
  * Initialise UART (sets baud rate, clears FIFOs).
  */
 void uart_init(void);
 
 /**
- * Send a single character (blocking, waits for TX FIFO space).
+ * Send a single character.  Polled mode waits for TX FIFO space; buffered
+ * mode queues it and returns.  If the ring is full it waits for room, or
+ * drops the character (uart_tx_overflows) after uart_tx_set_drop(1).
  */
 void uart_putc(char c);
 
+/**
+ * Send @p len raw bytes as one unit.  In buffered mode they are queued
+ * only once all of them fit, after waiting for room like uart_putc().
+ * With uart_tx_set_drop(1), or if @p len exceeds the ring, none are sent
+ * and all are counted in uart_tx_overflows(), so a binary record is never
+ * cut short.
+ *
+ * @return  0 if queued / sent, -1 if dropped
+ */
+int uart_write(const uint8_t *buf, uint32_t len);
+
 /**
  * Send a null-terminated string.
  */
@@ -41,4 +64,55 @@ void uart_print_hex(const char *label, uint32_t val);
  */
 void uart_print_separator(void);
 
+/**
+ * Switch transmit to the interrupt-drained ring buffer.  Requires
+ * intc_init(); CPU interrupts must be enabled by the caller.
+ */
+void uart_tx_enable_interrupt(void);
+
+/**
+ * Full-ring policy of buffered transmit.  By default (0) a print that
+ * does not fit waits while the CPU moves queued characters into the TX
+ * FIFO itself, which also works with interrupts masked, so no output is
+ * lost.  With @p drop = 1 it returns at once and the characters are
+ * dropped and counted instead: for callers that must never stall on the
+ * line (e.g. a real-time loop that would rather lose a report than a
+ * frame).
+ */
+void uart_tx_set_drop(int drop);
+
+/**
+ * Wait until every queued character has left the UART (also works with
+ * interrupts masked).
+ */
+void uart_flush(void);
+
+/**
+ * @return  Characters dropped because the TX ring was full
+ */
+uint32_t uart_tx_overflows(void);
+
+/**
+ * Receive handler, called from the UART interrupt for every byte.
+ */
+typedef void (*UartRxHandler)(uint8_t byte, void *ctx);
+
+/**
+ * Deliver received bytes to @p handler: drops anything left in the RX
+ * FIFO, then enables the UART Lite interrupt on INTC_IRQ_UART.  Requires
+ * intc_init(); CPU interrupts must be enabled by the caller.
+ */
+void uart_rx_attach(UartRxHandler handler, void *ctx);
+
+/**
+ * Stop interrupt-driven receive.
+ */
+void uart_rx_detach(void);
+
+/**
+ * @return  RX FIFO overruns seen since uart_rx_attach() (bytes lost
+ *          because the FIFO was not drained in time)
+ */
+uint32_t uart_rx_overruns(void);
+
 #endif /* UART_DEBUG_H */
@@ -0,0 +1,275 @@
+/******************************************************************************
+ * volume.c
+ * ---------
+ * 3D segmentation of slice stacks (see volume.h).
+ *
+ * Slice labels get global numbers in slice order.  The kernel runs one
+ * call ahead of the CPU: as soon as a finished slice is copied out, the
+ * next slice is started, and the copy is labelled and joined meanwhile
+ * (the kernel's buffers and the watershed scratch do not overlap).
+ *****************************************************************************/
+#include "volume.h"
+#include "tiler.h"
+#include "dispatcher.h"
+#include "image_loader.h"
+#include "label_util.h"
+#include <stddef.h>
+#include <string.h>
+
+#define LABELS      ((volatile uint16_t *)PHYS_PTR(WATERSHED_LABEL_BASE))
+#define PREV_LABELS ((volatile uint16_t *)PHYS_PTR(VOLUME_PREV_LABEL_BASE))
+
+typedef struct
+{
+    uint32_t voxels;
+    uint32_t sum_x, sum_y, sum_z;
+    uint32_t isum;
+    uint8_t x0, y0, x1, y1;
+    uint16_t z0, z1;
+} LesionStats;
+
+/* Global labels are 1-based; entry 0 is unused */
+static uint16_t    parent[VOLUME_MAX_LABELS + 1];
+static LesionStats stats[VOLUME_MAX_LABELS + 1];
+
+static uint32_t volume_hist[256];
+
+/* =====================================================================
+ * Slice labelling
+ * ===================================================================*/
+typedef struct
+{
+    VolumeResult *result;
+    uint32_t next_label;     /* global labels handed out */
+} Labeller;
+
+/* Global label of pixel i, 0 for background and for slice labels past
+ * VOLUME_MAX_LABELS */
+static uint16_t global_label(const uint8_t *mask, uint32_t i,
+                             uint32_t base, uint32_t last)
+{
+    uint32_t g = mask[i] ? base + LABELS[i] : 0;
+    return (uint16_t)(g <= last ? g : 0);
+}
+
+static void add_slice(Labeller *lb, const uint8_t *mask, const uint8_t *image,
+                      uint32_t z)
+{
+    WatershedResult ws;
+    watershed_label_components(mask, 0, VOLUME_CONNECTIVITY == 26 ? 8 : 4, &ws);
+
+    /* Slice label l becomes global label base + l */
+    uint32_t base = lb->next_label;
+    uint32_t last = base + ws.total_regions;
+    if (last > VOLUME_MAX_LABELS) {
+        lb->result->label_overflow = 1;
+        last = VOLUME_MAX_LABELS;
+    }
+    for (uint32_t g = base + 1U; g <= last; g++) {
+        parent[g] = (uint16_t)g;
+        memset(&stats[g], 0, sizeof(stats[g]));
+        stats[g].x0 = stats[g].y0 = 0xFF;
+        stats[g].z0 = 0xFFFF;
+    }
+    lb->next_label = last;
+
+    /* ---- Join to the slice before: same pixel (6), or its 3x3
+     *      neighbourhood (26) ---- */
+    volatile uint16_t *prev = PREV_LABELS;
+    if (z > 0) {
+        for (uint32_t y = 0, i = 0; y < IMG_HEIGHT; y++) {
+            for (uint32_t x = 0; x < IMG_WIDTH; x++, i++) {
+                uint16_t g = global_label(mask, i, base, last);
+                if (!g)
+                    continue;
+#if VOLUME_CONNECTIVITY == 26
+                uint32_t x0 = x > 0 ? x - 1U : 0, x1 = x + 1U < IMG_WIDTH ? x + 1U : x;
+                uint32_t y0 = y > 0 ? y - 1U : 0, y1 = y + 1U < IMG_HEIGHT ? y + 1U : y;
+                for (uint32_t yy = y0; yy <= y1; yy++)
+                    for (uint32_t xx = x0; xx <= x1; xx++)
+                        if (prev[yy * IMG_WIDTH + xx])
+                            label_uf_union(parent, g, prev[yy * IMG_WIDTH + xx]);
+#else
+                if (prev[i])
+                    label_uf_union(parent, g, prev[i]);
+#endif
+            }
+        }
+    }
+
+    /* ---- Label statistics; this slice becomes the previous one ---- */
+    for (uint32_t y = 0, i = 0; y < IMG_HEIGHT; y++) {
+        for (uint32_t x = 0; x < IMG_WIDTH; x++, i++) {
+            uint16_t g = global_label(mask, i, base, last);
+            prev[i] = g;
+            if (!g)
+                continue;
+
+            LesionStats *st = &stats[g];
+            st->voxels++;
+            st->sum_x += x;
+            st->sum_y += y;
+            st->sum_z += z;
+            st->isum  += image[i];
+            if (x < st->x0) st->x0 = (uint8_t)x;
+            if (x > st->x1) st->x1 = (uint8_t)x;
+            if (y < st->y0) st->y0 = (uint8_t)y;
+            if (y > st->y1) st->y1 = (uint8_t)y;
+            if (z < st->z0) st->z0 = (uint16_t)z;
+            st->z1 = (uint16_t)z;
+        }
+    }
+}
+
+/* ---- Fold every label into its root; list the largest lesions ---- */
+static void finish_lesions(const Labeller *lb)
+{
+    VolumeResult *res = lb->result;
+
+    for (uint32_t g = 1; g <= lb->next_label; g++) {
+        uint16_t root = label_uf_find(parent, (uint16_t)g);
+        if (root == g)
+            continue;
+        LesionStats *dst = &stats[root], *src = &stats[g];
+        dst->voxels += src->voxels;
+        dst->sum_x  += src->sum_x;
+        dst->sum_y  += src->sum_y;
+        dst->sum_z  += src->sum_z;
+        dst->isum   += src->isum;
+        if (src->x0 < dst->x0) dst->x0 = src->x0;
+        if (src->y0 < dst->y0) dst->y0 = src->y0;
+        if (src->z0 < dst->z0) dst->z0 = src->z0;
+        if (src->x1 > dst->x1) dst->x1 = src->x1;
+        if (src->y1 > dst->y1) dst->y1 = src->y1;
+        if (src->z1 > dst->z1) dst->z1 = src->z1;
+    }
+
+    for (uint32_t g = 1; g <= lb->next_label; g++) {
+        const LesionStats *st = &stats[g];
+        if (parent[g] != g || st->voxels == 0)
+            continue;
+        res->total_lesions++;
+
+        /* Insert by volume, largest first; the earlier root wins ties */
+        int k = label_top_insert(res->lesions, sizeof(res->lesions[0]),
+                                 offsetof(VolumeLesion, volume), &res->num_lesions,
+                                 st->voxels);
+        if (k < 0)
+            continue;
+
+        VolumeLesion *l = &res->lesions[k];
+        l->volume         = st->voxels;
+        l->intensity_sum  = st->isum;
+        l->centroid_x     = (uint16_t)(st->sum_x / st->voxels);
+        l->centroid_y     = (uint16_t)(st->sum_y / st->voxels);
+        l->centroid_z     = (uint16_t)(st->sum_z / st->voxels);
+        l->bbox_z0        = st->z0;
+        l->bbox_z1        = st->z1;
+        l->bbox_x0        = st->x0;
+        l->bbox_y0        = st->y0;
+        l->bbox_x1        = st->x1;
+        l->bbox_y1        = st->y1;
+        l->mean_intensity = (uint8_t)(st->isum / st->voxels);
+    }
+}
+
+/* =====================================================================
+ * Passes
+ * ===================================================================*/
+static void add_cycles(VolumeResult *res, const OtsuAccelResult *r)
+{
+    for (uint32_t s = 0; s < HLS_NUM_STAGES; s++)
+        res->hw_cycles += r->stage_cycles[s];
+}
+
+/* ---- Pass 1: stack histogram, any instance ---- */
+static int volume_histogram(const uint8_t *slices, uint32_t depth, uint8_t mode,
+                            VolumeResult *res)
+{
+    uint32_t next = 0, done = 0;
+    int ok = 1;
+
+    memset(volume_hist, 0, sizeof(volume_hist));
+    while (done < depth) {
+        if (next < depth &&
+            dispatcher_submit(slices + next * IMG_SIZE, mode | HLS_OTSU_MODE_HIST, next) >= 0)
+            next++;
+
+        dispatcher_poll();
+        DispatchResult r;
+        while (dispatcher_collect(&r)) {
+            if (r.status != 0) {
+                ok = 0;
+            } else {
+                otsu_accel_add_histogram(r.mask, volume_hist);
+            }
+            add_cycles(res, &r.result);
+            done++;
+        }
+    }
+    return ok ? 0 : -1;
+}
+
+/* ---- Pass 2: call k enters slice k (a flush past the last) ---- */
+static void start_slice(const OtsuAccel *acc, const uint8_t *slices,
+                        uint32_t depth, uint8_t mode, uint32_t k)
+{
+    uint8_t m = mode | HLS_OTSU_MODE_FIXED_THR | HLS_OTSU_MODE_VOLUME;
+    if (k == 0)
+        m |= HLS_OTSU_MODE_VOL_START;
+    if (k < depth)
+        image_load_to_buffer(acc->in_addr, slices + k * IMG_SIZE);
+    else
+        m |= HLS_OTSU_MODE_VOL_FLUSH;
+    otsu_accel_start(acc, m);
+}
+
+/* ------------------------------------------------------------------ */
+int volume_segment(const uint8_t *slices, uint16_t depth, uint8_t mode,
+                   uint8_t *mask, VolumeResult *result)
+{
+    if (depth == 0 || depth > VOLUME_MAX_DEPTH)
+        return -1;
+
+    memset(result, 0, sizeof(*result));
+    result->depth = depth;
+
+    /* ---- Pass 1: one threshold for the stack ---- */
+    if (volume_histogram(slices, depth, mode, result) != 0)
+        return -1;
+    result->threshold = tiler_threshold(volume_hist, (uint32_t)depth * IMG_SIZE, mode);
+
+    /* ---- Pass 2: slice stream on instance 0, labelled one behind ---- */
+    OtsuAccel acc;
+    otsu_accel_init(&acc, 0);
+    otsu_accel_set_threshold(&acc, result->threshold);
+
+    Labeller lb;
+    lb.result     = result;
+    lb.next_label = 0;
+
+    uint32_t calls = depth + HLS_OTSU_VOLUME_LAG(mode);
+    start_slice(&acc, slices, depth, mode, 0);
+    for (uint32_t k = 0; k < calls; k++) {
+        if (otsu_accel_wait_done(&acc) != 0)
+            return -1;
+        OtsuAccelResult r;
+        otsu_accel_read_result(&acc, &r);
+        add_cycles(result, &r);
+
+        /* Copy the finished slice out before the next call overwrites it */
+        uint32_t z = k - HLS_OTSU_VOLUME_LAG(mode);
+        if (r.slice_ready) {
+            image_copy(mask + z * IMG_SIZE, PHYS_PTR(acc.out_addr), IMG_SIZE);
+            result->foreground += r.moments.count;
+        }
+
+        if (k + 1U < calls)
+            start_slice(&acc, slices, depth, mode, k + 1U);
+        if (r.slice_ready)
+            add_slice(&lb, mask + z * IMG_SIZE, slices + z * IMG_SIZE, z);
+    }
+
+    finish_lesions(&lb);
+    return 0;
+}
@@ -0,0 +1,99 @@
+/******************************************************************************
+ * volume.h
+ * ---------
+ * Segmentation of MRI volumes: stacks of IMG_WIDTH x IMG_HEIGHT slices
+ * thresholded, cleaned up and labelled in 3D rather than slice by slice.
+ *
+ * The slices and the output mask live in memory the CPU addresses.  Two
+ * passes:
+ *
+ *   1. histogram – every slice runs with HLS_OTSU_MODE_HIST through the
+ *      dispatcher; the summed histogram gives one threshold for the whole
+ *      stack (tiler_threshold(): Otsu, plus the MODE_CAREFUL fall-back).
+ *   2. slices – streamed in order through instance 0 with
+ *      HLS_OTSU_MODE_VOLUME and that threshold.  The kernel's 3x3x3
+ *      morphology hands back slice z - HLS_OTSU_VOLUME_LAG(mode) per call
+ *      and is flushed after the last slice.
+ *
+ * Each finished slice is labelled in-plane (watershed_label_components())
+ * while the kernel works on the next one, and its labels are joined to
+ * those of the slice before through a union-find: same pixel for
+ * VOLUME_CONNECTIVITY 6, its 3x3 neighbourhood for 26.  The previous
+ * slice's labels are kept in VOLUME_PREV_LABEL_BASE.
+ *****************************************************************************/
+#ifndef VOLUME_H
+#define VOLUME_H
+
+#include <stdint.h>
+#include "platform_config.h"
+#include "adaptive_controller.h"
+#include "watershed.h"
+
+/* Largest stack (keeps the z moments within 32 bits) */
+#ifndef VOLUME_MAX_DEPTH
+#define VOLUME_MAX_DEPTH 256
+#endif
+
+/* Slice labels across the whole volume (union-find and statistics, 30
+ * bytes each); components beyond are dropped from the lesion list */
+#ifndef VOLUME_MAX_LABELS
+#define VOLUME_MAX_LABELS 1024
+#endif
+
+/* 6 (face neighbours) or 26 (face, edge and corner) */
+#ifndef VOLUME_CONNECTIVITY
+#define VOLUME_CONNECTIVITY 26
+#endif
+
+/**
+ * One connected component of the volume mask.
+ */
+typedef struct
+{
+    uint32_t volume;         /* voxels                              */
+    uint32_t intensity_sum;  /* sum of the slices under the lesion  */
+    uint16_t centroid_x;     /* centre of mass                      */
+    uint16_t centroid_y;
+    uint16_t centroid_z;     /* slice index                         */
+    uint16_t bbox_z0;        /* first / last slice                  */
+    uint16_t bbox_z1;
+    uint8_t bbox_x0;         /* in-plane bounding box               */
+    uint8_t bbox_y0;
+    uint8_t bbox_x1;
+    uint8_t bbox_y1;
+    uint8_t mean_intensity;  /* intensity_sum / volume              */
+} VolumeLesion;
+
+/**
+ * Result of volume_segment().
+ */
+typedef struct
+{
+    uint8_t threshold;       /* volume threshold applied            */
+    uint8_t label_overflow;  /* 1 = more than VOLUME_MAX_LABELS
+                              * slice labels, lesions incomplete    */
+    uint16_t depth;          /* slices                              */
+    uint32_t foreground;     /* mask voxels                         */
+    uint32_t hw_cycles;      /* kernel cycles, both passes          */
+    uint16_t total_lesions;  /* connected components                */
+    uint8_t num_lesions;     /* entries in lesions[]                */
+    VolumeLesion lesions[MAX_REGIONS]; /* largest first             */
+} VolumeResult;
+
+/**
+ * Segment a volume of @p depth slices.  Uses the dispatcher
+ * (dispatcher_init() first), instance 0 and the watershed scratch;
+ * nothing else may be in flight on the dispatcher.
+ *
+ * @param slices  depth x IMG_SIZE bytes, slice after slice
+ * @param depth   1 .. VOLUME_MAX_DEPTH
+ * @param mode    PROCESSING_MODE_FAST / NORMAL / CAREFUL
+ * @param mask    Output: binary mask (0 / 255), depth x IMG_SIZE bytes
+ * @param result  Output: threshold and lesions
+ * @return        0 on success, -1 for an unsupported depth or an
+ *                accelerator timeout
+ */
+int volume_segment(const uint8_t *slices, uint16_t depth, uint8_t mode,
+                   uint8_t *mask, VolumeResult *result);
+
+#endif /* VOLUME_H */
@@ -3,119 +3,1096 @@
  * -------------
  * Connected-component labelling for binary tumor masks.
  *
- * Uses a simple scanline flood-fill (no recursion, constant stack) so it
- * runs safely on MicroBlaze with limited stack space.
+ * Two raster passes with a union-find equivalence table: the first gives
+ * every foreground pixel a provisional label from its already-visited
+ * neighbours and records which labels touch; the second replaces each
+ * provisional label by its component's final label.  Region areas, then
+ * the listed regions' statistics, follow from the finished label map.  Coordinates are tracked as loop counters, so there
+ * are no per-pixel divides, and the runtime is linear in the image size
+ * whatever the mask looks like.
  *
- * Large scratch buffers (BFS queue, label map) live in the image BRAM
- * scratch area (WATERSHED_QUEUE_BASE / WATERSHED_LABEL_BASE) to avoid
- * overflowing the 64 KB LMB BRAM.
+ * A run-based variant (watershed_label_runs) does the same over row runs
+ * of foreground pixels, and watershed_flood() is the marker-based
+ * watershed of the Python model, which also splits touching tumors.
+ * The listed regions' outlines are traced afterwards on the label map.
+ *
+ * The label map and the equivalence table (afterwards the region areas)
+ * live in the image BRAM scratch area (WATERSHED_LABEL_BASE /
+ * WATERSHED_EQUIV_BASE) to avoid overflowing the 64 KB LMB BRAM.
  *****************************************************************************/
 #include "watershed.h"
 #include "uart_debug.h"
 #include <string.h>
+#include <math.h>
 
-/* ---- BFS queue stored in image BRAM scratch (32 KB: uint16_t[16384]) ---- */
-#define QUEUE_CAP   IMG_SIZE
-#define QUEUE_BUF   ((volatile uint16_t *)(WATERSHED_QUEUE_BASE))
+/* ---- Per-pixel label map stored in image BRAM scratch (32 KB) ---- */
+#define LABEL_MAP   ((volatile uint16_t *)PHYS_PTR(WATERSHED_LABEL_BASE))
 
-/* ---- Per-pixel label map stored in image BRAM scratch (16 KB) ---- */
-#define LABEL_MAP   ((volatile uint8_t *)(WATERSHED_LABEL_BASE))
+/*
+ * Union-find table stored in image BRAM scratch (16 KB).  PARENT(l) is
+ * the parent of provisional label l (1-based).  A parent is always smaller
+ * than its child, so a component's root is the first label it received,
+ * i.e. roots come in raster order of the components' first pixels.  At
+ * most IMG_SIZE / 2 provisional labels exist (4-connected checkerboard).
+ */
+#define EQUIV       ((volatile uint16_t *)PHYS_PTR(WATERSHED_EQUIV_BASE))
+#define PARENT(l)   EQUIV[(l) - 1U]
 
-static uint32_t q_head, q_tail;
+static uint16_t uf_find(uint16_t l)
+{
+    while (PARENT(l) != l) {
+        uint16_t gp = PARENT(PARENT(l));
+        PARENT(l) = gp;             /* path halving */
+        l = gp;
+    }
+    return l;
+}
 
-static void q_reset(void)        { q_head = q_tail = 0; }
-static int  q_empty(void)        { return q_head == q_tail; }
+/* Merge the sets of @p a and @p b; returns the common root */
+static uint16_t uf_union(uint16_t a, uint16_t b)
+{
+    a = uf_find(a);
+    b = uf_find(b);
+    if (a < b) {
+        PARENT(b) = a;
+        return a;
+    }
+    PARENT(a) = b;
+    return b;
+}
+
+/* ---- Pass 1: provisional labels; returns how many were issued ---- */
+static uint16_t label_pass(const uint8_t *mask, uint8_t connectivity)
+{
+    volatile uint16_t *map = LABEL_MAP;
+    uint16_t next = 0;
+    uint32_t i = 0;
+
+    for (uint32_t y = 0; y < IMG_HEIGHT; y++) {
+        uint16_t left = 0;
+        for (uint32_t x = 0; x < IMG_WIDTH; x++, i++) {
+            uint16_t l = 0;
+            if (mask[i] != 0) {
+                uint16_t up = y ? map[i - IMG_WIDTH] : 0;
+                if (connectivity == 8) {
+                    if (up) {
+                        /* Up touches left, up-left and up-right, whose
+                         * labels were already merged with it */
+                        l = up;
+                    } else {
+                        uint16_t ul = (y && x) ? map[i - IMG_WIDTH - 1U] : 0;
+                        uint16_t ur = (y && x + 1U < IMG_WIDTH) ? map[i - IMG_WIDTH + 1U] : 0;
+                        l = left ? left : ul;     /* left and up-left touch */
+                        if (ur)
+                            l = l ? uf_union(l, ur) : ur;
+                    }
+                } else {
+                    l = up ? up : left;
+                    if (up && left && up != left)
+                        l = uf_union(up, left);
+                }
+                if (!l) {
+                    l = ++next;
+                    PARENT(l) = l;
+                }
+            }
+            map[i] = l;
+            left   = l;
+        }
+    }
+    return next;
+}
 
 /*
- * Queue is circular buffer with power-of-2 size.
- * Use bitwise AND instead of modulo for efficiency on MicroBlaze (no divider).
+ * Rewrite the table in place so PARENT(l) is the final label of l: roots
+ * in ascending order get 1, 2, ...  A non-root's parent is smaller, hence
+ * already rewritten.  Returns the number of components.
  */
-#define QUEUE_MASK  (QUEUE_CAP - 1)
+static uint16_t resolve_labels(uint16_t count)
+{
+    uint16_t regions = 0;
+    for (uint16_t l = 1; l <= count; l++) {
+        uint16_t p = PARENT(l);
+        PARENT(l) = p == l ? ++regions : PARENT(p);
+    }
+    return regions;
+}
+
+/* =====================================================================
+ * Region statistics shared by the variants
+ *
+ * Every final label gets an area, kept as uint16_t in the union-find
+ * scratch (REGION_AREA): there are at most IMG_SIZE / 2 labels, the bound
+ * the table already has for provisional labels.  Each variant counts the
+ * areas in the pass that writes its final labels.  The MAX_REGIONS
+ * largest are then picked from the areas with a min-heap, and one pass
+ * over the label map (or run table) gathers the other statistics
+ * (intensities included) of just those into a small table in LMB, a whole
+ * run of equal label at a time.  The pick needs every area first, so
+ * this statistics pass cannot be folded into the labelling.
+ * ===================================================================*/
+#define REGION_AREA   ((volatile uint16_t *)PHYS_PTR(WATERSHED_EQUIV_BASE))
+#define AREA(f)       REGION_AREA[(f) - 1U]
+#define REGION_LISTED 0x8000U   /* AREA(f) = REGION_LISTED | slot once picked;
+                                   areas are <= IMG_SIZE < 0x8000 */
+
+typedef struct
+{
+    uint32_t sum_x;           /* sum of x over the region's pixels */
+    uint32_t sum_y;
+    uint32_t intensity_sum;
+    uint32_t intensity_sq;
+    uint16_t area;            /* <= IMG_SIZE                       */
+    uint8_t  bbox_x0;         /* coordinates < 256                 */
+    uint8_t  bbox_y0;
+    uint8_t  bbox_x1;
+    uint8_t  bbox_y1;
+} RegionEntry;
+
+static RegionEntry listed[MAX_REGIONS];
+static uint16_t listed_label[MAX_REGIONS];
+static uint32_t listed_count;
 
-static int  q_full(void)         { return ((q_tail - q_head) & 0xFFFF) >= QUEUE_CAP; }
-static void q_push(uint16_t v)   {
-    if (q_full()) return;  /* silently drop if full */
-    QUEUE_BUF[q_tail & QUEUE_MASK] = v;
-    q_tail++;
+/* Zero areas for regions 1..@p count */
+static void regions_begin(uint32_t count)
+{
+    volatile uint16_t *area = REGION_AREA;
+    for (uint32_t f = 0; f < count; f++)
+        area[f] = 0;
 }
-static uint16_t q_pop(void)      {
-    uint16_t v = QUEUE_BUF[q_head & QUEUE_MASK];
-    q_head++;
-    return v;
+
+/* Areas of a labelled row (label map row @p map, 0 = background), as
+ * runs of equal label.  Returns its foreground pixel count. */
+static uint32_t region_count_row(volatile const uint16_t *map)
+{
+    uint32_t fg = 0, x = 0;
+    while (x < IMG_WIDTH) {
+        uint16_t f = map[x];
+        if (!f) {
+            x++;
+            continue;
+        }
+        uint32_t x0 = x;
+        do
+            x++;
+        while (x < IMG_WIDTH && map[x] == f);
+        AREA(f) += (uint16_t)(x - x0);
+        fg += x - x0;
+    }
+    return fg;
 }
 
-/* ------------------------------------------------------------------ */
-void watershed_segment(const uint8_t *mask, WatershedResult *result)
+/* Region with label @p a ranks above @p b: larger, or as large and earlier */
+static int region_ranks_above(uint16_t a, uint16_t b)
+{
+    volatile uint16_t *area = REGION_AREA;
+    return area[a - 1U] > area[b - 1U] || (area[a - 1U] == area[b - 1U] && a < b);
+}
+
+/* Restore the heap below @p k; the lowest-ranked region is at the root */
+static void heap_sift_down(uint16_t *heap, uint32_t n, uint32_t k)
+{
+    for (;;) {
+        uint32_t low = k, c = 2U * k + 1U;
+        if (c < n && region_ranks_above(heap[low], heap[c]))
+            low = c;
+        if (c + 1U < n && region_ranks_above(heap[low], heap[c + 1U]))
+            low = c + 1U;
+        if (low == k)
+            return;
+        uint16_t tmp = heap[k];
+        heap[k] = heap[low];
+        heap[low] = tmp;
+        k = low;
+    }
+}
+
+/*
+ * Pick the MAX_REGIONS largest of the @p count regions with a min-heap in
+ * one scan of the areas, in label order, and mark them in REGION_AREA for
+ * the statistics pass.
+ */
+static void regions_select(uint32_t count)
+{
+    uint16_t *heap = listed_label;
+    uint32_t n = 0;
+
+    for (uint32_t l = 1; l <= count; l++) {
+        if (n < MAX_REGIONS) {
+            /* Sift up */
+            uint32_t k = n++;
+            heap[k] = (uint16_t)l;
+            while (k && region_ranks_above(heap[(k - 1U) / 2U], heap[k])) {
+                uint16_t tmp = heap[k];
+                heap[k] = heap[(k - 1U) / 2U];
+                heap[(k - 1U) / 2U] = tmp;
+                k = (k - 1U) / 2U;
+            }
+        } else if (region_ranks_above((uint16_t)l, heap[0])) {
+            heap[0] = (uint16_t)l;
+            heap_sift_down(heap, n, 0);
+        }
+    }
+
+    /* Back to label (raster) order */
+    for (uint32_t i = 1; i < n; i++)
+        for (uint32_t j = i; j && heap[j - 1U] > heap[j]; j--) {
+            uint16_t tmp = heap[j];
+            heap[j] = heap[j - 1U];
+            heap[j - 1U] = tmp;
+        }
+
+    memset(listed, 0, sizeof(listed));
+    for (uint32_t k = 0; k < n; k++) {
+        listed[k].bbox_x0 = IMG_WIDTH;
+        listed[k].bbox_y0 = IMG_HEIGHT;
+        AREA(heap[k]) = (uint16_t)(REGION_LISTED | k);
+    }
+    listed_count = n;
+}
+
+/* Pixels @p x0..@p x1 of row @p y belong to region @p f; @p image is the
+ * row's grayscale values or NULL.  Only listed regions are accumulated. */
+static void region_add_run(uint32_t f, uint32_t y, uint32_t x0, uint32_t x1,
+                           const uint8_t *image)
+{
+    uint16_t a = AREA(f);
+    if (!(a & REGION_LISTED))
+        return;
+    RegionEntry *e = &listed[a & ~REGION_LISTED];
+    uint32_t len = x1 - x0 + 1U;
+    e->area  += (uint16_t)len;
+    e->sum_x += ((x0 + x1) * len) >> 1;   /* x0 + .. + x1 */
+    e->sum_y += y * len;
+    if (image)
+        for (uint32_t x = x0; x <= x1; x++) {
+            uint32_t v = image[x];
+            e->intensity_sum += v;
+            e->intensity_sq  += v * v;
+        }
+    if (x0 < e->bbox_x0) e->bbox_x0 = (uint8_t)x0;
+    if (y  < e->bbox_y0) e->bbox_y0 = (uint8_t)y;
+    if (x1 > e->bbox_x1) e->bbox_x1 = (uint8_t)x1;
+    if (y  > e->bbox_y1) e->bbox_y1 = (uint8_t)y;
+}
+
+/* Statistics of a labelled row, as runs of equal label */
+static void region_add_row(volatile const uint16_t *map, const uint8_t *image,
+                           uint32_t y)
+{
+    uint32_t x = 0;
+    while (x < IMG_WIDTH) {
+        uint16_t f = map[x];
+        if (!f) {
+            x++;
+            continue;
+        }
+        uint32_t x0 = x;
+        do
+            x++;
+        while (x < IMG_WIDTH && map[x] == f);
+        region_add_run(f, y, x0, x - 1U, image);
+    }
+}
+
+/* Fill @p result from the listed regions */
+static void regions_finish(WatershedResult *result, uint32_t count, uint32_t foreground)
 {
-    /* Clear output */
     memset(result, 0, sizeof(*result));
-    for (uint32_t i = 0; i < IMG_SIZE; i++) LABEL_MAP[i] = 0;
+    for (uint32_t k = 0; k < listed_count; k++) {
+        const RegionEntry *e = &listed[k];
+        RegionInfo *r = &result->regions[k];
+        r->label         = listed_label[k];
+        r->area          = e->area;
+        r->centroid_x    = (uint16_t)(e->sum_x / e->area);
+        r->centroid_y    = (uint16_t)(e->sum_y / e->area);
+        r->bbox_x0       = e->bbox_x0;
+        r->bbox_y0       = e->bbox_y0;
+        r->bbox_x1       = e->bbox_x1;
+        r->bbox_y1       = e->bbox_y1;
+        r->intensity_sum = e->intensity_sum;
+        r->intensity_sq  = e->intensity_sq;
+    }
+    result->num_regions      = (uint8_t)listed_count;
+    result->total_regions    = (uint16_t)count;
+    result->total_foreground = foreground;
+}
+
+/* Regions 1..@p count, with their areas in place: pick, then gather the
+ * listed ones' statistics from the label map */
+static void regions_collect(uint32_t count, uint32_t foreground, const uint8_t *image,
+                            WatershedResult *result)
+{
+    volatile uint16_t *map = LABEL_MAP;
+
+    regions_select(count);
+    for (uint32_t y = 0; y < IMG_HEIGHT; y++)
+        region_add_row(map + y * IMG_WIDTH, image ? image + y * IMG_WIDTH : 0, y);
+    regions_finish(result, count, foreground);
+}
+
+/* Areas, then statistics, from a finished label map with final labels
+ * 1..@p count */
+static void regions_from_map(uint32_t count, const uint8_t *image,
+                             WatershedResult *result)
+{
+    volatile uint16_t *map = LABEL_MAP;
+    uint32_t fg = 0;
+
+    regions_begin(count);
+    for (uint32_t y = 0; y < IMG_HEIGHT; y++)
+        fg += region_count_row(map + y * IMG_WIDTH);
+    regions_collect(count, fg, image, result);
+}
+
+/* ------------------------------------------------------------------ */
+void watershed_segment(const uint8_t *mask, const uint8_t *image,
+                       WatershedResult *result)
+{
+#if WATERSHED_VARIANT == WATERSHED_VARIANT_FLOOD
+    watershed_flood(mask, image, result);
+#elif WATERSHED_VARIANT == WATERSHED_VARIANT_SPANS
+    watershed_label_spans(mask, image, WATERSHED_CONNECTIVITY, result);
+#elif WATERSHED_VARIANT == WATERSHED_VARIANT_RUNS
+    watershed_label_runs(mask, image, WATERSHED_CONNECTIVITY, result);
+#else
+    watershed_label_components(mask, image, WATERSHED_CONNECTIVITY, result);
+#endif
+#if WATERSHED_HAS_LABEL_MAP
+    watershed_measure_contours(result);
+#endif
+}
+
+/* ------------------------------------------------------------------ */
+void watershed_label_components(const uint8_t *mask, const uint8_t *image,
+                                uint8_t connectivity, WatershedResult *result)
+{
+    volatile uint16_t *map = LABEL_MAP;
+    uint16_t issued = label_pass(mask, connectivity);
+    uint16_t count  = resolve_labels(issued);
+
+    /* ---- Pass 2: final labels; the union-find table is free after it.
+     *      The areas are counted behind the provisional labels' entries,
+     *      then moved down to REGION_AREA. ---- */
+    if ((uint32_t)issued + count <= IMG_SIZE / 2U) {
+        volatile uint16_t *area = EQUIV + issued - 1U;   /* area[f], f >= 1 */
+        uint32_t fg = 0;
+        for (uint32_t f = 1; f <= count; f++)
+            area[f] = 0;
+        for (uint32_t i = 0; i < IMG_SIZE; i++) {
+            if (map[i]) {
+                uint16_t f = PARENT(map[i]);
+                map[i] = f;
+                area[f]++;
+                fg++;
+            }
+        }
+        for (uint32_t f = 1; f <= count; f++)
+            AREA(f) = area[f];
+        regions_collect(count, fg, image, result);
+        return;
+    }
+
+    /* Both tables do not fit (4-connected speckle): areas in a pass of
+     * their own */
+    for (uint32_t i = 0; i < IMG_SIZE; i++)
+        if (map[i])
+            map[i] = PARENT(map[i]);
 
-    uint8_t current_label = 0;
+    regions_from_map(count, image, result);
+}
+
+/* =====================================================================
+ * Run-based labelling
+ *
+ * Each row is encoded into runs of foreground pixels; runs that touch a
+ * run of the previous row are merged in the same union-find table (one
+ * entry per run instead of per pixel), and region statistics follow from
+ * each run's extent.  The run table reuses the label map's scratch area,
+ * so this variant leaves no label map.
+ * ===================================================================*/
+typedef struct
+{
+    uint8_t x0;      /* first pixel                               */
+    uint8_t x1;      /* last pixel                                */
+    uint16_t label;  /* final label, once the table is resolved   */
+} Run;
+
+#define RUNS        ((volatile Run *)PHYS_PTR(WATERSHED_LABEL_BASE))
 
-    for (uint32_t idx = 0; idx < IMG_SIZE; idx++) {
-        /* Skip background or already labelled */
-        if (mask[idx] == 0 || LABEL_MAP[idx] != 0)
+/* First x >= @p x whose pixel is foreground (fg = 1) / background (fg = 0),
+ * or IMG_WIDTH.  Whole words of background (or 255 foreground) are skipped
+ * four pixels at a time. */
+static uint32_t scan_row(const uint8_t *row, uint32_t x, int fg)
+{
+    const uint32_t skip = fg ? 0U : 0xFFFFFFFFU;
+    int aligned = (((uintptr_t)row) & 3U) == 0;
+
+    while (x < IMG_WIDTH) {
+        if (aligned && (x & 3U) == 0 && x + 4U <= IMG_WIDTH &&
+            *(const uint32_t *)(row + x) == skip) {
+            x += 4;
             continue;
+        }
+        if ((row[x] != 0) == fg)
+            return x;
+        x++;
+    }
+    return IMG_WIDTH;
+}
 
-        if (current_label >= MAX_REGIONS)
-            break;
+/* ---- Append run [x0, x1] as run n + 1 and merge it with the touching
+ *      runs of the previous row (runs prev.. up to first) ---- */
+static void run_link(uint16_t n, uint16_t first, uint16_t *prev,
+                     uint32_t x0, uint32_t x1, uint32_t reach)
+{
+    volatile Run *runs = RUNS;
+
+    runs[n].x0 = (uint8_t)x0;
+    runs[n].x1 = (uint8_t)x1;
+    PARENT(n + 1U) = (uint16_t)(n + 1U);
+
+    /* Previous-row runs touching [x0 - reach, x1 + reach]; the last of
+     * them may touch the next run too, so stay on it */
+    while (*prev < first && runs[*prev].x1 + reach < x0)
+        (*prev)++;
+    for (uint16_t p = *prev; p < first && runs[p].x0 <= x1 + reach; p++)
+        uf_union((uint16_t)(p + 1U), (uint16_t)(n + 1U));
+}
+
+/* ---- Encode the mask and merge touching runs; returns the run count ---- */
+static uint16_t run_pass(const uint8_t *mask, uint8_t connectivity,
+                         uint16_t row_first[IMG_HEIGHT + 1])
+{
+    const uint32_t reach = connectivity == 8 ? 1U : 0U;   /* diagonal slack */
+    uint16_t n = 0, prev = 0;
+
+    for (uint32_t y = 0; y < IMG_HEIGHT; y++) {
+        const uint8_t *row = mask + y * IMG_WIDTH;
+        uint16_t first = n;
+        row_first[y] = n;
+
+        uint32_t x = scan_row(row, 0, 1);
+        while (x < IMG_WIDTH) {
+            uint32_t end = scan_row(row, x, 0);
+            run_link(n++, first, &prev, x, end - 1U, reach);
+            x = end < IMG_WIDTH ? scan_row(row, end, 1) : IMG_WIDTH;
+        }
+        prev = first;
+    }
+    row_first[IMG_HEIGHT] = n;
+    return n;
+}
+
+/* ---- Merge the kernel's runs (HLS_OTSU_MODE_RLE); returns the run count ---- */
+static uint16_t rle_pass(const uint32_t *rle, uint16_t count, uint8_t connectivity,
+                         uint16_t row_first[IMG_HEIGHT + 1])
+{
+    const uint32_t reach = connectivity == 8 ? 1U : 0U;
+    uint16_t n = 0, prev = 0;
+
+    for (uint32_t y = 0; y < IMG_HEIGHT; y++) {
+        uint16_t first = n;
+        row_first[y] = n;
+
+        /* One word per run: x0 | length << 8 | y << 16, rows ascending */
+        for (uint32_t w; n < count && ((w = rle[n]) >> 16 & 0xFFU) == y; ) {
+            uint32_t x0 = w & 0xFFU;
+            run_link(n++, first, &prev, x0, x0 + (w >> 8 & 0xFFU) - 1U, reach);
+        }
+        prev = first;
+    }
+    row_first[IMG_HEIGHT] = n;
+    return n;
+}
+
+/* ---- Region statistics from each run's extent ---- */
+static void runs_regions(uint16_t count, const uint16_t row_first[IMG_HEIGHT + 1],
+                         const uint8_t *image, WatershedResult *result)
+{
+    volatile Run *runs = RUNS;
+    uint16_t n = row_first[IMG_HEIGHT];
+    uint32_t fg = 0;
+
+    /* Final labels into the runs, which frees the union-find table */
+    for (uint16_t k = 0; k < n; k++)
+        runs[k].label = PARENT(k + 1U);
+
+    regions_begin(count);
+    for (uint16_t k = 0; k < n; k++) {
+        uint32_t len = runs[k].x1 - runs[k].x0 + 1U;
+        AREA(runs[k].label) += (uint16_t)len;
+        fg += len;
+    }
+
+    regions_select(count);
+    for (uint32_t y = 0; y < IMG_HEIGHT; y++)
+        for (uint16_t k = row_first[y]; k < row_first[y + 1U]; k++)
+            region_add_run(runs[k].label, y, runs[k].x0, runs[k].x1,
+                           image ? image + y * IMG_WIDTH : 0);
+
+    regions_finish(result, count, fg);
+}
+
+/* ------------------------------------------------------------------ */
+void watershed_label_runs(const uint8_t *mask, const uint8_t *image,
+                          uint8_t connectivity, WatershedResult *result)
+{
+    uint16_t row_first[IMG_HEIGHT + 1];
+    uint16_t count = resolve_labels(run_pass(mask, connectivity, row_first));
+
+    runs_regions(count, row_first, image, result);
+}
+
+/* ------------------------------------------------------------------ */
+void watershed_label_rle(const uint32_t *rle, uint16_t count, const uint8_t *image,
+                         uint8_t connectivity, WatershedResult *result)
+{
+    uint16_t row_first[IMG_HEIGHT + 1];
+    uint16_t labels = resolve_labels(rle_pass(rle, count, connectivity, row_first));
+
+    runs_regions(labels, row_first, image, result);
+}
+
+/* =====================================================================
+ * Marker-based watershed (as otsu_watershed.py)
+ *
+ *   1. 3-4 chamfer distance of every mask pixel to the background
+ *   2. markers: 8-connected components of distance > 0.4 * max
+ *   3. priority flood from the markers over the mask, highest distance
+ *      first: a pixel takes the label of the neighbour that reached it,
+ *      so touching tumors split along the distance valley between them
+ *
+ * The flood is a 256-level bucket queue: a pixel is queued once, at
+ * min(its distance, current level), so the level only ever falls and the
+ * whole flood is O(N).  Mask pixels no marker reaches (blobs too thin to
+ * hold a marker) stay unlabelled.  Scratch, per pixel:
+ *   DIST (WATERSHED_EQUIV_BASE, uint8)   distance; the label once reached
+ *   LINK (WATERSHED_LABEL_BASE, uint16)  FLOOD_REACHED | next pixel + 1 in
+ *                                        its bucket; finally the label map
+ * ===================================================================*/
+#define DIST             ((volatile uint8_t *)PHYS_PTR(WATERSHED_EQUIV_BASE))
+#define LINK             LABEL_MAP
+#define FLOOD_REACHED    0x8000U
+#define FLOOD_NEXT       0x7FFFU
+#define CHAMFER_EDGE     3U
+#define CHAMFER_DIAG     4U
+#define DIST_INF         254U      /* above any 3-4 distance in the image */
+#define MARKER_BUCKET    255U      /* marker growth, ahead of any level   */
+#define FLOOD_MAX_LABELS 255U
+
+static uint16_t bucket_head[256];   /* pixel + 1, 0 = empty */
+static uint16_t bucket_tail[256];
 
-        current_label++;
-        RegionInfo *r = &result->regions[current_label - 1];
-        r->label    = current_label;
-        r->area     = 0;
-        r->bbox_x0  = IMG_WIDTH;
-        r->bbox_y0  = IMG_HEIGHT;
-        r->bbox_x1  = 0;
-        r->bbox_y1  = 0;
-        uint32_t sum_x = 0, sum_y = 0;
-
-        /* BFS flood fill */
-        q_reset();
-        q_push((uint16_t)idx);
-        LABEL_MAP[idx] = current_label;
-
-        while (!q_empty()) {
-            uint16_t p  = q_pop();
-            uint16_t px = (uint16_t)(p % IMG_WIDTH);
-            uint16_t py = (uint16_t)(p / IMG_WIDTH);
-
-            r->area++;
-            sum_x += px;
-            sum_y += py;
-
-            if (px < r->bbox_x0) r->bbox_x0 = px;
-            if (py < r->bbox_y0) r->bbox_y0 = py;
-            if (px > r->bbox_x1) r->bbox_x1 = px;
-            if (py > r->bbox_y1) r->bbox_y1 = py;
-
-            /* 4-connected neighbours */
-            int16_t dx[] = {-1, 1, 0, 0};
-            int16_t dy[] = {0, 0, -1, 1};
-            for (int d = 0; d < 4; d++) {
-                int16_t nx = (int16_t)px + dx[d];
-                int16_t ny = (int16_t)py + dy[d];
-                if (nx < 0 || nx >= IMG_WIDTH || ny < 0 || ny >= IMG_HEIGHT)
+static uint32_t min_u32(uint32_t a, uint32_t b)
+{
+    return a < b ? a : b;
+}
+
+/* ---- Two-pass 3-4 chamfer distance; clears LINK, returns the maximum.
+ *      Pixels outside the image count as background. ---- */
+static uint32_t chamfer_pass(const uint8_t *mask)
+{
+    volatile uint8_t *dist = DIST;
+    volatile uint16_t *link = LINK;
+    uint32_t i = 0, dmax = 0;
+
+    for (uint32_t y = 0; y < IMG_HEIGHT; y++) {
+        for (uint32_t x = 0; x < IMG_WIDTH; x++, i++) {
+            uint32_t d = 0;
+            link[i] = 0;
+            if (mask[i] != 0) {
+                int up = y != 0, left = x != 0, right = x + 1U < IMG_WIDTH;
+                d = DIST_INF;
+                d = min_u32(d, (left ? dist[i - 1U] : 0U) + CHAMFER_EDGE);
+                d = min_u32(d, (up ? dist[i - IMG_WIDTH] : 0U) + CHAMFER_EDGE);
+                d = min_u32(d, (up && left ? dist[i - IMG_WIDTH - 1U] : 0U) + CHAMFER_DIAG);
+                d = min_u32(d, (up && right ? dist[i - IMG_WIDTH + 1U] : 0U) + CHAMFER_DIAG);
+            }
+            dist[i] = (uint8_t)d;
+        }
+    }
+
+    for (uint32_t y = IMG_HEIGHT; y-- > 0;) {
+        for (uint32_t x = IMG_WIDTH; x-- > 0;) {
+            i--;
+            uint32_t d = dist[i];
+            if (!d)
+                continue;
+            int down = y + 1U < IMG_HEIGHT, left = x != 0, right = x + 1U < IMG_WIDTH;
+            d = min_u32(d, (right ? dist[i + 1U] : 0U) + CHAMFER_EDGE);
+            d = min_u32(d, (down ? dist[i + IMG_WIDTH] : 0U) + CHAMFER_EDGE);
+            d = min_u32(d, (down && right ? dist[i + IMG_WIDTH + 1U] : 0U) + CHAMFER_DIAG);
+            d = min_u32(d, (down && left ? dist[i + IMG_WIDTH - 1U] : 0U) + CHAMFER_DIAG);
+            dist[i] = (uint8_t)d;
+            if (d > dmax)
+                dmax = d;
+        }
+    }
+    return dmax;
+}
+
+/* ---- Bucket queue, linked through LINK ---- */
+static void bq_push(uint32_t bucket, uint32_t i, uint8_t label)
+{
+    DIST[i] = label;
+    LINK[i] = FLOOD_REACHED;
+    if (bucket_tail[bucket])
+        LINK[bucket_tail[bucket] - 1U] |= (uint16_t)(i + 1U);
+    else
+        bucket_head[bucket] = (uint16_t)(i + 1U);
+    bucket_tail[bucket] = (uint16_t)(i + 1U);
+}
+
+/* Oldest pixel of @p bucket, or -1 if it is empty */
+static int32_t bq_pop(uint32_t bucket)
+{
+    uint16_t h = bucket_head[bucket];
+    if (!h)
+        return -1;
+    uint16_t next = LINK[h - 1U] & FLOOD_NEXT;
+    bucket_head[bucket] = next;
+    if (!next)
+        bucket_tail[bucket] = 0;
+    return (int32_t)h - 1;
+}
+
+/*
+ * Queue neighbour @p n of a pixel labelled @p label that is being expanded
+ * at @p level.  While markers grow (level MARKER_BUCKET), marker pixels
+ * (distance > @p thresh) join through any neighbour; everything else is
+ * flooded through edge neighbours only.
+ */
+static void flood_reach(uint32_t n, uint32_t level, uint8_t label,
+                        uint32_t thresh, int edge)
+{
+    if (LINK[n] & FLOOD_REACHED)
+        return;
+    uint32_t d = DIST[n];
+    if (!d)
+        return;
+    if (level == MARKER_BUCKET && d > thresh)
+        bq_push(MARKER_BUCKET, n, label);
+    else if (edge)
+        bq_push(min_u32(d, level), n, label);
+}
+
+static void flood_expand(uint32_t i, uint32_t level, uint32_t thresh)
+{
+    uint8_t label = DIST[i];
+    uint32_t x = i % IMG_WIDTH;
+    int up = i >= IMG_WIDTH, down = i + IMG_WIDTH < IMG_SIZE;
+    int left = x != 0, right = x + 1U < IMG_WIDTH;
+
+    if (up)    flood_reach(i - IMG_WIDTH, level, label, thresh, 1);
+    if (left)  flood_reach(i - 1U,        level, label, thresh, 1);
+    if (right) flood_reach(i + 1U,        level, label, thresh, 1);
+    if (down)  flood_reach(i + IMG_WIDTH, level, label, thresh, 1);
+    if (level != MARKER_BUCKET)
+        return;
+    if (up && left)    flood_reach(i - IMG_WIDTH - 1U, level, label, thresh, 0);
+    if (up && right)   flood_reach(i - IMG_WIDTH + 1U, level, label, thresh, 0);
+    if (down && left)  flood_reach(i + IMG_WIDTH - 1U, level, label, thresh, 0);
+    if (down && right) flood_reach(i + IMG_WIDTH + 1U, level, label, thresh, 0);
+}
+
+/* ------------------------------------------------------------------ */
+void watershed_flood(const uint8_t *mask, const uint8_t *image,
+                     WatershedResult *result)
+{
+    volatile uint8_t *dist = DIST;
+    volatile uint16_t *link = LINK;
+    int32_t p;
+
+    uint32_t dmax = chamfer_pass(mask);
+    uint32_t thresh = (2U * dmax) / 5U;     /* d > thresh <=> d > 0.4 * dmax */
+    memset(bucket_head, 0, sizeof(bucket_head));
+    memset(bucket_tail, 0, sizeof(bucket_tail));
+
+    /* ---- Markers, numbered in raster order of their first pixel; each
+     *      one's edge neighbours are queued at their own distance ---- */
+    uint32_t markers = 0;
+    for (uint32_t i = 0; i < IMG_SIZE && markers < FLOOD_MAX_LABELS; i++) {
+        if ((link[i] & FLOOD_REACHED) || dist[i] <= thresh)
+            continue;
+        bq_push(MARKER_BUCKET, i, (uint8_t)++markers);
+        while ((p = bq_pop(MARKER_BUCKET)) >= 0)
+            flood_expand((uint32_t)p, MARKER_BUCKET, thresh);
+    }
+
+    /* ---- Flood, highest level first ---- */
+    for (uint32_t level = dmax; level > 0; level--)
+        while ((p = bq_pop(level)) >= 0)
+            flood_expand((uint32_t)p, level, thresh);
+
+    /* ---- Label map, with the areas counted in bucket_head (free after
+     *      the flood; REGION_AREA is still DIST); DIST is free after it ---- */
+    uint16_t *area = bucket_head;
+    uint32_t fg = 0;
+    memset(bucket_head, 0, sizeof(bucket_head));
+    for (uint32_t i = 0; i < IMG_SIZE; i++) {
+        uint16_t l = 0;
+        if (link[i] & FLOOD_REACHED) {
+            l = dist[i];
+            area[l]++;
+            fg++;
+        }
+        link[i] = l;
+    }
+    for (uint32_t l = 1; l <= markers; l++)
+        AREA(l) = area[l];
+
+    regions_collect(markers, fg, image, result);
+}
+
+/* ------------------------------------------------------------------ */
+uint8_t watershed_select(WatershedResult *result, uint8_t img_mean, uint8_t img_std)
+{
+    /* mean >= img_mean + factor * img_std, in tenths: no float, no divide */
+    uint32_t bar = 10U * img_mean + WATERSHED_INTENSITY_FACTOR_X10 * (uint32_t)img_std;
+    uint8_t selected = 0, best = 0;
+
+    for (uint8_t k = 0; k < result->num_regions; k++) {
+        RegionInfo *r = &result->regions[k];
+        r->selected = r->area >= WATERSHED_MIN_AREA &&
+                      10U * r->intensity_sum >= r->area * bar;
+        selected += r->selected;
+
+        /* Brightest region (larger on ties), compared as sum_k / area_k */
+        const RegionInfo *b = &result->regions[best];
+        uint64_t lhs = (uint64_t)r->intensity_sum * b->area;
+        uint64_t rhs = (uint64_t)b->intensity_sum * r->area;
+        if (lhs > rhs || (lhs == rhs && r->area > b->area))
+            best = k;
+    }
+
+    /* Nothing qualifies: keep the brightest region, as the Python model */
+    if (!selected && result->num_regions) {
+        result->regions[best].selected = 1;
+        selected = 1;
+    }
+    return selected;
+}
+
+/* ------------------------------------------------------------------ */
+void watershed_select_mask(const WatershedResult *result, uint8_t *out)
+{
+    volatile uint16_t *map = LABEL_MAP;
+
+    /* Only the selected regions' bounding boxes are read back */
+    memset(out, 0, IMG_SIZE);
+    for (uint8_t k = 0; k < result->num_regions; k++) {
+        const RegionInfo *r = &result->regions[k];
+        if (!r->selected)
+            continue;
+        for (uint32_t y = r->bbox_y0; y <= r->bbox_y1; y++)
+            for (uint32_t i = y * IMG_WIDTH + r->bbox_x0; i <= y * IMG_WIDTH + r->bbox_x1; i++)
+                if (map[i] == r->label)
+                    out[i] = 255;
+    }
+}
+
+/* =====================================================================
+ * Scanline span fill
+ *
+ * Raster scan; each unlabelled foreground pixel seeds a new region, which
+ * is filled span by span: a span is a maximal run of the region in one
+ * row, labelled and added to the region's area when found, then pushed so
+ * the rows above and below it are searched for further spans.  The stack
+ * holds spans, not pixels, and lives in LMB (WATERSHED_SPAN_STACK
+ * entries).  No union-find links are needed: the equivalence table only
+ * holds the region areas.
+ *
+ * A span that does not fit on the stack is still labelled, and the
+ * region's rows are swept once the stack drains to pick up its
+ * neighbours, so a full stack costs time but never loses pixels.
+ * ===================================================================*/
+typedef struct
+{
+    uint8_t x0;   /* first pixel */
+    uint8_t x1;   /* last pixel  */
+    uint8_t y;
+    uint8_t pad;
+} Span;
+
+typedef struct
+{
+    const uint8_t *mask;
+    uint32_t reach;             /* diagonal slack, 1 for 8-connectivity */
+    uint16_t label;
+    uint32_t fg;
+    uint32_t y0, y1;            /* rows the region reached so far      */
+    uint32_t depth;
+    int overflow;
+    Span stack[WATERSHED_SPAN_STACK];
+} SpanFill;
+
+/* Label the span of row @p y through @p x (foreground, unlabelled), add it
+ * to the region and push it; returns its last pixel */
+static uint32_t span_take(SpanFill *sf, uint32_t x, uint32_t y)
+{
+    volatile uint16_t *row = LABEL_MAP + y * IMG_WIDTH;
+    const uint8_t *m = sf->mask + y * IMG_WIDTH;
+    uint32_t x0 = x, x1 = x;
+
+    while (x0 > 0 && m[x0 - 1U] && !row[x0 - 1U])
+        x0--;
+    while (x1 + 1U < IMG_WIDTH && m[x1 + 1U] && !row[x1 + 1U])
+        x1++;
+    for (x = x0; x <= x1; x++)
+        row[x] = sf->label;
+    AREA(sf->label) += (uint16_t)(x1 - x0 + 1U);
+    sf->fg += x1 - x0 + 1U;
+    if (y < sf->y0) sf->y0 = y;
+    if (y > sf->y1) sf->y1 = y;
+
+    if (sf->depth < WATERSHED_SPAN_STACK) {
+        Span *s = &sf->stack[sf->depth++];
+        s->x0 = (uint8_t)x0;
+        s->x1 = (uint8_t)x1;
+        s->y  = (uint8_t)y;
+    } else {
+        sf->overflow = 1;
+    }
+    return x1;
+}
+
+/* Take every unlabelled span of row @p y touching [@p x0, @p x1] */
+static void span_search(SpanFill *sf, uint32_t y, uint32_t x0, uint32_t x1)
+{
+    volatile uint16_t *row = LABEL_MAP + y * IMG_WIDTH;
+    const uint8_t *m = sf->mask + y * IMG_WIDTH;
+
+    x0 = x0 >= sf->reach ? x0 - sf->reach : 0U;
+    x1 = x1 + sf->reach < IMG_WIDTH ? x1 + sf->reach : IMG_WIDTH - 1U;
+    for (uint32_t x = x0; x <= x1; x++)
+        if (m[x] && !row[x])
+            x = span_take(sf, x, y);
+}
+
+/* Search above and below the span @p x0..@p x1 of row @p y */
+static void span_neighbours(SpanFill *sf, uint32_t y, uint32_t x0, uint32_t x1)
+{
+    if (y > 0)
+        span_search(sf, y - 1U, x0, x1);
+    if (y + 1U < IMG_HEIGHT)
+        span_search(sf, y + 1U, x0, x1);
+}
+
+static void span_fill(SpanFill *sf, uint32_t x, uint32_t y)
+{
+    sf->y0 = sf->y1 = y;
+    sf->overflow = 0;
+    span_take(sf, x, y);
+
+    for (;;) {
+        while (sf->depth) {
+            const Span *s = &sf->stack[--sf->depth];
+            span_neighbours(sf, s->y, s->x0, s->x1);
+        }
+        if (!sf->overflow)
+            return;
+
+        /* Some spans were not pushed: search around all of the region's
+         * spans again (the rows grow as it does) */
+        sf->overflow = 0;
+        for (uint32_t yy = sf->y0; yy <= sf->y1; yy++) {
+            volatile uint16_t *row = LABEL_MAP + yy * IMG_WIDTH;
+            for (uint32_t xx = 0; xx < IMG_WIDTH; xx++) {
+                if (row[xx] != sf->label)
                     continue;
-                uint16_t ni = (uint16_t)((uint32_t)ny * IMG_WIDTH + (uint32_t)nx);
-                if (mask[ni] != 0 && LABEL_MAP[ni] == 0) {
-                    LABEL_MAP[ni] = current_label;
-                    q_push(ni);
-                }
+                uint32_t x0 = xx;
+                while (xx + 1U < IMG_WIDTH && row[xx + 1U] == sf->label)
+                    xx++;
+                span_neighbours(sf, yy, x0, xx);
             }
         }
+    }
+}
+
+/* ------------------------------------------------------------------ */
+void watershed_label_spans(const uint8_t *mask, const uint8_t *image,
+                           uint8_t connectivity, WatershedResult *result)
+{
+    volatile uint16_t *map = LABEL_MAP;
+    static SpanFill sf;
+
+    sf.mask  = mask;
+    sf.reach = connectivity == 8 ? 1U : 0U;
+    sf.label = 0;
+    sf.fg    = 0;
+    sf.depth = 0;
+
+    for (uint32_t i = 0; i < IMG_SIZE; i++)
+        map[i] = 0;
 
-        /* Compute centroid */
-        if (r->area > 0) {
-            r->centroid_x = (uint16_t)(sum_x / r->area);
-            r->centroid_y = (uint16_t)(sum_y / r->area);
+    uint32_t i = 0;
+    for (uint32_t y = 0; y < IMG_HEIGHT; y++) {
+        uint32_t x = scan_row(mask + i, 0, 1);
+        while (x < IMG_WIDTH) {
+            if (!map[i + x]) {
+                AREA(++sf.label) = 0;
+                span_fill(&sf, x, y);
+            }
+            /* Skip the rest of this run: it is labelled now */
+            x = scan_row(mask + i, x, 0);
+            x = x < IMG_WIDTH ? scan_row(mask + i, x, 1) : IMG_WIDTH;
         }
+        i += IMG_WIDTH;
+    }
+
+    regions_collect(sf.label, sf.fg, image, result);
+}
+
+/* =====================================================================
+ * Contour tracing
+ *
+ * Moore neighbour tracing on the label map: from the region's first pixel
+ * (whose left, upper-left, upper and upper-right neighbours are outside),
+ * the 8 neighbours of the current pixel are scanned clockwise starting at
+ * the last outside one, and the first region pixel found is the next
+ * step.  The walk ends when it is about to leave the first pixel in its
+ * first direction again (Jacob's criterion), so one-pixel-wide parts are
+ * walked out and back.  Only the pixels around the contour are read.
+ * ===================================================================*/
+static const int8_t chain_dx[8] = { 1, 1, 0, -1, -1, -1, 0, 1 };
+static const int8_t chain_dy[8] = { 0, -1, -1, -1, 0, 1, 1, 1 };
 
-        result->total_foreground += r->area;
+/* Pixel (@p x, @p y) belongs to region @p label; outside the image not */
+static int in_region(int32_t x, int32_t y, uint16_t label)
+{
+    return x >= 0 && x < IMG_WIDTH && y >= 0 && y < IMG_HEIGHT &&
+           LABEL_MAP[(uint32_t)y * IMG_WIDTH + (uint32_t)x] == label;
+}
+
+/* Direction of the first region pixel around (@p x, @p y), scanning
+ * clockwise from direction @p from; -1 for an isolated pixel */
+static int32_t moore_step(int32_t x, int32_t y, uint32_t from, uint16_t label)
+{
+    for (uint32_t k = 0; k < 8U; k++) {
+        uint32_t d = (from - k) & 7U;
+        if (in_region(x + chain_dx[d], y + chain_dy[d], label))
+            return (int32_t)d;
     }
+    return -1;
+}
 
-    result->num_regions = current_label;
+/*
+ * Trace region @p r from its first pixel.  Returns the number of steps
+ * and sets @p diagonal to how many of them were diagonal; the codes go to
+ * @p c (if not NULL) as far as they fit.
+ */
+static uint32_t trace(const RegionInfo *r, RegionContour *c, uint32_t *diagonal)
+{
+    volatile uint16_t *row = LABEL_MAP + (uint32_t)r->bbox_y0 * IMG_WIDTH;
+    uint32_t x0 = r->bbox_x0, n = 0;
+
+    while (x0 < r->bbox_x1 && row[x0] != r->label)
+        x0++;
+    if (c) {
+        memset(c, 0, sizeof(*c));
+        c->label   = r->label;
+        c->start_x = (uint8_t)x0;
+        c->start_y = (uint8_t)r->bbox_y0;
+    }
+
+    int32_t x = (int32_t)x0, y = r->bbox_y0;
+    int32_t first = moore_step(x, y, 4U, r->label);   /* west is outside */
+    int32_t d = first;
+    *diagonal = 0;
+    while (d >= 0) {
+        if (c && n < WATERSHED_CHAIN_STEPS) {
+            uint32_t bit = 3U * n;
+            c->chain[bit >> 3] |= (uint8_t)(d << (bit & 7U));
+            if ((bit & 7U) > 5U)
+                c->chain[(bit >> 3) + 1U] |= (uint8_t)(d >> (8U - (bit & 7U)));
+        }
+        n++;
+        *diagonal += (uint32_t)d & 1U;
+        x += chain_dx[d];
+        y += chain_dy[d];
+
+        /* Resume at the outside neighbour scanned just before this step */
+        d = moore_step(x, y, ((uint32_t)d + 2U + ((uint32_t)d & 1U)) & 7U, r->label);
+        if (x == (int32_t)x0 && y == r->bbox_y0 && d == first)
+            break;
+    }
+
+    if (c) {
+        c->steps  = (uint16_t)n;
+        c->stored = (uint16_t)(n < WATERSHED_CHAIN_STEPS ? n : WATERSHED_CHAIN_STEPS);
+    }
+    return n;
+}
+
+/* ------------------------------------------------------------------ */
+void watershed_trace_contour(const RegionInfo *r, RegionContour *contour)
+{
+    uint32_t diagonal;
+    trace(r, contour, &diagonal);
+}
+
+/* ------------------------------------------------------------------ */
+void watershed_measure_contours(WatershedResult *result)
+{
+    for (uint8_t k = 0; k < result->num_regions; k++) {
+        RegionInfo *r = &result->regions[k];
+        uint32_t diagonal;
+        uint32_t straight = trace(r, NULL, &diagonal) - diagonal;
+
+        /* sqrt 2 as 14142 / 10000, rounded to tenths of a pixel.  The walk
+         * joins pixel centres, half a pixel inside the region's outline;
+         * moving a closed outline out by 1/2 lengthens it by 2 pi x 1/2,
+         * so pi (31.4 tenths) is added back */
+        uint32_t p10 = straight + diagonal == 0U ? 0U :
+                       (straight * 10000U + diagonal * 14142U + 31416U + 500U) / 1000U;
+        r->perimeter_x10   = (uint16_t)(p10 < 0xFFFFU ? p10 : 0xFFFFU);
+        /* 4 pi x 100 x 10^2 = 125664, for a perimeter in tenths */
+        uint32_t pct = p10 ? r->area * 125664U / p10 / p10 : 0U;
+        r->compactness_pct = (uint16_t)(pct < 100U ? pct : 100U);
+    }
+}
+
+/* ------------------------------------------------------------------ */
+void watershed_from_moments(const ForegroundMoments *m, WatershedResult *result)
+{
+    memset(result, 0, sizeof(*result));
+    if (m->count == 0)
+        return;
+
+    RegionInfo *r = &result->regions[0];
+    r->label      = 1;
+    r->area       = m->count;
+    r->centroid_x = (uint16_t)(m->sum_x / m->count);
+    r->centroid_y = (uint16_t)(m->sum_y / m->count);
+    r->bbox_x0    = m->bbox_x0;
+    r->bbox_y0    = m->bbox_y0;
+    r->bbox_x1    = m->bbox_x1;
+    r->bbox_y1    = m->bbox_y1;
+    r->selected   = 1;
+
+    result->num_regions      = 1;
+    result->total_regions    = 1;
+    result->total_foreground = m->count;
+}
+
+/* ------------------------------------------------------------------ */
+int16_t watershed_moments_orientation(const ForegroundMoments *m)
+{
+    if (m->count == 0)
+        return 0;
+
+    /* Central second moments (scaled by count) */
+    float n    = (float)m->count;
+    float mx   = (float)m->sum_x / n;
+    float my   = (float)m->sum_y / n;
+    float mu20 = (float)m->sum_xx / n - mx * mx;
+    float mu02 = (float)m->sum_yy / n - my * my;
+    float mu11 = (float)m->sum_xy / n - mx * my;
+
+    /* theta = 0.5 * atan2(2*mu11, mu20 - mu02) */
+    float theta = 0.5f * atan2f(2.0f * mu11, mu20 - mu02);
+    return (int16_t)lroundf(theta * (180.0f / 3.14159265f));
 }
 
 /* ------------------------------------------------------------------ */
@@ -123,7 +1100,9 @@ void watershed_print_summary(const WatershedResult *result)
 {
     uart_print("=== Watershed Results ===\r\n");
 
-    uart_print_uint("Regions found: ", result->num_regions);
+    uart_print_uint("Regions found: ", result->total_regions);
+    if (result->total_regions > result->num_regions)
+        uart_print_uint("Largest listed: ", result->num_regions);
     uart_print_uint("Total foreground pixels: ", result->total_foreground);
 
     for (uint8_t i = 0; i < result->num_regions; i++) {
@@ -137,6 +1116,13 @@ void watershed_print_summary(const WatershedResult *result)
         uart_print_uint("  BBox Y0:   ", r->bbox_y0);
         uart_print_uint("  BBox X1:   ", r->bbox_x1);
         uart_print_uint("  BBox Y1:   ", r->bbox_y1);
+        if (r->intensity_sum)
+            uart_print_uint("  Mean int.: ", r->intensity_sum / r->area);
+        if (r->perimeter_x10) {
+            uart_print_uint("  Perimeter: ", (r->perimeter_x10 + 5U) / 10U);
+            uart_print_uint("  Compact. %:", r->compactness_pct);
+        }
+        uart_print(r->selected ? "  Selected:   yes\r\n" : "  Selected:   no\r\n");
     }
     uart_print("=========================\r\n");
 }
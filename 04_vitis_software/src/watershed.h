@@ -4,18 +4,90 @@
  * Software-side watershed-like post-processing for the binary mask produced
  * by the HLS Otsu accelerator.
  *
- * Implements connected-component labelling to identify distinct tumor regions
- * and compute region statistics (area, centroid, bounding box).
+ * Implements the marker-based watershed of otsu_watershed.py (distance
+ * transform, markers, priority flood) and plain connected-component
+ * labelling (two-pass, union-find) to identify distinct tumor regions and
+ * compute region statistics (area, centroid, bounding box, perimeter),
+ * plus the regions' outlines as Freeman chain codes.
  *****************************************************************************/
 #ifndef WATERSHED_H
 #define WATERSHED_H
 
 #include <stdint.h>
 #include "platform_config.h"
+#include "otsu_accel.h" /* ForegroundMoments */
 
-/* Maximum number of distinct tumors we track */
+/*
+ * Number of regions listed in a WatershedResult: the largest ones by area.
+ * Every region is still labelled and counted (up to 65535).
+ */
 #define MAX_REGIONS 16
 
+/*
+ * When set, a non-empty HLS mask is assumed to hold a single tumor and the
+ * region descriptor is built directly from the accelerator's moments, so
+ * watershed_segment() is skipped entirely.  Leave at 0 for multi-tumor data.
+ */
+#ifndef WATERSHED_SINGLE_TUMOR_FASTPATH
+#define WATERSHED_SINGLE_TUMOR_FASTPATH 0
+#endif
+
+/* Pixel connectivity of the labelling variants: 4 or 8 */
+#ifndef WATERSHED_CONNECTIVITY
+#define WATERSHED_CONNECTIVITY 4
+#endif
+
+/*
+ * Segmentation behind watershed_segment():
+ *   WATERSHED_VARIANT_PIXEL – per-pixel two-pass labelling, writes the
+ *                             label map (watershed_label_components)
+ *   WATERSHED_VARIANT_RUNS  – row runs, cost scales with the number of
+ *                             runs; no label map (watershed_label_runs)
+ *   WATERSHED_VARIANT_FLOOD – marker-based watershed, splits touching
+ *                             tumors; writes the label map (watershed_flood)
+ *   WATERSHED_VARIANT_SPANS – scanline span fill, writes the label map and
+ *                             needs no union-find links
+ *                             (watershed_label_spans)
+ * PIXEL, RUNS and SPANS give identical region lists (connected components).
+ */
+#define WATERSHED_VARIANT_PIXEL 0
+#define WATERSHED_VARIANT_RUNS  1
+#define WATERSHED_VARIANT_FLOOD 2
+#define WATERSHED_VARIANT_SPANS 3
+#ifndef WATERSHED_VARIANT
+#define WATERSHED_VARIANT WATERSHED_VARIANT_FLOOD
+#endif
+
+/* Span stack of watershed_label_spans(), in LMB (4 bytes per entry) */
+#ifndef WATERSHED_SPAN_STACK
+#define WATERSHED_SPAN_STACK 512
+#endif
+
+/*
+ * True if WATERSHED_VARIANT leaves the label map behind, which
+ * watershed_select_mask() and the contour tracing read
+ */
+#define WATERSHED_HAS_LABEL_MAP (WATERSHED_VARIANT != WATERSHED_VARIANT_RUNS)
+
+/* Chain-code steps a RegionContour holds (3 bits each) */
+#ifndef WATERSHED_CHAIN_STEPS
+#define WATERSHED_CHAIN_STEPS 1024
+#endif
+#define WATERSHED_CHAIN_BYTES ((3U * WATERSHED_CHAIN_STEPS + 7U) / 8U)
+
+/*
+ * Region selection (watershed_select), as otsu_watershed.py: a region is
+ * kept if it has at least WATERSHED_MIN_AREA pixels and a mean intensity
+ * of at least image mean + WATERSHED_INTENSITY_FACTOR_X10 / 10 x image
+ * standard deviation.
+ */
+#ifndef WATERSHED_MIN_AREA
+#define WATERSHED_MIN_AREA 200U
+#endif
+#ifndef WATERSHED_INTENSITY_FACTOR_X10
+#define WATERSHED_INTENSITY_FACTOR_X10 7U
+#endif
+
 /**
  * Descriptor for one connected component (tumor candidate).
  */
@@ -28,31 +100,207 @@ typedef struct
     uint16_t bbox_y0;    /* bounding-box top-left Y                   */
     uint16_t bbox_x1;    /* bounding-box bottom-right X               */
     uint16_t bbox_y1;    /* bounding-box bottom-right Y               */
-    uint8_t label;       /* region label (1, 2, …)                    */
+    uint32_t intensity_sum; /* sum of image values over the region    */
+    uint32_t intensity_sq;  /* sum of squared image values            */
+    uint16_t label;      /* region label in the label map (1, 2, …)   */
+    uint8_t selected;    /* kept by watershed_select()                */
+    uint16_t perimeter_x10;   /* outer outline length x 10: the contour
+                               * through pixel centres plus pi for the
+                               * half pixel outside it (0: not traced)   */
+    uint16_t compactness_pct; /* 4 pi area / perimeter^2, at most 100;
+                               * digital discs give about 85..95, as the
+                               * diagonal steps overstate the perimeter */
 } RegionInfo;
 
+/**
+ * Outer contour of one region as a Freeman chain code: from the region's
+ * first pixel in raster order, walking clockwise, one 3-bit code per
+ * step to the next boundary pixel (0 = +X, 1 = +X-Y, 2 = -Y, …
+ * 7 = +X+Y), packed LSB first.  A contour longer than WATERSHED_CHAIN_STEPS is
+ * counted in full but only its first steps are kept.
+ */
+typedef struct
+{
+    uint16_t label;
+    uint8_t start_x;     /* first pixel of the region                 */
+    uint8_t start_y;
+    uint16_t steps;      /* contour length in steps (0: single pixel) */
+    uint16_t stored;     /* steps held in chain[]                     */
+    uint8_t chain[WATERSHED_CHAIN_BYTES];
+} RegionContour;
+
 /**
  * Result of watershed post-processing.
- * label_map is stored in WATERSHED_LABEL_BASE (image BRAM) to save LMB BRAM.
+ * The label map (uint16_t per pixel, 0 = background) is stored in
+ * WATERSHED_LABEL_BASE (image BRAM) to save LMB BRAM; the area of every
+ * region, which picks the listed ones, goes to WATERSHED_EQUIV_BASE once
+ * the union-find table is done with.
  */
 typedef struct
 {
-    uint8_t num_regions;             /* how many regions found   */
-    RegionInfo regions[MAX_REGIONS]; /* region descriptors       */
-    uint32_t total_foreground;       /* total foreground pixels  */
+    uint8_t num_regions;             /* regions listed, largest first kept */
+    RegionInfo regions[MAX_REGIONS]; /* region descriptors, label order    */
+    uint16_t total_regions;          /* regions found, all labelled        */
+    uint32_t total_foreground;       /* labelled foreground pixels         */
 } WatershedResult;
 
 /**
- * Run connected-component labelling on a binary mask.
+ * Segment a binary mask with WATERSHED_VARIANT (and, for the labelling
+ * variants, WATERSHED_CONNECTIVITY).
+ *
+ * The mask is expected to contain 0 (background) and non-zero (foreground).
+ * Regions are numbered in raster order of their first pixel (of their
+ * marker, for the flood).  All of them are labelled and counted; the
+ * MAX_REGIONS largest (the earlier on equal area) are listed, in label
+ * order, whatever their label: every region's area is kept (up to
+ * IMG_SIZE / 2 regions, a 4-connected checkerboard).
+ * With a label map (WATERSHED_HAS_LABEL_MAP) the listed regions' contours
+ * are measured as well (watershed_measure_contours).
  *
- * The mask is expected to contain 0 (background) and 255 (foreground).
- * Uses a two-pass flood-fill approach (stack-free BFS with scanline trick)
- * suitable for the MicroBlaze memory footprint.
+ * Intensity sums come from @p image, for the listed regions only (NULL:
+ * left at 0).
  *
  * @param mask       Input binary mask (IMG_SIZE bytes, 0 or 255)
+ * @param image      Grayscale image the mask was computed from, or NULL
+ * @param result     Output: region list (and label map, except RUNS)
+ */
+void watershed_segment(const uint8_t *mask, const uint8_t *image,
+                       WatershedResult *result);
+
+/**
+ * watershed_segment() with an explicit connectivity.
+ *
+ * @param mask          Input binary mask (IMG_SIZE bytes)
+ * @param image         Grayscale image for the intensity sums, or NULL
+ * @param connectivity  4 (edge neighbours) or 8 (edge and corner)
+ * @param result        Output: region list and label map
+ */
+void watershed_label_components(const uint8_t *mask, const uint8_t *image,
+                                uint8_t connectivity, WatershedResult *result);
+
+/**
+ * Run-based labelling: rows are encoded into runs of foreground pixels,
+ * touching runs of consecutive rows are merged and the region statistics
+ * are computed per run.  Same regions as watershed_label_components(),
+ * but the label map is not written (its scratch holds the run table).
+ *
+ * @param mask          Input binary mask (IMG_SIZE bytes)
+ * @param image         Grayscale image for the intensity sums, or NULL
+ * @param connectivity  4 or 8
+ * @param result        Output: region list
+ */
+void watershed_label_runs(const uint8_t *mask, const uint8_t *image,
+                          uint8_t connectivity, WatershedResult *result);
+
+/**
+ * Run-based labelling of the accelerator's run-length output
+ * (HLS_OTSU_MODE_RLE): as watershed_label_runs() with the runs taken from
+ * the kernel instead of encoded from the mask.  No label map.
+ *
+ * @param rle           Kernel runs, one word each (x0 | length << 8 |
+ *                      y << 16), rows ascending
+ * @param count         Number of runs (OtsuAccelResult.run_count)
+ * @param image         Grayscale image for the intensity sums, or NULL
+ * @param connectivity  4 or 8
+ * @param result        Output: region list
+ */
+void watershed_label_rle(const uint32_t *rle, uint16_t count, const uint8_t *image,
+                         uint8_t connectivity, WatershedResult *result);
+
+/**
+ * Scanline span fill: each region is filled from its first pixel span by
+ * span, with a stack of row spans (WATERSHED_SPAN_STACK entries) instead
+ * of a per-pixel queue.  Same regions and label map as
+ * watershed_label_components() without the union-find table; a region
+ * that overflows the stack is finished by re-sweeping its rows.
+ *
+ * @param mask          Input binary mask (IMG_SIZE bytes)
+ * @param image         Grayscale image for the intensity sums, or NULL
+ * @param connectivity  4 or 8
+ * @param result        Output: region list and label map
+ */
+void watershed_label_spans(const uint8_t *mask, const uint8_t *image,
+                           uint8_t connectivity, WatershedResult *result);
+
+/**
+ * Marker-based watershed, as otsu_watershed.py: 3-4 chamfer distance to
+ * the background, markers = 8-connected components of distance > 0.4 x
+ * the maximum, then a priority flood from the markers (highest distance
+ * first, 4-connected) over a 256-level bucket queue.  Touching tumors
+ * split along the narrowing between them; mask pixels no marker reaches
+ * are left unlabelled and not counted.  The bucket queue and the distance
+ * map use the label-map and equivalence-table scratch; the label map is
+ * written.
+ *
+ * @param mask       Input binary mask (IMG_SIZE bytes)
+ * @param image      Grayscale image for the intensity sums, or NULL
  * @param result     Output: region list and label map
  */
-void watershed_segment(const uint8_t *mask, WatershedResult *result);
+void watershed_flood(const uint8_t *mask, const uint8_t *image,
+                     WatershedResult *result);
+
+/**
+ * Mark the regions that pass the intensity selection of otsu_watershed.py
+ * (WATERSHED_MIN_AREA, WATERSHED_INTENSITY_FACTOR_X10), from the sums
+ * gathered for the listed regions; no pixel is read.  If none passes, the region
+ * with the highest mean intensity is kept, as in the Python model.
+ *
+ * @param result     Region list with intensity sums; selected flags set
+ * @param img_mean   Mean of the image
+ * @param img_std    Standard deviation of the image
+ * @return           Number of selected regions
+ */
+uint8_t watershed_select(WatershedResult *result, uint8_t img_mean, uint8_t img_std);
+
+/**
+ * Write the final mask: 255 on pixels of selected regions, 0 elsewhere.
+ * Only the selected regions' bounding boxes of the label map are read, so
+ * it needs the label map of the PIXEL, FLOOD or SPANS variant.
+ *
+ * @param result     Region list after watershed_select()
+ * @param out        Output mask (IMG_SIZE bytes)
+ */
+void watershed_select_mask(const WatershedResult *result, uint8_t *out);
+
+/**
+ * Trace the outer contour of a listed region in the label map (Moore
+ * neighbour tracing, 8-connected) into a Freeman chain code.  Holes are
+ * not traced.  Needs the label map of the PIXEL, FLOOD or SPANS variant.
+ *
+ * @param r          Region of the last segmentation
+ * @param contour    Output: start pixel, length and chain code
+ */
+void watershed_trace_contour(const RegionInfo *r, RegionContour *contour);
+
+/**
+ * Fill perimeter_x10 and compactness_pct of every listed region from its
+ * traced contour (straight steps count 1, diagonal steps sqrt 2).  Reads
+ * only the pixels around each contour, not the whole label map.
+ *
+ * @param result     Region list with the label map still in place
+ */
+void watershed_measure_contours(WatershedResult *result);
+
+/**
+ * Fill a single-region result from the accelerator's foreground moments.
+ *
+ * Zero-pass alternative to watershed_segment() for single-tumor inputs:
+ * area, centroid and bounding box come straight from the moments.  The
+ * label map and intensity sums are not written; the region is selected.
+ *
+ * @param m          Foreground moments read back from the accelerator
+ * @param result     Output: zero or one region
+ */
+void watershed_from_moments(const ForegroundMoments *m, WatershedResult *result);
+
+/**
+ * Principal-axis orientation of the foreground from its second moments.
+ *
+ * @param m          Foreground moments
+ * @return           Angle of the major axis in degrees (-90..90, 0 = +X,
+ *                   positive = towards +Y); 0 for empty masks
+ */
+int16_t watershed_moments_orientation(const ForegroundMoments *m);
 
 /**
  * Print a human-readable summary of the watershed result via UART.
@@ -0,0 +1,145 @@
+/******************************************************************************
+ * bench_watershed.c
+ * ------------------
+ * Desktop benchmark of the segmentation variants in watershed.c:
+ * per-pixel two-pass labelling (watershed_label_components) against
+ * run-based labelling (watershed_label_runs) and the scanline span fill
+ * (watershed_label_spans), and the marker-based watershed (watershed_flood), on masks shaped like the accelerator
+ * output (one or a few compact tumors, touching or not) and on noisy ones.
+ *
+ * Host wall-clock time per call, best of several repetitions.  On the
+ * MicroBlaze every scratch access is an AXI BRAM access, so the gap is
+ * wider there than on the host.
+ *
+ * Build / run (from 04_vitis_software):
+ *   make bench
+ ******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "platform_config.h"
+#include "watershed.h"
+
+#define CALLS 200
+#define REPS  5
+
+static uint8_t mask[IMG_SIZE];
+static uint8_t image[IMG_SIZE];
+
+typedef void (*LabelFn)(const uint8_t *, const uint8_t *, uint8_t, WatershedResult *);
+
+static void flood(const uint8_t *m, const uint8_t *img, uint8_t conn, WatershedResult *res)
+{
+    (void)conn;
+    watershed_flood(m, img, res);
+}
+
+static uint32_t rng = 7;
+static uint32_t rand32(void)
+{
+    rng = rng * 1664525U + 1013904223U;
+    return rng >> 8;
+}
+
+static void blob(int cx, int cy, int rx, int ry)
+{
+    for (int y = cy - ry; y <= cy + ry; y++)
+        for (int x = cx - rx; x <= cx + rx; x++)
+            if (x >= 0 && x < IMG_WIDTH && y >= 0 && y < IMG_HEIGHT &&
+                (x - cx) * (x - cx) * ry * ry + (y - cy) * (y - cy) * rx * rx <=
+                    rx * rx * ry * ry)
+                mask[y * IMG_WIDTH + x] = 255;
+}
+
+static double ns_per_call(LabelFn fn, uint8_t conn)
+{
+    WatershedResult res;
+    double best = 1e30;
+    for (int r = 0; r < REPS; r++) {
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        for (int c = 0; c < CALLS; c++)
+            fn(mask, image, conn, &res);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        double ns = ((double)(t1.tv_sec - t0.tv_sec) * 1e9 +
+                     (double)(t1.tv_nsec - t0.tv_nsec)) / CALLS;
+        if (ns < best)
+            best = ns;
+    }
+    return best;
+}
+
+static uint32_t count_runs(void)
+{
+    uint32_t runs = 0;
+    for (uint32_t i = 0; i < IMG_SIZE; i++)
+        if (mask[i] && (i % IMG_WIDTH == 0 || !mask[i - 1]))
+            runs++;
+    return runs;
+}
+
+static void bench(const char *name)
+{
+    WatershedResult a, b, s, w;
+    watershed_label_components(mask, image, 4, &a);
+    watershed_label_runs(mask, image, 4, &b);
+    watershed_label_spans(mask, image, 4, &s);
+    watershed_flood(mask, image, &w);
+
+    double pixel = ns_per_call(watershed_label_components, 4);
+    double runs  = ns_per_call(watershed_label_runs, 4);
+    double spans = ns_per_call(watershed_label_spans, 4);
+    double fl    = ns_per_call(flood, 4);
+    printf("  %-24s %5u runs %3u regions  pixel %8.0f ns  runs %8.0f ns  %5.1fx"
+           "  spans %8.0f ns  | flood %3u regions %8.0f ns%s\n",
+           name, (unsigned)count_runs(), (unsigned)a.total_regions, pixel, runs,
+           pixel / runs, spans, (unsigned)w.total_regions, fl,
+           memcmp(&a, &b, sizeof(a)) || memcmp(&a, &s, sizeof(a)) ? "  MISMATCH" : "");
+}
+
+/* ------------------------------------------------------------------ */
+int main(void)
+{
+    printf("Segmentation variants (%dx%d mask, 4-connected labelling, "
+           "with intensity sums)\n", IMG_WIDTH, IMG_HEIGHT);
+
+    for (uint32_t i = 0; i < IMG_SIZE; i++)
+        image[i] = (uint8_t)rand32();
+
+    memset(mask, 0, sizeof(mask));
+    bench("empty");
+
+    blob(64, 64, 6, 6);
+    bench("one small tumor");
+
+    memset(mask, 0, sizeof(mask));
+    blob(60, 70, 28, 22);
+    bench("one large tumor");
+
+    memset(mask, 0, sizeof(mask));
+    blob(30, 30, 12, 9);
+    blob(90, 40, 15, 20);
+    blob(70, 100, 20, 10);
+    bench("three tumors");
+
+    memset(mask, 0, sizeof(mask));
+    blob(40, 60, 16, 16);
+    blob(70, 60, 16, 16);
+    bench("two touching tumors");
+
+    memset(mask, 0, sizeof(mask));
+    blob(30, 30, 12, 9);
+    blob(90, 40, 15, 20);
+    blob(70, 100, 20, 10);
+
+    for (uint32_t i = 0; i < IMG_SIZE; i++)
+        if (rand32() % 100U < 2U)
+            mask[i] = 255;
+    bench("three tumors + 2% noise");
+
+    for (uint32_t i = 0; i < IMG_SIZE; i++)
+        mask[i] = rand32() % 100U < 30U ? 255 : 0;
+    bench("30% random");
+
+    return 0;
+}
@@ -0,0 +1,375 @@
+/******************************************************************************
+ * test_dispatcher.c
+ * ------------------
+ * Desktop test for the multi-instance frame dispatcher.
+ *
+ * Runs against the simulated platform (sim/), whose accelerator instances
+ * execute the HLS C model.  Each frame is first processed alone on
+ * instance 0 (polled completion) to get a reference; the same frames are
+ * then pushed through the dispatcher with mixed modes (so later frames can
+ * finish first) and the results must come back in submission order and
+ * match the reference.  With OTSU_ACCEL_USE_IRQ the dispatcher must learn
+ * of completions from the ap_done interrupt alone, without ap_ctrl reads.
+ * Frames built in place in the zero-copy buffers, interleaved with copied
+ * frames, must give the same results.  Low-contrast frames submitted with
+ * PROCESSING_MODE_AUTO after a contrast stretch must run in the mode
+ * adaptive_select_mode() picks for the stretched frame.  Frames that time
+ * out must come back with status -1 without any frame being started on an
+ * instance whose kernel is still running.
+ *
+ * Build / run (from 04_vitis_software):
+ *   make test
+ ******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "platform_config.h"
+#include "adaptive_controller.h"
+#include "otsu_accel.h"
+#include "dispatcher.h"
+#include "image_loader.h"
+#include "intc.h"
+#include "energy_analyzer.h"
+#include "test_rng.h"
+
+#define NUM_FRAMES 12
+
+static uint8_t frames[NUM_FRAMES][IMG_SIZE];
+static uint8_t ref_mask[NUM_FRAMES][IMG_SIZE];
+static OtsuAccelResult ref_result[NUM_FRAMES];
+
+/* Noisy background with one bright disc whose size / place vary per frame */
+static void generate_frame(uint8_t *img, uint32_t k)
+{
+    int cx = 30 + (int)(k * 7) % 70;
+    int cy = 40 + (int)(k * 13) % 50;
+    int r  = 8 + (int)(k * 3) % 20;
+    for (int y = 0; y < IMG_HEIGHT; y++) {
+        for (int x = 0; x < IMG_WIDTH; x++) {
+            int dx = x - cx, dy = y - cy;
+            int base = (dx * dx + dy * dy <= r * r) ? 170 : 40;
+            img[y * IMG_WIDTH + x] = (uint8_t)(base + (rand8() % 30));
+        }
+    }
+}
+
+static uint8_t frame_mode(uint32_t k)
+{
+    static const uint8_t modes[3] = {
+        PROCESSING_MODE_CAREFUL, PROCESSING_MODE_FAST, PROCESSING_MODE_NORMAL
+    };
+    return modes[k % 3];
+}
+
+static int same_result(const OtsuAccelResult *a, const OtsuAccelResult *b)
+{
+    return a->threshold == b->threshold &&
+           a->mode_used == b->mode_used &&
+           a->separability == b->separability &&
+           memcmp(&a->moments, &b->moments, sizeof(a->moments)) == 0;
+}
+
+/* ------------------------------------------------------------------ */
+static void build_reference(void)
+{
+    OtsuAccel acc;
+    otsu_accel_init(&acc, 0);
+
+    for (uint32_t k = 0; k < NUM_FRAMES; k++) {
+        image_load_to_buffer(acc.in_addr, frames[k]);
+        otsu_accel_start(&acc, frame_mode(k));
+        otsu_accel_wait_done(&acc);
+        otsu_accel_read_result(&acc, &ref_result[k]);
+        memcpy(ref_mask[k], PHYS_PTR(acc.out_addr), IMG_SIZE);
+    }
+}
+
+/* ------------------------------------------------------------------ */
+static int test_in_order_results(void)
+{
+    int pass = 1;
+    uint32_t submitted = 0, collected = 0, peak_busy = 0;
+    uint32_t ctrl_reads = 0;
+    for (uint32_t i = 0; i < HLS_OTSU_NUM_INSTANCES; i++)
+        ctrl_reads += sim_accel_ctrl_reads(i);
+
+    printf("Dispatcher (%d instances, %u frames)\n",
+           HLS_OTSU_NUM_INSTANCES, (unsigned)NUM_FRAMES);
+    dispatcher_init();
+
+    while (collected < NUM_FRAMES) {
+        while (submitted < NUM_FRAMES &&
+               dispatcher_submit(frames[submitted], frame_mode(submitted),
+                                 100 + submitted) >= 0)
+            submitted++;
+
+        dispatcher_poll();
+        if (dispatcher_busy_instances() > peak_busy)
+            peak_busy = dispatcher_busy_instances();
+
+        DispatchResult r;
+        while (dispatcher_collect(&r)) {
+            uint32_t k = collected++;
+            int ok = r.seq == k && r.tag == 100 + k && r.status == 0 &&
+                     same_result(&r.result, &ref_result[k]) &&
+                     memcmp(r.mask, ref_mask[k], IMG_SIZE) == 0;
+            printf("  frame %2u: instance %u  thr=%3u  fg=%5u  %s\n",
+                   (unsigned)r.seq, (unsigned)r.instance,
+                   (unsigned)r.result.threshold,
+                   (unsigned)r.result.moments.count,
+                   ok ? "[PASS]" : "[FAIL]");
+            if (!ok)
+                pass = 0;
+        }
+    }
+
+    printf("  peak busy instances: %u (dispatcher), %u (platform)\n",
+           (unsigned)peak_busy, (unsigned)sim_accel_peak_busy());
+    if (HLS_OTSU_NUM_INSTANCES > 1 && peak_busy < 2) {
+        printf("  [FAIL: instances never overlapped]\n");
+        pass = 0;
+    }
+    for (uint32_t i = 0; i < HLS_OTSU_NUM_INSTANCES; i++) {
+        if (sim_accel_starts(i) == 0) {
+            printf("  [FAIL: instance %u never used]\n", (unsigned)i);
+            pass = 0;
+        }
+    }
+    if (dispatcher_in_flight() != 0) {
+        printf("  [FAIL: frames left in flight]\n");
+        pass = 0;
+    }
+
+    for (uint32_t i = 0; i < HLS_OTSU_NUM_INSTANCES; i++)
+        ctrl_reads -= sim_accel_ctrl_reads(i);
+    printf("  ap_ctrl polls: %u\n", (unsigned)-ctrl_reads);
+    if (OTSU_ACCEL_USE_IRQ && ctrl_reads != 0) {
+        printf("  [FAIL: interrupt mode polled ap_ctrl]\n");
+        pass = 0;
+    }
+    return pass;
+}
+
+/* ------------------------------------------------------------------ */
+static int test_queue_full(void)
+{
+    int pass = 1;
+    dispatcher_init();
+
+    for (uint32_t k = 0; k < DISPATCH_QUEUE_DEPTH; k++) {
+        if (dispatcher_submit(frames[k], PROCESSING_MODE_FAST, k) != (int32_t)k)
+            pass = 0;
+    }
+    if (dispatcher_submit(frames[0], PROCESSING_MODE_FAST, 0) != -1)
+        pass = 0;
+
+    /* Drain so the instances are idle again */
+    DispatchResult r;
+    uint32_t collected = 0;
+    while (collected < DISPATCH_QUEUE_DEPTH) {
+        dispatcher_poll();
+        while (dispatcher_collect(&r))
+            collected++;
+    }
+    dispatcher_collect(&r);
+
+    printf("Queue-full rejection %s\n", pass ? "[PASS]" : "[FAIL]");
+    return pass;
+}
+
+/* ------------------------------------------------------------------ */
+static int test_zero_copy(void)
+{
+    int pass = 1;
+    uint32_t submitted = 0, collected = 0, zero_copy = 0;
+    dispatcher_init();
+
+    /* Pool exhaustion */
+    int b[DISPATCH_FRAME_COUNT + 1];
+    for (int i = 0; i <= DISPATCH_FRAME_COUNT; i++)
+        b[i] = dispatcher_acquire();
+    if (b[DISPATCH_FRAME_COUNT] != -1 || b[DISPATCH_FRAME_COUNT - 1] < 0)
+        pass = 0;
+    dispatcher_init();
+
+    /* Even frames zero-copy, odd frames copied */
+    while (collected < NUM_FRAMES) {
+        if (submitted < NUM_FRAMES) {
+            if (submitted % 2 == 0) {
+                int buf = dispatcher_acquire();
+                if (buf >= 0) {
+                    memcpy(dispatcher_input(buf), frames[submitted], IMG_SIZE);
+                    if (dispatcher_submit_buffer(buf, frame_mode(submitted),
+                                                 submitted) < 0)
+                        pass = 0;
+                    submitted++;
+                    zero_copy++;
+                }
+            } else if (dispatcher_submit(frames[submitted], frame_mode(submitted),
+                                         submitted) >= 0) {
+                submitted++;
+            }
+        }
+
+        dispatcher_poll();
+
+        DispatchResult r;
+        while (dispatcher_collect(&r)) {
+            uint32_t k = collected++;
+            if (r.tag != k || r.status != 0 ||
+                !same_result(&r.result, &ref_result[k]) ||
+                memcmp(r.mask, ref_mask[k], IMG_SIZE) != 0 ||
+                memcmp(r.input, frames[k], IMG_SIZE) != 0) {
+                printf("  frame %2u: [FAIL]\n", (unsigned)k);
+                pass = 0;
+            }
+        }
+    }
+
+    printf("Zero-copy frames (%u of %u) %s\n", (unsigned)zero_copy,
+           (unsigned)NUM_FRAMES, pass ? "[PASS]" : "[FAIL]");
+    return pass;
+}
+
+/* ------------------------------------------------------------------ */
+/* Dim disc on a dim background: CAREFUL as received */
+static void generate_low_contrast(uint8_t *img, uint32_t k)
+{
+    int cx = 40 + (int)(k * 11) % 50, cy = 64, r = 14 + (int)k;
+    for (int y = 0; y < IMG_HEIGHT; y++) {
+        for (int x = 0; x < IMG_WIDTH; x++) {
+            int dx = x - cx, dy = y - cy;
+            int base = (dx * dx + dy * dy <= r * r) ? 122 : 100;
+            img[y * IMG_WIDTH + x] = (uint8_t)(base + (rand8() % 12));
+        }
+    }
+}
+
+static int test_auto_normalize(void)
+{
+    int pass = 1;
+    static uint8_t img[IMG_SIZE], stretched[IMG_SIZE];
+    dispatcher_init();
+    dispatcher_set_normalize(HLS_OTSU_NORM_STRETCH);
+
+    printf("AUTO mode after contrast stretch\n");
+    for (uint32_t k = 0; k < 4; k++) {
+        SwImageStats raw, st;
+        generate_low_contrast(img, k);
+        adaptive_compute_stats(img, &raw);
+
+        uint32_t lo = raw.min_val, span = raw.max_val - raw.min_val;
+        for (uint32_t i = 0; i < IMG_SIZE; i++)
+            stretched[i] = (uint8_t)(((img[i] - lo) * 255U + span / 2U) / span);
+        adaptive_compute_stats(stretched, &st);
+
+        DispatchResult r;
+        int ok = dispatcher_submit(img, PROCESSING_MODE_AUTO, k) >= 0;
+        while (ok && !dispatcher_collect(&r))
+            dispatcher_poll();
+        ok = ok && r.status == 0 &&
+             adaptive_select_mode(&raw) == PROCESSING_MODE_CAREFUL &&
+             r.result.mode_used == adaptive_select_mode(&st) &&
+             r.result.mode_used != PROCESSING_MODE_CAREFUL;
+        printf("  frame %u: contrast %3u -> %3u, mode_used %u %s\n", (unsigned)k,
+               (unsigned)raw.contrast, (unsigned)st.contrast,
+               (unsigned)r.result.mode_used, ok ? "[PASS]" : "[FAIL]");
+        if (!ok)
+            pass = 0;
+    }
+
+    dispatcher_set_normalize(HLS_OTSU_NORM_NONE);
+    return pass;
+}
+
+/* ------------------------------------------------------------------ */
+/* A timeout well below the kernel latency: every frame times out, and the
+ * instance / buffer must not be reused until the kernel is idle again */
+static int test_timeout(void)
+{
+    int pass = 1;
+    uint32_t submitted = 0, collected = 0, timed_out = 0;
+    uint32_t starts[HLS_OTSU_NUM_INSTANCES];
+    for (uint32_t i = 0; i < HLS_OTSU_NUM_INSTANCES; i++)
+        starts[i] = sim_accel_starts(i) - sim_accel_kicks(i);
+
+    dispatcher_init();
+    dispatcher_set_timeout(1000);
+
+    /* Even frames zero-copy, odd frames copied */
+    while (collected < NUM_FRAMES) {
+        int buf;
+        if (submitted < NUM_FRAMES && submitted % 2 == 0 &&
+            (buf = dispatcher_acquire()) >= 0) {
+            memcpy(dispatcher_input(buf), frames[submitted], IMG_SIZE);
+            if (dispatcher_submit_buffer(buf, frame_mode(submitted), submitted) >= 0)
+                submitted++;
+        } else if (submitted < NUM_FRAMES && submitted % 2 == 1 &&
+                   dispatcher_submit(frames[submitted], frame_mode(submitted),
+                                     submitted) >= 0) {
+            submitted++;
+        }
+
+        dispatcher_poll();
+
+        DispatchResult r;
+        while (dispatcher_collect(&r)) {
+            if (r.tag != collected++)
+                pass = 0;
+            timed_out += r.status == -1;
+        }
+    }
+
+    /* ap_start on a running kernel is a kick that starts nothing */
+    for (uint32_t i = 0; i < HLS_OTSU_NUM_INSTANCES; i++) {
+        if (sim_accel_starts(i) - sim_accel_kicks(i) != starts[i]) {
+            printf("  [FAIL: instance %u started while running]\n", (unsigned)i);
+            pass = 0;
+        }
+    }
+    if (timed_out != NUM_FRAMES)
+        pass = 0;
+
+    /* The instances recover once the late kernels are idle */
+    DispatchResult r;
+    dispatcher_set_timeout(HLS_TIMEOUT_CYCLES);
+    int ok = dispatcher_submit(frames[0], frame_mode(0), 0) >= 0;
+    while (ok && !dispatcher_collect(&r))
+        dispatcher_poll();
+    if (!ok || r.status != 0 || !same_result(&r.result, &ref_result[0]) ||
+        memcmp(r.mask, ref_mask[0], IMG_SIZE) != 0)
+        pass = 0;
+
+    printf("Timeout (%u of %u frames timed out) %s\n", (unsigned)timed_out,
+           (unsigned)NUM_FRAMES, pass ? "[PASS]" : "[FAIL]");
+    return pass;
+}
+
+/* ==================================================================== */
+int main(void)
+{
+    int total_pass = 1;
+
+    for (uint32_t k = 0; k < NUM_FRAMES; k++)
+        generate_frame(frames[k], k);
+    build_reference();
+
+    intc_init();
+    cpu_irq_enable();
+    energy_clock_start();
+
+    if (!test_in_order_results())
+        total_pass = 0;
+    if (!test_queue_full())
+        total_pass = 0;
+    if (!test_zero_copy())
+        total_pass = 0;
+    if (!test_auto_normalize())
+        total_pass = 0;
+    if (!test_timeout())
+        total_pass = 0;
+
+    printf("\n==============================================\n");
+    printf(total_pass ? "  ALL TESTS PASSED\n" : "  SOME TESTS FAILED\n");
+    printf("==============================================\n");
+    return total_pass ? 0 : 1;
+}
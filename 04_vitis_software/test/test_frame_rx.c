@@ -0,0 +1,257 @@
+/******************************************************************************
+ * test_frame_rx.c
+ * ----------------
+ * Loopback test for binary frame ingestion over the UART (frame_rx.c).
+ *
+ * A child process plays the host: it writes framed images into a pipe
+ * whose read end is the simulated UART Lite RX line (UART_BAUD_RATE).
+ * The stream is a mix of
+ *   - good frames with explicit and AUTO modes,
+ *   - a frame with a corrupted CRC and one with a bad header,
+ *   - a good frame that the CPU fails to drain in time (interrupts held
+ *     off), which overruns the RX FIFO and takes the next frame with it,
+ * and the received frames must produce exactly the polled reference
+ * results, each one before the next frame has finished arriving.
+ *
+ * Build / run (from 04_vitis_software):
+ *   make test
+ ******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "platform_config.h"
+#include "adaptive_controller.h"
+#include "otsu_accel.h"
+#include "otsu_stream.h"
+#include "frame_rx.h"
+#include "image_loader.h"
+#include "intc.h"
+#include "test_rng.h"
+
+#define NUM_FRAMES 9
+
+typedef enum { SEND_GOOD = 0, SEND_BAD_CRC, SEND_BAD_HEADER } SendKind;
+
+static const struct
+{
+    uint8_t mode;
+    SendKind kind;
+    int expect;      /* 1 = must be processed */
+} plan[NUM_FRAMES] = {
+    { FRAME_RX_MODE_AUTO,      SEND_GOOD,       1 },
+    { PROCESSING_MODE_NORMAL,  SEND_GOOD,       1 },
+    { PROCESSING_MODE_FAST,    SEND_BAD_CRC,    0 },
+    { PROCESSING_MODE_FAST,    SEND_BAD_HEADER, 0 },
+    { FRAME_RX_MODE_AUTO,      SEND_GOOD,       1 },
+    { PROCESSING_MODE_CAREFUL, SEND_GOOD,       1 },
+    { FRAME_RX_MODE_AUTO,      SEND_GOOD,       0 },   /* overrun victim   */
+    { PROCESSING_MODE_NORMAL,  SEND_GOOD,       0 },   /* swallowed by it  */
+    { FRAME_RX_MODE_AUTO,      SEND_GOOD,       1 },
+};
+#define OVERRUN_AFTER 4   /* good frames received before interrupts stall */
+
+static uint8_t frames[NUM_FRAMES][IMG_SIZE];
+static uint8_t ref_mask[NUM_FRAMES][IMG_SIZE];
+static OtsuAccelResult ref_result[NUM_FRAMES];
+static uint8_t ref_mode[NUM_FRAMES];
+
+/* Dark noisy background with a bright ellipse; contrast varies per frame */
+static void generate_frame(uint8_t *img, uint32_t k)
+{
+    int cx = 30 + (int)(k * 8), cy = 70 - (int)(k * 3);
+    int bg = 20 + (int)(k % 3) * 30, fg = 200 - (int)(k % 3) * 50;
+    for (int y = 0; y < IMG_HEIGHT; y++) {
+        for (int x = 0; x < IMG_WIDTH; x++) {
+            int dx = x - cx, dy = y - cy;
+            int base = (dx * dx + 2 * dy * dy <= 500) ? fg : bg;
+            img[y * IMG_WIDTH + x] = (uint8_t)(base + (rand8() % 40));
+        }
+    }
+}
+
+/* Bitwise CRC-32, independent of the receiver's table */
+static uint32_t crc32_ref(uint32_t crc, const uint8_t *p, size_t n)
+{
+    crc = ~crc;
+    while (n--) {
+        crc ^= *p++;
+        for (int b = 0; b < 8; b++)
+            crc = (crc >> 1) ^ (0xEDB88320U & (0U - (crc & 1U)));
+    }
+    return ~crc;
+}
+
+/* ------------------------------------------------------------------ */
+/* Host side: write every frame of the plan to the line, then hang up */
+static void host_send(int fd)
+{
+    static uint8_t buf[FRAME_RX_HEADER_SIZE + IMG_SIZE + 4];
+    static const uint8_t noise[] = { 0x00, 0x1D, 0xFC, 0x55, 0xCF, 0x1A, 0xFF };
+
+    if (write(fd, noise, sizeof(noise)) != (ssize_t)sizeof(noise))
+        _exit(1);
+
+    for (uint32_t k = 0; k < NUM_FRAMES; k++) {
+        uint16_t width = plan[k].kind == SEND_BAD_HEADER ? 64 : IMG_WIDTH;
+        uint8_t *h = buf;
+        h[0] = 0x1D; h[1] = 0xFC; h[2] = 0xCF; h[3] = 0x1A;
+        h[4] = (uint8_t)width;      h[5] = (uint8_t)(width >> 8);
+        h[6] = (uint8_t)IMG_HEIGHT; h[7] = (uint8_t)(IMG_HEIGHT >> 8);
+        h[8] = plan[k].mode;
+        h[9] = 0;
+        h[10] = (uint8_t)k;         h[11] = (uint8_t)(k >> 8);
+        memcpy(buf + FRAME_RX_HEADER_SIZE, frames[k], IMG_SIZE);
+
+        uint32_t crc = crc32_ref(0, buf, FRAME_RX_HEADER_SIZE + IMG_SIZE);
+        if (plan[k].kind == SEND_BAD_CRC)
+            crc ^= 0x00010000U;
+        for (int i = 0; i < 4; i++)
+            buf[FRAME_RX_HEADER_SIZE + IMG_SIZE + i] = (uint8_t)(crc >> (8 * i));
+
+        if (write(fd, buf, sizeof(buf)) != (ssize_t)sizeof(buf))
+            _exit(1);
+    }
+    _exit(0);
+}
+
+/* ------------------------------------------------------------------ */
+static void build_reference(void)
+{
+    OtsuAccel acc;
+    otsu_accel_init(&acc, 0);
+
+    for (uint32_t k = 0; k < NUM_FRAMES; k++) {
+        SwImageStats st;
+        adaptive_compute_stats(frames[k], &st);
+        ref_mode[k] = plan[k].mode == FRAME_RX_MODE_AUTO
+                          ? adaptive_select_mode(&st) : plan[k].mode;
+
+        image_load_to_buffer(acc.in_addr, frames[k]);
+        otsu_accel_start(&acc, ref_mode[k]);
+        otsu_accel_wait_done(&acc);
+        otsu_accel_read_result(&acc, &ref_result[k]);
+        memcpy(ref_mask[k], PHYS_PTR(acc.out_addr), IMG_SIZE);
+    }
+}
+
+static int check_frame(const StreamResult *r, const FrameRxInfo *info)
+{
+    uint32_t k = info->frame_id;
+    SwImageStats st;
+    adaptive_compute_stats(frames[k], &st);
+
+    return k < NUM_FRAMES && plan[k].expect &&
+           info->mode == ref_mode[k] &&
+           memcmp(&info->stats, &st, sizeof(st)) == 0 &&
+           r->result.threshold == ref_result[k].threshold &&
+           r->result.mode_used == ref_result[k].mode_used &&
+           memcmp(&r->result.moments, &ref_result[k].moments,
+                  sizeof(r->result.moments)) == 0 &&
+           memcmp(r->mask, ref_mask[k], IMG_SIZE) == 0;
+}
+
+/* ==================================================================== */
+int main(void)
+{
+    int pass = 1;
+    uint32_t expected = 0, collected = 0, next_expected = 0;
+    int stalled = 0;
+
+    seed_rng(777);
+    for (uint32_t k = 0; k < NUM_FRAMES; k++) {
+        generate_frame(frames[k], k);
+        expected += (uint32_t)plan[k].expect;
+    }
+    build_reference();
+
+    int line[2];
+    if (pipe(line) != 0) {
+        perror("pipe");
+        return 1;
+    }
+    fflush(stdout);
+    pid_t host = fork();
+    if (host == 0) {
+        close(line[0]);
+        host_send(line[1]);
+    }
+    close(line[1]);
+    sim_uart_attach_rx(line[0]);
+
+    intc_init();
+    cpu_irq_enable();
+    otsu_stream_init(0);
+    frame_rx_start();
+
+    printf("Frame ingestion over UART (%u baud, %u frames sent)\n",
+           (unsigned)UART_BAUD_RATE, (unsigned)NUM_FRAMES);
+
+    /* 20 s of line time is far more than the plan needs */
+    uint64_t deadline = sim_now() + 20ULL * SYS_CLK_FREQ_HZ;
+    while (collected < expected && sim_now() < deadline) {
+        FrameRxStats rs;
+        frame_rx_get_stats(&rs);
+
+        /* Hold interrupts off for ~45 characters mid-frame */
+        if (!stalled && rs.frames == OVERRUN_AFTER) {
+            cpu_irq_disable();
+            sim_advance(45U * (SYS_CLK_FREQ_HZ / (UART_BAUD_RATE / 10U)));
+            cpu_irq_enable();
+            stalled = 1;
+        }
+
+        StreamResult r;
+        if (otsu_stream_collect(&r)) {
+            FrameRxInfo info;
+            frame_rx_info(r.slot, &info);
+            while (next_expected < NUM_FRAMES && !plan[next_expected].expect)
+                next_expected++;
+
+            /* Processed before the next frame could have arrived */
+            int ok = info.frame_id == next_expected && check_frame(&r, &info) &&
+                     rs.frames <= collected + 1;
+            printf("  frame id %u: mode %u thr=%3u fg=%5u  %s\n",
+                   (unsigned)info.frame_id, (unsigned)info.mode,
+                   (unsigned)r.result.threshold,
+                   (unsigned)r.result.moments.count, ok ? "[PASS]" : "[FAIL]");
+            if (!ok)
+                pass = 0;
+            otsu_stream_release(r.slot);
+            collected++;
+            next_expected++;
+        } else {
+            sim_advance(1000);   /* CPU busy elsewhere */
+        }
+    }
+
+    FrameRxStats rs;
+    frame_rx_get_stats(&rs);
+    frame_rx_stop();
+    otsu_stream_stop();
+
+    int status = 0;
+    waitpid(host, &status, 0);
+
+    printf("  received=%u crc_errors=%u header_errors=%u no_slot=%u overruns=%u\n",
+           (unsigned)rs.frames, (unsigned)rs.crc_errors,
+           (unsigned)rs.header_errors, (unsigned)rs.no_slot,
+           (unsigned)rs.overruns);
+    if (collected != expected || rs.frames != expected ||
+        rs.crc_errors != 2 || rs.header_errors != 1 || rs.overruns == 0 ||
+        !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        printf("  [FAIL: receiver accounting]\n");
+        pass = 0;
+    }
+
+    uint8_t probe[] = { '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+    if (frame_rx_crc32(0, probe, sizeof(probe)) != 0xCBF43926U) {
+        printf("  [FAIL: CRC-32 check value]\n");
+        pass = 0;
+    }
+
+    printf("\n==============================================\n");
+    printf(pass ? "  ALL TESTS PASSED\n" : "  SOME TESTS FAILED\n");
+    printf("==============================================\n");
+    return pass ? 0 : 1;
+}
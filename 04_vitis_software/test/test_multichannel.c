@@ -0,0 +1,215 @@
+/******************************************************************************
+ * test_multichannel.c
+ * -------------------
+ * Desktop test for fused thresholding of co-registered modalities on the
+ * multi-channel Otsu IP.
+ *
+ * Runs against the simulated platform (sim/), whose multi-channel IP
+ * executes the HLS C model.  Each channel's threshold must be the Otsu
+ * split of its own plane (tiler_threshold()), and the mask the LUT fusion
+ * of the channel masks with the mode's clipped 3x3 open / close.  One
+ * channel with the identity LUT must reproduce the single-channel kernel.
+ *
+ * Build / run (from 04_vitis_software):
+ *   make test
+ ******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "platform_config.h"
+#include "adaptive_controller.h"
+#include "otsu_accel.h"
+#include "image_loader.h"
+#include "intc.h"
+#include "tiler.h"
+#include "multichannel.h"
+#include "sim_platform.h"
+#include "test_rng.h"
+
+static uint8_t planes[HLS_MC_MAX_CHANNELS][IMG_SIZE];
+static uint8_t mask[IMG_SIZE];
+static uint8_t ref[IMG_SIZE];
+static uint8_t tmp[IMG_SIZE];
+
+static const uint8_t *const plane_ptrs[HLS_MC_MAX_CHANNELS] = {
+    planes[0], planes[1], planes[2], planes[3],
+};
+
+static const char *mode_name[3] = { "FAST", "NORMAL", "CAREFUL" };
+
+/* T1-like: enhancing core; T2-like: core and edema; FLAIR-like: edema
+ * and a small artefact; a fourth plane of noise with a bright square */
+static void generate_planes(uint32_t seed)
+{
+    seed_rng(seed);
+    for (uint32_t i = 0; i < IMG_SIZE; i++) {
+        int x = (int)(i % IMG_WIDTH), y = (int)(i / IMG_WIDTH);
+        int d2 = (x - 70) * (x - 70) + (y - 58) * (y - 58);
+        int core = d2 <= 12 * 12, edema = !core && d2 <= 24 * 24;
+
+        planes[0][i] = (uint8_t)(core ? 180 + rand8() % 50 : 40 + rand8() % 60);
+        planes[1][i] = (uint8_t)(core || edema ? 150 + rand8() % 60 : 60 + rand8() % 40);
+        planes[2][i] = (uint8_t)(edema ? 170 + rand8() % 60 : 30 + rand8() % 70);
+        if (x < 12 && y > 110)
+            planes[2][i] = 250;
+        planes[3][i] = (uint8_t)(x > 30 && x < 90 && y > 30 && y < 90 ?
+                                 120 + rand8() % 100 : rand8() % 120);
+        if (rand8() == 0)
+            planes[1][i] = 255;
+    }
+}
+
+/* ---- Reference: per-channel Otsu, LUT, clipped 3x3 morphology ---- */
+static void morph(uint8_t *dst, const uint8_t *src, int dilate)
+{
+    for (int y = 0; y < IMG_HEIGHT; y++) {
+        for (int x = 0; x < IMG_WIDTH; x++) {
+            uint8_t v = dilate ? 0 : 255;
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    int xx = x + dx, yy = y + dy;
+                    if (xx < 0 || yy < 0 || xx >= IMG_WIDTH || yy >= IMG_HEIGHT)
+                        continue;
+                    uint8_t s = src[yy * IMG_WIDTH + xx];
+                    if (dilate ? s > v : s < v)
+                        v = s;
+                }
+            }
+            dst[y * IMG_WIDTH + x] = v;
+        }
+    }
+}
+
+static void reference(uint8_t channels, uint16_t lut, uint8_t mode,
+                      uint8_t thr[HLS_MC_MAX_CHANNELS],
+                      uint32_t ch_pixels[HLS_MC_MAX_CHANNELS])
+{
+    for (uint32_t c = 0; c < HLS_MC_MAX_CHANNELS; c++) {
+        uint32_t hist[256] = { 0 };
+        thr[c] = 0;
+        ch_pixels[c] = 0;
+        if (c >= channels)
+            continue;
+        for (uint32_t i = 0; i < IMG_SIZE; i++)
+            hist[planes[c][i]]++;
+        thr[c] = tiler_threshold(hist, IMG_SIZE, PROCESSING_MODE_FAST);
+    }
+
+    for (uint32_t i = 0; i < IMG_SIZE; i++) {
+        uint32_t v = 0;
+        for (uint32_t c = 0; c < channels; c++) {
+            if (planes[c][i] > thr[c]) {
+                v |= 1U << c;
+                ch_pixels[c]++;
+            }
+        }
+        ref[i] = (lut >> v) & 1U ? 255 : 0;
+    }
+
+    if (mode == PROCESSING_MODE_FAST)
+        return;
+    morph(tmp, ref, 0);                 /* open */
+    morph(ref, tmp, 1);
+    if (mode != PROCESSING_MODE_CAREFUL)
+        return;
+    morph(tmp, ref, 1);                 /* close */
+    morph(ref, tmp, 0);
+}
+
+/* ------------------------------------------------------------------ */
+static int test_fusion(const char *name, uint8_t channels, uint16_t lut)
+{
+    int pass = 1;
+
+    printf("%s (%u channels, LUT 0x%04X)\n", name, channels, lut);
+    for (uint8_t mode = 0; mode < 3; mode++) {
+        uint8_t thr[HLS_MC_MAX_CHANNELS];
+        uint32_t ch_pixels[HLS_MC_MAX_CHANNELS];
+        MultiChannelResult res;
+
+        memset(mask, 0xA5, IMG_SIZE);
+        int ok = multichannel_segment(plane_ptrs, channels, mode, lut, mask, &res) == 0;
+        reference(channels, lut, mode, thr, ch_pixels);
+
+        uint32_t fg = 0;
+        for (uint32_t i = 0; i < IMG_SIZE; i++)
+            fg += ref[i] != 0;
+        ok = ok && memcmp(mask, ref, IMG_SIZE) == 0 && res.foreground == fg &&
+             res.channels == channels && res.combine == lut && res.mode_used == mode &&
+             res.stage_cycles[HLS_NUM_STAGES - 1] > 0;
+        for (uint32_t c = 0; c < HLS_MC_MAX_CHANNELS; c++)
+            ok = ok && res.thresholds[c] == thr[c] &&
+                 res.channel_pixels[c] == ch_pixels[c] &&
+                 (c < channels) == (res.separability[c] != 0);
+
+        printf("  %-8s thr %3u/%3u/%3u/%3u, %5u px %s\n", mode_name[mode],
+               res.thresholds[0], res.thresholds[1], res.thresholds[2],
+               res.thresholds[3], (unsigned)res.foreground, ok ? "[PASS]" : "[FAIL]");
+        if (!ok)
+            pass = 0;
+    }
+    return pass;
+}
+
+/* One channel, identity LUT: the single-channel kernel's mask */
+static int test_single_channel(void)
+{
+    OtsuAccel acc;
+    OtsuAccelResult kr;
+    MultiChannelResult res;
+
+    otsu_accel_init(&acc, 0);
+    image_load_to_buffer(acc.in_addr, planes[1]);
+    otsu_accel_start(&acc, PROCESSING_MODE_NORMAL);
+    int ok = otsu_accel_wait_done(&acc) == 0;
+    otsu_accel_read_result(&acc, &kr);
+
+    ok = ok && multichannel_segment(plane_ptrs + 1, 1, PROCESSING_MODE_NORMAL,
+                                    HLS_MC_LUT_AND(1), mask, &res) == 0 &&
+         memcmp(mask, PHYS_PTR(acc.out_addr), IMG_SIZE) == 0 &&
+         res.thresholds[0] == kr.threshold && res.foreground == kr.moments.count &&
+         res.separability[0] == kr.separability;
+    printf("Single channel against the kernel: thr %u (kernel %u) %s\n",
+           res.thresholds[0], kr.threshold, ok ? "[PASS]" : "[FAIL]");
+    return ok;
+}
+
+static int test_limits(void)
+{
+    MultiChannelResult res;
+    uint32_t starts = sim_accel_starts(HLS_OTSU_MAX_INSTANCES);
+    int pass = multichannel_segment(plane_ptrs, 0, 0, HLS_MC_LUT_OR, mask, &res) == -1 &&
+               multichannel_run(0, HLS_MC_MAX_CHANNELS + 1, HLS_MC_LUT_OR, &res) == -1 &&
+               sim_accel_starts(HLS_OTSU_MAX_INSTANCES) == starts;
+    printf("Unsupported channel counts %s\n", pass ? "[PASS]" : "[FAIL]");
+    return pass;
+}
+
+/* ==================================================================== */
+int main(void)
+{
+    int total_pass = 1;
+
+    intc_init();
+    cpu_irq_enable();
+
+    generate_planes(1);
+    if (!test_fusion("AND", 2, HLS_MC_LUT_AND(2)))
+        total_pass = 0;
+    if (!test_fusion("OR", 3, HLS_MC_LUT_OR))
+        total_pass = 0;
+    if (!test_fusion("Majority", 3, HLS_MC_LUT_MAJORITY3))
+        total_pass = 0;
+    if (!test_fusion("Majority", 4, HLS_MC_LUT_MAJORITY4))
+        total_pass = 0;
+    if (!test_fusion("Edema (T2 without T1)", 3, 0x0044))
+        total_pass = 0;
+    if (!test_single_channel())
+        total_pass = 0;
+    if (!test_limits())
+        total_pass = 0;
+
+    printf("\n==============================================\n");
+    printf(total_pass ? "  ALL TESTS PASSED\n" : "  SOME TESTS FAILED\n");
+    printf("==============================================\n");
+    return total_pass ? 0 : 1;
+}
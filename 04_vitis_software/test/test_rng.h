@@ -0,0 +1,24 @@
+/******************************************************************************
+ * test_rng.h
+ * ----------
+ * Pixel noise for the desktop tests' synthetic images.  Each test binary
+ * gets its own generator; seed it before building fixtures so the images
+ * (and the expected results) stay the same from run to run.
+ *****************************************************************************/
+#ifndef TEST_RNG_H
+#define TEST_RNG_H
+
+#include <stdint.h>
+
+/* Simple pseudo-random (LCG) – deterministic across platforms */
+static uint32_t rng_state = 12345;
+
+static inline uint8_t rand8(void)
+{
+    rng_state = rng_state * 1103515245u + 12345u;
+    return (uint8_t)((rng_state >> 16) & 0xFF);
+}
+
+static inline void seed_rng(uint32_t s) { rng_state = s; }
+
+#endif /* TEST_RNG_H */
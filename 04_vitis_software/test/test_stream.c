@@ -0,0 +1,251 @@
+/******************************************************************************
+ * test_stream.c
+ * --------------
+ * Desktop test for auto_restart streaming (otsu_stream.c).
+ *
+ * Frames are first processed one at a time with polled completion to get
+ * a reference.  They are then streamed through the frame slots with
+ *   - a producer that keeps every slot full (one ap_start for the whole
+ *     stream, the rest auto-restarted),
+ *   - a producer that waits for each result (the kernel drains and is
+ *     restarted for every frame),
+ *   - a producer whose pace straddles the kernel latency, exercising the
+ *     re-arm / drain race,
+ *   - a saturated stream with run-length output (HLS_OTSU_MODE_RLE),
+ *     whose runs must decode to the reference mask, with the rest of the
+ *     output buffer left as it was,
+ * and every result must match the reference, in submission order.
+ * CAREFUL-class frames probed in NORMAL must report the mode that ran:
+ * NORMAL when the probe is kept, CAREFUL after an ambiguous probe is
+ * re-run in the same slot.
+ *
+ * Build / run (from 04_vitis_software):
+ *   make test
+ ******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "platform_config.h"
+#include "adaptive_controller.h"
+#include "otsu_accel.h"
+#include "otsu_stream.h"
+#include "image_loader.h"
+#include "intc.h"
+#include "test_rng.h"
+
+#define NUM_FRAMES 10
+
+static uint8_t frames[NUM_FRAMES][IMG_SIZE];
+static uint8_t ref_mask[NUM_FRAMES][IMG_SIZE];
+static OtsuAccelResult ref_result[NUM_FRAMES];
+
+/* Dark noisy background with a bright ellipse that drifts per frame */
+static void generate_frame(uint8_t *img, uint32_t k)
+{
+    int cx = 40 + (int)(k * 5);
+    int cy = 50 + (int)(k * 3);
+    for (int y = 0; y < IMG_HEIGHT; y++) {
+        for (int x = 0; x < IMG_WIDTH; x++) {
+            int dx = x - cx, dy = (y - cy) * 2;
+            int base = (dx * dx + dy * dy <= 400) ? 160 + (int)k * 4 : 35;
+            img[y * IMG_WIDTH + x] = (uint8_t)(base + (rand8() % 40));
+        }
+    }
+}
+
+static uint8_t frame_mode(uint32_t k)
+{
+    return (uint8_t)(k % 3);   /* FAST, NORMAL, CAREFUL in turn */
+}
+
+/* ------------------------------------------------------------------ */
+static void build_reference(void)
+{
+    OtsuAccel acc;
+    otsu_accel_init(&acc, 0);
+
+    for (uint32_t k = 0; k < NUM_FRAMES; k++) {
+        image_load_to_buffer(acc.in_addr, frames[k]);
+        otsu_accel_start(&acc, frame_mode(k));
+        otsu_accel_wait_done(&acc);
+        otsu_accel_read_result(&acc, &ref_result[k]);
+        memcpy(ref_mask[k], PHYS_PTR(acc.out_addr), IMG_SIZE);
+    }
+}
+
+#define RLE_FILL 0xA5U   /* output bytes before an RLE run */
+
+static uint8_t rle_mask[IMG_SIZE];
+static uint32_t rle_frames;
+static uint32_t rle_overwrites;   /* bytes written past the runs */
+
+/* The slot's output as a mask: decoded if the kernel wrote runs */
+static const uint8_t *output_mask(const StreamResult *r)
+{
+    if (!r->result.run_count)
+        return r->mask;
+
+    memset(rle_mask, 0, sizeof(rle_mask));
+    for (uint32_t i = 0; i < r->result.run_count; i++) {
+        const uint8_t *run = r->mask + i * HLS_OTSU_RLE_RUN_BYTES;
+        memset(rle_mask + run[2] * IMG_WIDTH + run[0], 255, run[1]);
+    }
+    for (uint32_t i = r->result.run_count * HLS_OTSU_RLE_RUN_BYTES; i < IMG_SIZE; i++)
+        rle_overwrites += r->mask[i] != RLE_FILL;
+    rle_frames++;
+    return rle_mask;
+}
+
+static int check_result(const StreamResult *r, uint32_t k)
+{
+    return r->seq == k &&
+           r->result.threshold == ref_result[k].threshold &&
+           r->result.mode_used == ref_result[k].mode_used &&
+           memcmp(&r->result.moments, &ref_result[k].moments,
+                  sizeof(r->result.moments)) == 0 &&
+           memcmp(output_mask(r), ref_mask[k], IMG_SIZE) == 0;
+}
+
+/*
+ * Stream all frames.  The producer submits at most `ahead` frames beyond
+ * the last collected one and burns `gap` cycles after each submit, and
+ * ORs `out_mode` into each frame's mode.
+ */
+static int run_stream(const char *name, uint32_t ahead, uint32_t gap,
+                      uint8_t out_mode, StreamStats *st)
+{
+    int pass = 1;
+    uint32_t submitted = 0, collected = 0;
+    uint32_t kicks0 = sim_accel_kicks(0);
+    uint64_t t0 = sim_now();
+
+    otsu_stream_init(0);
+    while (collected < NUM_FRAMES) {
+        if (submitted < NUM_FRAMES && submitted - collected < ahead) {
+            int s = otsu_stream_acquire();
+            if (s >= 0) {
+                memcpy(otsu_stream_input(s), frames[submitted], IMG_SIZE);
+                if (out_mode & HLS_OTSU_MODE_RLE)
+                    memset(PHYS_PTR(FRAME_SLOT_OUT(s)), RLE_FILL, IMG_SIZE);
+                otsu_stream_submit(s, frame_mode(submitted) | out_mode);
+                submitted++;
+                sim_advance(gap);
+            }
+        }
+
+        StreamResult r;
+        while (otsu_stream_collect(&r)) {
+            if (!check_result(&r, collected)) {
+                printf("  frame %u: [FAIL]\n", (unsigned)collected);
+                pass = 0;
+            }
+            otsu_stream_release(r.slot);
+            collected++;
+        }
+    }
+    otsu_stream_get_stats(st);
+    otsu_stream_stop();
+
+    printf("%-14s frames=%u kicks=%u auto=%u drains=%u ap_start_writes=%u "
+           "cycles/frame=%u  %s\n", name, (unsigned)st->frames,
+           (unsigned)st->kicks, (unsigned)st->auto_restarts,
+           (unsigned)st->drains, (unsigned)(sim_accel_kicks(0) - kicks0),
+           (unsigned)((sim_now() - t0) / NUM_FRAMES),
+           pass ? "[PASS]" : "[FAIL]");
+
+    if (st->frames != NUM_FRAMES ||
+        st->kicks + st->auto_restarts != NUM_FRAMES ||
+        sim_accel_kicks(0) - kicks0 != st->kicks) {
+        printf("  [FAIL: run accounting]\n");
+        pass = 0;
+    }
+    return pass;
+}
+
+/* ------------------------------------------------------------------ */
+/* Low contrast, so CAREFUL by statistics; a two-level frame separates
+ * cleanly in NORMAL, uniform noise does not */
+static int test_probe(const char *name, int two_level, uint8_t expect)
+{
+    static uint8_t img[IMG_SIZE];
+    for (int y = 0; y < IMG_HEIGHT; y++) {
+        for (int x = 0; x < IMG_WIDTH; x++) {
+            int dx = x - 64, dy = y - 64;
+            img[y * IMG_WIDTH + x] = (uint8_t)(two_level
+                ? (dx * dx + dy * dy <= 900 ? 150 : 100) + rand8() % 8
+                : 100 + rand8() % 60);
+        }
+    }
+    SwImageStats stats;
+    adaptive_compute_stats(img, &stats);
+
+    /* As the frame pipeline in main.c: probe, then keep or re-run */
+    StreamResult r;
+    otsu_stream_init(0);
+    int s = otsu_stream_acquire();
+    memcpy(otsu_stream_input(s), img, IMG_SIZE);
+    otsu_stream_submit(s, PROCESSING_MODE_NORMAL);
+    while (!otsu_stream_collect(&r))
+        ;
+    uint8_t mode = adaptive_probe_mode(r.result.separability);
+    if (mode == PROCESSING_MODE_CAREFUL) {
+        otsu_stream_submit(r.slot, PROCESSING_MODE_CAREFUL);
+        while (!otsu_stream_collect(&r))
+            ;
+    }
+    otsu_stream_release(r.slot);
+    otsu_stream_stop();
+
+    int ok = adaptive_select_mode(&stats) == PROCESSING_MODE_CAREFUL &&
+             mode == expect && r.result.mode_used == mode;
+    printf("probe %-10s eta=%5u reported=%u ran=%u  %s\n", name,
+           (unsigned)r.result.separability, (unsigned)mode,
+           (unsigned)r.result.mode_used, ok ? "[PASS]" : "[FAIL]");
+    return ok;
+}
+
+/* ==================================================================== */
+int main(void)
+{
+    int total_pass = 1;
+    StreamStats st;
+
+    seed_rng(4242);
+    for (uint32_t k = 0; k < NUM_FRAMES; k++)
+        generate_frame(frames[k], k);
+    build_reference();
+
+    intc_init();
+    cpu_irq_enable();
+
+    /* Producer always ahead: a single ap_start for the whole stream */
+    if (!run_stream("saturated", FRAME_SLOT_COUNT, 0, 0, &st) || st.kicks != 1)
+        total_pass = 0;
+
+    /* Lock-step producer: the kernel drains after every frame */
+    if (!run_stream("lock-step", 1, 0, 0, &st) || st.kicks != NUM_FRAMES)
+        total_pass = 0;
+
+    /* Producer pace around the kernel latency: mixed restarts / drains */
+    if (!run_stream("paced", 2, 100000, 0, &st) ||
+        st.kicks < 2 || st.auto_restarts == 0)
+        total_pass = 0;
+
+    /* Row runs instead of the mask: far fewer bytes written per frame */
+    rle_frames = 0;
+    rle_overwrites = 0;
+    if (!run_stream("run-length", FRAME_SLOT_COUNT, 0, HLS_OTSU_MODE_RLE, &st) ||
+        rle_frames != NUM_FRAMES || rle_overwrites != 0) {
+        printf("  [FAIL: %u of %u frames as runs, %u bytes past the runs]\n",
+               (unsigned)rle_frames, (unsigned)NUM_FRAMES, (unsigned)rle_overwrites);
+        total_pass = 0;
+    }
+
+    /* NORMAL probes of CAREFUL-class frames */
+    total_pass &= test_probe("kept", 1, PROCESSING_MODE_NORMAL);
+    total_pass &= test_probe("re-run", 0, PROCESSING_MODE_CAREFUL);
+
+    printf("\n==============================================\n");
+    printf(total_pass ? "  ALL TESTS PASSED\n" : "  SOME TESTS FAILED\n");
+    printf("==============================================\n");
+    return total_pass ? 0 : 1;
+}
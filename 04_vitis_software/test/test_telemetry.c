@@ -0,0 +1,254 @@
+/******************************************************************************
+ * test_telemetry.c
+ * -----------------
+ * Desktop test for the binary telemetry records (telemetry.c).
+ *
+ *   - each record type is framed as documented in telemetry.h (sync word,
+ *     type, length, sequence number, CRC-32) with every field at its
+ *     little-endian offset,
+ *   - with drops enabled, a record that does not fit in the UART TX ring
+ *     is dropped whole and still consumes a sequence number, so the host
+ *     sees the gap,
+ *   - a frame's records are several times smaller than its ASCII report,
+ *     and a contour record carries only the chain-code steps it holds.
+ *
+ * The simulated UART echoes transmitted bytes to stdout; the test sends
+ * them to a scratch file and parses them back.
+ *
+ * Build / run (from 04_vitis_software):
+ *   make test
+ ******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "platform_config.h"
+#include "telemetry.h"
+#include "frame_rx.h"
+#include "uart_debug.h"
+#include "intc.h"
+
+static uint8_t line[8192];
+static uint32_t line_len;
+static int total_pass = 1;
+static int saved_stdout = -1;
+static FILE *line_file;
+
+static void check(int ok, const char *what)
+{
+    printf("  %-44s %s\n", what, ok ? "[PASS]" : "[FAIL]");
+    if (!ok)
+        total_pass = 0;
+}
+
+/* ---- Capture the simulated line in a scratch file ---- */
+static void capture_begin(void)
+{
+    fflush(stdout);
+    saved_stdout = dup(STDOUT_FILENO);
+    line_file = tmpfile();
+    dup2(fileno(line_file), STDOUT_FILENO);
+}
+
+static void capture_end(void)
+{
+    fflush(stdout);
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+    rewind(line_file);
+    line_len = (uint32_t)fread(line, 1, sizeof(line), line_file);
+    fclose(line_file);
+}
+
+static uint32_t get_u16(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8);
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* Check the framing of the record at @p rec; returns its payload or 0 */
+static const uint8_t *check_frame(const uint8_t *rec, uint32_t type,
+                                  uint32_t len, uint32_t seq)
+{
+    if (get_u32(rec) != TELEMETRY_SYNC || rec[4] != type || rec[5] != 0 ||
+        get_u16(rec + 6) != len || get_u32(rec + 8) != seq)
+        return 0;
+    uint32_t body = TELEMETRY_HEADER_BYTES + len;
+    if (get_u32(rec + body) != frame_rx_crc32(0, rec, body))
+        return 0;
+    return rec + TELEMETRY_HEADER_BYTES;
+}
+
+/* ------------------------------------------------------------------ */
+static void test_layout(void)
+{
+    OtsuAccelResult res;
+    memset(&res, 0, sizeof(res));
+    res.threshold         = 97;
+    res.mode_used         = PROCESSING_MODE_CAREFUL;
+    res.separability      = 0xBEEF;
+    res.run_count         = 321;
+    res.moments.count     = 0x01020304U;
+    res.moments.sum_x     = 11;
+    res.moments.sum_xy    = 0xA0B0C0D0U;
+    res.moments.bbox_x0   = 5;
+    res.moments.bbox_y1   = 120;
+    for (uint32_t s = 0; s < HLS_NUM_STAGES; s++)
+        res.stage_cycles[s] = 1000U * (s + 1U);
+
+    WatershedResult ws;
+    memset(&ws, 0, sizeof(ws));
+    ws.num_regions      = 2;
+    ws.total_regions    = 300;
+    ws.total_foreground = 700;
+    ws.regions[0].area  = 500;
+    ws.regions[0].label = 1;
+    ws.regions[1].area       = 200;
+    ws.regions[1].centroid_x = 90;
+    ws.regions[1].bbox_y1    = 127;
+    ws.regions[1].label      = 258;
+    ws.regions[1].selected   = 1;
+    ws.regions[1].perimeter_x10   = 1234;
+    ws.regions[1].compactness_pct = 87;
+
+    static RegionContour contour;
+    memset(&contour, 0, sizeof(contour));
+    contour.label   = 258;
+    contour.start_x = 90;
+    contour.start_y = 3;
+    contour.steps   = 2000;
+    contour.stored  = 5;              /* 0 7 6 5 4: 15 bits */
+    contour.chain[0] = 0xB8;
+    contour.chain[1] = 0x4B;
+
+    EnergyReport er;
+    memset(&er, 0, sizeof(er));
+    er.hw_cycles          = 99330;
+    er.speedup            = 1.5f;
+    er.energy_savings_pct = 99.0f;
+
+    uint32_t seq = telemetry_sequence();
+    capture_begin();
+    telemetry_send_result(42, PROCESSING_MODE_NORMAL, &res);
+    telemetry_send_regions(42, &ws);
+    telemetry_send_contour(42, &contour);
+    telemetry_send_energy(42, &er);
+    capture_end();
+
+    const uint8_t *rec = line;
+    const uint8_t *p = check_frame(rec, TELEMETRY_ACCEL_RESULT,
+                                   TELEMETRY_ACCEL_RESULT_BYTES, seq);
+    check(p && get_u32(p) == 42 && p[4] == PROCESSING_MODE_NORMAL &&
+          p[5] == 97 && p[6] == PROCESSING_MODE_CAREFUL &&
+          get_u16(p + 8) == 0xBEEF && get_u16(p + 10) == 321 && get_u32(p + 12) == 0x01020304U &&
+          get_u32(p + 16) == 11 && get_u32(p + 32) == 0xA0B0C0D0U &&
+          p[36] == 5 && p[39] == 120 &&
+          get_u32(p + 40) == 1000 &&
+          get_u32(p + 40 + 4 * (HLS_NUM_STAGES - 1)) == 1000U * HLS_NUM_STAGES,
+          "accelerator result record");
+    rec += TELEMETRY_HEADER_BYTES + TELEMETRY_ACCEL_RESULT_BYTES + TELEMETRY_CRC_BYTES;
+
+    p = check_frame(rec, TELEMETRY_WATERSHED, TELEMETRY_WATERSHED_BYTES(2), seq + 1);
+    check(p && get_u32(p) == 42 && get_u32(p + 4) == 700 && p[8] == 2 &&
+          get_u16(p + 10) == 300 &&
+          get_u32(p + 12) == 500 && get_u16(p + 12 + 16) == 1 && p[12 + 18] == 0 &&
+          get_u16(p + 12 + 20) == 0 &&
+          get_u32(p + 36) == 200 && get_u16(p + 40) == 90 &&
+          get_u16(p + 50) == 127 && get_u16(p + 36 + 16) == 258 && p[36 + 18] == 1 &&
+          get_u16(p + 36 + 20) == 1234 && get_u16(p + 36 + 22) == 87,
+          "watershed record (only used regions)");
+    rec += TELEMETRY_HEADER_BYTES + TELEMETRY_WATERSHED_BYTES(2) + TELEMETRY_CRC_BYTES;
+
+    p = check_frame(rec, TELEMETRY_CONTOUR, TELEMETRY_CONTOUR_BYTES(5), seq + 2);
+    check(p && TELEMETRY_CONTOUR_BYTES(5) == 14 && get_u32(p) == 42 &&
+          get_u16(p + 4) == 258 && p[6] == 90 && p[7] == 3 &&
+          get_u16(p + 8) == 2000 && get_u16(p + 10) == 5 &&
+          p[12] == 0xB8 && p[13] == 0x4B,
+          "contour record (only stored steps)");
+    rec += TELEMETRY_HEADER_BYTES + TELEMETRY_CONTOUR_BYTES(5) + TELEMETRY_CRC_BYTES;
+
+    float speedup = 0.0f, savings = 0.0f;
+    p = check_frame(rec, TELEMETRY_ENERGY, TELEMETRY_ENERGY_BYTES, seq + 3);
+    if (p) {
+        uint32_t bits = get_u32(p + 24);
+        memcpy(&speedup, &bits, sizeof(speedup));
+        bits = get_u32(p + 44);
+        memcpy(&savings, &bits, sizeof(savings));
+    }
+    check(p && get_u32(p) == 42 && get_u32(p + 4) == 99330 &&
+          speedup == 1.5f && savings == 99.0f,
+          "energy record");
+    rec += TELEMETRY_HEADER_BYTES + TELEMETRY_ENERGY_BYTES + TELEMETRY_CRC_BYTES;
+
+    check(rec == line + line_len, "nothing else on the line");
+    printf("  frame telemetry: %u bytes\n", (unsigned)line_len);
+
+    /* The same frame as an ASCII report */
+    capture_begin();
+    energy_print_stage_cycles(res.stage_cycles);
+    watershed_print_summary(&ws);
+    energy_print_report(&er);
+    capture_end();
+    printf("  ASCII report:    %u bytes\n", (unsigned)line_len);
+    /* (the ASCII report has no contour) */
+    uint32_t binary = (uint32_t)(rec - line) - TELEMETRY_HEADER_BYTES -
+                      TELEMETRY_CONTOUR_BYTES(5) - TELEMETRY_CRC_BYTES;
+    check(line_len > 4U * binary, "binary report much smaller");
+}
+
+/* ------------------------------------------------------------------ */
+static void test_drop_whole(void)
+{
+    EnergyReport er;
+    memset(&er, 0, sizeof(er));
+    uint32_t record = TELEMETRY_HEADER_BYTES + TELEMETRY_ENERGY_BYTES + TELEMETRY_CRC_BYTES;
+
+    uart_tx_enable_interrupt();
+    uart_tx_set_drop(1);
+    capture_begin();
+
+    /* Leave less room in the ring than one record, with nothing draining */
+    cpu_irq_disable();
+    for (uint32_t i = 0; i < 16U + UART_TX_BUF_SIZE - record / 2U; i++)
+        uart_putc('.');
+    uint32_t seq = telemetry_sequence();
+    int rc = telemetry_send_energy(7, &er);
+    uint32_t dropped = uart_tx_overflows();
+    cpu_irq_enable();
+    uart_flush();
+
+    int rc2 = telemetry_send_energy(8, &er);
+    uart_flush();
+    capture_end();
+    uart_tx_set_drop(0);
+
+    /* The line holds the filler, then exactly the second record */
+    const uint8_t *rec = line + line_len - record;
+    check(rc == -1 && dropped == record && telemetry_sequence() == seq + 2,
+          "full ring drops a whole record");
+    check(rc2 == 0 && check_frame(rec, TELEMETRY_ENERGY, TELEMETRY_ENERGY_BYTES,
+                                  seq + 1) && get_u32(rec + 12) == 8 &&
+          line_len == 16U + UART_TX_BUF_SIZE - record / 2U + record,
+          "next record intact, sequence gap of one");
+}
+
+/* ------------------------------------------------------------------ */
+int main(void)
+{
+    uart_init();
+    intc_init();
+    cpu_irq_enable();
+
+    printf("Binary telemetry records\n");
+    test_layout();
+    test_drop_whole();
+
+    printf("\n==============================================\n");
+    printf(total_pass ? "  ALL TESTS PASSED\n" : "  SOME TESTS FAILED\n");
+    printf("==============================================\n");
+    return total_pass ? 0 : 1;
+}
@@ -0,0 +1,303 @@
+/******************************************************************************
+ * test_tiler.c
+ * ------------
+ * Desktop test for the tiled segmentation of large images.
+ *
+ * Runs against the simulated platform (sim/), whose accelerator instances
+ * execute the HLS C model.  On a frame-sized image the tiler must pick the
+ * kernel's own threshold and give the kernel's mask.  On larger images,
+ * with shapes crossing the seams between tiles, the mask must equal a
+ * whole-image reference built here with the tiler's threshold (checked
+ * against the image histogram) and the kernel's 3x3 morphology, and the
+ * stitched regions must be the reference's connected components.
+ *
+ * Build / run (from 04_vitis_software):
+ *   make test
+ ******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "platform_config.h"
+#include "adaptive_controller.h"
+#include "otsu_accel.h"
+#include "dispatcher.h"
+#include "image_loader.h"
+#include "intc.h"
+#include "tiler.h"
+#include "test_rng.h"
+
+#define MAX_W 512
+#define MAX_H 512
+#define MAX_PIXELS (MAX_W * MAX_H)
+
+static uint8_t image[MAX_PIXELS];
+static uint8_t mask[MAX_PIXELS];
+static uint8_t ref[MAX_PIXELS];
+static uint8_t tmp[MAX_PIXELS];
+static uint32_t comp[MAX_PIXELS];
+static uint32_t queue[MAX_PIXELS];
+
+typedef struct
+{
+    uint32_t area, isum;
+    uint16_t x0, y0, x1, y1;
+} RefRegion;
+
+static RefRegion ref_regions[MAX_PIXELS / 2 + 1];
+
+static const char *mode_name[3] = { "FAST", "NORMAL", "CAREFUL" };
+
+/* Noisy background; discs, a long bar and a diagonal line that cross tile
+ * seams; a few isolated bright pixels that the morphology removes */
+static void generate_image(uint16_t w, uint16_t h, uint32_t seed)
+{
+    seed_rng(seed);
+    for (uint32_t y = 0; y < h; y++) {
+        for (uint32_t x = 0; x < w; x++) {
+            int v = 40 + rand8() % 40;
+            for (int k = 0; k < 6; k++) {
+                int cx = (int)(w * (k + 1)) / 7;
+                int cy = (int)(h * ((k * 3) % 5 + 1)) / 6;
+                int r  = 9 + k * 5;
+                int dx = (int)x - cx, dy = (int)y - cy;
+                if (dx * dx + dy * dy <= r * r)
+                    v = 150 + k * 10 + rand8() % 30;
+            }
+            if (y >= h / 2U - 3U && y < h / 2U + 4U && x >= 20 && x + 20 < w)
+                v = 200 + rand8() % 20;
+            if (x + 10 < w && (x - y == 10 || x - y == 11))
+                v = 210;
+            if (rand8() == 0)
+                v = 255;
+            image[y * w + x] = (uint8_t)v;
+        }
+    }
+}
+
+/* ---- Whole-image reference: threshold, clipped 3x3 morphology ---- */
+static void morph(uint8_t *dst, const uint8_t *src, uint16_t w, uint16_t h,
+                  int dilate)
+{
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            uint8_t v = dilate ? 0 : 255;
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    int xx = x + dx, yy = y + dy;
+                    if (xx < 0 || yy < 0 || xx >= w || yy >= h)
+                        continue;
+                    uint8_t s = src[yy * w + xx];
+                    if (dilate ? s > v : s < v)
+                        v = s;
+                }
+            }
+            dst[y * w + x] = v;
+        }
+    }
+}
+
+static void reference_mask(uint16_t w, uint16_t h, uint8_t thr, uint8_t mode)
+{
+    uint32_t n = (uint32_t)w * h;
+    for (uint32_t i = 0; i < n; i++)
+        ref[i] = image[i] > thr ? 255 : 0;
+    if (mode == PROCESSING_MODE_FAST)
+        return;
+    morph(tmp, ref, w, h, 0);           /* open */
+    morph(ref, tmp, w, h, 1);
+    if (mode != PROCESSING_MODE_CAREFUL)
+        return;
+    morph(tmp, ref, w, h, 1);           /* close */
+    morph(ref, tmp, w, h, 0);
+}
+
+/* Breadth-first connected components of ref; returns their number */
+static uint32_t reference_components(uint16_t w, uint16_t h)
+{
+    uint32_t n = (uint32_t)w * h, count = 0;
+    memset(comp, 0, n * sizeof(comp[0]));
+
+    for (uint32_t s = 0; s < n; s++) {
+        if (!ref[s] || comp[s])
+            continue;
+        RefRegion *rg = &ref_regions[count++];
+        rg->area = rg->isum = 0;
+        rg->x0 = rg->y0 = 0xFFFF;
+        rg->x1 = rg->y1 = 0;
+
+        uint32_t head = 0, tail = 0;
+        comp[s] = count;
+        queue[tail++] = s;
+        while (head < tail) {
+            uint32_t i = queue[head++];
+            int x = (int)(i % w), y = (int)(i / w);
+            rg->area++;
+            rg->isum += image[i];
+            if (x < rg->x0) rg->x0 = (uint16_t)x;
+            if (x > rg->x1) rg->x1 = (uint16_t)x;
+            if (y < rg->y0) rg->y0 = (uint16_t)y;
+            if (y > rg->y1) rg->y1 = (uint16_t)y;
+
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    if ((dx == 0 && dy == 0) ||
+                        (WATERSHED_CONNECTIVITY == 4 && dx != 0 && dy != 0))
+                        continue;
+                    int xx = x + dx, yy = y + dy;
+                    if (xx < 0 || yy < 0 || xx >= w || yy >= h)
+                        continue;
+                    uint32_t j = (uint32_t)yy * w + (uint32_t)xx;
+                    if (ref[j] && !comp[j]) {
+                        comp[j] = count;
+                        queue[tail++] = j;
+                    }
+                }
+            }
+        }
+    }
+    return count;
+}
+
+/* Every reported region must be a reference component, and the reported
+ * areas must be the largest ones in order */
+static int regions_match(const TiledResult *res, uint32_t count)
+{
+    if (res->total_regions != count)
+        return 0;
+    if (res->num_regions != (count < MAX_REGIONS ? count : MAX_REGIONS))
+        return 0;
+
+    for (uint32_t k = 0; k < res->num_regions; k++) {
+        const TiledRegion *tr = &res->regions[k];
+        uint32_t larger = 0, found = 0;
+        for (uint32_t c = 0; c < count; c++) {
+            const RefRegion *rg = &ref_regions[c];
+            if (rg->area > tr->area)
+                larger++;
+            if (rg->area == tr->area && rg->isum == tr->intensity_sum &&
+                rg->x0 == tr->bbox_x0 && rg->y0 == tr->bbox_y0 &&
+                rg->x1 == tr->bbox_x1 && rg->y1 == tr->bbox_y1)
+                found = 1;
+        }
+        if (!found || larger > k)
+            return 0;
+        if (tr->mean_intensity != tr->intensity_sum / tr->area)
+            return 0;
+    }
+    return 1;
+}
+
+/* ------------------------------------------------------------------ */
+static int test_single_frame(void)
+{
+    int pass = 1;
+    OtsuAccel acc;
+    OtsuAccelResult kr;
+    static uint8_t kernel_mask[IMG_SIZE];
+
+    printf("Frame-sized image against the kernel\n");
+    for (uint8_t mode = 0; mode < 3; mode++) {
+        generate_image(IMG_WIDTH, IMG_HEIGHT, 100u + mode);
+
+        /* The kernel alone, its own threshold */
+        dispatcher_init();
+        otsu_accel_init(&acc, 0);
+        image_load_to_buffer(acc.in_addr, image);
+        otsu_accel_start(&acc, mode);
+        otsu_accel_wait_done(&acc);
+        otsu_accel_read_result(&acc, &kr);
+        memcpy(kernel_mask, PHYS_PTR(acc.out_addr), IMG_SIZE);
+
+        dispatcher_init();
+        TiledResult res;
+        int ok = tiler_segment(image, IMG_WIDTH, IMG_HEIGHT, mode, mask, &res) == 0 &&
+                 res.tiles == 1 && res.threshold == kr.threshold &&
+                 memcmp(mask, kernel_mask, IMG_SIZE) == 0;
+        printf("  %-8s thr %3u (kernel %3u) %s\n", mode_name[mode],
+               res.threshold, kr.threshold, ok ? "[PASS]" : "[FAIL]");
+        if (!ok)
+            pass = 0;
+    }
+    return pass;
+}
+
+static int test_large(uint16_t w, uint16_t h, uint32_t seed)
+{
+    int pass = 1;
+    uint32_t n = (uint32_t)w * h;
+
+    printf("%ux%u image\n", w, h);
+    generate_image(w, h, seed);
+
+    uint32_t hist[256] = { 0 };
+    for (uint32_t i = 0; i < n; i++)
+        hist[image[i]]++;
+
+    for (uint8_t mode = 0; mode < 3; mode++) {
+        TiledResult res;
+        dispatcher_init();
+        memset(mask, 0xA5, n);
+        int ok = tiler_segment(image, w, h, mode, mask, &res) == 0;
+
+        reference_mask(w, h, res.threshold, mode);
+        uint32_t count = reference_components(w, h);
+        uint32_t fg = 0;
+        for (uint32_t i = 0; i < n; i++)
+            fg += ref[i] != 0;
+
+        ok = ok && !res.label_overflow &&
+             res.threshold == tiler_threshold(hist, n, mode) &&
+             memcmp(mask, ref, n) == 0 && res.foreground == fg &&
+             regions_match(&res, count) && res.hw_cycles > 0;
+        printf("  %-8s thr %3u, %2u tiles, %3u regions, largest %5u px %s\n",
+               mode_name[mode], res.threshold, res.tiles, res.total_regions,
+               res.num_regions ? (unsigned)res.regions[0].area : 0U,
+               ok ? "[PASS]" : "[FAIL]");
+        if (!ok)
+            pass = 0;
+    }
+    return pass;
+}
+
+static int test_limits(void)
+{
+    TiledResult res;
+    int pass = tiler_segment(image, IMG_WIDTH - 1, IMG_HEIGHT, 0, mask, &res) == -1 &&
+               tiler_segment(image, IMG_WIDTH, TILER_MAX_DIM + 1, 0, mask, &res) == -1;
+
+    /* Speckle everywhere: more tile labels than the table holds */
+    seed_rng(7);
+    for (uint32_t i = 0; i < MAX_PIXELS; i++)
+        image[i] = (rand8() & 1) ? 200 : 20;
+    dispatcher_init();
+    pass = pass &&
+           tiler_segment(image, MAX_W, MAX_H, PROCESSING_MODE_FAST, mask, &res) == 0 &&
+           res.label_overflow && res.num_regions == MAX_REGIONS;
+
+    printf("Unsupported sizes, label overflow %s\n", pass ? "[PASS]" : "[FAIL]");
+    return pass;
+}
+
+/* ==================================================================== */
+int main(void)
+{
+    int total_pass = 1;
+
+    intc_init();
+    cpu_irq_enable();
+
+    if (!test_single_frame())
+        total_pass = 0;
+    if (!test_large(300, 200, 1))
+        total_pass = 0;
+    if (!test_large(MAX_W, MAX_H, 2))
+        total_pass = 0;
+    if (!test_large(IMG_WIDTH + 1, 400, 3))
+        total_pass = 0;
+    if (!test_limits())
+        total_pass = 0;
+
+    printf("\n==============================================\n");
+    printf(total_pass ? "  ALL TESTS PASSED\n" : "  SOME TESTS FAILED\n");
+    printf("==============================================\n");
+    return total_pass ? 0 : 1;
+}
@@ -0,0 +1,276 @@
+/******************************************************************************
+ * test_volume.c
+ * -------------
+ * Desktop test for the 3D segmentation of slice stacks.
+ *
+ * Runs against the simulated platform (sim/), whose accelerator instances
+ * execute the HLS C model.  The volume mask must equal a reference built
+ * here from the whole stack: the threshold of the stack's histogram, then
+ * the kernel's open / close as 3x3x3 operations clipped at the volume's
+ * borders.  The lesions must be the reference's 3D connected components
+ * (VOLUME_CONNECTIVITY), including a diagonal chain of voxels that only
+ * 26-connectivity joins across slices.
+ *
+ * Build / run (from 04_vitis_software):
+ *   make test
+ ******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "platform_config.h"
+#include "adaptive_controller.h"
+#include "dispatcher.h"
+#include "intc.h"
+#include "tiler.h"
+#include "volume.h"
+#include "test_rng.h"
+
+#define MAX_DEPTH  40
+#define MAX_VOXELS (MAX_DEPTH * IMG_SIZE)
+
+static uint8_t volume[MAX_VOXELS];
+static uint8_t mask[MAX_VOXELS];
+static uint8_t ref[MAX_VOXELS];
+static uint8_t tmp[MAX_VOXELS];
+static uint32_t comp[MAX_VOXELS];
+static uint32_t queue[MAX_VOXELS];
+
+typedef struct
+{
+    uint32_t voxels, isum;
+    uint32_t sx, sy, sz;
+    uint16_t x0, y0, z0, x1, y1, z1;
+} RefLesion;
+
+static RefLesion ref_lesions[MAX_VOXELS / 2 + 1];
+
+static const char *mode_name[3] = { "FAST", "NORMAL", "CAREFUL" };
+
+/* Noisy background; two ellipsoids of different size, a diagonal chain of
+ * single voxels through the slices and salt noise */
+static void generate_volume(uint32_t depth, uint32_t seed)
+{
+    seed_rng(seed);
+    for (uint32_t z = 0; z < depth; z++) {
+        for (uint32_t i = 0; i < IMG_SIZE; i++) {
+            int x = (int)(i % IMG_WIDTH), y = (int)(i / IMG_WIDTH);
+            int v = 30 + rand8() % 50;
+
+            float dx = (x - 45) / 28.0f, dy = (y - 50) / 22.0f;
+            float dz = ((float)z - depth * 0.4f) / (depth * 0.35f + 1.0f);
+            if (dx * dx + dy * dy + dz * dz <= 1.0f)
+                v = 170 + rand8() % 40;
+            dx = (x - 100) / 12.0f;
+            dy = (y - 96) / 14.0f;
+            dz = ((float)z - depth * 0.7f) / (depth * 0.2f + 1.0f);
+            if (dx * dx + dy * dy + dz * dz <= 1.0f)
+                v = 160 + rand8() % 30;
+
+            if (x == 10 + (int)z && y == 120)
+                v = 230;
+            if (rand8() == 0 && rand8() < 64)
+                v = 255;
+            volume[z * IMG_SIZE + i] = (uint8_t)v;
+        }
+    }
+}
+
+/* ---- Whole-volume reference: threshold, clipped 3x3x3 morphology ---- */
+static void morph_3d(uint8_t *dst, const uint8_t *src, uint32_t depth, int dilate)
+{
+    for (int z = 0; z < (int)depth; z++) {
+        for (int y = 0; y < IMG_HEIGHT; y++) {
+            for (int x = 0; x < IMG_WIDTH; x++) {
+                uint8_t v = dilate ? 0 : 255;
+                for (int dz = -1; dz <= 1; dz++) {
+                    for (int dy = -1; dy <= 1; dy++) {
+                        for (int dx = -1; dx <= 1; dx++) {
+                            int zz = z + dz, yy = y + dy, xx = x + dx;
+                            if (zz < 0 || zz >= (int)depth || yy < 0 ||
+                                yy >= IMG_HEIGHT || xx < 0 || xx >= IMG_WIDTH)
+                                continue;
+                            uint8_t s = src[(zz * IMG_HEIGHT + yy) * IMG_WIDTH + xx];
+                            if (dilate ? s > v : s < v)
+                                v = s;
+                        }
+                    }
+                }
+                dst[(z * IMG_HEIGHT + y) * IMG_WIDTH + x] = v;
+            }
+        }
+    }
+}
+
+static void reference_mask(uint32_t depth, uint8_t thr, uint8_t mode)
+{
+    uint32_t n = depth * IMG_SIZE;
+    for (uint32_t i = 0; i < n; i++)
+        ref[i] = volume[i] > thr ? 255 : 0;
+    if (mode == PROCESSING_MODE_FAST)
+        return;
+    morph_3d(tmp, ref, depth, 0);       /* open */
+    morph_3d(ref, tmp, depth, 1);
+    if (mode != PROCESSING_MODE_CAREFUL)
+        return;
+    morph_3d(tmp, ref, depth, 1);       /* close */
+    morph_3d(ref, tmp, depth, 0);
+}
+
+/* Breadth-first 3D connected components of ref; returns their number */
+static uint32_t reference_components(uint32_t depth)
+{
+    uint32_t n = depth * IMG_SIZE, count = 0;
+    memset(comp, 0, n * sizeof(comp[0]));
+
+    for (uint32_t s = 0; s < n; s++) {
+        if (!ref[s] || comp[s])
+            continue;
+        RefLesion *l = &ref_lesions[count++];
+        memset(l, 0, sizeof(*l));
+        l->x0 = l->y0 = l->z0 = 0xFFFF;
+
+        uint32_t head = 0, tail = 0;
+        comp[s] = count;
+        queue[tail++] = s;
+        while (head < tail) {
+            uint32_t i = queue[head++];
+            int x = (int)(i % IMG_WIDTH), y = (int)((i / IMG_WIDTH) % IMG_HEIGHT);
+            int z = (int)(i / IMG_SIZE);
+            l->voxels++;
+            l->isum += volume[i];
+            l->sx += (uint32_t)x;
+            l->sy += (uint32_t)y;
+            l->sz += (uint32_t)z;
+            if (x < l->x0) l->x0 = (uint16_t)x;
+            if (x > l->x1) l->x1 = (uint16_t)x;
+            if (y < l->y0) l->y0 = (uint16_t)y;
+            if (y > l->y1) l->y1 = (uint16_t)y;
+            if (z < l->z0) l->z0 = (uint16_t)z;
+            if (z > l->z1) l->z1 = (uint16_t)z;
+
+            for (int dz = -1; dz <= 1; dz++) {
+                for (int dy = -1; dy <= 1; dy++) {
+                    for (int dx = -1; dx <= 1; dx++) {
+                        int off = (dx != 0) + (dy != 0) + (dz != 0);
+                        if (off == 0 || (VOLUME_CONNECTIVITY == 6 && off > 1))
+                            continue;
+                        int xx = x + dx, yy = y + dy, zz = z + dz;
+                        if (xx < 0 || yy < 0 || zz < 0 || xx >= IMG_WIDTH ||
+                            yy >= IMG_HEIGHT || zz >= (int)depth)
+                            continue;
+                        uint32_t j = ((uint32_t)zz * IMG_HEIGHT + (uint32_t)yy) * IMG_WIDTH +
+                                     (uint32_t)xx;
+                        if (ref[j] && !comp[j]) {
+                            comp[j] = count;
+                            queue[tail++] = j;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return count;
+}
+
+/* Every reported lesion must be a reference component, and the reported
+ * volumes must be the largest ones in order */
+static int lesions_match(const VolumeResult *res, uint32_t count)
+{
+    if (res->total_lesions != count)
+        return 0;
+    if (res->num_lesions != (count < MAX_REGIONS ? count : MAX_REGIONS))
+        return 0;
+
+    for (uint32_t k = 0; k < res->num_lesions; k++) {
+        const VolumeLesion *vl = &res->lesions[k];
+        uint32_t larger = 0, found = 0;
+        for (uint32_t c = 0; c < count; c++) {
+            const RefLesion *l = &ref_lesions[c];
+            if (l->voxels > vl->volume)
+                larger++;
+            if (l->voxels == vl->volume && l->isum == vl->intensity_sum &&
+                l->sx / l->voxels == vl->centroid_x &&
+                l->sy / l->voxels == vl->centroid_y &&
+                l->sz / l->voxels == vl->centroid_z &&
+                l->x0 == vl->bbox_x0 && l->y0 == vl->bbox_y0 && l->z0 == vl->bbox_z0 &&
+                l->x1 == vl->bbox_x1 && l->y1 == vl->bbox_y1 && l->z1 == vl->bbox_z1)
+                found = 1;
+        }
+        if (!found || larger > k)
+            return 0;
+    }
+    return 1;
+}
+
+/* ------------------------------------------------------------------ */
+static int test_volume(uint32_t depth, uint32_t seed)
+{
+    int pass = 1;
+    uint32_t n = depth * IMG_SIZE;
+
+    printf("%u-slice volume\n", (unsigned)depth);
+    generate_volume(depth, seed);
+
+    uint32_t hist[256] = { 0 };
+    for (uint32_t i = 0; i < n; i++)
+        hist[volume[i]]++;
+
+    for (uint8_t mode = 0; mode < 3; mode++) {
+        VolumeResult res;
+        dispatcher_init();
+        memset(mask, 0xA5, n);
+        int ok = volume_segment(volume, (uint16_t)depth, mode, mask, &res) == 0;
+
+        reference_mask(depth, res.threshold, mode);
+        uint32_t count = reference_components(depth);
+        uint32_t fg = 0;
+        for (uint32_t i = 0; i < n; i++)
+            fg += ref[i] != 0;
+
+        ok = ok && !res.label_overflow && res.depth == depth &&
+             res.threshold == tiler_threshold(hist, n, mode) &&
+             memcmp(mask, ref, n) == 0 && res.foreground == fg &&
+             lesions_match(&res, count) && res.hw_cycles > 0;
+        printf("  %-8s thr %3u, %3u lesions, largest %6u voxels at (%u, %u, %u) %s\n",
+               mode_name[mode], res.threshold, res.total_lesions,
+               res.num_lesions ? (unsigned)res.lesions[0].volume : 0U,
+               res.num_lesions ? res.lesions[0].centroid_x : 0U,
+               res.num_lesions ? res.lesions[0].centroid_y : 0U,
+               res.num_lesions ? res.lesions[0].centroid_z : 0U,
+               ok ? "[PASS]" : "[FAIL]");
+        if (!ok)
+            pass = 0;
+    }
+    return pass;
+}
+
+static int test_limits(void)
+{
+    VolumeResult res;
+    int pass = volume_segment(volume, 0, 0, mask, &res) == -1 &&
+               volume_segment(volume, VOLUME_MAX_DEPTH + 1, 0, mask, &res) == -1;
+    printf("Unsupported depths %s\n", pass ? "[PASS]" : "[FAIL]");
+    return pass;
+}
+
+/* ==================================================================== */
+int main(void)
+{
+    int total_pass = 1;
+
+    intc_init();
+    cpu_irq_enable();
+
+    if (!test_volume(12, 1))
+        total_pass = 0;
+    if (!test_volume(MAX_DEPTH, 2))
+        total_pass = 0;
+    if (!test_volume(2, 3))         /* fewer slices than the CAREFUL lag */
+        total_pass = 0;
+    if (!test_limits())
+        total_pass = 0;
+
+    printf("\n==============================================\n");
+    printf(total_pass ? "  ALL TESTS PASSED\n" : "  SOME TESTS FAILED\n");
+    printf("==============================================\n");
+    return total_pass ? 0 : 1;
+}
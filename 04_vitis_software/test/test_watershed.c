@@ -0,0 +1,644 @@
+/******************************************************************************
+ * test_watershed.c
+ * -----------------
+ * Desktop test for the labelling and the marker-based watershed
+ * (watershed.c).
+ *
+ *   - random blob / speckle masks give the same regions, intensity sums
+ *     and label map as a straightforward BFS reference, for 4- and
+ *     8-connectivity; the run-based variant gives the same regions
+ *     (aligned or not, or from kernel-format row runs), the span fill the
+ *     same regions and label map,
+ *   - shapes that need label merging (U, comb, staircase) come out as
+ *     one region; a diagonal chain is one region with 8-connectivity and
+ *     one per pixel with 4-connectivity,
+ *   - a full checkerboard (the most provisional labels a mask can need)
+ *     fits the equivalence table; a dense comb overflows the span stack
+ *     and the span fill still finds the whole region,
+ *   - past MAX_REGIONS every region is still labelled and counted and the
+ *     largest ones are listed, also when a large one comes after
+ *     thousands of speckles in raster order,
+ *   - the marker-based watershed splits touching discs at their neck into
+ *     connected regions, keeps a lone disc whole (same region as the
+ *     labelling) and drops a blob too small to hold a marker,
+ *   - the intensity selection keeps large bright regions only (or the
+ *     brightest if none qualifies) and the final mask holds exactly their
+ *     pixels,
+ *   - contours close on their first pixel over boundary pixels only (all
+ *     of them for hole-free shapes), with the expected length, perimeter
+ *     and compactness for rectangles, discs and one-pixel-wide lines.
+ *
+ * Build / run (from 04_vitis_software):
+ *   make test
+ ******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "platform_config.h"
+#include "watershed.h"
+#include "adaptive_controller.h"
+
+#define LABELS ((volatile uint16_t *)PHYS_PTR(WATERSHED_LABEL_BASE))
+
+static uint8_t mask[IMG_SIZE];
+static uint8_t image[IMG_SIZE];
+static uint8_t out[IMG_SIZE];
+static uint8_t shifted[IMG_SIZE + 1];
+static uint16_t ref_map[IMG_SIZE];
+static uint16_t queue[IMG_SIZE];
+static int total_pass = 1;
+
+static void check(int ok, const char *what)
+{
+    printf("  %-44s %s\n", what, ok ? "[PASS]" : "[FAIL]");
+    if (!ok)
+        total_pass = 0;
+}
+
+static uint32_t rng = 2024;
+static uint32_t rand32(void)
+{
+    rng = rng * 1664525U + 1013904223U;
+    return rng >> 8;
+}
+
+/* ---- BFS reference: every component in raster order of its first pixel,
+ *      the MAX_REGIONS largest listed (earlier first on equal area) ---- */
+static RegionInfo all_regions[IMG_SIZE / 2U + 1U];
+
+static int ranks_above(const RegionInfo *a, const RegionInfo *b)
+{
+    return a->area > b->area || (a->area == b->area && a->label < b->label);
+}
+
+static void reference(uint8_t conn, WatershedResult *res)
+{
+    static const int dx[8] = { -1, 1, 0, 0, -1, 1, -1, 1 };
+    static const int dy[8] = { 0, 0, -1, 1, -1, -1, 1, 1 };
+
+    memset(res, 0, sizeof(*res));
+    memset(ref_map, 0, sizeof(ref_map));
+    uint16_t label = 0;
+
+    for (uint32_t s = 0; s < IMG_SIZE; s++) {
+        if (!mask[s] || ref_map[s])
+            continue;
+        RegionInfo *r = &all_regions[label++];
+        memset(r, 0, sizeof(*r));
+        r->label   = label;
+        r->bbox_x0 = IMG_WIDTH;
+        r->bbox_y0 = IMG_HEIGHT;
+        uint32_t sx = 0, sy = 0, head = 0, tail = 0;
+        queue[tail++] = (uint16_t)s;
+        ref_map[s] = label;
+        while (head < tail) {
+            uint16_t p = queue[head++];
+            int x = p % IMG_WIDTH, y = p / IMG_WIDTH;
+            r->area++;
+            sx += (uint32_t)x;
+            sy += (uint32_t)y;
+            if (x < r->bbox_x0) r->bbox_x0 = (uint16_t)x;
+            if (y < r->bbox_y0) r->bbox_y0 = (uint16_t)y;
+            if (x > r->bbox_x1) r->bbox_x1 = (uint16_t)x;
+            if (y > r->bbox_y1) r->bbox_y1 = (uint16_t)y;
+            r->intensity_sum += image[p];
+            r->intensity_sq  += (uint32_t)image[p] * image[p];
+            for (int d = 0; d < conn; d++) {
+                int nx = x + dx[d], ny = y + dy[d];
+                if (nx < 0 || nx >= IMG_WIDTH || ny < 0 || ny >= IMG_HEIGHT)
+                    continue;
+                uint32_t n = (uint32_t)ny * IMG_WIDTH + (uint32_t)nx;
+                if (mask[n] && !ref_map[n]) {
+                    ref_map[n] = label;
+                    queue[tail++] = (uint16_t)n;
+                }
+            }
+        }
+        r->centroid_x = (uint16_t)(sx / r->area);
+        r->centroid_y = (uint16_t)(sy / r->area);
+        res->total_foreground += r->area;
+    }
+    res->total_regions = label;
+
+    /* A region is listed if fewer than MAX_REGIONS others rank above it */
+    for (uint16_t a = 0; a < label; a++) {
+        uint32_t above = 0;
+        for (uint16_t b = 0; b < label && above < MAX_REGIONS; b++)
+            above += ranks_above(&all_regions[b], &all_regions[a]);
+        if (above < MAX_REGIONS)
+            res->regions[res->num_regions++] = all_regions[a];
+    }
+}
+
+/* Encode the mask as the kernel's HLS_OTSU_MODE_RLE output */
+static uint32_t rle[IMG_SIZE / 2];
+
+static uint16_t encode_rle(void)
+{
+    uint16_t n = 0;
+    for (uint32_t y = 0; y < IMG_HEIGHT; y++)
+        for (uint32_t x = 0; x < IMG_WIDTH; x++) {
+            const uint8_t *row = mask + y * IMG_WIDTH;
+            if (!row[x] || (x > 0 && row[x - 1]))
+                continue;
+            uint32_t len = 1;
+            while (x + len < IMG_WIDTH && row[x + len])
+                len++;
+            rle[n++] = x | len << 8 | y << 16;
+        }
+    return n;
+}
+
+/* Label with @p conn (every labelling variant) and compare with the
+ * reference */
+static int matches_reference(uint8_t conn)
+{
+    WatershedResult got, runs, runs_odd, runs_rle, spans, want;
+
+    /* Run variant, also on an unaligned copy of the mask */
+    watershed_label_runs(mask, image, conn, &runs);
+    memcpy(shifted + 1, mask, IMG_SIZE);
+    watershed_label_runs(shifted + 1, image, conn, &runs_odd);
+    watershed_label_rle(rle, encode_rle(), image, conn, &runs_rle);
+
+    reference(conn, &want);
+
+    /* Span fill, label map included */
+    watershed_label_spans(mask, image, conn, &spans);
+    if (memcmp(&spans, &want, sizeof(spans)) != 0)
+        return 0;
+    for (uint32_t i = 0; i < IMG_SIZE; i++)
+        if (LABELS[i] != ref_map[i])
+            return 0;
+
+    watershed_label_components(mask, image, conn, &got);
+
+    if (memcmp(&got, &want, sizeof(got)) != 0 ||
+        memcmp(&runs, &want, sizeof(runs)) != 0 ||
+        memcmp(&runs_odd, &want, sizeof(runs_odd)) != 0 ||
+        memcmp(&runs_rle, &want, sizeof(runs_rle)) != 0)
+        return 0;
+    for (uint32_t i = 0; i < IMG_SIZE; i++)
+        if (LABELS[i] != ref_map[i])
+            return 0;
+    return 1;
+}
+
+/* ---- Mask generators ---- */
+static void put(int x, int y)
+{
+    if (x >= 0 && x < IMG_WIDTH && y >= 0 && y < IMG_HEIGHT)
+        mask[y * IMG_WIDTH + x] = 255;
+}
+
+static void random_mask(uint32_t blobs, uint32_t speckle_per_mille)
+{
+    memset(mask, 0, sizeof(mask));
+    for (uint32_t b = 0; b < blobs; b++) {
+        int cx = (int)(rand32() % IMG_WIDTH), cy = (int)(rand32() % IMG_HEIGHT);
+        int rx = 2 + (int)(rand32() % 14), ry = 2 + (int)(rand32() % 14);
+        for (int y = -ry; y <= ry; y++)
+            for (int x = -rx; x <= rx; x++)
+                if (x * x * ry * ry + y * y * rx * rx <= rx * rx * ry * ry)
+                    put(cx + x, cy + y);
+    }
+    for (uint32_t i = 0; i < IMG_SIZE; i++)
+        if (rand32() % 1000U < speckle_per_mille)
+            mask[i] = 255;
+}
+
+static void disc(int cx, int cy, int r)
+{
+    for (int y = -r; y <= r; y++)
+        for (int x = -r; x <= r; x++)
+            if (x * x + y * y <= r * r)
+                put(cx + x, cy + y);
+}
+
+/* Flood label map: every region is one 4-connected piece of the mask whose
+ * size is its area, and labelled pixels add up to the foreground */
+static int flood_map_consistent(const WatershedResult *res)
+{
+    static uint8_t seen[IMG_SIZE];
+    memset(seen, 0, sizeof(seen));
+    uint32_t labelled = 0;
+
+    for (uint32_t i = 0; i < IMG_SIZE; i++) {
+        uint16_t l = LABELS[i];
+        if (l > res->total_regions || (l && !mask[i]))
+            return 0;
+        labelled += l != 0;
+    }
+    for (uint8_t k = 0; k < res->num_regions; k++) {
+        uint16_t label = res->regions[k].label;
+        uint32_t s = 0, head = 0, tail = 0;
+        while (s < IMG_SIZE && LABELS[s] != label)
+            s++;
+        if (s == IMG_SIZE)
+            return 0;
+        queue[tail++] = (uint16_t)s;
+        seen[s] = 1;
+        while (head < tail) {
+            uint32_t p = queue[head++], x = p % IMG_WIDTH;
+            uint32_t n[4] = { p - IMG_WIDTH, p - 1U, p + 1U, p + IMG_WIDTH };
+            int in[4] = { p >= IMG_WIDTH, x > 0, x + 1U < IMG_WIDTH,
+                          p + IMG_WIDTH < IMG_SIZE };
+            for (int d = 0; d < 4; d++)
+                if (in[d] && !seen[n[d]] && LABELS[n[d]] == label) {
+                    seen[n[d]] = 1;
+                    queue[tail++] = (uint16_t)n[d];
+                }
+        }
+        if (tail != res->regions[k].area)
+            return 0;
+    }
+    return labelled == res->total_foreground;
+}
+
+static void test_flood(void)
+{
+    WatershedResult res, cc;
+
+    /* Two overlapping discs: one component, two basins split at the neck */
+    memset(mask, 0, sizeof(mask));
+    disc(40, 60, 16);
+    disc(70, 60, 16);
+    watershed_label_components(mask, NULL, 4, &cc);
+    watershed_flood(mask, NULL, &res);
+    int split = cc.num_regions == 1 && res.num_regions == 2 &&
+                res.total_foreground == cc.total_foreground &&
+                flood_map_consistent(&res);
+    for (uint32_t i = 0; split && i < IMG_SIZE; i++) {
+        uint32_t x = i % IMG_WIDTH;
+        if ((LABELS[i] == 1 && x > 56) || (LABELS[i] == 2 && x < 54))
+            split = 0;
+    }
+    check(split, "flood: touching discs split at the neck");
+
+    /* Three in a row, of different sizes */
+    memset(mask, 0, sizeof(mask));
+    disc(22, 32, 12);
+    disc(46, 32, 14);
+    disc(74, 32, 16);
+    watershed_flood(mask, NULL, &res);
+    int chain = res.num_regions == 3 && flood_map_consistent(&res);
+    for (uint8_t k = 0; chain && k < res.num_regions; k++) {
+        int cx = res.regions[k].centroid_x;   /* near one of the centres */
+        chain = (cx > 19 && cx < 25) || (cx > 43 && cx < 49) || (cx > 71 && cx < 77);
+    }
+    check(chain, "flood: chain of three discs, three regions");
+
+    /* A lone disc is one region, as with plain labelling */
+    memset(mask, 0, sizeof(mask));
+    disc(90, 90, 20);
+    watershed_label_components(mask, NULL, 4, &cc);
+    watershed_flood(mask, NULL, &res);
+    int lone = memcmp(&res, &cc, sizeof(res)) == 0 && flood_map_consistent(&res);
+
+    /* A speck far below 0.4 x the largest distance holds no marker */
+    put(10, 10);
+    put(11, 10);
+    watershed_flood(mask, NULL, &res);
+    check(lone && res.num_regions == 1 && res.total_foreground == cc.total_foreground &&
+          LABELS[10 * IMG_WIDTH + 10] == 0,
+          "flood: lone disc whole, marker-less speck dropped");
+
+    /* Random masks and the edge cases of the scratch encoding */
+    int ok = 1;
+    for (int t = 0; t < 20; t++) {
+        random_mask(1 + (uint32_t)t % 6U, (uint32_t)(t % 3) * 10U);
+        watershed_flood(mask, NULL, &res);
+        ok &= flood_map_consistent(&res);
+    }
+    memset(mask, 255, sizeof(mask));
+    watershed_flood(mask, NULL, &res);
+    ok &= res.num_regions == 1 && res.total_foreground == IMG_SIZE &&
+          flood_map_consistent(&res);
+    memset(mask, 0, sizeof(mask));
+    watershed_flood(mask, NULL, &res);
+    ok &= res.num_regions == 0 && res.total_foreground == 0;
+    check(ok, "flood: random, full and empty masks");
+}
+
+/* Intensity @p v on the disc, both in the mask and in the image */
+static void bright_disc(int cx, int cy, int r, uint8_t v)
+{
+    for (int y = -r; y <= r; y++)
+        for (int x = -r; x <= r; x++)
+            if (x * x + y * y <= r * r && cx + x >= 0 && cx + x < IMG_WIDTH &&
+                cy + y >= 0 && cy + y < IMG_HEIGHT) {
+                mask[(cy + y) * IMG_WIDTH + cx + x]  = 255;
+                image[(cy + y) * IMG_WIDTH + cx + x] = v;
+            }
+}
+
+static void test_select(void)
+{
+    WatershedResult res;
+    SwImageStats st;
+
+    /* Bright large disc, dim large disc, bright disc under the minimum area */
+    memset(mask, 0, sizeof(mask));
+    memset(image, 20, sizeof(image));
+    bright_disc(30, 30, 14, 200);
+    bright_disc(90, 40, 14, 45);
+    bright_disc(60, 100, 6, 220);
+    adaptive_compute_stats(image, &st);
+
+    watershed_flood(mask, image, &res);
+    int sums = res.num_regions == 3;
+    for (uint8_t k = 0; sums && k < res.num_regions; k++) {
+        const RegionInfo *r = &res.regions[k];
+        uint32_t v = r->intensity_sum / r->area;
+        sums = r->intensity_sum == v * r->area && r->intensity_sq == v * v * r->area;
+    }
+    check(sums, "intensity sums gathered while flooding");
+
+    uint8_t n = watershed_select(&res, st.mean, st.std_dev);
+    watershed_select_mask(&res, out);
+    int exact = 1;
+    for (uint32_t i = 0; i < IMG_SIZE; i++)
+        if (out[i] != ((mask[i] && image[i] == 200) ? 255 : 0))
+            exact = 0;
+    check(n == 1 && res.regions[0].selected && !res.regions[1].selected &&
+          !res.regions[2].selected && exact,
+          "select: large and bright only, exact mask");
+
+    /* Nothing clears the bar: the brightest region is kept */
+    memset(mask, 0, sizeof(mask));
+    memset(image, 20, sizeof(image));
+    bright_disc(30, 30, 14, 60);
+    bright_disc(90, 40, 14, 61);
+    for (uint32_t i = 0; i < IMG_SIZE; i += 3)
+        image[i] = 250;                     /* raise the image std */
+    adaptive_compute_stats(image, &st);
+    watershed_label_runs(mask, image, 4, &res);
+    n = watershed_select(&res, st.mean, st.std_dev);
+    check(n == 1 && res.num_regions == 2 && !res.regions[0].selected &&
+          res.regions[1].selected,
+          "select: falls back to the brightest region");
+}
+
+/* ---- Contours: walk a chain code over the label map ---- */
+static int on_region(int x, int y, uint16_t label)
+{
+    return x >= 0 && x < IMG_WIDTH && y >= 0 && y < IMG_HEIGHT &&
+           LABELS[y * IMG_WIDTH + x] == label;
+}
+
+static int on_boundary(int x, int y, uint16_t label)
+{
+    return on_region(x, y, label) &&
+           !(on_region(x - 1, y, label) && on_region(x + 1, y, label) &&
+             on_region(x, y - 1, label) && on_region(x, y + 1, label));
+}
+
+/* Every pixel of the stored steps is a boundary pixel of the region and a
+ * complete chain ends on its start; returns the distinct pixels visited,
+ * 0 if not */
+static uint32_t walk_contour(const RegionContour *c)
+{
+    static const int dx[8] = { 1, 1, 0, -1, -1, -1, 0, 1 };
+    static const int dy[8] = { 0, -1, -1, -1, 0, 1, 1, 1 };
+    static uint8_t seen[IMG_SIZE];
+    int x = c->start_x, y = c->start_y;
+    uint32_t visited = 1;
+
+    if (!on_boundary(x, y, c->label))
+        return 0;
+    memset(seen, 0, sizeof(seen));
+    seen[y * IMG_WIDTH + x] = 1;
+    for (uint32_t n = 0; n < c->stored; n++) {
+        uint32_t bit = 3U * n, v = c->chain[bit / 8U];
+        if (bit % 8U > 5U)
+            v |= (uint32_t)c->chain[bit / 8U + 1U] << 8;
+        uint32_t d = (v >> (bit % 8U)) & 7U;
+        x += dx[d];
+        y += dy[d];
+        if (!on_boundary(x, y, c->label))
+            return 0;
+        if (!seen[y * IMG_WIDTH + x]) {
+            seen[y * IMG_WIDTH + x] = 1;
+            visited++;
+        }
+    }
+    if (c->stored == c->steps && (x != c->start_x || y != c->start_y))
+        return 0;
+    return visited;
+}
+
+static uint32_t boundary_pixels(uint16_t label)
+{
+    uint32_t n = 0;
+    for (int y = 0; y < IMG_HEIGHT; y++)
+        for (int x = 0; x < IMG_WIDTH; x++)
+            n += (uint32_t)on_boundary(x, y, label);
+    return n;
+}
+
+static void test_contour(void)
+{
+    static RegionContour c;
+    WatershedResult res, seg;
+
+    /* Rectangle: straight steps only, clockwise from the top-left corner */
+    memset(mask, 0, sizeof(mask));
+    for (int y = 40; y < 50; y++)
+        for (int x = 30; x < 50; x++)
+            put(x, y);
+    watershed_label_components(mask, NULL, 4, &res);
+    watershed_measure_contours(&res);
+    watershed_trace_contour(&res.regions[0], &c);
+    check(c.steps == 56 && c.stored == 56 && c.start_x == 30 && c.start_y == 40 &&
+          (c.chain[0] & 7U) == 0 && walk_contour(&c) == boundary_pixels(1) &&
+          res.regions[0].perimeter_x10 == 591 && res.regions[0].compactness_pct == 71,
+          "contour: 20x10 rectangle, 56 steps");
+
+    /* Disc: closed, every boundary pixel, compactness near 1 */
+    memset(mask, 0, sizeof(mask));
+    disc(64, 64, 16);
+    watershed_label_components(mask, NULL, 4, &res);
+    watershed_measure_contours(&res);
+    watershed_trace_contour(&res.regions[0], &c);
+    uint32_t cp = res.regions[0].compactness_pct;
+    watershed_segment(mask, NULL, &seg);
+    check(walk_contour(&c) == boundary_pixels(1) && c.stored == c.steps &&
+          cp >= 80 && cp <= 100 &&
+          seg.regions[0].perimeter_x10 == res.regions[0].perimeter_x10,
+          "contour: disc closes, compactness near 100");
+
+    /* One-pixel-wide parts are walked out and back; a lone pixel has no
+     * contour */
+    memset(mask, 0, sizeof(mask));
+    for (int x = 10; x < 20; x++)
+        put(x, 5);
+    for (int i = 0; i < 8; i++)
+        put(100 + i, 20 + i);
+    put(60, 60);
+    watershed_label_components(mask, NULL, 8, &res);
+    watershed_measure_contours(&res);
+    watershed_trace_contour(&res.regions[1], &c);
+    check(res.num_regions == 3 &&
+          res.regions[0].perimeter_x10 == 211 && res.regions[1].perimeter_x10 == 229 &&
+          c.steps == 14 && walk_contour(&c) == 8 &&
+          res.regions[2].perimeter_x10 == 0 && res.regions[2].compactness_pct == 0,
+          "contour: lines out and back, lone pixel");
+
+    /* Longer than the chain: counted in full, first steps kept */
+    memset(mask, 0, sizeof(mask));
+    for (int x = 0; x < IMG_WIDTH; x++)
+        put(x, 20);
+    for (int x = 0; x < IMG_WIDTH; x += 2)
+        for (int y = 21; y < 40; y++)
+            put(x, y);
+    watershed_label_components(mask, NULL, 4, &res);
+    watershed_measure_contours(&res);
+    watershed_trace_contour(&res.regions[0], &c);
+    check(c.steps > WATERSHED_CHAIN_STEPS && c.stored == WATERSHED_CHAIN_STEPS &&
+          walk_contour(&c) && res.regions[0].perimeter_x10 >= 10U * c.steps,
+          "contour: truncated chain, full perimeter");
+
+    /* Random masks, both connectivities */
+    int ok = 1;
+    for (int t = 0; t < 20; t++) {
+        random_mask(1 + (uint32_t)t % 6U, (uint32_t)(t % 3) * 10U);
+        for (uint8_t conn = 4; conn <= 8; conn += 4) {
+            watershed_label_components(mask, NULL, conn, &res);
+            for (uint8_t k = 0; k < res.num_regions; k++) {
+                watershed_trace_contour(&res.regions[k], &c);
+                ok &= walk_contour(&c) != 0;
+            }
+        }
+    }
+    check(ok, "contour: random masks, closed on the boundary");
+}
+
+/* ------------------------------------------------------------------ */
+int main(void)
+{
+    WatershedResult res;
+    int ok4 = 1, ok8 = 1;
+
+    printf("Connected-component labelling\n");
+
+    for (uint32_t i = 0; i < IMG_SIZE; i++)
+        image[i] = (uint8_t)rand32();
+
+    for (int t = 0; t < 40; t++) {
+        random_mask(1 + (uint32_t)t % 6U, (uint32_t)(t % 4) * 15U);
+        ok4 &= matches_reference(4);
+        ok8 &= matches_reference(8);
+    }
+    memset(mask, 255, sizeof(mask));
+    ok4 &= matches_reference(4);
+    ok8 &= matches_reference(8);
+    memset(mask, 0, sizeof(mask));
+    ok4 &= matches_reference(4);
+    check(ok4, "random masks, 4-connected, match BFS");
+    check(ok8, "random masks, 8-connected, match BFS");
+
+    /* U: two arms that only meet at the bottom */
+    memset(mask, 0, sizeof(mask));
+    for (int y = 10; y < 60; y++) {
+        put(20, y);
+        put(21, y);
+        put(70, y);
+    }
+    for (int x = 20; x <= 70; x++)
+        put(x, 60);
+    /* Comb: teeth that are only joined by the bottom bar */
+    for (int x = 80; x < 125; x += 4)
+        for (int y = 10; y <= 60; y++)
+            put(x, y);
+    for (int x = 80; x <= 124; x++)
+        put(x, 61);
+    /* Staircase opening upwards: every step starts a new label */
+    for (int s = 0; s < 20; s++)
+        for (int y = 100; y < 120; y++)
+            if (y >= 119 - s)
+                put(s * 3, y), put(s * 3 + 1, y), put(s * 3 + 2, y);
+    watershed_label_components(mask, NULL, 4, &res);
+    check(res.num_regions == 3 && matches_reference(4) && matches_reference(8),
+          "U, comb and staircase, one region each");
+
+    /* Diagonal chain */
+    memset(mask, 0, sizeof(mask));
+    for (int i = 0; i < 10; i++)
+        put(100 - i, 5 + i);
+    watershed_label_components(mask, NULL, 8, &res);
+    int diag8 = res.num_regions == 1 && res.regions[0].area == 10;
+    watershed_label_components(mask, NULL, 4, &res);
+    check(diag8 && res.num_regions == 10 && matches_reference(4),
+          "diagonal chain: 1 region (8), 10 regions (4)");
+
+    /* More regions than MAX_REGIONS: squares of growing size, the largest
+     * in the middle of the raster order */
+    memset(mask, 0, sizeof(mask));
+    for (int k = 0; k < 30; k++) {
+        int side = 1 + (k * 7) % 30;
+        for (int y = 0; y < side / 4 + 1; y++)
+            for (int x = 0; x < 4; x++)
+                put((k % 10) * 12 + x, (k / 10) * 40 + y);
+    }
+    watershed_label_components(mask, NULL, 4, &res);
+    int many = res.total_regions == 30 && res.num_regions == MAX_REGIONS &&
+               matches_reference(4);
+    for (uint8_t k = 1; many && k < res.num_regions; k++)
+        many = res.regions[k - 1].label < res.regions[k].label;
+    uint32_t labelled = 0;
+    for (uint32_t i = 0; i < IMG_SIZE; i++)
+        labelled += LABELS[i] != 0;
+    watershed_label_runs(mask, NULL, 4, &res);
+    check(many && res.total_regions == 30 && labelled == res.total_foreground,
+          "30 regions: all labelled, largest 16 listed");
+
+    /* Speckle grid (one region per pixel) above the largest region: its
+     * label is past any small region table */
+    memset(mask, 0, sizeof(mask));
+    for (int y = 0; y < 80; y += 2)
+        for (int x = 0; x < IMG_WIDTH; x += 2)
+            put(x, y);
+    disc(64, 105, 12);
+    disc(20, 110, 6);
+    uint16_t late = 0;
+    watershed_label_components(mask, image, 4, &res);
+    for (uint8_t k = 0; k < res.num_regions; k++)
+        if (res.regions[k].area == 441)
+            late = res.regions[k].label;
+    int late_ok = res.total_regions == 40 * 64 + 2 && late > 2560 &&
+                  res.num_regions == MAX_REGIONS && matches_reference(4) &&
+                  matches_reference(8);
+    watershed_flood(mask, image, &res);
+    check(late_ok && res.total_regions == 2 && res.regions[0].area > 400,
+          "largest region after 2560 speckles is listed");
+
+    /* Checkerboard: IMG_SIZE / 2 provisional labels */
+    for (uint32_t i = 0; i < IMG_SIZE; i++)
+        mask[i] = (((i / IMG_WIDTH) + (i % IMG_WIDTH)) & 1U) ? 0 : 255;
+    watershed_label_components(mask, NULL, 4, &res);
+    int cb4 = res.num_regions == MAX_REGIONS && res.total_regions == IMG_SIZE / 2U &&
+              matches_reference(4);
+    watershed_label_components(mask, NULL, 8, &res);
+    check(cb4 && res.num_regions == 1 && res.regions[0].area == IMG_SIZE / 2U,
+          "checkerboard fits the equivalence table");
+
+    /* Dense comb: one bar span reaches more teeth than the span stack
+     * holds (16 entries in the test build), so the fill re-sweeps */
+    memset(mask, 0, sizeof(mask));
+    for (int x = 0; x < IMG_WIDTH; x++)
+        put(x, 20);
+    for (int x = 0; x < IMG_WIDTH; x += 2)
+        for (int y = 21; y < 40 + (x % 7); y++)
+            put(x, y);
+    watershed_label_spans(mask, NULL, 4, &res);
+    check(res.total_regions == 1 && matches_reference(4) && matches_reference(8),
+          "span fill: dense comb overflows the stack");
+
+    test_flood();
+    test_select();
+    test_contour();
+
+    printf("\n==============================================\n");
+    printf(total_pass ? "  ALL TESTS PASSED\n" : "  SOME TESTS FAILED\n");
+    printf("==============================================\n");
+    return total_pass ? 0 : 1;
+}